@@ -1,11 +1,16 @@
 #pragma once
 
+#include <IIOScan.hpp>
+#include <PollScheduler.hpp>
 #include <Thresholds.hpp>
-#include <boost/asio/streambuf.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
 #include <gpiod.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sensor.hpp>
 
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <stdexcept>
@@ -58,6 +63,8 @@ class BridgeGpio
     gpiod::line line;
 };
 
+class ADCBufferedCapture;
+
 class ADCSensor : public Sensor, public std::enable_shared_from_this<ADCSensor>
 {
   public:
@@ -72,16 +79,85 @@ class ADCSensor : public Sensor, public std::enable_shared_from_this<ADCSensor>
     ~ADCSensor() override;
     void setupRead(void);
 
+    // Hands reading the sensor over to the buffered capture of its ADC, the
+    // sensor stops polling its hwmon input.
+    void useCapture(const std::shared_ptr<ADCBufferedCapture>& newCapture);
+    // publishes a reading of the channel, in millivolts
+    void updateMillivolts(double millivolts);
+    bool hasBridge(void) const
+    {
+        return bridgeGpio.has_value();
+    }
+    void setBridge(int value)
+    {
+        if (bridgeGpio.has_value())
+        {
+            (*bridgeGpio).set(value);
+        }
+    }
+
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
+    SysfsFile inputFile;
     boost::asio::deadline_timer waitTimer;
-    std::shared_ptr<boost::asio::streambuf> readBuf;
     std::string path;
     double scaleFactor;
     unsigned int sensorPollMs;
     std::optional<BridgeGpio> bridgeGpio;
     thresholds::ThresholdTimer thresholdTimer;
-    void handleResponse(const boost::system::error_code& err);
+    bool readQueued = false;
+    PollHandle pollHandle;
+    std::shared_ptr<ADCBufferedCapture> capture;
+    void readInput(void);
     void checkThresholds(void) override;
 };
+
+// Reads the channels of one IIO ADC together through the buffer of the
+// device, /dev/iio:deviceN, one scan per poll instead of a read of the hwmon
+// input of every channel. The device needs a trigger in current_trigger,
+// which the platform sets up. Bridge GPIOs are switched on once for the whole
+// scan.
+class ADCBufferedCapture :
+    public std::enable_shared_from_this<ADCBufferedCapture>
+{
+  public:
+    ADCBufferedCapture(boost::asio::io_service& io,
+                       const std::filesystem::path& device);
+    ~ADCBufferedCapture();
+
+    // The capture of the IIO device with the given name attribute, nullptr
+    // if there is none or it can't capture.
+    static std::shared_ptr<ADCBufferedCapture>
+        get(boost::asio::io_service& io, const std::string& name);
+
+    // false if the channel is not a scan element of the device
+    bool add(unsigned int channel, const std::shared_ptr<ADCSensor>& sensor,
+             unsigned int pollMs);
+
+  private:
+    struct Channel : iio::ScanElement
+    {
+        unsigned int channel = 0;
+        std::weak_ptr<ADCSensor> sensor;
+    };
+
+    bool readChannel(unsigned int channel, Channel& element);
+    bool configure(void);
+    void startScan(void);
+    void readScan(void);
+    void finishScan(bool success);
+
+    boost::asio::io_service& io;
+    std::filesystem::path device;
+    boost::asio::posix::stream_descriptor buffer;
+    boost::asio::deadline_timer bridgeTimer;
+    boost::asio::deadline_timer scanTimer;
+    std::vector<Channel> channels;
+    std::vector<uint8_t> scanData;
+    // the scan elements have to be set up again before the next scan
+    bool layoutChanged = true;
+    bool scanning = false;
+    size_t failedScans = 0;
+    unsigned int pollMs = 0;
+    PollHandle pollHandle;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <PollScheduler.hpp>
 #include <Thresholds.hpp>
 #include <Utils.hpp>
 #include <boost/asio/streambuf.hpp>
@@ -11,11 +12,53 @@
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
+class CPUSensor;
+
+// Reads the DIMM temperatures of one CPU in aggregate. The RdPkgConfig DDR
+// DIMM Temperature service returns every DIMM of a memory channel at once, so
+// a poll period takes one PECI transaction per channel instead of the hwmon
+// driver's one per DIMM. Only CPUs that report their DIMM temperatures
+// through that service may use it, which the configuration has to opt in to.
+class PeciBatch
+{
+  public:
+    PeciBatch(boost::asio::io_service& io, int bus, int addr);
+    ~PeciBatch();
+
+    PeciBatch(const PeciBatch&) = delete;
+    PeciBatch& operator=(const PeciBatch&) = delete;
+
+    // channel and DIMM index of a "DIMM A1" label of the dimmtemp driver
+    static std::optional<std::pair<uint8_t, uint8_t>>
+        parseDimmLabel(const std::string& label);
+
+    void add(CPUSensor* sensor, uint8_t channel, uint8_t dimm);
+    void remove(CPUSensor* sensor);
+
+  private:
+    struct Dimm
+    {
+        CPUSensor* sensor;
+        uint8_t channel;
+        uint8_t dimm;
+    };
+
+    void read(void);
+
+    int fd;
+    int addr;
+    // ordered by channel, the DIMMs of a channel share one read
+    std::vector<Dimm> dimms;
+    PollHandle pollHandle;
+};
+
 class CPUSensor : public Sensor
 {
   public:
@@ -32,25 +75,56 @@ class CPUSensor : public Sensor
     static constexpr size_t warnAfterErrorCount = 10;
     static constexpr const char* labelTcontrol = "Tcontrol";
 
+    // stops reading the hwmon attribute and takes the readings of the DIMM
+    // from the batch instead
+    void readThrough(const std::shared_ptr<PeciBatch>& peciBatch,
+                     uint8_t channel, uint8_t dimm);
+    // a batched reading in milli degrees, or nullopt if it failed
+    void batchReading(std::optional<int64_t> reading);
+
   private:
     sdbusplus::asio::object_server& objServer;
     boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
     boost::asio::streambuf readBuf;
     std::string nameTcontrol;
     std::string path;
     double privTcontrol;
     double dtsOffset;
     bool show;
-    size_t pollTime;
     bool loggedInterfaceDown = false;
     uint8_t minMaxReadCounter;
+    PollHandle pollHandle;
+    std::shared_ptr<PeciBatch> batch;
     void setupRead(void);
     void handleResponse(const boost::system::error_code& err);
+    void applyReading(int64_t reading);
     void checkThresholds(void) override;
     void updateMinMaxValues(void);
 };
 
+// The hottest DIMM of one CPU, published in place of the per DIMM sensors
+// that aren't created up front in the lazy mode.
+class DimmMaxSensor : public Sensor
+{
+  public:
+    DimmMaxSensor(const std::vector<std::string>& paths,
+                  const std::string& objectType,
+                  sdbusplus::asio::object_server& objectServer,
+                  std::shared_ptr<sdbusplus::asio::connection>& conn,
+                  boost::asio::io_service& io, const std::string& sensorName,
+                  std::vector<thresholds::Threshold>&& thresholds,
+                  const std::string& configuration);
+    ~DimmMaxSensor() override;
+
+  private:
+    sdbusplus::asio::object_server& objServer;
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<SysfsFile>> inputs;
+    PollHandle pollHandle;
+    void read(void);
+    void checkThresholds(void) override;
+};
+
 extern boost::container::flat_map<std::string, std::unique_ptr<CPUSensor>>
     gCpuSensors;
 
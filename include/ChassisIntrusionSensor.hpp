@@ -1,5 +1,6 @@
 #pragma once
 
+#include <SmbusExecutor.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
 #include <gpiod.hpp>
@@ -23,8 +24,10 @@ class ChassisIntrusionSensor
 
     ~ChassisIntrusionSensor();
 
+    // alertGpio names the line the PCH raises on intrusion, if there is one,
+    // the PCH is then read on its events instead of every second
     void start(IntrusionSensorType type, int busId, int slaveAddr,
-               bool gpioInverted);
+               bool gpioInverted, const std::string& alertGpio = "");
 
   private:
     std::shared_ptr<sdbusplus::asio::dbus_interface> mIface;
@@ -40,6 +43,10 @@ class ChassisIntrusionSensor
     int mBusId;
     int mSlaveAddr;
     boost::asio::deadline_timer mPollTimer;
+    SmbusExecutor& mSmbus;
+    std::string mAlertPinName;
+    gpiod::line mAlertLine;
+    boost::asio::posix::stream_descriptor mAlertFd;
 
     // valid if it is via GPIO
     bool mGpioInverted;
@@ -54,8 +61,12 @@ class ChassisIntrusionSensor
     bool mInitialized = false;
 
     void updateValue(const std::string& newValue);
-    int i2cReadFromPch(int busId, int slaveAddr);
+    int statusFromPch(int32_t statusValue);
     void pollSensorStatusByPch();
+    void readPch(bool pollAgain);
+    void initAlertGpio(const std::string& pinName);
+    void releaseAlertGpio();
+    void waitForAlert();
     void readGpio();
     void pollSensorStatusByGpio();
     void initGpioDeviceFile();
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/read.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Hands work finished on other threads back to the io thread. The daemons
+// are built without asio thread support, so instead of posting to the
+// io_service the workers queue the item and signal an eventfd, and the io
+// thread runs the handler for every item queued since the last wakeup.
+template <typename Item>
+class CompletionQueue
+{
+  public:
+    // called on the io thread for every item pushed
+    using Handler = std::function<void(Item&)>;
+
+    CompletionQueue(boost::asio::io_service& io, std::string name,
+                    Handler&& handler) :
+        name(std::move(name)),
+        handler(std::move(handler)), notifier(io)
+    {
+        int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (fd < 0)
+        {
+            return;
+        }
+        notifier.assign(fd);
+        waitForCompletions();
+    }
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    // false if the eventfd could not be created, nothing is handed back then
+    bool isOpen(void) const
+    {
+        return notifier.is_open();
+    }
+
+    // may be called from any thread
+    void push(Item&& item)
+    {
+        bool signal = false;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            // the io thread drains all of them, one wakeup is enough
+            signal = completed.empty();
+            completed.emplace_back(std::move(item));
+        }
+        if (signal)
+        {
+            uint64_t one = 1;
+            if (write(notifier.native_handle(), &one, sizeof(one)) < 0)
+            {
+                std::cerr << "Failed to signal " << name << " completion\n";
+            }
+        }
+    }
+
+  private:
+    void waitForCompletions(void)
+    {
+        boost::asio::async_read(
+            notifier,
+            boost::asio::buffer(&notifierValue, sizeof(notifierValue)),
+            [this](const boost::system::error_code& ec, std::size_t) {
+                if (ec == boost::asio::error::operation_aborted)
+                {
+                    return;
+                }
+                if (ec)
+                {
+                    std::cerr << name << " notifier error " << ec.message()
+                              << "\n";
+                }
+                complete();
+            });
+    }
+
+    void complete(void)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            completing.swap(completed);
+        }
+        waitForCompletions();
+        for (Item& item : completing)
+        {
+            handler(item);
+        }
+        completing.clear();
+    }
+
+    std::string name;
+    Handler handler;
+    boost::asio::posix::stream_descriptor notifier;
+    uint64_t notifierValue = 0;
+    std::mutex lock;
+    std::vector<Item> completed;
+    // reused between completions so handing back results doesn't allocate
+    std::vector<Item> completing;
+};
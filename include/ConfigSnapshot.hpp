@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Utils.hpp>
+#include <boost/container/flat_set.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Keeps the last configuration a daemon got from Entity Manager on disk, so
+// that sensors can be created from it right after boot instead of waiting for
+// Entity Manager to settle. The live configuration is reconciled against the
+// snapshot once it arrives.
+//
+// Snapshots are keyed by a hash of the configuration interfaces the daemon
+// asks for and of the configuration Entity Manager keeps on disk, jsonStore.
+// A snapshot written for other interfaces, or before Entity Manager last
+// stored a different configuration, is ignored. Nothing is read or written
+// unless the config-cache option is enabled. Only hwmontempsensor uses it so
+// far.
+class ConfigSnapshot
+{
+  public:
+    ConfigSnapshot(const std::string& daemonName,
+                   const std::vector<std::string>& interfaces);
+
+    // fills config with the snapshot on disk, false if there is no usable one
+    bool load(ManagedObjectType& config);
+
+    // Records the live configuration, changed receives the object paths that
+    // were added, modified or removed since the last load or update. The
+    // snapshot is only rewritten when its contents differ.
+    void update(const ManagedObjectType& config,
+                boost::container::flat_set<std::string>& changed);
+
+  private:
+    // the key for the configuration Entity Manager has stored right now
+    uint64_t currentKey(void) const;
+
+    std::filesystem::path path;
+    uint64_t interfacesKey;
+    // key of the snapshot on disk, 0 if there is none
+    uint64_t storedKey = 0;
+    ManagedObjectType current;
+};
+
+// the configuration part of a snapshot file, after its header
+namespace config_snapshot
+{
+std::string serialize(const ManagedObjectType& config);
+// false unless in holds exactly one well formed configuration
+bool deserialize(std::string_view in, ManagedObjectType& config);
+} // namespace config_snapshot
@@ -1,14 +1,20 @@
 #pragma once
+#include <boost/asio/steady_timer.hpp>
 #include <boost/container/flat_map.hpp>
 #include <sdbusplus/bus/match.hpp>
 #include <sensor.hpp>
 
 #include <chrono>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
+// called with the new Value of a sensor and the PropertiesChanged carrying it
+using SensorValueCallback =
+    std::function<void(double, sdbusplus::message::message&)>;
+
 struct ExitAirTempSensor;
 struct CFMSensor : public Sensor, std::enable_shared_from_this<CFMSensor>
 {
@@ -30,17 +36,27 @@ struct CFMSensor : public Sensor, std::enable_shared_from_this<CFMSensor>
 
     bool calculate(double&);
     void updateReading(void);
+    // recomputes once for all the tach changes within updateDelayMs
+    void scheduleUpdate(void);
     void setupMatches(void);
     void createMaxCFMIface(void);
-    void addTachRanges(const std::string& serviceName, const std::string& path);
+    void addTachRanges(const std::string& serviceName, const std::string& path,
+                       const std::string& tachName);
     void checkThresholds(void) override;
     uint64_t getMaxRpm(uint64_t cfmMax);
 
+    static constexpr unsigned int updateDelayMs = 100;
+
   private:
+    boost::asio::steady_timer updateTimer;
+    bool updatePending = false;
     std::vector<sdbusplus::bus::match::match> matches;
+    std::vector<std::shared_ptr<SensorValueCallback>> valueSubscriptions;
+    // by tach name, as listed in tachs
     boost::container::flat_map<std::string, double> tachReadings;
     boost::container::flat_map<std::string, std::pair<double, double>>
         tachRanges;
+    double ciAt(double percent) const;
     std::shared_ptr<sdbusplus::asio::dbus_interface> pwmLimitIface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> cfmLimitIface;
     sdbusplus::asio::object_server& objServer;
@@ -68,12 +84,17 @@ struct ExitAirTempSensor :
 
     void checkThresholds(void) override;
     void updateReading(void);
+    // recomputes once for all the input changes within
+    // CFMSensor::updateDelayMs
+    void scheduleUpdate(void);
     void setupMatches(void);
 
   private:
     double lastReading;
+    boost::asio::steady_timer updateTimer;
+    bool updatePending = false;
 
-    std::vector<sdbusplus::bus::match::match> matches;
+    std::vector<std::shared_ptr<SensorValueCallback>> valueSubscriptions;
     double inletTemp = std::numeric_limits<double>::quiet_NaN();
     boost::container::flat_map<std::string, double> powerReadings;
 
@@ -43,6 +43,11 @@ class ExternalSensor :
     // Marks sensor as timed out, replacing Value with floating-point "NaN"
     void writeInvalidate(void);
 
+    // Applies a value as an external write of Value would, as of writtenAt,
+    // but leaves calling the write hook to the caller
+    void ingest(double newValue,
+                const std::chrono::steady_clock::time_point& writtenAt);
+
     // Returns amount of time elapsed since last writeBegin() happened
     std::chrono::steady_clock::duration
         ageElapsed(const std::chrono::steady_clock::time_point& now) const;
@@ -51,6 +56,10 @@ class ExternalSensor :
     std::chrono::steady_clock::duration
         ageRemaining(const std::chrono::steady_clock::time_point& now) const;
 
+    // Set while the sensor has an entry in the expiry queue of
+    // ExternalSensorMain, that entry is rechecked when it comes due
+    bool expiryQueued = false;
+
   private:
     sdbusplus::asio::object_server& objServer;
 
@@ -58,6 +67,8 @@ class ExternalSensor :
     std::chrono::steady_clock::duration writeTimeout;
     bool writeAlive;
     bool writePerishable;
+    // set while ingest() goes through setSensorValue()
+    bool ingesting = false;
     std::function<void(const std::chrono::steady_clock::time_point& now)>
         writeHook;
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+// hwmon attribute file names follow the <type><channel>_<item> pattern of
+// Documentation/hwmon/sysfs-interface, e.g. temp1_input or curr2_max. The
+// helpers below match those names by hand, discovery runs over every file of
+// every hwmon device and std::regex is far too slow for that on the BMC.
+
+struct HwmonAttribute
+{
+    // alphabetic prefix, e.g. temp
+    std::string_view type;
+    // channel number as written in the file name, e.g. 1
+    std::string_view channel;
+    // everything after the underscore, e.g. input, empty for pwm1 and alike
+    std::string_view item;
+
+    constexpr size_t getChannel(void) const
+    {
+        size_t value = 0;
+        for (char c : channel)
+        {
+            value = value * 10 + static_cast<size_t>(c - '0');
+        }
+        return value;
+    }
+};
+
+constexpr bool isAlpha(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+constexpr bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+constexpr std::optional<HwmonAttribute>
+    splitHwmonAttribute(std::string_view fileName)
+{
+    size_t typeEnd = 0;
+    while (typeEnd < fileName.size() && isAlpha(fileName[typeEnd]))
+    {
+        typeEnd++;
+    }
+    size_t channelEnd = typeEnd;
+    while (channelEnd < fileName.size() && isDigit(fileName[channelEnd]))
+    {
+        channelEnd++;
+    }
+    if (typeEnd == 0 || channelEnd == typeEnd)
+    {
+        return std::nullopt;
+    }
+    HwmonAttribute attribute{fileName.substr(0, typeEnd),
+                             fileName.substr(typeEnd, channelEnd - typeEnd),
+                             std::string_view()};
+    if (channelEnd == fileName.size())
+    {
+        return attribute;
+    }
+    if (fileName[channelEnd] != '_' || channelEnd + 1 == fileName.size())
+    {
+        return std::nullopt;
+    }
+    attribute.item = fileName.substr(channelEnd + 1);
+    return attribute;
+}
+
+// true if word is one of the '|' separated alternatives, an empty list
+// accepts any word
+constexpr bool matchesAlternative(std::string_view alternatives,
+                                  std::string_view word)
+{
+    if (alternatives.empty())
+    {
+        return true;
+    }
+    size_t start = 0;
+    while (start <= alternatives.size())
+    {
+        size_t end = alternatives.find('|', start);
+        if (end == std::string_view::npos)
+        {
+            end = alternatives.size();
+        }
+        if (alternatives.substr(start, end - start) == word)
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// Matches hwmon attribute file names by type and item, so
+// HwmonAttributeMatch{"temp|power", "input"} is the equivalent of the
+// (temp|power)\d+_input$ regex.
+struct HwmonAttributeMatch
+{
+    std::string_view types;
+    std::string_view items;
+
+    constexpr bool operator()(std::string_view fileName) const
+    {
+        auto attribute = splitHwmonAttribute(fileName);
+        return attribute && matchesAlternative(types, attribute->type) &&
+               matchesAlternative(items, attribute->item);
+    }
+};
+
+static_assert(HwmonAttributeMatch{"temp", "input"}("temp12_input"));
+static_assert(!HwmonAttributeMatch{"temp", "input"}("temp_input"));
+static_assert(!HwmonAttributeMatch{"temp", "input"}("temp1_label"));
+static_assert(HwmonAttributeMatch{"", "max"}("curr3_max"));
+static_assert(HwmonAttributeMatch{"pwm", ""}("pwm1"));
+static_assert(!HwmonAttributeMatch{"pwm", "input"}("pwm1"));
+static_assert(splitHwmonAttribute("in10_input")->getChannel() == 10);
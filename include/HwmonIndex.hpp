@@ -0,0 +1,93 @@
+#pragma once
+
+#include <HwmonAttribute.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr const char* defaultHwmonRoot = "/sys/class/hwmon";
+
+// The hwmon class directory the daemons scan. SENSOR_HWMON_ROOT in the
+// environment replaces /sys/class/hwmon, e.g. with a fake tree for testing.
+const std::filesystem::path& hwmonRoot(void);
+
+// Cached view of one /sys/class/hwmon/hwmonN directory
+struct HwmonDevice
+{
+    // the hwmonN directory below hwmonRoot()
+    std::filesystem::path directory;
+    // canonical path of the parent device, empty for virtual hwmon devices
+    std::filesystem::path devicePath;
+    // contents of the name attribute
+    std::string name;
+    // file names of all the attributes in the directory, sorted
+    std::vector<std::string> attributes;
+    // contents of the *_label attributes keyed by their prefix, e.g. temp1
+    boost::container::flat_map<std::string, std::string> labels;
+
+    std::optional<std::string> getLabel(const std::string& prefix) const;
+
+    // appends the paths of the attributes accepted by match
+    bool findFiles(const HwmonAttributeMatch& match,
+                   std::vector<std::filesystem::path>& foundPaths) const;
+};
+
+// Index of the hwmon class devices. It is built on first use and then kept
+// current from kernel uevents, so that a rescan doesn't walk sysfs and reread
+// every name and label file again. Should the uevent socket be unavailable,
+// or hwmonRoot() not be the kernel's, the index is rebuilt on every
+// findFiles() / getDevices() instead.
+class HwmonIndex
+{
+  public:
+    explicit HwmonIndex(boost::asio::io_service& io);
+
+    // one per io_service, destroyed with it
+    static HwmonIndex& getInstance(boost::asio::io_service& io);
+
+    const boost::container::flat_map<std::string, HwmonDevice>& getDevices();
+
+    // looks up a device by any path to its hwmonN directory, this includes
+    // the paths below /sys/bus and /sys/devices
+    const HwmonDevice* find(const std::filesystem::path& directory);
+
+    // appends the paths of the attributes of all devices accepted by match,
+    // false if there is no hwmon class at all
+    bool findFiles(const HwmonAttributeMatch& match,
+                   std::vector<std::filesystem::path>& foundPaths);
+
+    // Registers a callback that runs for every hwmon device added while the
+    // index follows uevents, with the device already indexed. The callback
+    // is dropped along with the returned subscription.
+    using DeviceCallback = std::function<void(const HwmonDevice&)>;
+    std::shared_ptr<DeviceCallback> subscribeAdded(DeviceCallback&& callback);
+
+    // whether devices are seen as they come, see subscribeAdded()
+    bool isMonitored(void) const
+    {
+        return monitored;
+    }
+
+  private:
+    void refresh(void);
+    void scan(const std::string& hwmonName);
+    void readEvents(void);
+    void handleEvent(std::string_view event);
+
+    boost::asio::posix::stream_descriptor uevents;
+    // the kernel limits a uevent to 2 KiB of environment
+    std::array<char, 4096> eventBuffer;
+    boost::container::flat_map<std::string, HwmonDevice> devices;
+    std::vector<std::weak_ptr<DeviceCallback>> addedSubscribers;
+    bool monitored = false;
+    bool populated = false;
+};
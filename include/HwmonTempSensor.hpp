@@ -1,10 +1,12 @@
 #pragma once
 
+#include <PollScheduler.hpp>
+#include <SysfsReadPool.hpp>
 #include <Thresholds.hpp>
-#include <boost/asio/streambuf.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sensor.hpp>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -26,12 +28,13 @@ class HwmonTempSensor :
 
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    std::shared_ptr<SysfsFile> inputFile;
+    SysfsReadPool* readPool;
+    bool readQueued = false;
     std::string path;
     unsigned int sensorPollMs;
+    PollHandle pollHandle;
 
-    void handleResponse(const boost::system::error_code& err);
+    void handleResponse(int64_t reading, int error);
     void checkThresholds(void) override;
 };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+// Shared state of one I2C bus, /run/i2c-arbiter/bus-<N>, mapped by every
+// daemon that goes through the I2CArbiter for the bus. The file lock of the
+// file is what the daemons take for each transaction. This part only needs
+// the standard library, so tools reading the statistics can include it on
+// their own and map the file read only.
+namespace i2c_arbiter
+{
+
+constexpr const char* directory = "/run/i2c-arbiter";
+constexpr uint32_t magic = 0x42433249; // "I2CB"
+// bump whenever BusState changes
+constexpr uint32_t version = 1;
+
+struct BusState
+{
+    uint32_t magic;
+    uint32_t version;
+    // transactions waiting for or holding the bus right now, across daemons
+    std::atomic<uint32_t> queueDepth;
+    std::atomic<uint32_t> peakQueueDepth;
+    // CLOCK_MONOTONIC nanoseconds the statistics are counted from
+    int64_t createdNs;
+    // only written with the bus locked
+    std::atomic<int64_t> lastEndNs;
+    std::atomic<uint64_t> busyNs;
+    std::atomic<uint64_t> transactions;
+    std::atomic<uint64_t> waitNs;
+    uint64_t reserved;
+};
+static_assert(sizeof(BusState) == 64, "BusState layout changed");
+// the atomics are shared with other processes through the mapping, which only
+// works for atomics that don't fall back to a lock of their own
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<int64_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// fraction of the time since createdNs the bus was held, from 0 to 1
+inline double utilization(const BusState& state, int64_t nowNs)
+{
+    int64_t elapsed = nowNs - state.createdNs;
+    if (elapsed <= 0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(state.busyNs.load(std::memory_order_relaxed)) /
+           static_cast<double>(elapsed);
+}
+
+} // namespace i2c_arbiter
+
+// Orders the transactions on a bus across the sensor daemons and keeps a
+// minimum idle gap between them, so that the daemons and the devices on the
+// bus don't see back to back transfers from several masters at once. A bus
+// whose state can't be set up, e.g. without /run, is used unarbitrated.
+class I2CArbiter
+{
+  public:
+    static constexpr std::chrono::microseconds defaultMinimumGap{100};
+
+    static I2CArbiter& getInstance(void);
+
+    // Runs transfer with the bus held and returns its result. Blocks for as
+    // long as other transactions on the bus are ahead, call it from a thread
+    // that may block on the bus anyway.
+    int32_t transact(int busId, const std::function<int32_t()>& transfer);
+
+    // Runs transfer like transact() if the bus is free and its minimum gap
+    // has passed, otherwise returns std::nullopt without waiting and sets
+    // retryAfter to when it is worth trying again. For the io thread, which
+    // must not block behind the transactions of other daemons. The time
+    // between attempts is not counted as waiting in the statistics.
+    std::optional<int32_t> tryTransact(int busId,
+                                       const std::function<int32_t()>& transfer,
+                                       std::chrono::nanoseconds& retryAfter);
+
+    void setMinimumGap(int busId, std::chrono::microseconds gap);
+
+    // nullptr if the state of the bus could not be set up
+    const i2c_arbiter::BusState* state(int busId);
+
+  private:
+    struct Bus
+    {
+        ~Bus();
+
+        int fd = -1;
+        i2c_arbiter::BusState* state = nullptr;
+        std::chrono::nanoseconds minimumGap = defaultMinimumGap;
+        // the file lock only excludes other daemons, not other threads
+        std::mutex lock;
+    };
+
+    I2CArbiter() = default;
+    Bus& getBus(int busId);
+    static void open(int busId, Bus& bus);
+    // runs transfer with the file lock of the bus held and releases it
+    static int32_t run(Bus& bus, int64_t requested, int64_t start,
+                       const std::function<int32_t()>& transfer);
+
+    std::mutex busesLock;
+    std::map<int, std::unique_ptr<Bus>> buses;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout and decoding of the scans an IIO device writes to its buffer, see
+// Documentation/iio/iio_devbuf.rst of the kernel. Kept apart from the
+// capture so it can be tested without a device.
+namespace iio
+{
+
+struct ScanElement
+{
+    unsigned int scanIndex = 0;
+    // of the element within a scan, set by layoutScan()
+    size_t offset = 0;
+    unsigned int storageBytes = 0;
+    unsigned int bits = 0;
+    unsigned int shift = 0;
+    bool isSigned = false;
+    bool bigEndian = false;
+    double scale = 1.0;
+    double rawOffset = 0.0;
+};
+
+// Sets the storage fields of element from the type attribute of a scan
+// element, e.g. le:u12/16>>0. False if the type is malformed or not one we
+// can decode.
+bool parseScanType(const std::string& type, ScanElement& element);
+
+// Puts the elements in the order of their index, each aligned to its size,
+// and returns the size of a scan, padded to the largest element.
+template <typename Element>
+size_t layoutScan(std::vector<Element>& elements)
+{
+    std::sort(elements.begin(), elements.end(),
+              [](const ScanElement& left, const ScanElement& right) {
+                  return left.scanIndex < right.scanIndex;
+              });
+    size_t size = 0;
+    size_t alignment = 1;
+    for (ScanElement& element : elements)
+    {
+        size_t bytes = element.storageBytes;
+        size = (size + bytes - 1) / bytes * bytes;
+        element.offset = size;
+        size += bytes;
+        alignment = std::max(alignment, bytes);
+    }
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// The scaled value of element in scan, in the unit of the channel, for
+// voltages millivolts.
+double decode(const ScanElement& element, const uint8_t* scan);
+
+} // namespace iio
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// An immutable string that shares its storage with every other interned
+// string of the same contents, for the configuration paths and object types
+// that hundreds of sensors of a daemon hold copies of. The storage goes away
+// with the last string holding it. Interning is done on the io thread only.
+class InternedString
+{
+  public:
+    InternedString() : InternedString(std::string_view())
+    {}
+    explicit InternedString(std::string_view contents);
+
+    const std::string& str(void) const
+    {
+        return *storage;
+    }
+    operator const std::string&() const
+    {
+        return *storage;
+    }
+    bool empty(void) const
+    {
+        return storage->empty();
+    }
+    const char* c_str(void) const
+    {
+        return storage->c_str();
+    }
+
+    // equal contents always share the storage
+    bool operator==(const InternedString& other) const
+    {
+        return storage == other.storage;
+    }
+    bool operator!=(const InternedString& other) const
+    {
+        return storage != other.storage;
+    }
+
+    // number of distinct strings interned right now
+    static size_t poolSize(void);
+
+  private:
+    std::shared_ptr<const std::string> storage;
+};
+
+inline std::ostream& operator<<(std::ostream& stream,
+                                const InternedString& string)
+{
+    return stream << string.str();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+
+#include <memory>
+
+// Holds the object a singleton keeps per io_service. A function-local static
+// would be destroyed after main() returned, after the io_service its timers,
+// descriptors and handlers belong to. This one is registered as a service of
+// the io_service and released while the io_service shuts down, before any of
+// its services is destroyed.
+template <typename T>
+class IoSingleton : public boost::asio::io_service::service
+{
+  public:
+    static boost::asio::io_service::id id;
+
+    explicit IoSingleton(boost::asio::io_service& io) : service(io)
+    {}
+
+    // empty until the singleton creates its object
+    static std::unique_ptr<T>& get(boost::asio::io_service& io)
+    {
+        return boost::asio::use_service<IoSingleton>(io).object;
+    }
+
+  private:
+    void shutdown() override
+    {
+        object = nullptr;
+    }
+
+    std::unique_ptr<T> object;
+};
+
+template <typename T>
+boost::asio::io_service::id IoSingleton<T>::id;
@@ -8,6 +8,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 
 enum class IpmbType
@@ -37,6 +38,15 @@ enum class ReadingFormat
     linearElevenBit
 };
 
+// order in which queued reads are sent while the IPMB link is busy
+enum class IpmbPriority
+{
+    high,
+    normal,
+    low
+};
+constexpr size_t ipmbPriorityCount = 3;
+
 namespace ipmi
 {
 namespace sensor
@@ -73,6 +83,11 @@ constexpr uint8_t sendRawPmbus = 0xd9;
 } // namespace me_bridge
 } // namespace ipmi
 
+using IpmbMethodType =
+    std::tuple<int, uint8_t, uint8_t, uint8_t, uint8_t, std::vector<uint8_t>>;
+
+class IpmbBus;
+
 struct IpmbSensor : public Sensor
 {
     IpmbSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
@@ -85,8 +100,10 @@ struct IpmbSensor : public Sensor
     ~IpmbSensor() override;
 
     void checkThresholds(void) override;
-    void read(void);
     void init(void);
+    // called by the IpmbBus with the response to the read request
+    void handleResponse(const boost::system::error_code& ec,
+                        const IpmbMethodType& response);
     std::string getSubTypeUnits(void);
     void loadDefaults(void);
     void runInitCmd(void);
@@ -107,8 +124,13 @@ struct IpmbSensor : public Sensor
     std::vector<uint8_t> initData;
 
     ReadingFormat readingFormat;
+    // PollRate and Priority of the configuration
+    std::chrono::milliseconds pollInterval{1000};
+    IpmbPriority priority = IpmbPriority::normal;
 
   private:
     sdbusplus::asio::object_server& objectServer;
-    boost::asio::deadline_timer waitTimer;
+    boost::asio::io_service& io;
+    // the bus sending the read requests, set once init() registered us
+    IpmbBus* bus = nullptr;
 };
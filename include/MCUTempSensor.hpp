@@ -1,4 +1,6 @@
 #pragma once
+
+#include <SmbusExecutor.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/container/flat_map.hpp>
 #include <sensor.hpp>
@@ -9,7 +11,9 @@
 #include <string>
 #include <vector>
 
-struct MCUTempSensor : public Sensor
+struct MCUTempSensor :
+    public Sensor,
+    public std::enable_shared_from_this<MCUTempSensor>
 {
     MCUTempSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
                   boost::asio::io_service& io, const std::string& name,
@@ -28,7 +32,9 @@ struct MCUTempSensor : public Sensor
     uint8_t tempReg;
 
   private:
-    int getMCURegsInfoWord(uint8_t regs, int16_t* pu16data);
+    void handleResponse(int32_t result);
+
     sdbusplus::asio::object_server& objectServer;
     boost::asio::deadline_timer waitTimer;
+    SmbusExecutor& smbus;
 };
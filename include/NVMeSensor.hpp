@@ -8,6 +8,11 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <sensor.hpp>
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
 class NVMeSensor : public Sensor
 {
   public:
@@ -22,13 +27,37 @@ class NVMeSensor : public Sensor
     NVMeSensor& operator=(const NVMeSensor& other) = delete;
 
     int bus;
+    // health status polls in a row without a response, and the sweeps this
+    // drive sits out before it is tried again
+    unsigned int missedResponses = 0;
+    unsigned int skipSweeps = 0;
+    // poll a steady drive less often and one near a threshold more often,
+    // see idleSweeps()
+    bool adaptive = false;
+    bool nearThreshold = false;
+
+    // keeps the health status poll response for GetHealthStatus
+    void cacheHealthStatus(const uint8_t* data, size_t len);
+    // sweeps to sit out after reading value, while the temperature holds
+    // steady and is clear of the thresholds, also tells whether it is near
+    // one of them
+    unsigned int idleSweeps(double reading);
 
   private:
     sdbusplus::asio::object_server& objServer;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> healthInterface;
+    std::vector<uint8_t> healthStatus;
+    std::chrono::steady_clock::time_point healthStatusTime;
+    unsigned int steadyReads = 0;
 
     void checkThresholds(void) override;
 };
 
+namespace nvmeMCTP
+{
+struct Binding;
+}
+
 struct NVMeContext : std::enable_shared_from_this<NVMeContext>
 {
     NVMeContext(boost::asio::io_service& io, int rootBus);
@@ -37,21 +66,39 @@ struct NVMeContext : std::enable_shared_from_this<NVMeContext>
 
     void pollNVMeDevices();
     void close();
+    // called by the MCTP binding of the root bus for every message received
+    void processResponse(uint8_t eid, void* msg, size_t len);
 
-    boost::asio::deadline_timer scanTimer;
     int rootBus; // Root bus for this drive
+    nvmeMCTP::Binding& binding;
+    boost::asio::deadline_timer scanTimer;
     boost::asio::deadline_timer mctpResponseTimer;
+    // retries a request while other daemons hold the bus
+    boost::asio::deadline_timer arbiterRetryTimer;
     boost::asio::ip::tcp::socket nvmeSlaveSocket;
-    std::list<std::shared_ptr<NVMeSensor>> sensors; // used as a poll queue
+    std::vector<std::shared_ptr<NVMeSensor>> sensors;
+
+  private:
+    void scheduleSweep();
+    void startSweep();
+    void pollNext();
+    void sendRequest();
+    void responseTimedOut();
+    void waitForResponses();
+
+    // start of the last sweep of all drives, and whether the one running
+    // or scheduled is the one half way to the next
+    boost::posix_time::ptime sweepStart;
+    bool nearThresholdSweep = false;
+    // drives still to be polled in this sweep, last one first
+    std::vector<std::shared_ptr<NVMeSensor>> sweep;
+    // the drive whose response we are waiting for
+    std::shared_ptr<NVMeSensor> polling;
+    unsigned int requestSequence = 0;
 };
 
 using NVMEMap = boost::container::flat_map<int, std::shared_ptr<NVMeContext>>;
 
 int verifyIntegrity(uint8_t* msg, size_t len);
 
-namespace nvmeMCTP
-{
-void init(void);
-}
-
 NVMEMap& getNVMEMap(void);
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <PollScheduler.hpp>
+#include <SysfsNotifier.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/streambuf.hpp>
@@ -45,10 +47,30 @@ class PSUSubEvent : public std::enable_shared_from_this<PSUSubEvent>
     std::shared_ptr<std::set<std::string>> combineEvent;
     std::shared_ptr<bool> assertState;
     void setupRead(void);
+    // Reads the attribute once, without arming a timer of its own, for
+    // events polled in a batch by their PSUCombineEvent.
+    void poll(void);
+    // Called when the driver notified a change of the attribute. From then
+    // on it is trusted to do so and the attribute is only polled at
+    // notifiedPollMs, to catch a notification that was missed.
+    void notify(void);
+
+    const std::string& getPath(void) const
+    {
+        return path;
+    }
+    bool isNotified(void) const
+    {
+        return notified;
+    }
+
+    static constexpr unsigned int eventPollMs = 1000;
+    static constexpr unsigned int notifiedPollMs = 10000;
 
   private:
     int value = 0;
     int fd;
+    bool notified = false;
     size_t errCount;
     std::string path;
     std::string eventName;
@@ -56,11 +78,11 @@ class PSUSubEvent : public std::enable_shared_from_this<PSUSubEvent>
     boost::asio::deadline_timer waitTimer;
     std::shared_ptr<boost::asio::streambuf> readBuf;
     void handleResponse(const boost::system::error_code& err);
+    void handleReading(bool valid, int newValue);
     void updateValue(const int& newValue);
     void beep(const uint8_t& beepPriority);
     static constexpr uint8_t beepPSUFailure = 2;
     boost::asio::posix::stream_descriptor inputDev;
-    static constexpr unsigned int eventPollMs = 1000;
     static constexpr size_t warnAfterErrorCount = 10;
     std::string psuName;
     std::string groupEventName;
@@ -83,7 +105,7 @@ class PSUCombineEvent
             std::string,
             boost::container::flat_map<std::string, std::vector<std::string>>>&
             groupEventPathList,
-        const std::string& combineEventName);
+        const std::string& combineEventName, bool batchEvents = false);
     ~PSUCombineEvent();
 
     sdbusplus::asio::object_server& objServer;
@@ -93,4 +115,17 @@ class PSUCombineEvent
         events;
     std::vector<std::shared_ptr<std::set<std::string>>> asserts;
     std::vector<std::shared_ptr<bool>> states;
+
+  private:
+    void pollEvents(void);
+    void handleNotification(const std::string& path);
+
+    // pmbus drivers with an interrupt signal the alarm attributes on faults,
+    // the sub events of those are read as soon as that happens
+    SysfsNotifier notifier;
+    size_t pollTicks = 0;
+
+    // Set when the sub events are read together, in the poll bucket the
+    // sensors of the PSU are read in, instead of each on a timer of its own.
+    PollHandle pollHandle;
 };
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <PollScheduler.hpp>
+#include <ProbePool.hpp>
 #include <PwmSensor.hpp>
+#include <SysfsReadPool.hpp>
 #include <Thresholds.hpp>
-#include <boost/asio/streambuf.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sensor.hpp>
 
@@ -23,22 +25,25 @@ class PSUSensor : public Sensor, public std::enable_shared_from_this<PSUSensor>
               double min, const std::string& label, size_t tSize);
     ~PSUSensor() override;
     void setupRead(void);
+    // takes the first reading from a probe snapshot instead of sysfs, false
+    // if the snapshot doesn't hold the input of this sensor
+    bool readSnapshot(const SysfsSnapshot& snapshot);
 
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    std::shared_ptr<boost::asio::streambuf> readBuf;
+    std::shared_ptr<SysfsFile> inputFile;
+    SysfsReadPool* readPool;
+    bool readQueued = false;
     std::string path;
     std::string pathRatedMax;
     std::string pathRatedMin;
     unsigned int sensorFactor;
     uint8_t minMaxReadCounter;
-    void handleResponse(const boost::system::error_code& err);
+    PollHandle pollHandle;
+    void handleResponse(int64_t reading, int error);
     void checkThresholds(void) override;
     void updateMinMaxValues(void);
 
-    int fd;
     static constexpr unsigned int sensorPollMs = 1000;
     static constexpr size_t warnAfterErrorCount = 10;
 };
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A poller registered with the PollScheduler, the callback is invoked once
+// per tick of the rate bucket it belongs to while active is set.
+struct PollEntry
+{
+    explicit PollEntry(std::function<void()>&& callback) :
+        callback(std::move(callback))
+    {}
+
+    std::function<void()> callback;
+    bool active = true;
+};
+
+// Groups pollers by their poll interval, so that every poller sharing an
+// interval is woken up by one timer instead of having a timer of its own.
+class PollScheduler
+{
+  public:
+    explicit PollScheduler(boost::asio::io_service& io) : io(io)
+    {}
+
+    // one per io_service, destroyed with it
+    static PollScheduler& getInstance(boost::asio::io_service& io);
+
+    void add(unsigned int intervalMs, const std::shared_ptr<PollEntry>& entry);
+    void remove(unsigned int intervalMs,
+                const std::shared_ptr<PollEntry>& entry);
+
+  private:
+    struct Bucket
+    {
+        Bucket(boost::asio::io_service& io, unsigned int intervalMs) :
+            timer(io), interval(intervalMs)
+        {}
+
+        boost::asio::steady_timer timer;
+        std::chrono::milliseconds interval;
+        std::vector<std::shared_ptr<PollEntry>> entries;
+        // reused between ticks so firing a bucket doesn't allocate
+        std::vector<std::shared_ptr<PollEntry>> firing;
+        bool inTick = false;
+    };
+
+    void arm(unsigned int intervalMs, Bucket& bucket);
+    void tick(unsigned int intervalMs);
+
+    boost::asio::io_service& io;
+    boost::container::flat_map<unsigned int, std::unique_ptr<Bucket>> buckets;
+};
+
+// Membership of one sensor in the PollScheduler. The registration is dropped
+// when the handle is reset or destroyed, so the callback may safely capture
+// the owner of the handle.
+class PollHandle
+{
+  public:
+    PollHandle() = default;
+    PollHandle(boost::asio::io_service& io, unsigned int intervalMs,
+               std::function<void()>&& callback)
+    {
+        start(io, intervalMs, std::move(callback));
+    }
+    ~PollHandle()
+    {
+        reset();
+    }
+
+    PollHandle(const PollHandle&) = delete;
+    PollHandle& operator=(const PollHandle&) = delete;
+
+    void start(boost::asio::io_service& io, unsigned int intervalMs,
+               std::function<void()>&& callback)
+    {
+        reset();
+        scheduler = &PollScheduler::getInstance(io);
+        interval = intervalMs;
+        entry = std::make_shared<PollEntry>(std::move(callback));
+        if (!paused)
+        {
+            scheduler->add(interval, entry);
+        }
+    }
+
+    // moves the poller to another rate bucket, used by sensors that slow
+    // down their polling while in an error state
+    void setInterval(unsigned int intervalMs)
+    {
+        if (!entry || intervalMs == interval)
+        {
+            return;
+        }
+        if (paused)
+        {
+            interval = intervalMs;
+            return;
+        }
+        scheduler->remove(interval, entry);
+        interval = intervalMs;
+        scheduler->add(interval, entry);
+    }
+
+    // Takes the poller out of its rate bucket until it is resumed, a bucket
+    // left without pollers stops its timer. Also applies to a poller that is
+    // started while paused.
+    void setPaused(bool pause)
+    {
+        if (pause == paused)
+        {
+            return;
+        }
+        paused = pause;
+        if (!entry)
+        {
+            return;
+        }
+        if (paused)
+        {
+            scheduler->remove(interval, entry);
+        }
+        else
+        {
+            scheduler->add(interval, entry);
+        }
+    }
+
+    void reset()
+    {
+        if (entry)
+        {
+            if (!paused)
+            {
+                scheduler->remove(interval, entry);
+            }
+            entry = nullptr;
+        }
+    }
+
+    bool active() const
+    {
+        return entry != nullptr;
+    }
+
+    unsigned int getInterval() const
+    {
+        return interval;
+    }
+
+  private:
+    PollScheduler* scheduler = nullptr;
+    unsigned int interval = 0;
+    bool paused = false;
+    std::shared_ptr<PollEntry> entry;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Raw sysfs readings taken by probe jobs, keyed by attribute path
+using SysfsSnapshot = boost::container::flat_map<std::string, int64_t>;
+
+// Runs blocking sysfs probing off the io thread, so that slow devices (a
+// PMBus read is an I2C transaction) are read in parallel at startup. Jobs run
+// on worker threads and must only do file I/O on data they own, they may not
+// touch asio or D-Bus since the daemons are built without asio thread
+// support. The completion handler of a batch runs on the io thread once all
+// of its jobs have finished.
+class ProbePool
+{
+  public:
+    ProbePool(boost::asio::io_service& io, size_t maxWorkers);
+    ~ProbePool();
+
+    ProbePool(const ProbePool&) = delete;
+    ProbePool& operator=(const ProbePool&) = delete;
+
+    void run(std::vector<std::function<void()>>&& jobs,
+             std::function<void()>&& done);
+
+    // reads every path into the snapshot, skipping the unreadable ones
+    static void readAll(const std::vector<std::string>& paths,
+                        SysfsSnapshot& snapshot);
+
+  private:
+    using Jobs = std::vector<std::function<void()>>;
+
+    struct Batch
+    {
+        // the workers hold their own reference, they don't touch batches
+        std::shared_ptr<const Jobs> jobs;
+        std::function<void()> done;
+    };
+
+    void start(void);
+    void work(const Jobs& jobs);
+    void waitForWorkers(void);
+    void finish(void);
+
+    boost::asio::posix::stream_descriptor notifier;
+    uint64_t notifierValue = 0;
+    size_t maxWorkers;
+    std::deque<Batch> batches;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextJob = 0;
+    std::atomic<size_t> runningWorkers = 0;
+};
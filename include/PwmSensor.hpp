@@ -1,9 +1,13 @@
 #pragma once
 
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sensor.hpp>
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 
 class PwmSensor
@@ -11,6 +15,7 @@ class PwmSensor
   public:
     PwmSensor(const std::string& name, const std::string& sysPath,
               std::shared_ptr<sdbusplus::asio::connection>& conn,
+              boost::asio::io_service& io,
               sdbusplus::asio::object_server& objectServer,
               const std::string& sensorConfiguration,
               const std::string& sensorType);
@@ -24,6 +29,20 @@ class PwmSensor
     std::shared_ptr<sdbusplus::asio::dbus_interface> controlInterface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
     double pwmMax;
+    // the pwm file stays open, a fan controller sets it several times a
+    // second
+    int fd = -1;
+    boost::asio::deadline_timer writeTimer;
+    // what the file was last set to by us, unknown until the first write
+    std::optional<uint32_t> written;
+    // set while a write waits for the end of the write interval
+    std::optional<uint32_t> pending;
+    bool writeWaiting = false;
+    std::chrono::steady_clock::time_point lastWrite;
     void setValue(uint32_t value);
+    void flush(void);
+    void writeValue(uint32_t value);
+    bool openFile(void);
+    void closeFile(void);
     uint32_t getValue(bool errThrow = true);
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <memory>
+
+// What one of the daemons created: its sensors, configuration matches and
+// timers. Destroying it removes them from D-Bus.
+class SensorDaemon
+{
+  public:
+    virtual ~SensorDaemon() = default;
+};
+
+// Entry points of the daemons that can also be hosted together by the
+// combined sensor daemon. Each one creates its sensors and configuration
+// matches, owned by the returned daemon. The caller owns the connection and
+// requests the bus names, has to keep io, objectServer and systemBus alive
+// for as long as io runs, and destroys the daemon before any of them.
+std::unique_ptr<SensorDaemon>
+    setupAdcSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus);
+std::unique_ptr<SensorDaemon>
+    setupFanSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus);
+std::unique_ptr<SensorDaemon> setupHwmonTempSensors(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& systemBus);
+std::unique_ptr<SensorDaemon>
+    setupPsuSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus);
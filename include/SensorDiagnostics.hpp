@@ -0,0 +1,148 @@
+#pragma once
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+struct Sensor;
+
+constexpr const char* diagnosticsPath =
+    "/xyz/openbmc_project/sensor_diagnostics";
+constexpr const char* diagnosticsInterface =
+    "xyz.openbmc_project.Sensor.Diagnostics";
+
+// Hot path counters of one sensor. They are only allocated and updated
+// while diagnostics are enabled, see SensorDiagnostics.
+struct SensorCounters
+{
+    using Clock = std::chrono::steady_clock;
+
+    // upper bounds of the read latency histogram buckets, the last bucket
+    // takes everything slower
+    static constexpr std::array<uint64_t, 6> latencyBoundsUs = {
+        10, 100, 1000, 10000, 100000, 1000000};
+
+    uint64_t samples = 0;
+    uint64_t errors = 0;
+    uint64_t errorStreak = 0;
+    uint64_t maxErrorStreak = 0;
+    uint64_t publishes = 0;
+    std::array<uint64_t, latencyBoundsUs.size() + 1> readLatency{};
+    uint64_t maxReadLatencyUs = 0;
+    // difference between consecutive sample intervals
+    uint64_t totalPollJitterUs = 0;
+    uint64_t maxPollJitterUs = 0;
+    uint64_t thresholdChecks = 0;
+    uint64_t totalThresholdTimeNs = 0;
+    uint64_t maxThresholdTimeNs = 0;
+
+    Clock::time_point readStart;
+    bool reading = false;
+    Clock::time_point lastSample;
+    Clock::duration lastInterval{};
+
+    void readStarted(Clock::time_point now)
+    {
+        readStart = now;
+        reading = true;
+    }
+
+    void sample(Clock::time_point now)
+    {
+        samples++;
+        if (reading)
+        {
+            reading = false;
+            uint64_t latency = toUs(now - readStart);
+            size_t bucket = 0;
+            while (bucket < latencyBoundsUs.size() &&
+                   latency >= latencyBoundsUs[bucket])
+            {
+                bucket++;
+            }
+            readLatency[bucket]++;
+            maxReadLatencyUs = std::max(maxReadLatencyUs, latency);
+        }
+        if (samples > 1)
+        {
+            Clock::duration interval = now - lastSample;
+            if (samples > 2)
+            {
+                uint64_t jitter = toUs(interval > lastInterval
+                                           ? interval - lastInterval
+                                           : lastInterval - interval);
+                totalPollJitterUs += jitter;
+                maxPollJitterUs = std::max(maxPollJitterUs, jitter);
+            }
+            lastInterval = interval;
+        }
+        lastSample = now;
+    }
+
+    void thresholdsChecked(Clock::duration elapsed)
+    {
+        uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count());
+        thresholdChecks++;
+        totalThresholdTimeNs += ns;
+        maxThresholdTimeNs = std::max(maxThresholdTimeNs, ns);
+    }
+
+    void error(void)
+    {
+        errors++;
+        errorStreak++;
+        maxErrorStreak = std::max(maxErrorStreak, errorStreak);
+    }
+
+    static uint64_t toUs(Clock::duration duration)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                .count());
+    }
+};
+
+// Exposes the counters of every sensor of the daemon on one diagnostic
+// object. Recording is off unless the daemon is started with
+// SENSOR_DIAGNOSTICS=1 in its environment or the Enabled property is set,
+// a disabled sensor pays a single branch per sample.
+class SensorDiagnostics
+{
+  public:
+    using CounterValue = std::variant<uint64_t, std::vector<uint64_t>>;
+    using SensorCounterMap =
+        boost::container::flat_map<std::string, CounterValue>;
+
+    static bool enabled(void)
+    {
+        return active;
+    }
+
+    // called once a sensor has its D-Bus interfaces, the diagnostic object
+    // is created along with the first sensor
+    static void add(Sensor* sensor,
+                    const std::shared_ptr<sdbusplus::asio::connection>& conn);
+    static void remove(Sensor* sensor);
+
+  private:
+    static void setEnabled(bool enable);
+    static boost::container::flat_map<std::string, SensorCounterMap>
+        collect(void);
+    static void reset(void);
+
+    static inline bool active = false;
+    static inline boost::container::flat_set<Sensor*> sensors;
+    static inline std::shared_ptr<sdbusplus::asio::dbus_interface> interface;
+};
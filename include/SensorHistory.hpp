@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Recent readings of one sensor, so that rolling aggregates don't need a
+// client polling the sensor to build them. Samples go into a fixed ring as
+// int16 relative to the sensor's range, 1/65534 of it in resolution, each
+// with a 32 bit timestamp in 100 ms ticks. Adding a sample is O(1),
+// aggregating walks the samples of the window asked for.
+class SensorHistory
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Aggregate
+    {
+        double min;
+        double average;
+        double max;
+        uint32_t samples;
+    };
+
+    SensorHistory(size_t capacity, double minValue, double maxValue,
+                  Clock::time_point now);
+
+    void add(double value, Clock::time_point now);
+
+    // over the samples of the last window, nan readings are left out, all
+    // nan if there are none
+    Aggregate aggregate(std::chrono::milliseconds window,
+                        Clock::time_point now) const;
+
+  private:
+    int16_t encode(double value) const;
+    double decode(int16_t code) const;
+    uint32_t ticks(Clock::time_point time) const;
+
+    double base;
+    double step;
+    Clock::time_point start;
+    std::vector<int16_t> values;
+    std::vector<uint32_t> times;
+    size_t next = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the optional shared memory export of sensor values, see
+// TelemetryExport. Each daemon maps one file, /run/sensors/<daemon>, made of a
+// Header followed by capacity Entries. This header only needs the standard
+// library, so local readers can include it on their own. Readers map the file
+// read only, check magic and version, and read the first count entries with
+// readEntry(), no system calls after the mmap().
+namespace sensor_telemetry
+{
+
+constexpr const char* directory = "/run/sensors";
+constexpr uint32_t magic = 0x544e5344; // "DSNT"
+// bump whenever Header or Entry change
+constexpr uint32_t version = 1;
+constexpr size_t pathSize = 104;
+
+// Entry::status bits
+constexpr uint32_t statusValid = 1 << 0;      // value is not nan
+constexpr uint32_t statusOverridden = 1 << 1; // value was set externally
+constexpr uint32_t statusWarning = 1 << 2;    // a warning alarm is asserted
+constexpr uint32_t statusCritical = 1 << 3;   // a critical alarm is asserted
+constexpr uint32_t statusRemoved = 1 << 4;    // the sensor is gone for now
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entrySize;
+    uint32_t capacity;
+    // entries in use, only ever grows, an entry's path is set before it is
+    // counted
+    std::atomic<uint32_t> count;
+    uint64_t reserved[5];
+};
+static_assert(sizeof(Header) == 64, "Header layout changed");
+
+// A seqlock, sequence is odd while the writer updates the entry
+struct Entry
+{
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> status;
+    // the IEEE 754 bits of the value
+    std::atomic<uint64_t> value;
+    // CLOCK_MONOTONIC nanoseconds of the last update
+    std::atomic<int64_t> timestampNs;
+    // NUL terminated D-Bus object path of the sensor, const once counted
+    char path[pathSize];
+};
+static_assert(sizeof(Entry) == 128, "Entry layout changed");
+
+struct Sample
+{
+    double value;
+    uint32_t status;
+    int64_t timestampNs;
+};
+
+// Copies an entry out consistently. Returns false if every attempt raced
+// with the writer, which only updates an entry once per reading.
+inline bool readEntry(const Entry& entry, Sample& sample,
+                      unsigned int attempts = 64)
+{
+    for (unsigned int attempt = 0; attempt < attempts; attempt++)
+    {
+        uint32_t before = entry.sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0)
+        {
+            continue;
+        }
+        uint64_t bits = entry.value.load(std::memory_order_relaxed);
+        sample.status = entry.status.load(std::memory_order_relaxed);
+        sample.timestampNs = entry.timestampNs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) == before)
+        {
+            std::memcpy(&sample.value, &bits, sizeof(sample.value));
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace sensor_telemetry
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <CompletionQueue.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class SmbusOp
+{
+    readByteData,
+    readWordData
+};
+
+// Runs SMBus transactions on a worker thread per bus, so that a stalled bus
+// only holds up the sensors on it instead of the io thread of the daemon.
+// Each worker keeps the device node of its bus open and runs the
+// transactions queued for the bus one after the other, the results are
+// handed back on the io thread.
+class SmbusExecutor
+{
+  public:
+    // called on the io thread with the data read, or a negative errno
+    using Callback = std::function<void(int32_t)>;
+
+    explicit SmbusExecutor(boost::asio::io_service& io);
+    ~SmbusExecutor();
+
+    SmbusExecutor(const SmbusExecutor&) = delete;
+    SmbusExecutor& operator=(const SmbusExecutor&) = delete;
+
+    // one per io_service, destroyed with it
+    static SmbusExecutor& getInstance(boost::asio::io_service& io);
+
+    void submit(int busId, uint8_t address, SmbusOp op, uint8_t reg,
+                Callback&& callback);
+
+  private:
+    struct Request
+    {
+        uint8_t address;
+        SmbusOp op;
+        uint8_t reg;
+        Callback callback;
+        int32_t result = 0;
+    };
+
+    struct Bus
+    {
+        explicit Bus(int busId) : busId(busId)
+        {}
+
+        int busId;
+        // only touched by the worker
+        int fd = -1;
+        int address = -1;
+        unsigned long funcs = 0;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<Request> queue;
+        bool stopping = false;
+        std::thread worker;
+    };
+
+    static int32_t transfer(Bus& bus, const Request& request);
+    void work(Bus& bus);
+
+    boost::asio::io_service& io;
+    CompletionQueue<Request> completions;
+    boost::container::flat_map<int, std::unique_ptr<Bus>> buses;
+};
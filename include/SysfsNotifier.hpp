@@ -0,0 +1,56 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Waits for sysfs_notify() on sysfs attributes, which the kernel signals as
+// POLLPRI on an open attribute. hwmon drivers raise it for their alarm
+// attributes, some also for inputs. An attribute that is never notified just
+// stays quiet, so watching one without support costs nothing but the fd.
+class SysfsNotifier
+{
+  public:
+    // called with the path of the attribute that was notified
+    using Callback = std::function<void(const std::string&)>;
+
+    SysfsNotifier(boost::asio::io_service& io, Callback&& callback) :
+        io(io), callback(std::move(callback))
+    {}
+    ~SysfsNotifier();
+
+    SysfsNotifier(const SysfsNotifier&) = delete;
+    SysfsNotifier& operator=(const SysfsNotifier&) = delete;
+
+    // returns false if the attribute can't be opened or polled
+    bool watch(const std::string& path);
+
+    size_t size(void) const
+    {
+        return watches.size();
+    }
+
+  private:
+    struct Watch
+    {
+        Watch(boost::asio::io_service& io, const std::string& path,
+              SysfsNotifier& owner) :
+            path(path), fd(io), owner(owner)
+        {}
+
+        std::string path;
+        boost::asio::posix::stream_descriptor fd;
+        SysfsNotifier& owner;
+    };
+
+    static void wait(const std::shared_ptr<Watch>& watch);
+
+    boost::asio::io_service& io;
+    Callback callback;
+    std::vector<std::shared_ptr<Watch>> watches;
+};
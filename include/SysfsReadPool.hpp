@@ -0,0 +1,64 @@
+#pragma once
+
+#include <CompletionQueue.hpp>
+#include <Utils.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Opt-in threads for the periodic sysfs reads of sensors, so that a slow
+// device (a PMBus read is an I2C transaction the device may stretch) only
+// delays its own sensors instead of every reading of the daemon. Set
+// SENSOR_READ_THREADS to the number of threads to enable it. The daemons are
+// built without asio thread support, so sensors and their D-Bus objects stay
+// on the io thread: the workers only read the file and the result is handed
+// back on the io thread. Sensors keep at most one read queued, which orders
+// their readings the way a strand per sensor would.
+class SysfsReadPool
+{
+  public:
+    // called on the io thread with the reading, error is 0 or the errno of
+    // SysfsFile::readInteger
+    using Callback = std::function<void(int64_t value, int error)>;
+
+    SysfsReadPool(boost::asio::io_service& io, size_t threads);
+    ~SysfsReadPool();
+
+    SysfsReadPool(const SysfsReadPool&) = delete;
+    SysfsReadPool& operator=(const SysfsReadPool&) = delete;
+
+    // nullptr unless enabled, sensors then read on the io thread as before.
+    // One per io_service, destroyed with it.
+    static SysfsReadPool* getInstance(boost::asio::io_service& io);
+
+    // the file is kept open until the read is done, even if its sensor is
+    // destroyed in the meantime
+    void read(const std::shared_ptr<const SysfsFile>& file,
+              Callback&& callback);
+
+  private:
+    struct Request
+    {
+        std::shared_ptr<const SysfsFile> file;
+        Callback callback;
+        int64_t value = 0;
+        int error = 0;
+    };
+
+    void work(void);
+
+    CompletionQueue<Request> completions;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<Request> queue;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
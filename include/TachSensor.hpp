@@ -1,14 +1,18 @@
 #pragma once
 #include <systemd/sd-journal.h>
 
+#include <PollScheduler.hpp>
+#include <SysfsNotifier.hpp>
 #include <Thresholds.hpp>
-#include <boost/asio/streambuf.hpp>
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
 #include <gpiod.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sensor.hpp>
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -26,7 +30,14 @@ class PresenceSensor
     void read(void);
     bool getValue(void);
 
+    // called after every presence change
+    void setChangedHook(std::function<void()>&& hook)
+    {
+        changedHook = std::move(hook);
+    }
+
   private:
+    std::function<void()> changedHook;
     bool status = true;
     bool inverted;
     gpiod::line gpioLine;
@@ -46,18 +57,36 @@ class RedundancySensor
   public:
     RedundancySensor(size_t count, const std::vector<std::string>& children,
                      sdbusplus::asio::object_server& objectServer,
-                     const std::string& sensorConfiguration);
+                     const std::string& sensorConfiguration,
+                     boost::asio::io_service& io);
     ~RedundancySensor();
 
+    RedundancySensor(const RedundancySensor&) = delete;
+    RedundancySensor& operator=(const RedundancySensor&) = delete;
+
+    // Called with every threshold check of a fan. The state goes out on
+    // D-Bus when it changes, at most once per updateWindow, so that fans
+    // flapping while they spin up don't flood the bus with changes.
     void update(const std::string& name, bool failed);
 
+    static constexpr std::chrono::seconds updateWindow{2};
+
   private:
+    const char* stateFor(size_t failures) const;
+    void publish(void);
+
     size_t count;
-    std::string state = redundancy::full;
+    // fans failed right now, counted along as their status changes
+    size_t failedCount = 0;
+    // the published state
+    const char* state = redundancy::full;
     std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
     sdbusplus::asio::object_server& objectServer;
     boost::container::flat_map<std::string, bool> statuses;
+    boost::asio::deadline_timer publishTimer;
+    bool publishWaiting = false;
+    std::chrono::steady_clock::time_point lastPublish;
 };
 
 class TachSensor : public Sensor
@@ -73,7 +102,8 @@ class TachSensor : public Sensor
                const std::string& sensorConfiguration,
                const std::pair<size_t, size_t>& limits,
                const PowerState& powerState,
-               const std::optional<std::string>& led);
+               const std::optional<std::string>& led,
+               bool eventDriven = false);
     ~TachSensor() override;
 
   private:
@@ -82,14 +112,26 @@ class TachSensor : public Sensor
     std::unique_ptr<PresenceSensor> presence;
     std::shared_ptr<sdbusplus::asio::dbus_interface> itemIface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> itemAssoc;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    SysfsFile inputFile;
     std::string path;
     std::optional<std::string> led;
+    // the LED follows the thresholds like the redundancy state does, at
+    // most one change per RedundancySensor::updateWindow
     bool ledState = false;
+    bool ledWanted = false;
+    bool ledWaiting = false;
+    std::chrono::steady_clock::time_point lastLedChange;
+    boost::asio::deadline_timer ledTimer;
+    PollHandle pollHandle;
+    // set in the event driven mode, where a steady fan is read less often
+    // and a notified alarm or input is read right away
+    std::unique_ptr<SysfsNotifier> notifier;
+    unsigned int steadyReads = 0;
     void setupRead(void);
-    void handleResponse(const boost::system::error_code& err);
+    void watchAttributes(boost::asio::io_service& io);
+    void updateSteadyRate(double reading);
+    void updateLed(void);
+    void applyLed(void);
     void checkThresholds(void) override;
 };
 
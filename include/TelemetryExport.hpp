@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SensorTelemetry.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Writes the value, status and time of every sensor of this process into the
+// shared memory table described in SensorTelemetry.hpp, next to publishing
+// them on D-Bus. Only built in with the telemetry-export option. Sensors keep
+// their entry across being recreated, by object path.
+//
+// The export is never destroyed, sensors held in static maps still mark
+// their entries removed on exit. The file stays behind with them and is
+// replaced when the daemon starts again.
+class TelemetryExport
+{
+  public:
+    // nullptr unless the export is built in and its file could be set up
+    static TelemetryExport* get(void);
+
+    TelemetryExport(const TelemetryExport&) = delete;
+    TelemetryExport& operator=(const TelemetryExport&) = delete;
+
+    // nullptr once the table is full, or if the path doesn't fit in an
+    // entry, a cut off path could name another sensor
+    sensor_telemetry::Entry* entry(const std::string& path);
+
+    static void write(sensor_telemetry::Entry& entry, double value,
+                      uint32_t status)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        uint32_t current = entry.sequence.load(std::memory_order_relaxed);
+        entry.sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.value.store(bits, std::memory_order_relaxed);
+        entry.status.store(status, std::memory_order_relaxed);
+        entry.timestampNs.store(now, std::memory_order_relaxed);
+        entry.sequence.store(current + 2, std::memory_order_release);
+    }
+
+  private:
+    explicit TelemetryExport(void* mapping);
+
+    sensor_telemetry::Header* header;
+    sensor_telemetry::Entry* entries;
+    boost::container::flat_map<std::string, sensor_telemetry::Entry*> byPath;
+};
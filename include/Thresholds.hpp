@@ -1,10 +1,13 @@
 #pragma once
 #include <Utils.hpp>
-#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <nlohmann/json.hpp>
 
-#include <list>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
@@ -23,6 +26,14 @@ enum Direction
     HIGH,
     LOW
 };
+
+// Every level and direction pair has one alarm property, sensors remember
+// the state last written to each so that unchanged alarms cost nothing.
+constexpr size_t alarmCount = 4;
+constexpr size_t alarmIndex(Level level, Direction direction)
+{
+    return static_cast<size_t>(level) * 2 + static_cast<size_t>(direction);
+}
 struct Threshold
 {
     Threshold(const Level& lev, const Direction& dir, const double& val,
@@ -46,64 +57,95 @@ void assertThresholds(Sensor* sensor, double assertValue,
                       thresholds::Level level, thresholds::Direction direction,
                       bool assert);
 
-struct TimerUsed
+struct ThresholdTimer;
+
+// All delayed threshold changes of the process share one asio timer. Every
+// change is delayed by the same amount, so pending changes expire in the
+// order they were started and a queue is all the bookkeeping needed.
+class ThresholdTimerPool
 {
-    bool used;
-    Level level;
-    Direction direction;
-    bool assert;
-};
+  public:
+    static constexpr std::chrono::seconds delay{5};
 
-using TimerPair = std::pair<struct TimerUsed, boost::asio::deadline_timer>;
+    explicit ThresholdTimerPool(boost::asio::io_service& io) : timer(io)
+    {}
+
+    // one per io_service, destroyed with it
+    static ThresholdTimerPool& getInstance(boost::asio::io_service& io);
+
+    void start(ThresholdTimer& owner, size_t index, uint32_t generation,
+               double assertValue);
+    // forgets every change pending for owner, only used on destruction
+    void cancel(const ThresholdTimer& owner);
 
+    size_t size(void) const
+    {
+        return entries.size();
+    }
+
+  private:
+    struct Entry
+    {
+        ThresholdTimer* owner;
+        size_t index;
+        uint32_t generation;
+        double assertValue;
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    void arm(void);
+    void expire(void);
+
+    boost::asio::steady_timer timer;
+    std::deque<Entry> entries;
+};
+
+// Delayed threshold changes of one sensor, see checkThresholdsPowerDelay().
 struct ThresholdTimer
 {
+    // one timer per level, direction and kind of change
+    static constexpr size_t timerCount = alarmCount * 2;
 
     ThresholdTimer(boost::asio::io_service& ioService, Sensor* sensor) :
-        io(ioService), sensor(sensor)
+        pool(ThresholdTimerPool::getInstance(ioService)), sensor(sensor)
     {}
+    ~ThresholdTimer()
+    {
+        pool.cancel(*this);
+    }
+
+    ThresholdTimer(const ThresholdTimer&) = delete;
+    ThresholdTimer& operator=(const ThresholdTimer&) = delete;
+
+    static constexpr size_t timerIndex(const Threshold& threshold,
+                                       bool assert)
+    {
+        return alarmIndex(threshold.level, threshold.direction) * 2 +
+               (assert ? 1 : 0);
+    }
 
-    bool hasActiveTimer(const Threshold& threshold, bool assert)
+    bool hasActiveTimer(const Threshold& threshold, bool assert) const
     {
-        for (TimerPair& timer : timers)
-        {
-            if (timer.first.used)
-            {
-                if ((timer.first.level == threshold.level) &&
-                    (timer.first.direction == threshold.direction) &&
-                    (timer.first.assert == assert))
-                {
-                    return true;
-                }
-            }
-        }
-        return false;
+        return pending[timerIndex(threshold, assert)] != 0;
     }
 
     void stopTimer(const Threshold& threshold, bool assert)
     {
-        struct TimerUsed timerUsed = {};
-        for (TimerPair& timer : timers)
-        {
-            timerUsed = timer.first;
-            if (timerUsed.used)
-            {
-                if ((timerUsed.level == threshold.level) &&
-                    (timerUsed.direction == threshold.direction) &&
-                    (timerUsed.assert == assert))
-                {
-                    timer.second.cancel();
-                }
-            }
-        }
+        size_t index = timerIndex(threshold, assert);
+        // entries still queued in the pool are ignored once they expire
+        generation[index]++;
+        pending[index] = 0;
     }
 
     void startTimer(const Threshold& threshold, bool assert,
                     double assertValue);
+    // called by the pool when a change is due
+    void expired(size_t index, uint32_t entryGeneration, double assertValue);
 
-    boost::asio::io_service& io;
-    std::list<TimerPair> timers;
+    ThresholdTimerPool& pool;
     Sensor* sensor;
+    std::array<uint16_t, timerCount> pending{};
+    std::array<uint32_t, timerCount> generation{};
 };
 
 bool parseThresholdsFromConfig(
@@ -121,7 +163,10 @@ bool hasCriticalInterface(
 bool hasWarningInterface(
     const std::vector<thresholds::Threshold>& thresholdVector);
 
-void persistThreshold(const std::string& baseInterface, const std::string& path,
+// Queues the threshold for writing back to Entity Manager, the sensor itself
+// is expected to hold the new value already. Writes are merged and delayed
+// by a few seconds at most.
+void persistThreshold(const std::string& path, const std::string& baseInterface,
                       const thresholds::Threshold& threshold,
                       std::shared_ptr<sdbusplus::asio::connection>& conn,
                       size_t thresholdCount, const std::string& label);
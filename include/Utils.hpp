@@ -1,4 +1,7 @@
 #pragma once
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/asio/steady_timer.hpp>
@@ -7,12 +10,17 @@
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/message/types.hpp>
 
+#include <array>
+#include <cerrno>
 #include <filesystem>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <regex>
+#include <set>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <variant>
@@ -47,6 +55,25 @@ std::optional<std::string>
                          const std::string& hwmonBaseName,
                          const std::set<std::string>& permitSet);
 std::set<std::string> getPermitSet(const SensorBaseConfigMap& config);
+
+// Controls how often a sensor sends its Value out on D-Bus, from the optional
+// PublishHysteresis, PublishHysteresisPercent and MaxPublishRate properties
+// of the sensor configuration.
+struct PublishPolicy
+{
+    // change in sensor units required before a new value is published
+    double hysteresis = 0.0;
+    // change in percent of the sensor range required before publishing
+    double hysteresisPercent = 0.0;
+    // maximum number of Value updates per second, 0 for no limit
+    double maxRate = 0.0;
+};
+PublishPolicy getPublishPolicy(const SensorBaseConfigMap& config);
+// True if two configurations of the same object only differ in thresholds,
+// limits, power state or publish policy, which running sensors pick up
+// through Sensor::reconfigure() instead of being recreated.
+bool onlyReconfigurableChanges(const SensorData& current,
+                               const SensorData& updated);
 bool findFiles(const std::filesystem::path& dirPath,
                const std::string& matchString,
                std::vector<std::filesystem::path>& foundPaths,
@@ -54,6 +81,13 @@ bool findFiles(const std::filesystem::path& dirPath,
 bool isPowerOn(void);
 bool hasBiosPost(void);
 void setupPowerMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn);
+
+// Registers a callback that runs whenever isPowerOn() or hasBiosPost()
+// change, setupPowerMatch() has to be called for any change to be seen. The
+// callback is dropped along with the returned subscription.
+using PowerStateCallback = std::function<void(void)>;
+std::shared_ptr<PowerStateCallback>
+    subscribePowerState(PowerStateCallback&& callback);
 bool getSensorConfiguration(
     const std::string& type,
     const std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
@@ -237,68 +271,11 @@ struct GetSensorConfiguration :
             interface);
     }
 
+    // Requests made in the same io_service turn, e.g. by the daemons of the
+    // combined multisensor, share one mapper query and one GetAll per
+    // configuration interface.
     void getConfiguration(const std::vector<std::string>& interfaces,
-                          size_t retries = 0)
-    {
-        if (retries > 5)
-        {
-            retries = 5;
-        }
-
-        std::shared_ptr<GetSensorConfiguration> self = shared_from_this();
-        dbusConnection->async_method_call(
-            [self, interfaces, retries](const boost::system::error_code ec,
-                                        const GetSubTreeType& ret) {
-                if (ec)
-                {
-                    std::cerr << "Error calling mapper\n";
-                    if (!retries)
-                    {
-                        return;
-                    }
-                    auto timer = std::make_shared<boost::asio::steady_timer>(
-                        self->dbusConnection->get_io_context());
-                    timer->expires_after(std::chrono::seconds(10));
-                    timer->async_wait([self, timer, interfaces,
-                                       retries](boost::system::error_code ec) {
-                        if (ec)
-                        {
-                            std::cerr << "Timer error!\n";
-                            return;
-                        }
-                        self->getConfiguration(interfaces, retries - 1);
-                    });
-
-                    return;
-                }
-                for (const auto& [path, objDict] : ret)
-                {
-                    if (objDict.empty())
-                    {
-                        return;
-                    }
-                    const std::string& owner = objDict.begin()->first;
-
-                    for (const std::string& interface : objDict.begin()->second)
-                    {
-                        // anything that starts with a requested configuration
-                        // is good
-                        if (std::find_if(
-                                interfaces.begin(), interfaces.end(),
-                                [interface](const std::string& possible) {
-                                    return boost::starts_with(interface,
-                                                              possible);
-                                }) == interfaces.end())
-                        {
-                            continue;
-                        }
-                        self->getPath(path, interface, owner);
-                    }
-                }
-            },
-            mapper::busName, mapper::path, mapper::interface, mapper::subtree,
-            "/", 0, interfaces);
-    }
+                          size_t retries = 0);
 
     ~GetSensorConfiguration()
     {
@@ -314,5 +291,72 @@ struct GetSensorConfiguration :
 // This function returns optionally these 3 elements as a tuple.
 std::optional<std::tuple<std::string, std::string, std::string>>
     splitFileName(const std::filesystem::path& filePath);
+bool parseSysfsInteger(std::string_view str, int64_t& value);
 std::optional<double> readFile(const std::string& thresholdFile,
                                const double& scaleFactor);
+
+// Keeps a sysfs attribute open for the lifetime of its owner, so that taking
+// a sample only costs a pread() from offset 0 instead of a close/open/read
+// cycle with a kernfs lookup each time.
+class SysfsFile
+{
+  public:
+    explicit SysfsFile(const std::string& path) :
+        fd(open(path.c_str(), O_RDONLY | O_CLOEXEC))
+    {}
+    ~SysfsFile()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    SysfsFile(const SysfsFile&) = delete;
+    SysfsFile& operator=(const SysfsFile&) = delete;
+
+    bool isOpen() const
+    {
+        return fd >= 0;
+    }
+
+    // Returns the number of bytes read, or -1 with errno set. ENODEV means
+    // the device is gone (kernfs deactivates the node on removal), which is
+    // also reported if the attribute could never be opened.
+    ssize_t read(char* buffer, size_t size) const
+    {
+        if (fd < 0)
+        {
+            errno = ENODEV;
+            return -1;
+        }
+        ssize_t rc = 0;
+        do
+        {
+            rc = pread(fd, buffer, size, 0);
+        } while (rc < 0 && errno == EINTR);
+        return rc;
+    }
+
+    // Reads the attribute as an integer without touching the heap. Returns
+    // false with errno set on failure, EINVAL if the contents did not parse.
+    bool readInteger(int64_t& value) const
+    {
+        std::array<char, 32> buffer;
+        ssize_t bytesRead = read(buffer.data(), buffer.size());
+        if (bytesRead < 0)
+        {
+            return false;
+        }
+        if (!parseSysfsInteger(std::string_view(buffer.data(), bytesRead),
+                               value))
+        {
+            errno = EINVAL;
+            return false;
+        }
+        return true;
+    }
+
+  private:
+    int fd;
+};
@@ -1,16 +1,39 @@
 #pragma once
 
+#include <InternedString.hpp>
+#include <PollScheduler.hpp>
+#include <SensorDiagnostics.hpp>
+#include <SensorHistory.hpp>
 #include <SensorPaths.hpp>
+#include <TelemetryExport.hpp>
 #include <Thresholds.hpp>
 #include <Utils.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <limits>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
-constexpr size_t sensorFailedPollTimeMs = 5000;
+// Failing reads are retried at a doubling interval up to this, see
+// Sensor::backOff(). Set with the poll-backoff-max-ms build option.
+#ifdef SENSOR_POLL_BACKOFF_MAX_MS
+constexpr unsigned int maxPollBackoffMs = SENSOR_POLL_BACKOFF_MAX_MS;
+#else
+constexpr unsigned int maxPollBackoffMs = 60000;
+#endif
+
+// Readings kept per sensor for the History interface, none if 0. Set with
+// the history-samples build option.
+#ifdef SENSOR_HISTORY_SAMPLES
+constexpr size_t sensorHistorySamples = SENSOR_HISTORY_SAMPLES;
+#else
+constexpr size_t sensorHistorySamples = 0;
+#endif
 
 // Enable useful logging with sensor instrumentation
 // This is intentionally not DEBUG, avoid clash with usage in .cpp files
@@ -21,6 +44,18 @@ constexpr const char* availableInterfaceName =
     "xyz.openbmc_project.State.Decorator.Availability";
 constexpr const char* operationalInterfaceName =
     "xyz.openbmc_project.State.Decorator.OperationalStatus";
+constexpr const char* historyInterfaceName =
+    "xyz.openbmc_project.Sensor.History";
+constexpr const char* timingInterfaceName =
+    "xyz.openbmc_project.Sensor.SampleTiming";
+
+// Publish the sample time and read duration of each published Value, set
+// with the sample-timing build option
+#ifdef ENABLE_SAMPLE_TIMING
+constexpr bool publishSampleTiming = true;
+#else
+constexpr bool publishSampleTiming = false;
+#endif
 constexpr const size_t errorThreshold = 5;
 
 struct SensorInstrumentation
@@ -42,23 +77,62 @@ struct Sensor
            const double max, const double min,
            std::shared_ptr<sdbusplus::asio::connection>& conn,
            PowerState readState = PowerState::always) :
+        hysteresisTrigger((max - min) * 0.01),
+        hysteresisPublish((max - min) * 0.0001), errCount(0),
+        readState(readState), maxValue(max), minValue(min),
         name(sensor_paths::escapePathForDbus(name)),
         configurationPath(configurationPath), objectType(objectType),
-        maxValue(max), minValue(min), thresholds(std::move(thresholdData)),
-        hysteresisTrigger((max - min) * 0.01),
-        hysteresisPublish((max - min) * 0.0001), dbusConnection(conn),
-        readState(readState), errCount(0),
+        thresholds(std::move(thresholdData)), dbusConnection(conn),
         instrumentation(enableInstrumentation
                             ? std::make_unique<SensorInstrumentation>()
                             : nullptr)
     {}
-    virtual ~Sensor() = default;
+    virtual ~Sensor()
+    {
+        SensorDiagnostics::remove(this);
+        if (telemetryEntry != nullptr)
+        {
+            TelemetryExport::write(*telemetryEntry,
+                                   std::numeric_limits<double>::quiet_NaN(),
+                                   sensor_telemetry::statusRemoved);
+        }
+    }
     virtual void checkThresholds(void) = 0;
-    std::string name;
-    std::string configurationPath;
-    std::string objectType;
+
+    // Read or written with every sample, kept together at the front so that
+    // a reading touches as few cache lines as possible.
+    double value = std::numeric_limits<double>::quiet_NaN();
+    double rawValue = std::numeric_limits<double>::quiet_NaN();
+    // last value sent out on D-Bus, value itself always holds the latest
+    // reading so that thresholds are checked against it
+    double publishedValue = std::numeric_limits<double>::quiet_NaN();
+    double hysteresisTrigger;
+    double hysteresisPublish;
+    size_t errCount;
+    // reads in a row that failed, see backOff()
+    unsigned int failedReads = 0;
+    PowerState readState;
+    bool overriddenState = false;
+    bool internalSet = false;
+    // set while reads are paused for the host power state
+    bool readsPaused = false;
+    bool readPending = false;
+    // current value of the alarm properties, by thresholds::alarmIndex()
+    std::array<bool, thresholds::alarmCount> alarmStates{};
+    // when the last reading was taken and, for sensors that call
+    // readStarted(), how long taking it took
+    std::chrono::steady_clock::time_point sampleTime;
+    std::chrono::steady_clock::time_point readStart;
+    std::chrono::steady_clock::duration readDuration{};
+    std::chrono::steady_clock::time_point lastPublish;
+    std::chrono::steady_clock::duration minPublishInterval{};
     double maxValue;
     double minValue;
+
+    std::string name;
+    // shared by the sensors of a daemon, most of them have the same few
+    InternedString configurationPath;
+    InternedString objectType;
     std::vector<thresholds::Threshold> thresholds;
     std::shared_ptr<sdbusplus::asio::dbus_interface> sensorInterface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> thresholdInterfaceWarning;
@@ -66,16 +140,20 @@ struct Sensor
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
     std::shared_ptr<sdbusplus::asio::dbus_interface> availableInterface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> operationalInterface;
-    double value = std::numeric_limits<double>::quiet_NaN();
-    double rawValue = std::numeric_limits<double>::quiet_NaN();
-    bool overriddenState = false;
-    bool internalSet = false;
-    double hysteresisTrigger;
-    double hysteresisPublish;
     std::shared_ptr<sdbusplus::asio::connection> dbusConnection;
-    PowerState readState;
-    size_t errCount;
     std::unique_ptr<SensorInstrumentation> instrumentation;
+    // runtime diagnostics, see diagnostics()
+    std::unique_ptr<SensorCounters> counters;
+    std::shared_ptr<PowerStateCallback> powerSubscription;
+    // poller of a sensor read by the PollScheduler, see setPoller()
+    PollHandle* poller = nullptr;
+    unsigned int pollIntervalMs = 0;
+    // this sensor's entry in the shared memory export, if that is built in
+    sensor_telemetry::Entry* telemetryEntry = nullptr;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> timingInterface;
+    // recent readings, see sensorHistorySamples
+    std::unique_ptr<SensorHistory> history;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> historyInterface;
 
     // This member variable provides a hook that can be used to receive
     // notification whenever this Sensor's value is externally set via D-Bus.
@@ -169,6 +247,106 @@ struct Sensor
         }
     }
 
+    // counters of this sensor, nullptr unless diagnostics are enabled
+    SensorCounters* diagnostics(void)
+    {
+        if (!SensorDiagnostics::enabled())
+        {
+            return nullptr;
+        }
+        if (!counters)
+        {
+            counters = std::make_unique<SensorCounters>();
+        }
+        return counters.get();
+    }
+
+    // sensors call this right before taking a reading, so that the time
+    // until updateValue() counts as read latency
+    void readStarted(void)
+    {
+        readStart = std::chrono::steady_clock::now();
+        readPending = true;
+        if (SensorCounters* stats = diagnostics())
+        {
+            stats->readStarted(readStart);
+        }
+    }
+
+    void setPublishPolicy(const PublishPolicy& policy)
+    {
+        if (policy.hysteresis > 0.0 || policy.hysteresisPercent > 0.0)
+        {
+            hysteresisPublish =
+                std::max(policy.hysteresis, (maxValue - minValue) *
+                                                policy.hysteresisPercent / 100);
+        }
+        minPublishInterval = std::chrono::steady_clock::duration::zero();
+        if (policy.maxRate > 0.0)
+        {
+            minPublishInterval =
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(1.0 / policy.maxRate));
+        }
+    }
+
+    // Applies a changed configuration to a sensor that is already on D-Bus,
+    // callers reapply the publish policy afterwards as it depends on the
+    // limits. Returns false if a threshold was added, removed or changed
+    // its level or direction, those are distinct D-Bus properties and the
+    // sensor has to be recreated for them.
+    bool reconfigure(const std::vector<thresholds::Threshold>& newThresholds,
+                     double max, double min, PowerState newReadState)
+    {
+        if (newThresholds.size() != thresholds.size() ||
+            !std::equal(thresholds.begin(), thresholds.end(),
+                        newThresholds.begin(),
+                        [](const thresholds::Threshold& lhs,
+                           const thresholds::Threshold& rhs) {
+                            return lhs.level == rhs.level &&
+                                   lhs.direction == rhs.direction;
+                        }))
+        {
+            return false;
+        }
+
+        // the property setters hold references to the elements, so the
+        // values are updated in place
+        bool thresholdsChanged = false;
+        for (size_t index = 0; index < thresholds.size(); index++)
+        {
+            if (thresholds[index].value != newThresholds[index].value)
+            {
+                thresholds[index].value = newThresholds[index].value;
+                thresholdsChanged = true;
+            }
+        }
+        if (thresholdsChanged)
+        {
+            thresholds::updateThresholds(this);
+            // same as for a threshold set over D-Bus, make sure the next
+            // reading is checked against the new values
+            value = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        if (max != maxValue || min != minValue)
+        {
+            maxValue = max;
+            minValue = min;
+            hysteresisTrigger = (max - min) * 0.01;
+            hysteresisPublish = (max - min) * 0.0001;
+            sensorInterface->set_property("MaxValue", maxValue);
+            sensorInterface->set_property("MinValue", minValue);
+        }
+
+        if (newReadState != readState)
+        {
+            readState = newReadState;
+            trackPowerState();
+        }
+        return true;
+    }
+
     int setSensorValue(const double& newValue, double& oldValue)
     {
         if (!internalSet)
@@ -178,6 +356,7 @@ struct Sensor
             // check thresholds for external set
             value = newValue;
             checkThresholds();
+            exportTelemetry();
 
             // Trigger the hook, as an external set has just happened
             if (externalSetHook)
@@ -198,13 +377,13 @@ struct Sensor
                              const std::string& label = std::string(),
                              size_t thresholdSize = 0)
     {
-        if (readState == PowerState::on || readState == PowerState::biosPost)
+        createAssociation(association, configurationPath);
+        if (TelemetryExport* exporter = TelemetryExport::get())
         {
-            setupPowerMatch(conn);
+            telemetryEntry =
+                exporter->entry(sensorInterface->get_object_path());
         }
 
-        createAssociation(association, configurationPath);
-
         sensorInterface->register_property("Unit", unit);
         sensorInterface->register_property("MaxValue", maxValue);
         sensorInterface->register_property("MinValue", minValue);
@@ -326,6 +505,42 @@ struct Sensor
             operationalInterface->register_property("Functional", true);
             operationalInterface->initialize();
         }
+        if (publishSampleTiming && !timingInterface)
+        {
+            // CLOCK_MONOTONIC microseconds, 0 until the first reading
+            timingInterface =
+                std::make_shared<sdbusplus::asio::dbus_interface>(
+                    conn, sensorInterface->get_object_path(),
+                    timingInterfaceName);
+            timingInterface->register_property("SampleTime", uint64_t(0));
+            timingInterface->register_property("ReadDuration", uint64_t(0));
+            timingInterface->initialize();
+        }
+        if (sensorHistorySamples > 0 && !historyInterface)
+        {
+            history = std::make_unique<SensorHistory>(
+                sensorHistorySamples, minValue, maxValue,
+                SensorHistory::Clock::now());
+            historyInterface =
+                std::make_shared<sdbusplus::asio::dbus_interface>(
+                    conn, sensorInterface->get_object_path(),
+                    historyInterfaceName);
+            historyInterface->register_property("Samples",
+                                                sensorHistorySamples);
+            // minimum, average and maximum over the last seconds, and the
+            // number of readings they are made of
+            historyInterface->register_method(
+                "Aggregate", [this](uint32_t seconds) {
+                    SensorHistory::Aggregate result = history->aggregate(
+                        std::chrono::seconds(seconds),
+                        SensorHistory::Clock::now());
+                    return std::make_tuple(result.min, result.average,
+                                           result.max, result.samples);
+                });
+            historyInterface->initialize();
+        }
+        SensorDiagnostics::add(this, conn);
+        trackPowerState();
     }
 
     bool readingStateGood()
@@ -343,6 +558,111 @@ struct Sensor
         return true;
     }
 
+    // Stops reading while the host power state doesn't allow it and carries
+    // on once it does again. Sensors that schedule their reads without
+    // setPoller() implement it themselves.
+    virtual void setReadsPaused(bool paused)
+    {
+        if (poller != nullptr)
+        {
+            poller->setPaused(paused);
+        }
+    }
+
+    // Lets the base class pace a sensor read every intervalMs by the
+    // PollScheduler: it is paused for the power state and backed off while
+    // reads fail.
+    void setPoller(PollHandle& handle, unsigned int intervalMs)
+    {
+        poller = &handle;
+        pollIntervalMs = intervalMs;
+        applyPollInterval();
+    }
+
+    // the interval until the next read, doubled for every failed read in a
+    // row up to maxPollBackoffMs
+    unsigned int currentPollInterval(void) const
+    {
+        unsigned int ceiling = std::max(pollIntervalMs, maxPollBackoffMs);
+        unsigned int interval = pollIntervalMs;
+        for (unsigned int ii = 0; ii < failedReads && interval < ceiling; ii++)
+        {
+            interval = interval > ceiling / 2 ? ceiling : interval * 2;
+        }
+        return interval;
+    }
+
+    // Called for every read that failed or found the device missing,
+    // incrementError() does so too.
+    void backOff(void)
+    {
+        // more doublings than any interval takes to reach the ceiling
+        if (failedReads < 32)
+        {
+            failedReads++;
+        }
+        applyPollInterval();
+    }
+
+    // back to the normal rate, on a good reading, a hotplug or a power state
+    // change
+    void resetBackoff(void)
+    {
+        if (failedReads != 0)
+        {
+            failedReads = 0;
+            applyPollInterval();
+        }
+    }
+
+    void applyPollInterval(void)
+    {
+        if (poller != nullptr)
+        {
+            poller->setInterval(currentPollInterval());
+        }
+    }
+
+    // follows the host power state for sensors that aren't always readable
+    void trackPowerState(void)
+    {
+        if (readState == PowerState::always)
+        {
+            powerSubscription = nullptr;
+            if (readsPaused)
+            {
+                readsPaused = false;
+                setReadsPaused(false);
+            }
+            return;
+        }
+        setupPowerMatch(dbusConnection);
+        if (!powerSubscription)
+        {
+            powerSubscription =
+                subscribePowerState([this]() { updateReadState(); });
+        }
+        updateReadState();
+    }
+
+    void updateReadState(void)
+    {
+        bool paused = !readingStateGood();
+        if (paused == readsPaused)
+        {
+            return;
+        }
+        readsPaused = paused;
+        resetBackoff();
+        if (paused)
+        {
+            // what the next reading would have reported
+            markAvailable(false);
+            updateValueProperty(std::numeric_limits<double>::quiet_NaN());
+        }
+        setReadsPaused(paused);
+    }
+
     void markFunctional(bool isFunctional)
     {
         if (operationalInterface)
@@ -352,6 +672,11 @@ struct Sensor
         if (isFunctional)
         {
             errCount = 0;
+            resetBackoff();
+            if (counters)
+            {
+                counters->errorStreak = 0;
+            }
         }
         else
         {
@@ -376,6 +701,12 @@ struct Sensor
             return;
         }
 
+        readPending = false;
+        if (SensorCounters* stats = diagnostics())
+        {
+            stats->error();
+        }
+        backOff();
         if (errCount >= errorThreshold)
         {
             return;
@@ -397,6 +728,18 @@ struct Sensor
             return;
         }
 
+        sampleTime = std::chrono::steady_clock::now();
+        if (readPending)
+        {
+            readPending = false;
+            readDuration = sampleTime - readStart;
+        }
+        SensorCounters* stats = diagnostics();
+        if (stats != nullptr)
+        {
+            stats->sample(sampleTime);
+        }
+
         if (!readingStateGood())
         {
             markAvailable(false);
@@ -406,18 +749,32 @@ struct Sensor
 
         updateValueProperty(newValue);
         updateInstrumentation(newValue);
+        if (history)
+        {
+            history->add(newValue, SensorHistory::Clock::now());
+        }
 
         // Always check thresholds after changing the value,
         // as the test against hysteresisTrigger now takes place in
         // the thresholds::checkThresholds() method,
         // which is called by checkThresholds() below,
         // in all current implementations of sensors that have thresholds.
-        checkThresholds();
+        if (stats != nullptr)
+        {
+            auto start = SensorCounters::Clock::now();
+            checkThresholds();
+            stats->thresholdsChecked(SensorCounters::Clock::now() - start);
+        }
+        else
+        {
+            checkThresholds();
+        }
         if (!std::isnan(newValue))
         {
             markFunctional(true);
             markAvailable(true);
         }
+        exportTelemetry();
     }
 
     void updateProperty(
@@ -450,12 +807,88 @@ struct Sensor
         return false;
     }
 
+    // Copies the value and the alarm states into the telemetry export, after
+    // thresholds were checked against the value
+    void exportTelemetry(void)
+    {
+        if (telemetryEntry == nullptr)
+        {
+            return;
+        }
+        uint32_t status = 0;
+        if (!std::isnan(value))
+        {
+            status |= sensor_telemetry::statusValid;
+        }
+        if (overriddenState)
+        {
+            status |= sensor_telemetry::statusOverridden;
+        }
+        using namespace thresholds;
+        if (alarmStates[alarmIndex(WARNING, HIGH)] ||
+            alarmStates[alarmIndex(WARNING, LOW)])
+        {
+            status |= sensor_telemetry::statusWarning;
+        }
+        if (alarmStates[alarmIndex(CRITICAL, HIGH)] ||
+            alarmStates[alarmIndex(CRITICAL, LOW)])
+        {
+            status |= sensor_telemetry::statusCritical;
+        }
+        TelemetryExport::write(*telemetryEntry, value, status);
+    }
+
   private:
+    // Rate limits publishing, transitions to or from nan always go out so
+    // that consumers see a sensor going away immediately.
+    bool publishDue(const double& newValue)
+    {
+        if (minPublishInterval == std::chrono::steady_clock::duration::zero())
+        {
+            return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (!std::isnan(newValue) && !std::isnan(publishedValue) &&
+            now - lastPublish < minPublishInterval)
+        {
+            return false;
+        }
+        lastPublish = now;
+        return true;
+    }
+
     void updateValueProperty(const double& newValue)
     {
-        // Indicate that it is internal set call, not an external overwrite
+        // a suppressed change is compared against the published value again
+        // on the next reading, so it is delayed rather than lost
+        value = newValue;
+        if (!requiresUpdate(publishedValue, newValue) || !publishDue(newValue))
+        {
+            return;
+        }
+        publishValue();
+    }
+
+    void publishValue(void)
+    {
+        if (counters)
+        {
+            counters->publishes++;
+        }
+        publishedValue = value;
         internalSet = true;
-        updateProperty(sensorInterface, value, newValue, "Value");
+        if (sensorInterface && !(sensorInterface->set_property("Value", value)))
+        {
+            std::cerr << "error setting property Value to " << value << "\n";
+        }
         internalSet = false;
+        if (timingInterface)
+        {
+            timingInterface->set_property(
+                "SampleTime",
+                SensorCounters::toUs(sampleTime.time_since_epoch()));
+            timingInterface->set_property("ReadDuration",
+                                          SensorCounters::toUs(readDuration));
+        }
     }
 };
@@ -14,17 +14,22 @@
 // limitations under the License.
 */
 
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <ADCSensor.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/asio/read_until.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/container/flat_map.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -43,6 +48,11 @@ static constexpr double roundFactor = 10000;     // 3 decimal places
 static constexpr double maxVoltageReading = 1.8; // pre sensor scaling
 static constexpr double minVoltageReading = 0;
 
+// a trigger fires many times a second, a scan that takes this long won't come
+static constexpr unsigned int scanTimeoutMs = 500;
+
+namespace fs = std::filesystem;
+
 ADCSensor::ADCSensor(const std::string& path,
                      sdbusplus::asio::object_server& objectServer,
                      std::shared_ptr<sdbusplus::asio::connection>& conn,
@@ -58,11 +68,13 @@ ADCSensor::ADCSensor(const std::string& path,
            maxVoltageReading / scaleFactor, minVoltageReading / scaleFactor,
            conn, readState),
     std::enable_shared_from_this<ADCSensor>(), objServer(objectServer),
-    inputDev(io, open(path.c_str(), O_RDONLY)), waitTimer(io), path(path),
+    inputFile(path), waitTimer(io), path(path),
     scaleFactor(scaleFactor),
     sensorPollMs(static_cast<unsigned int>(pollRate * 1000)),
-    bridgeGpio(std::move(bridgeGpio)), thresholdTimer(io, this)
+    bridgeGpio(std::move(bridgeGpio)), thresholdTimer(io, this),
+    pollHandle(io, sensorPollMs, [this]() { setupRead(); })
 {
+    setPoller(pollHandle, sensorPollMs);
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/voltage/" + name,
         "xyz.openbmc_project.Sensor.Value");
@@ -85,9 +97,8 @@ ADCSensor::ADCSensor(const std::string& path,
 
 ADCSensor::~ADCSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
     waitTimer.cancel();
+    pollHandle.reset();
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -96,139 +107,462 @@ ADCSensor::~ADCSensor()
 
 void ADCSensor::setupRead(void)
 {
-    std::shared_ptr<boost::asio::streambuf> buffer =
-        std::make_shared<boost::asio::streambuf>();
-
-    std::weak_ptr<ADCSensor> weakRef = weak_from_this();
+    // don't stack reads while waiting for the bridge to settle
+    if (readQueued)
+    {
+        return;
+    }
 
     if (bridgeGpio.has_value())
     {
+        readQueued = true;
         (*bridgeGpio).set(1);
         // In case a channel has a bridge circuit,we have to turn the bridge on
         // prior to reading a value at least for one scan cycle to get a valid
         // value. Guarantee that the HW signal can be stable, the HW signal
         // could be instability.
+        std::weak_ptr<ADCSensor> weakRef = weak_from_this();
         waitTimer.expires_from_now(
             boost::posix_time::milliseconds(gpioBridgeEnableMs));
-        waitTimer.async_wait(
-            [weakRef, buffer](const boost::system::error_code& ec) {
-                std::shared_ptr<ADCSensor> self = weakRef.lock();
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    return; // we're being canceled
-                }
-
-                if (self)
-                {
-                    boost::asio::async_read_until(
-                        self->inputDev, *buffer, '\n',
-                        [weakRef, buffer](const boost::system::error_code& ec,
-                                          std::size_t /*bytes_transfered*/) {
-                            std::shared_ptr<ADCSensor> self = weakRef.lock();
-                            if (self)
-                            {
-                                self->readBuf = buffer;
-                                self->handleResponse(ec);
-                            }
-                        });
-                }
-            });
+        waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+            std::shared_ptr<ADCSensor> self = weakRef.lock();
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return; // we're being canceled
+            }
+
+            if (self)
+            {
+                self->readInput();
+            }
+        });
     }
     else
     {
-        boost::asio::async_read_until(
-            inputDev, *buffer, '\n',
-            [weakRef, buffer](const boost::system::error_code& ec,
-                              std::size_t /*bytes_transfered*/) {
-                std::shared_ptr<ADCSensor> self = weakRef.lock();
-                if (self)
-                {
-                    self->readBuf = buffer;
-                    self->handleResponse(ec);
-                }
-            });
+        readInput();
+    }
+}
+
+void ADCSensor::readInput(void)
+{
+    readQueued = false;
+
+    readStarted();
+    int64_t reading = 0;
+    bool success = inputFile.readInteger(reading);
+    int err = errno;
+    if (bridgeGpio.has_value())
+    {
+        (*bridgeGpio).set(0);
+    }
+
+    if (!success)
+    {
+        if (err == ENODEV)
+        {
+            std::cerr << "adcsensor " << name << " removed " << path << "\n";
+            pollHandle.reset();
+            return; // we're no longer valid
+        }
+        incrementError();
+        return;
+    }
+
+    updateMillivolts(static_cast<double>(reading));
+}
+
+void ADCSensor::updateMillivolts(double millivolts)
+{
+    // todo read scaling factors from configuration
+    rawValue = millivolts;
+    double nvalue = (rawValue / sensorScaleFactor) / scaleFactor;
+    nvalue = std::round(nvalue * roundFactor) / roundFactor;
+    updateValue(nvalue);
+}
+
+void ADCSensor::useCapture(
+    const std::shared_ptr<ADCBufferedCapture>& newCapture)
+{
+    capture = newCapture;
+    pollHandle.reset();
+    waitTimer.cancel();
+    readQueued = false;
+}
+
+void ADCSensor::checkThresholds(void)
+{
+    if (!readingStateGood())
+    {
+        return;
+    }
+
+    thresholds::checkThresholdsPowerDelay(this, thresholdTimer);
+}
+
+static std::optional<std::string> readAttribute(const fs::path& path)
+{
+    std::ifstream file(path);
+    std::string value;
+    if (!file.good() || !std::getline(file, value))
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+static std::optional<double> readNumber(const fs::path& path)
+{
+    std::optional<std::string> value = readAttribute(path);
+    if (!value)
+    {
+        return std::nullopt;
+    }
+    try
+    {
+        return std::stod(*value);
+    }
+    catch (const std::logic_error&)
+    {
+        return std::nullopt;
     }
 }
 
-void ADCSensor::handleResponse(const boost::system::error_code& err)
+static bool writeAttribute(const fs::path& path, const char* value)
 {
-    std::weak_ptr<ADCSensor> weakRef = weak_from_this();
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    size_t size = std::strlen(value);
+    bool written = write(fd, value, size) == static_cast<ssize_t>(size);
+    close(fd);
+    return written;
+}
+
+ADCBufferedCapture::ADCBufferedCapture(boost::asio::io_service& io,
+                                       const fs::path& device) :
+    io(io),
+    device(device), buffer(io), bridgeTimer(io), scanTimer(io)
+{
+    std::string node = "/dev/" + device.filename().string();
+    int fd = open(node.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Can't open " << node << ": " << std::strerror(errno)
+                  << "\n";
+        return;
+    }
+    buffer.assign(fd);
+}
 
-    if (err == boost::system::errc::bad_file_descriptor)
+ADCBufferedCapture::~ADCBufferedCapture()
+{
+    pollHandle.reset();
+    bridgeTimer.cancel();
+    scanTimer.cancel();
+    if (scanning)
     {
-        return; // we're being destroyed
+        writeAttribute(device / "buffer" / "enable", "0");
     }
-    std::istream responseStream(readBuf.get());
+    boost::system::error_code ec;
+    buffer.close(ec);
+}
 
-    if (!err)
+std::shared_ptr<ADCBufferedCapture>
+    ADCBufferedCapture::get(boost::asio::io_service& io,
+                            const std::string& name)
+{
+    static boost::container::flat_map<std::string,
+                                      std::weak_ptr<ADCBufferedCapture>>
+        captures;
+    std::weak_ptr<ADCBufferedCapture>& known = captures[name];
+    if (std::shared_ptr<ADCBufferedCapture> capture = known.lock())
     {
-        std::string response;
-        std::getline(responseStream, response);
+        return capture;
+    }
 
-        // todo read scaling factors from configuration
-        try
+    std::error_code ec;
+    for (const auto& entry :
+         fs::directory_iterator("/sys/bus/iio/devices", ec))
+    {
+        if (readAttribute(entry.path() / "name") != name)
+        {
+            continue;
+        }
+        if (!fs::exists(entry.path() / "scan_elements"))
         {
-            rawValue = std::stod(response);
-            double nvalue = (rawValue / sensorScaleFactor) / scaleFactor;
-            nvalue = std::round(nvalue * roundFactor) / roundFactor;
-            updateValue(nvalue);
+            std::cerr << "IIO device " << name
+                      << " has no buffer, reading its channels one by one\n";
+            return nullptr;
         }
-        catch (std::invalid_argument&)
+        // devices without a trigger directory capture on their own
+        std::optional<std::string> trigger =
+            readAttribute(entry.path() / "trigger" / "current_trigger");
+        if (fs::exists(entry.path() / "trigger") &&
+            (!trigger || trigger->empty()))
         {
-            incrementError();
+            std::cerr << "IIO device " << name
+                      << " has no trigger, reading its channels one by one\n";
+            return nullptr;
         }
+        auto capture = std::make_shared<ADCBufferedCapture>(io, entry.path());
+        if (!capture->buffer.is_open())
+        {
+            return nullptr;
+        }
+        known = capture;
+        return capture;
+    }
+    std::cerr << "No IIO device named " << name
+              << ", reading its channels one by one\n";
+    return nullptr;
+}
+
+bool ADCBufferedCapture::readChannel(unsigned int channel, Channel& element)
+{
+    std::string prefix = "in_voltage" + std::to_string(channel);
+    fs::path scanElements = device / "scan_elements";
+    std::optional<std::string> type = readAttribute(scanElements /
+                                                    (prefix + "_type"));
+    std::optional<double> index = readNumber(scanElements /
+                                             (prefix + "_index"));
+    if (!type || !index)
+    {
+        return false;
+    }
+
+    if (!iio::parseScanType(*type, element))
+    {
+        std::cerr << "Unsupported scan element type " << *type << " of "
+                  << prefix << "\n";
+        return false;
+    }
+
+    element.channel = channel;
+    element.scanIndex = static_cast<unsigned int>(*index);
+
+    // the scale may be per channel or shared by all of them
+    std::optional<double> scale = readNumber(device / (prefix + "_scale"));
+    if (!scale)
+    {
+        scale = readNumber(device / "in_voltage_scale");
+    }
+    element.scale = scale.value_or(1.0);
+    std::optional<double> offset = readNumber(device / (prefix + "_offset"));
+    if (!offset)
+    {
+        offset = readNumber(device / "in_voltage_offset");
+    }
+    element.rawOffset = offset.value_or(0.0);
+    return true;
+}
+
+bool ADCBufferedCapture::add(unsigned int channel,
+                             const std::shared_ptr<ADCSensor>& sensor,
+                             unsigned int sensorPollMs)
+{
+    Channel element{};
+    if (!readChannel(channel, element))
+    {
+        return false;
+    }
+    element.sensor = sensor;
+
+    auto existing = std::find_if(
+        channels.begin(), channels.end(),
+        [channel](const Channel& other) { return other.channel == channel; });
+    if (existing != channels.end())
+    {
+        *existing = element;
     }
     else
     {
-        incrementError();
+        channels.push_back(element);
     }
+    layoutChanged = true;
 
-    responseStream.clear();
-    inputDev.close();
-    if (bridgeGpio.has_value())
+    // the scan runs at the fastest rate any of the channels asks for
+    if (pollMs == 0 || sensorPollMs < pollMs)
     {
-        (*bridgeGpio).set(0);
+        pollMs = sensorPollMs;
+        pollHandle.start(io, pollMs, [this]() { startScan(); });
     }
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
+    sensor->useCapture(shared_from_this());
+    return true;
+}
+
+bool ADCBufferedCapture::configure(void)
+{
+    // only the channels of our sensors go into a scan
+    fs::path scanElements = device / "scan_elements";
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(scanElements, ec))
+    {
+        std::string fileName = entry.path().filename();
+        if (fileName.size() > 3 &&
+            fileName.compare(fileName.size() - 3, 3, "_en") == 0)
+        {
+            writeAttribute(entry.path(), "0");
+        }
+    }
+    for (const Channel& element : channels)
     {
-        std::cerr << "adcsensor " << name << " failed to open " << path << "\n";
-        return; // we're no longer valid
+        std::string enable =
+            "in_voltage" + std::to_string(element.channel) + "_en";
+        if (!writeAttribute(scanElements / enable, "1"))
+        {
+            std::cerr << "Can't enable " << (scanElements / enable) << "\n";
+            return false;
+        }
     }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
-    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
-        std::shared_ptr<ADCSensor> self = weakRef.lock();
-        if (ec == boost::asio::error::operation_aborted)
+
+    scanData.resize(iio::layoutScan(channels));
+    layoutChanged = false;
+    return true;
+}
+
+void ADCBufferedCapture::startScan(void)
+{
+    if (scanning)
+    {
+        return;
+    }
+    auto expired = std::remove_if(
+        channels.begin(), channels.end(),
+        [](const Channel& element) { return element.sensor.expired(); });
+    if (expired != channels.end())
+    {
+        channels.erase(expired, channels.end());
+        layoutChanged = true;
+    }
+    if (channels.empty())
+    {
+        pollHandle.reset();
+        pollMs = 0;
+        return;
+    }
+    if (layoutChanged && !configure())
+    {
+        for (const Channel& element : channels)
         {
-            if (self)
+            if (auto sensor = element.sensor.lock())
             {
-                std::cerr << "adcsensor " << self->name << " read cancelled\n";
+                sensor->incrementError();
             }
-            else
-            {
-                std::cerr << "adcsensor read cancelled no self\n";
-            }
-            return; // we're being canceled
         }
+        return;
+    }
 
-        if (self)
+    scanning = true;
+    bool bridged = false;
+    for (const Channel& element : channels)
+    {
+        std::shared_ptr<ADCSensor> sensor = element.sensor.lock();
+        if (sensor && sensor->hasBridge())
         {
-            self->setupRead();
+            sensor->setBridge(1);
+            bridged = true;
         }
-        else
+    }
+    if (!bridged)
+    {
+        readScan();
+        return;
+    }
+    // same settling time as for a single channel, once for all of them
+    std::weak_ptr<ADCBufferedCapture> weakRef = weak_from_this();
+    bridgeTimer.expires_from_now(
+        boost::posix_time::milliseconds(gpioBridgeEnableMs));
+    bridgeTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
         {
-            std::cerr << "adcsensor weakref no self\n";
+            return;
+        }
+        if (std::shared_ptr<ADCBufferedCapture> self = weakRef.lock())
+        {
+            self->readScan();
         }
     });
 }
 
-void ADCSensor::checkThresholds(void)
+void ADCBufferedCapture::readScan(void)
 {
-    if (!readingStateGood())
+    for (const Channel& element : channels)
+    {
+        // finishScan() only completes the reads of these
+        auto sensor = element.sensor.lock();
+        if (sensor && sensor->readingStateGood())
+        {
+            sensor->readStarted();
+        }
+    }
+    if (!writeAttribute(device / "buffer" / "enable", "1"))
     {
+        finishScan(false);
         return;
     }
 
-    thresholds::checkThresholdsPowerDelay(this, thresholdTimer);
+    std::weak_ptr<ADCBufferedCapture> weakRef = weak_from_this();
+    scanTimer.expires_from_now(boost::posix_time::milliseconds(scanTimeoutMs));
+    scanTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+        if (ec)
+        {
+            return; // the scan came in
+        }
+        if (std::shared_ptr<ADCBufferedCapture> self = weakRef.lock())
+        {
+            self->buffer.cancel();
+        }
+    });
+    boost::asio::async_read(
+        buffer, boost::asio::buffer(scanData),
+        [weakRef](const boost::system::error_code& ec, std::size_t) {
+            std::shared_ptr<ADCBufferedCapture> self = weakRef.lock();
+            if (!self)
+            {
+                return;
+            }
+            self->scanTimer.cancel();
+            self->finishScan(!ec);
+        });
+}
+
+void ADCBufferedCapture::finishScan(bool success)
+{
+    writeAttribute(device / "buffer" / "enable", "0");
+    scanning = false;
+    if (success)
+    {
+        failedScans = 0;
+    }
+    else if (++failedScans == warnAfterErrorCount)
+    {
+        std::cerr << "No scans from " << device.string()
+                  << ", is its trigger running?\n";
+    }
+
+    for (const Channel& element : channels)
+    {
+        std::shared_ptr<ADCSensor> sensor = element.sensor.lock();
+        if (!sensor)
+        {
+            continue;
+        }
+        sensor->setBridge(0);
+        if (!sensor->readingStateGood())
+        {
+            continue;
+        }
+        if (success)
+        {
+            // IIO voltages are in millivolts once scaled, like the hwmon
+            // inputs
+            sensor->updateMillivolts(iio::decode(element, scanData.data()));
+        }
+        else
+        {
+            sensor->incrementError();
+        }
+    }
 }
@@ -15,6 +15,8 @@
 */
 
 #include <ADCSensor.hpp>
+#include <HwmonIndex.hpp>
+#include <SensorDaemons.hpp>
 #include <Utils.hpp>
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
@@ -26,11 +28,9 @@
 #include <sdbusplus/bus/match.hpp>
 
 #include <filesystem>
-#include <fstream>
 #include <functional>
 #include <memory>
 #include <optional>
-#include <regex>
 #include <string>
 #include <variant>
 #include <vector>
@@ -42,26 +42,14 @@ namespace fs = std::filesystem;
 
 static constexpr std::array<const char*, 1> sensorTypes = {
     "xyz.openbmc_project.Configuration.ADC"};
-static std::regex inputRegex(R"(in(\d+)_input)");
+static constexpr HwmonAttributeMatch inputMatch{"in", "input"};
 
 static boost::container::flat_map<size_t, bool> cpuPresence;
 
 // filter out adc from any other voltage sensor
-bool isAdc(const fs::path& parentPath)
+bool isAdc(const HwmonDevice* device)
 {
-    fs::path namePath = parentPath / "name";
-
-    std::ifstream nameFile(namePath);
-    if (!nameFile.good())
-    {
-        std::cerr << "Failure reading " << namePath.string() << "\n";
-        return false;
-    }
-
-    std::string name;
-    std::getline(nameFile, name);
-
-    return name == "iio_hwmon";
+    return device != nullptr && device->name == "iio_hwmon";
 }
 
 void createSensors(
@@ -79,8 +67,8 @@ void createSensors(
                       const ManagedObjectType& sensorConfigurations) {
             bool firstScan = sensorsChanged == nullptr;
             std::vector<fs::path> paths;
-            if (!findFiles(fs::path("/sys/class/hwmon"), R"(in\d+_input)",
-                           paths))
+            HwmonIndex& hwmonIndex = HwmonIndex::getInstance(io);
+            if (!hwmonIndex.findFiles(inputMatch, paths))
             {
                 std::cerr << "No temperature sensors in system\n";
                 return;
@@ -90,19 +78,16 @@ void createSensors(
             // configuration
             for (auto& path : paths)
             {
-                if (!isAdc(path.parent_path()))
+                if (!isAdc(hwmonIndex.find(path.parent_path())))
                 {
                     continue;
                 }
-                std::smatch match;
-                std::string pathStr = path.string();
-
-                std::regex_search(pathStr, match, inputRegex);
-                std::string indexStr = *(match.begin() + 1);
+                std::string fileName = path.filename();
+                auto attribute = splitHwmonAttribute(fileName);
 
                 auto directory = path.parent_path();
                 // convert to 0 based
-                size_t index = std::stoul(indexStr) - 1;
+                size_t index = attribute->getChannel() - 1;
 
                 const SensorData* sensorData = nullptr;
                 const std::string* interfacePath = nullptr;
@@ -292,7 +277,35 @@ void createSensors(
                     path.string(), objectServer, dbusConnection, io, sensorName,
                     std::move(sensorThresholds), scaleFactor, pollRate,
                     readState, *interfacePath, std::move(bridgeGpio));
-                sensor->setupRead();
+                sensor->setPublishPolicy(
+                    getPublishPolicy(baseConfiguration->second));
+
+                // opt in to reading the channel through the IIO buffer of its
+                // ADC, together with the other channels of the device
+                bool captured = false;
+                auto findDevice = baseConfiguration->second.find("IIODevice");
+                if (findDevice != baseConfiguration->second.end())
+                {
+                    std::string deviceName = std::visit(
+                        VariantToStringVisitor(), findDevice->second);
+                    unsigned int channel = static_cast<unsigned int>(index);
+                    auto findChannel =
+                        baseConfiguration->second.find("IIOChannel");
+                    if (findChannel != baseConfiguration->second.end())
+                    {
+                        channel = std::visit(VariantToUnsignedIntVisitor(),
+                                             findChannel->second);
+                    }
+                    auto capture = ADCBufferedCapture::get(io, deviceName);
+                    captured = capture &&
+                               capture->add(channel, sensor,
+                                            static_cast<unsigned int>(
+                                                pollRate * 1000));
+                }
+                if (!captured)
+                {
+                    sensor->setupRead();
+                }
             }
         }));
 
@@ -300,22 +313,31 @@ void createSensors(
         std::vector<std::string>{sensorTypes.begin(), sensorTypes.end()});
 }
 
-int main()
+struct AdcDaemon : public SensorDaemon
 {
-    boost::asio::io_service io;
-    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
-    systemBus->request_name("xyz.openbmc_project.ADCSensor");
-    sdbusplus::asio::object_server objectServer(systemBus);
-    boost::container::flat_map<std::string, std::shared_ptr<ADCSensor>> sensors;
-    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
-    auto sensorsChanged =
+    explicit AdcDaemon(boost::asio::io_service& io) : filterTimer(io)
+    {}
+
+    boost::container::flat_map<std::string, std::shared_ptr<ADCSensor>>
+        sensors;
+    std::shared_ptr<boost::container::flat_set<std::string>> sensorsChanged =
         std::make_shared<boost::container::flat_set<std::string>>();
+    boost::asio::deadline_timer filterTimer;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
+
+std::unique_ptr<SensorDaemon>
+    setupAdcSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus)
+{
+    auto daemon = std::make_unique<AdcDaemon>(io);
+    AdcDaemon& state = *daemon;
 
     io.post([&]() {
-        createSensors(io, objectServer, sensors, systemBus, nullptr);
+        createSensors(io, objectServer, state.sensors, systemBus, nullptr);
     });
 
-    boost::asio::deadline_timer filterTimer(io);
     std::function<void(sdbusplus::message::message&)> eventHandler =
         [&](sdbusplus::message::message& message) {
             if (message.is_method_error())
@@ -323,24 +345,25 @@ int main()
                 std::cerr << "callback method error\n";
                 return;
             }
-            sensorsChanged->insert(message.get_path());
+            state.sensorsChanged->insert(message.get_path());
             // this implicitly cancels the timer
-            filterTimer.expires_from_now(boost::posix_time::seconds(1));
+            state.filterTimer.expires_from_now(boost::posix_time::seconds(1));
 
-            filterTimer.async_wait([&](const boost::system::error_code& ec) {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    /* we were canceled*/
-                    return;
-                }
-                if (ec)
-                {
-                    std::cerr << "timer error\n";
-                    return;
-                }
-                createSensors(io, objectServer, sensors, systemBus,
-                              sensorsChanged);
-            });
+            state.filterTimer.async_wait(
+                [&](const boost::system::error_code& ec) {
+                    if (ec == boost::asio::error::operation_aborted)
+                    {
+                        /* we were canceled*/
+                        return;
+                    }
+                    if (ec)
+                    {
+                        std::cerr << "timer error\n";
+                        return;
+                    }
+                    createSensors(io, objectServer, state.sensors, systemBus,
+                                  state.sensorsChanged);
+                });
         };
 
     std::function<void(sdbusplus::message::message&)> cpuPresenceHandler =
@@ -373,21 +396,23 @@ int main()
             }
 
             // this implicitly cancels the timer
-            filterTimer.expires_from_now(boost::posix_time::seconds(1));
+            state.filterTimer.expires_from_now(boost::posix_time::seconds(1));
 
-            filterTimer.async_wait([&](const boost::system::error_code& ec) {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    /* we were canceled*/
-                    return;
-                }
-                if (ec)
-                {
-                    std::cerr << "timer error\n";
-                    return;
-                }
-                createSensors(io, objectServer, sensors, systemBus, nullptr);
-            });
+            state.filterTimer.async_wait(
+                [&](const boost::system::error_code& ec) {
+                    if (ec == boost::asio::error::operation_aborted)
+                    {
+                        /* we were canceled*/
+                        return;
+                    }
+                    if (ec)
+                    {
+                        std::cerr << "timer error\n";
+                        return;
+                    }
+                    createSensors(io, objectServer, state.sensors, systemBus,
+                                  nullptr);
+                });
         };
 
     for (const char* type : sensorTypes)
@@ -397,14 +422,26 @@ int main()
             "type='signal',member='PropertiesChanged',path_namespace='" +
                 std::string(inventoryPath) + "',arg0namespace='" + type + "'",
             eventHandler);
-        matches.emplace_back(std::move(match));
+        state.matches.emplace_back(std::move(match));
     }
-    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+    state.matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
         static_cast<sdbusplus::bus::bus&>(*systemBus),
         "type='signal',member='PropertiesChanged',path_namespace='" +
             std::string(cpuInventoryPath) +
             "',arg0namespace='xyz.openbmc_project.Inventory.Item'",
         cpuPresenceHandler));
+    return daemon;
+}
 
+#ifndef COMBINED_SENSOR_DAEMON
+int main()
+{
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    systemBus->request_name("xyz.openbmc_project.ADCSensor");
+    sdbusplus::asio::object_server objectServer(systemBus);
+    std::unique_ptr<SensorDaemon> daemon =
+        setupAdcSensors(io, objectServer, systemBus);
     io.run();
 }
+#endif
@@ -14,6 +14,8 @@
 // limitations under the License.
 */
 
+#include <fcntl.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
 #include <CPUSensor.hpp>
@@ -25,14 +27,24 @@
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
-#include <istream>
 #include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// clang-format off
+// this needs to be included last or we'll have build issues
+#include <linux/peci-ioctl.h>
+#if !defined(PECI_MBX_INDEX_DDR_DIMM_TEMP)
+#define PECI_MBX_INDEX_DDR_DIMM_TEMP MBX_INDEX_DDR_DIMM_TEMP
+#endif
+// clang-format on
+
 CPUSensor::CPUSensor(const std::string& path, const std::string& objectType,
                      sdbusplus::asio::object_server& objectServer,
                      std::shared_ptr<sdbusplus::asio::connection>& conn,
@@ -43,11 +55,12 @@ CPUSensor::CPUSensor(const std::string& path, const std::string& objectType,
     Sensor(boost::replace_all_copy(sensorName, " ", "_"),
            std::move(thresholdsIn), sensorConfiguration, objectType, 0, 0, conn,
            PowerState::on),
-    objServer(objectServer), inputDev(io), waitTimer(io), path(path),
+    objServer(objectServer), inputDev(io), path(path),
     privTcontrol(std::numeric_limits<double>::quiet_NaN()),
-    dtsOffset(dtsOffset), show(show), pollTime(CPUSensor::sensorPollMs),
-    minMaxReadCounter(0)
+    dtsOffset(dtsOffset), show(show), minMaxReadCounter(0),
+    pollHandle(io, CPUSensor::sensorPollMs, [this]() { setupRead(); })
 {
+    setPoller(pollHandle, CPUSensor::sensorPollMs);
     nameTcontrol = labelTcontrol;
     nameTcontrol += " CPU" + std::to_string(cpuId);
     if (show)
@@ -101,9 +114,13 @@ CPUSensor::CPUSensor(const std::string& path, const std::string& objectType,
 
 CPUSensor::~CPUSensor()
 {
+    if (batch)
+    {
+        batch->remove(this);
+    }
     // close the input dev to cancel async operations
     inputDev.close();
-    waitTimer.cancel();
+    pollHandle.reset();
     if (show)
     {
         objServer.remove_interface(thresholdInterfaceWarning);
@@ -113,6 +130,8 @@ CPUSensor::~CPUSensor()
     }
 }
 
+// an outstanding read is cancelled by the next tick, which is how a hung PECI
+// interface gets detected in handleResponse()
 void CPUSensor::setupRead(void)
 {
     if (readingStateGood())
@@ -123,6 +142,7 @@ void CPUSensor::setupRead(void)
         {
             inputDev.assign(fd);
 
+            readStarted();
             boost::asio::async_read_until(
                 inputDev, readBuf, '\n',
                 [&](const boost::system::error_code& ec,
@@ -131,22 +151,13 @@ void CPUSensor::setupRead(void)
         else
         {
             std::cerr << name << " unable to open fd!\n";
-            pollTime = sensorFailedPollTimeMs;
+            backOff();
         }
     }
     else
     {
-        pollTime = sensorFailedPollTimeMs;
         markAvailable(false);
     }
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(pollTime));
-    waitTimer.async_wait([&](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return; // we're being canceled
-        }
-        setupRead();
-    });
 }
 
 void CPUSensor::updateMinMaxValues(void)
@@ -215,88 +226,299 @@ void CPUSensor::handleResponse(const boost::system::error_code& err)
                 std::cerr << name << " interface down!\n";
                 loggedInterfaceDown = true;
             }
-            pollTime = CPUSensor::sensorPollMs * 10u;
             markFunctional(false);
+            backOff();
         }
         return;
     }
     loggedInterfaceDown = false;
-    pollTime = CPUSensor::sensorPollMs;
-    std::istream responseStream(&readBuf);
     if (!err)
     {
-        std::string response;
-        try
+        // the buffer is contiguous, parse it in place rather than copying the
+        // line out
+        std::string_view response(
+            boost::asio::buffer_cast<const char*>(readBuf.data()),
+            readBuf.size());
+        int64_t reading = 0;
+        bool parsed = parseSysfsInteger(response, reading);
+        readBuf.consume(readBuf.size());
+        if (!parsed)
         {
-            std::getline(responseStream, response);
-            rawValue = std::stod(response);
-            responseStream.clear();
-            double nvalue = rawValue / CPUSensor::sensorScaleFactor;
+            incrementError();
+            return;
+        }
+        applyReading(reading);
+    }
+    else
+    {
+        incrementError();
+    }
+}
 
-            if (show)
+void CPUSensor::applyReading(int64_t reading)
+{
+    rawValue = static_cast<double>(reading);
+    double nvalue = rawValue / CPUSensor::sensorScaleFactor;
+    // hidden sensors don't go through updateValue()
+    resetBackoff();
+
+    if (show)
+    {
+        updateValue(nvalue);
+    }
+    else
+    {
+        value = nvalue;
+    }
+    if (minMaxReadCounter++ % 8 == 0)
+    {
+        updateMinMaxValues();
+    }
+
+    double gTcontrol = gCpuSensors[nameTcontrol]
+                           ? gCpuSensors[nameTcontrol]->value
+                           : std::numeric_limits<double>::quiet_NaN();
+    if (gTcontrol != privTcontrol)
+    {
+        privTcontrol = gTcontrol;
+
+        if (!thresholds.empty())
+        {
+            std::vector<thresholds::Threshold> newThresholds;
+            if (parseThresholdsFromAttr(newThresholds, path,
+                                        CPUSensor::sensorScaleFactor,
+                                        dtsOffset))
             {
-                updateValue(nvalue);
+                if (!std::equal(thresholds.begin(), thresholds.end(),
+                                newThresholds.begin(), newThresholds.end()))
+                {
+                    thresholds = newThresholds;
+                    if (show)
+                    {
+                        thresholds::updateThresholds(this);
+                    }
+                }
             }
             else
             {
-                value = nvalue;
-            }
-            if (minMaxReadCounter++ % 8 == 0)
-            {
-                updateMinMaxValues();
+                std::cerr << "Failure to update thresholds for " << name
+                          << "\n";
             }
+        }
+    }
+}
 
-            double gTcontrol = gCpuSensors[nameTcontrol]
-                                   ? gCpuSensors[nameTcontrol]->value
-                                   : std::numeric_limits<double>::quiet_NaN();
-            if (gTcontrol != privTcontrol)
-            {
-                privTcontrol = gTcontrol;
+void CPUSensor::readThrough(const std::shared_ptr<PeciBatch>& peciBatch,
+                            uint8_t channel, uint8_t dimm)
+{
+    pollHandle.reset();
+    inputDev.close();
+    batch = peciBatch;
+    batch->add(this, channel, dimm);
+}
 
-                if (!thresholds.empty())
-                {
-                    std::vector<thresholds::Threshold> newThresholds;
-                    if (parseThresholdsFromAttr(newThresholds, path,
-                                                CPUSensor::sensorScaleFactor,
-                                                dtsOffset))
-                    {
-                        if (!std::equal(thresholds.begin(), thresholds.end(),
-                                        newThresholds.begin(),
-                                        newThresholds.end()))
-                        {
-                            thresholds = newThresholds;
-                            if (show)
-                            {
-                                thresholds::updateThresholds(this);
-                            }
-                        }
-                    }
-                    else
-                    {
-                        std::cerr << "Failure to update thresholds for " << name
-                                  << "\n";
-                    }
-                }
+void CPUSensor::batchReading(std::optional<int64_t> reading)
+{
+    if (!readingStateGood())
+    {
+        markAvailable(false);
+        return;
+    }
+    if (!reading)
+    {
+        incrementError();
+        return;
+    }
+    applyReading(*reading);
+}
+
+void CPUSensor::checkThresholds(void)
+{
+    if (show)
+    {
+        thresholds::checkThresholds(this);
+    }
+}
+
+DimmMaxSensor::DimmMaxSensor(
+    const std::vector<std::string>& paths, const std::string& objectType,
+    sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& conn,
+    boost::asio::io_service& io, const std::string& sensorName,
+    std::vector<thresholds::Threshold>&& thresholdsIn,
+    const std::string& sensorConfiguration) :
+    Sensor(boost::replace_all_copy(sensorName, " ", "_"),
+           std::move(thresholdsIn), sensorConfiguration, objectType, 127, -128,
+           conn, PowerState::on),
+    objServer(objectServer), paths(paths),
+    pollHandle(io, CPUSensor::sensorPollMs, [this]() { read(); })
+{
+    setPoller(pollHandle, CPUSensor::sensorPollMs);
+    for (const std::string& path : paths)
+    {
+        inputs.emplace_back(std::make_unique<SysfsFile>(path));
+    }
+
+    std::string interfacePath =
+        "/xyz/openbmc_project/sensors/temperature/" + name;
+    sensorInterface = objectServer.add_interface(
+        interfacePath, "xyz.openbmc_project.Sensor.Value");
+    if (thresholds::hasWarningInterface(thresholds))
+    {
+        thresholdInterfaceWarning = objectServer.add_interface(
+            interfacePath, "xyz.openbmc_project.Sensor.Threshold.Warning");
+    }
+    if (thresholds::hasCriticalInterface(thresholds))
+    {
+        thresholdInterfaceCritical = objectServer.add_interface(
+            interfacePath, "xyz.openbmc_project.Sensor.Threshold.Critical");
+    }
+    association =
+        objectServer.add_interface(interfacePath, association::interface);
+
+    setInitialProperties(conn, sensor_paths::unitDegreesC);
+    setupPowerMatch(conn);
+}
+
+DimmMaxSensor::~DimmMaxSensor()
+{
+    pollHandle.reset();
+    objServer.remove_interface(thresholdInterfaceWarning);
+    objServer.remove_interface(thresholdInterfaceCritical);
+    objServer.remove_interface(sensorInterface);
+    objServer.remove_interface(association);
+}
+
+void DimmMaxSensor::read(void)
+{
+    if (!readingStateGood())
+    {
+        markAvailable(false);
+        return;
+    }
+    readStarted();
+    // empty slots and untrained DIMMs fail to read, the others still count
+    std::optional<int64_t> hottest;
+    for (size_t index = 0; index < inputs.size(); index++)
+    {
+        int64_t reading = 0;
+        if (inputs[index]->readInteger(reading))
+        {
+            if (!hottest || reading > *hottest)
+            {
+                hottest = reading;
             }
         }
-        catch (const std::invalid_argument&)
+        else if (errno == ENODEV)
         {
-            incrementError();
+            // the dimmtemp node goes away with the host, try it again on the
+            // next poll
+            inputs[index] = std::make_unique<SysfsFile>(paths[index]);
         }
     }
-    else
+    if (!hottest)
     {
-        pollTime = sensorFailedPollTimeMs;
         incrementError();
+        return;
     }
+    rawValue = static_cast<double>(*hottest);
+    updateValue(rawValue / CPUSensor::sensorScaleFactor);
+}
 
-    responseStream.clear();
+void DimmMaxSensor::checkThresholds(void)
+{
+    thresholds::checkThresholds(this);
 }
 
-void CPUSensor::checkThresholds(void)
+PeciBatch::PeciBatch(boost::asio::io_service& io, int bus, int addr) :
+    fd(open(("/dev/peci-" + std::to_string(bus)).c_str(), O_RDWR | O_CLOEXEC)),
+    addr(addr),
+    pollHandle(io, CPUSensor::sensorPollMs, [this]() { read(); })
 {
-    if (show)
+    if (fd < 0)
     {
-        thresholds::checkThresholds(this);
+        std::cerr << "unable to open /dev/peci-" << bus
+                  << " for batched reads\n";
+    }
+}
+
+PeciBatch::~PeciBatch()
+{
+    pollHandle.reset();
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+std::optional<std::pair<uint8_t, uint8_t>>
+    PeciBatch::parseDimmLabel(const std::string& label)
+{
+    constexpr std::string_view prefix = "DIMM ";
+    if (label.size() != prefix.size() + 2 ||
+        !boost::starts_with(label, prefix))
+    {
+        return std::nullopt;
+    }
+    char channel = label[prefix.size()];
+    char dimm = label[prefix.size() + 1];
+    if (channel < 'A' || channel > 'Z' || dimm < '1' || dimm > '4')
+    {
+        return std::nullopt;
+    }
+    return std::make_pair(static_cast<uint8_t>(channel - 'A'),
+                          static_cast<uint8_t>(dimm - '1'));
+}
+
+void PeciBatch::add(CPUSensor* sensor, uint8_t channel, uint8_t dimm)
+{
+    auto position = std::upper_bound(
+        dimms.begin(), dimms.end(), channel,
+        [](uint8_t value, const Dimm& entry) { return value < entry.channel; });
+    dimms.insert(position, {sensor, channel, dimm});
+}
+
+void PeciBatch::remove(CPUSensor* sensor)
+{
+    dimms.erase(std::remove_if(dimms.begin(), dimms.end(),
+                               [sensor](const Dimm& entry) {
+                                   return entry.sensor == sensor;
+                               }),
+                dimms.end());
+}
+
+void PeciBatch::read(void)
+{
+    size_t index = 0;
+    while (index < dimms.size())
+    {
+        uint8_t channel = dimms[index].channel;
+        struct peci_rd_pkg_cfg_msg msg = {};
+        bool valid = false;
+        if (fd >= 0 && isPowerOn())
+        {
+            msg.addr = addr;
+            msg.index = PECI_MBX_INDEX_DDR_DIMM_TEMP;
+            msg.param = channel;
+            msg.rx_len = 4;
+            valid = !ioctl(fd, PECI_IOC_RD_PKG_CFG, &msg) &&
+                    msg.cc == PECI_DEV_CC_SUCCESS;
+        }
+        for (; index < dimms.size() && dimms[index].channel == channel; index++)
+        {
+            const Dimm& entry = dimms[index];
+            // a zero reading is an empty or not yet trained slot
+            if (valid && entry.dimm < sizeof(msg.pkg_config) &&
+                msg.pkg_config[entry.dimm] != 0)
+            {
+                entry.sensor->batchReading(
+                    static_cast<int64_t>(msg.pkg_config[entry.dimm]) *
+                    CPUSensor::sensorScaleFactor);
+            }
+            else
+            {
+                entry.sensor->batchReading(std::nullopt);
+            }
+        }
     }
 }
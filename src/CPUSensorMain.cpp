@@ -17,6 +17,7 @@
 #include <fcntl.h>
 
 #include <CPUSensor.hpp>
+#include <HwmonIndex.hpp>
 #include <Utils.hpp>
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -29,10 +30,12 @@
 #include <sdbusplus/bus/match.hpp>
 
 #include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <stdexcept>
@@ -81,7 +84,45 @@ struct CPUConfig
     }
 };
 
+// one batch per PECI client, by bus and address
+static boost::container::flat_map<std::pair<int, int>,
+                                  std::shared_ptr<PeciBatch>>
+    peciBatches;
+
+// What it takes to create a CPUSensor. The lazy mode keeps it for the per
+// core and per DIMM sensors it doesn't create up front.
+struct SensorParams
+{
+    std::string path;
+    std::string sensorType;
+    std::string configuration;
+    std::string label;
+    std::vector<thresholds::Threshold> thresholds;
+    int cpuId;
+    bool show;
+    double dtsOffset;
+    int bus;
+    int addr;
+    bool batchedPeci;
+};
+
+static boost::container::flat_map<std::string, SensorParams> deferredSensors;
+static boost::container::flat_map<std::string, std::unique_ptr<DimmMaxSensor>>
+    dimmMaxSensors;
+static std::shared_ptr<sdbusplus::asio::dbus_interface> onDemandIface;
+
 static constexpr const char* peciDev = "/dev/peci-";
+
+// CPUs are only pinged for this long after a power state change, a POST
+// complete or a configuration change
+static constexpr unsigned int pingWindowSeconds = 30;
+static std::chrono::steady_clock::time_point pingDeadline;
+
+static void openPingWindow(void)
+{
+    pingDeadline = std::chrono::steady_clock::now() +
+                   std::chrono::seconds(pingWindowSeconds);
+}
 static constexpr const unsigned int rankNumMax = 8;
 
 namespace fs = std::filesystem;
@@ -89,6 +130,8 @@ namespace fs = std::filesystem;
 static constexpr const char* configPrefix =
     "xyz.openbmc_project.Configuration.";
 static constexpr std::array<const char*, 1> sensorTypes = {"XeonCPU"};
+static constexpr HwmonAttributeMatch cpuInputMatch{"temp|power",
+                                                  "input|average|cap"};
 static constexpr std::array<const char*, 3> hiddenProps = {
     CPUSensor::labelTcontrol, "Tthrottle", "Tjmax"};
 
@@ -130,6 +173,77 @@ std::string createSensorName(const std::string& label, const std::string& item,
     return sensorName;
 }
 
+static bool isPerCoreOrDimm(const std::string& label)
+{
+    return boost::starts_with(label, "Core ") ||
+           boost::starts_with(label, "DIMM ");
+}
+
+static void createCpuSensor(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    const std::string& sensorName, SensorParams&& params)
+{
+    auto& sensorPtr = gCpuSensors[sensorName];
+    // make sure destructor fires before creating a new one
+    sensorPtr = nullptr;
+    sensorPtr = std::make_unique<CPUSensor>(
+        params.path, params.sensorType, objectServer, dbusConnection, io,
+        sensorName, std::move(params.thresholds), params.configuration,
+        params.cpuId, params.show, params.dtsOffset);
+    if (params.batchedPeci)
+    {
+        if (auto dimm = PeciBatch::parseDimmLabel(params.label))
+        {
+            auto& batch =
+                peciBatches[std::make_pair(params.bus, params.addr)];
+            if (!batch)
+            {
+                batch = std::make_shared<PeciBatch>(io, params.bus,
+                                                    params.addr);
+            }
+            sensorPtr->readThrough(batch, dimm->first, dimm->second);
+        }
+    }
+}
+
+static void updateDeferred(void)
+{
+    if (!onDemandIface)
+    {
+        return;
+    }
+    std::vector<std::string> names;
+    names.reserve(deferredSensors.size());
+    for (const auto& [sensorName, params] : deferredSensors)
+    {
+        names.emplace_back(boost::replace_all_copy(sensorName, " ", "_"));
+    }
+    onDemandIface->set_property("Deferred", names);
+}
+
+// Creates one of the sensors the lazy mode held back, by its name as listed
+// in Deferred. Returns false if there is no such sensor.
+static bool createDeferredSensor(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    const std::string& requested)
+{
+    auto findDeferred =
+        deferredSensors.find(boost::replace_all_copy(requested, "_", " "));
+    if (findDeferred == deferredSensors.end())
+    {
+        return false;
+    }
+    std::string sensorName = findDeferred->first;
+    SensorParams params = std::move(findDeferred->second);
+    deferredSensors.erase(findDeferred);
+    createCpuSensor(io, objectServer, dbusConnection, sensorName,
+                    std::move(params));
+    updateDeferred();
+    return true;
+}
+
 bool createSensors(boost::asio::io_service& io,
                    sdbusplus::asio::object_server& objectServer,
                    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
@@ -166,32 +280,28 @@ bool createSensors(boost::asio::io_service& io,
         return false;
     }
 
-    std::vector<fs::path> hwmonNamePaths;
-    if (!findFiles(fs::path(R"(/sys/bus/peci/devices)"),
-                   R"(peci-\d+/\d+-.+/peci-.+/hwmon/hwmon\d+/name$)",
-                   hwmonNamePaths, 6))
+    if (!fs::exists(fs::path(R"(/sys/bus/peci/devices)")))
     {
         std::cerr << "No CPU sensors in system\n";
         return true;
     }
 
-    boost::container::flat_set<std::string> scannedDirectories;
     boost::container::flat_set<std::string> createdSensors;
 
-    for (const fs::path& hwmonNamePath : hwmonNamePaths)
+    for (const auto& [hwmonIndexName, hwmonDevice] :
+         HwmonIndex::getInstance(io).getDevices())
     {
-        const std::string& pathStr = hwmonNamePath.string();
-        auto hwmonDirectory = hwmonNamePath.parent_path();
-
-        auto ret = scannedDirectories.insert(hwmonDirectory.string());
-        if (!ret.second)
+        // PECI client hwmon devices are children of
+        // peci-N/N-addr/peci-<driver>, N-addr names the PECI client
+        const fs::path& driverPath = hwmonDevice.devicePath;
+        fs::path clientPath = driverPath.parent_path();
+        if (!boost::starts_with(driverPath.filename().string(), "peci-") ||
+            !boost::starts_with(clientPath.parent_path().filename().string(),
+                                "peci-"))
         {
-            continue; // already searched this path
+            continue;
         }
-
-        fs::path::iterator it = hwmonNamePath.begin();
-        std::advance(it, 6); // pick the 6th part for a PECI client device name
-        std::string deviceName = *it;
+        std::string deviceName = clientPath.filename();
         auto findHyphen = deviceName.find('-');
         if (findHyphen == std::string::npos)
         {
@@ -213,15 +323,7 @@ bool createSensors(boost::asio::io_service& io,
             continue;
         }
 
-        std::ifstream nameFile(hwmonNamePath);
-        if (!nameFile.good())
-        {
-            std::cerr << "Failure reading " << hwmonNamePath << "\n";
-            continue;
-        }
-        std::string hwmonName;
-        std::getline(nameFile, hwmonName);
-        nameFile.close();
+        const std::string& hwmonName = hwmonDevice.name;
         if (hwmonName.empty())
         {
             // shouldn't have an empty name file
@@ -229,8 +331,8 @@ bool createSensors(boost::asio::io_service& io,
         }
         if (debug)
         {
-            std::cout << "Checking: " << hwmonNamePath << ": " << hwmonName
-                      << "\n";
+            std::cout << "Checking: " << hwmonDevice.directory << ": "
+                      << hwmonName << "\n";
         }
 
         std::string sensorType;
@@ -293,10 +395,42 @@ bool createSensors(boost::asio::io_service& io,
         int cpuId =
             std::visit(VariantToUnsignedIntVisitor(), findCpuId->second);
 
-        auto directory = hwmonNamePath.parent_path();
+        // DIMM temperatures read in aggregate, see PeciBatch
+        bool batchedPeci = false;
+        auto findBatched = baseConfiguration->second.find("BatchedPeci");
+        if (findBatched != baseConfiguration->second.end())
+        {
+            if (auto batched = std::get_if<bool>(&findBatched->second))
+            {
+                batchedPeci = *batched;
+            }
+        }
+
+        // per core and per DIMM sensors only when asked for, see
+        // SensorParams
+        bool lazySensors = false;
+        auto findLazy = baseConfiguration->second.find("LazySensors");
+        if (findLazy != baseConfiguration->second.end())
+        {
+            if (auto lazy = std::get_if<bool>(&findLazy->second))
+            {
+                lazySensors = *lazy;
+            }
+        }
+        std::vector<std::string> eagerSensors;
+        auto findEager = baseConfiguration->second.find("EagerSensors");
+        if (findEager != baseConfiguration->second.end())
+        {
+            if (auto eager =
+                    std::get_if<std::vector<std::string>>(&findEager->second))
+            {
+                eagerSensors = *eager;
+            }
+        }
+        std::vector<std::string> dimmPaths;
+
         std::vector<fs::path> inputPaths;
-        if (!findFiles(directory, R"((temp|power)\d+_(input|average|cap)$)",
-                       inputPaths, 0))
+        if (!hwmonDevice.findFiles(cpuInputMatch, inputPaths))
         {
             std::cerr << "No temperature sensors in system\n";
             continue;
@@ -312,17 +446,15 @@ bool createSensors(boost::asio::io_service& io,
             }
             auto& [type, nr, item] = *fileParts;
             auto inputPathStr = inputPath.string();
-            auto labelPath =
-                boost::replace_all_copy(inputPathStr, item, "label");
-            std::ifstream labelFile(labelPath);
-            if (!labelFile.good())
+            std::optional<std::string> findLabel =
+                hwmonDevice.getLabel(type + nr);
+            if (!findLabel)
             {
-                std::cerr << "Failure reading " << labelPath << "\n";
+                std::cerr << "Failure reading label for " << inputPathStr
+                          << "\n";
                 continue;
             }
-            std::string label;
-            std::getline(labelFile, label);
-            labelFile.close();
+            const std::string& label = *findLabel;
 
             std::string sensorName = createSensorName(label, item, cpuId);
 
@@ -378,13 +510,32 @@ bool createSensors(boost::asio::io_service& io,
                               << sensorName << "\n";
                 }
             }
-            auto& sensorPtr = gCpuSensors[sensorName];
-            // make sure destructor fires before creating a new one
-            sensorPtr = nullptr;
-            sensorPtr = std::make_unique<CPUSensor>(
-                inputPathStr, sensorType, objectServer, dbusConnection, io,
-                sensorName, std::move(sensorThresholds), *interfacePath, cpuId,
-                show, dtsOffset);
+            SensorParams params{inputPathStr,
+                                sensorType,
+                                *interfacePath,
+                                label,
+                                std::move(sensorThresholds),
+                                cpuId,
+                                show,
+                                dtsOffset,
+                                static_cast<int>(bus),
+                                static_cast<int>(addr),
+                                batchedPeci};
+            if (lazySensors && isPerCoreOrDimm(label) &&
+                std::find(eagerSensors.begin(), eagerSensors.end(), label) ==
+                    eagerSensors.end())
+            {
+                if (type == "temp" && item == "input" &&
+                    boost::starts_with(label, "DIMM "))
+                {
+                    dimmPaths.emplace_back(inputPathStr);
+                }
+                deferredSensors[sensorName] = std::move(params);
+                continue;
+            }
+            deferredSensors.erase(sensorName);
+            createCpuSensor(io, objectServer, dbusConnection, sensorName,
+                            std::move(params));
             createdSensors.insert(sensorName);
             if (debug)
             {
@@ -392,7 +543,32 @@ bool createSensors(boost::asio::io_service& io,
                           << "\n";
             }
         }
+
+        // stands in for the DIMMs not created, thresholds as for a DIMM
+        if (!dimmPaths.empty())
+        {
+            std::string sensorName =
+                createSensorName("DIMM Max", "input", cpuId);
+            auto& sensorPtr = dimmMaxSensors[sensorName];
+            if (!sensorPtr)
+            {
+                std::vector<thresholds::Threshold> sensorThresholds;
+                std::string labelHead = "DIMM";
+                parseThresholdsFromConfig(*sensorData, sensorThresholds,
+                                          &labelHead);
+                if (sensorThresholds.empty())
+                {
+                    parseThresholdsFromAttr(sensorThresholds, dimmPaths[0],
+                                            CPUSensor::sensorScaleFactor);
+                }
+                sensorPtr = std::make_unique<DimmMaxSensor>(
+                    dimmPaths, sensorType, objectServer, dbusConnection, io,
+                    sensorName, std::move(sensorThresholds), *interfacePath);
+                createdSensors.insert(sensorName);
+            }
+        }
     }
+    updateDeferred();
 
     if (createdSensors.size())
     {
@@ -456,7 +632,7 @@ void detectCpu(boost::asio::deadline_timer& pingTimer,
                ManagedObjectType& sensorConfigs)
 {
     size_t rescanDelaySeconds = 0;
-    static bool keepPinging = false;
+    bool keepPinging = false;
 
     for (CPUConfig& config : cpuConfigs)
     {
@@ -548,11 +724,16 @@ void detectCpu(boost::asio::deadline_timer& pingTimer,
         }
     }
 
-    if (rescanDelaySeconds)
+    bool pinging =
+        keepPinging && std::chrono::steady_clock::now() < pingDeadline;
+    if (rescanDelaySeconds && !HwmonIndex::getInstance(io).isMonitored())
     {
+        // without uevents there is no telling when the hwmon nodes of the
+        // PECI client are up, give them some time
         creationTimer.expires_from_now(
             boost::posix_time::seconds(rescanDelaySeconds));
-        creationTimer.async_wait([&](const boost::system::error_code& ec) {
+        creationTimer.async_wait([&, pinging](
+                                     const boost::system::error_code& ec) {
             if (ec == boost::asio::error::operation_aborted)
             {
                 return; // we're being canceled
@@ -560,14 +741,23 @@ void detectCpu(boost::asio::deadline_timer& pingTimer,
 
             if (!createSensors(io, objectServer, dbusConnection, cpuConfigs,
                                sensorConfigs) ||
-                keepPinging)
+                pinging)
             {
                 detectCpuAsync(pingTimer, creationTimer, io, objectServer,
                                dbusConnection, cpuConfigs, sensorConfigs);
             }
         });
+        return;
+    }
+
+    if (rescanDelaySeconds)
+    {
+        // the nodes that are up already get their sensors now, the others
+        // as soon as they appear, see main()
+        createSensors(io, objectServer, dbusConnection, cpuConfigs,
+                      sensorConfigs);
     }
-    else if (keepPinging)
+    if (pinging)
     {
         detectCpuAsync(pingTimer, creationTimer, io, objectServer,
                        dbusConnection, cpuConfigs, sensorConfigs);
@@ -724,6 +914,7 @@ int main()
 
         if (getCpuConfig(systemBus, cpuConfigs, sensorConfigs, objectServer))
         {
+            openPingWindow();
             detectCpuAsync(pingTimer, creationTimer, io, objectServer,
                            systemBus, cpuConfigs, sensorConfigs);
         }
@@ -753,6 +944,7 @@ int main()
                 if (getCpuConfig(systemBus, cpuConfigs, sensorConfigs,
                                  objectServer))
                 {
+                    openPingWindow();
                     detectCpuAsync(pingTimer, creationTimer, io, objectServer,
                                    systemBus, cpuConfigs, sensorConfigs);
                 }
@@ -770,6 +962,44 @@ int main()
         matches.emplace_back(std::move(match));
     }
 
+    // CPUs come and go with the host, look for them for a while after every
+    // power state or POST change
+    setupPowerMatch(systemBus);
+    auto powerSubscription = subscribePowerState([&]() {
+        openPingWindow();
+        detectCpuAsync(pingTimer, creationTimer, io, objectServer, systemBus,
+                       cpuConfigs, sensorConfigs);
+    });
+
+    // a PECI client gets its sensors as soon as its hwmon node shows up
+    bool creationPosted = false;
+    auto hwmonSubscription = HwmonIndex::getInstance(io).subscribeAdded(
+        [&](const HwmonDevice& device) {
+            if (creationPosted ||
+                !boost::starts_with(device.devicePath.filename().string(),
+                                    "peci-"))
+            {
+                return;
+            }
+            // a client brings up several nodes at once, one scan does
+            creationPosted = true;
+            io.post([&]() {
+                creationPosted = false;
+                createSensors(io, objectServer, systemBus, cpuConfigs,
+                              sensorConfigs);
+            });
+        });
+
+    // the sensors held back by LazySensors, created on first request
+    onDemandIface =
+        objectServer.add_interface("/xyz/openbmc_project/CPUSensor",
+                                   "xyz.openbmc_project.Sensor.OnDemand");
+    onDemandIface->register_property("Deferred", std::vector<std::string>());
+    onDemandIface->register_method("Create", [&](const std::string& name) {
+        return createDeferredSensor(io, objectServer, systemBus, name);
+    });
+    onDemandIface->initialize();
+
     systemBus->request_name("xyz.openbmc_project.CPUSensor");
     io.run();
 }
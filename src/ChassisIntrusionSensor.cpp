@@ -14,34 +14,27 @@
 // limitations under the License.
 */
 
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
-
 #include <ChassisIntrusionSensor.hpp>
+#include <SmbusExecutor.hpp>
 #include <boost/asio/io_service.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
 #include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <thread>
 #include <utility>
 
-extern "C"
-{
-#include <i2c/smbus.h>
-#include <linux/i2c-dev.h>
-}
-
 static constexpr bool debug = false;
 
 static constexpr unsigned int intrusionSensorPollSec = 1;
+static constexpr unsigned int intrusionAlertConfirmSec = 60;
 
 // SMLink Status Register
-const static constexpr size_t pchStatusRegIntrusion = 0x04;
+const static constexpr uint8_t pchStatusRegIntrusion = 0x04;
 
 // Status bit field masks
 const static constexpr size_t pchRegMaskIntrusion = 0x01;
@@ -76,58 +69,23 @@ void ChassisIntrusionSensor::updateValue(const std::string& newValue)
     }
 }
 
-int ChassisIntrusionSensor::i2cReadFromPch(int busId, int slaveAddr)
+int ChassisIntrusionSensor::statusFromPch(int32_t statusValue)
 {
-    std::string i2cBus = "/dev/i2c-" + std::to_string(busId);
-
-    int fd = open(i2cBus.c_str(), O_RDWR | O_CLOEXEC);
-    if (fd < 0)
-    {
-        std::cerr << "unable to open i2c device \n";
-        return -1;
-    }
-    if (ioctl(fd, I2C_SLAVE_FORCE, slaveAddr) < 0)
-    {
-        std::cerr << "unable to set device address\n";
-        close(fd);
-        return -1;
-    }
-
-    unsigned long funcs = 0;
-    if (ioctl(fd, I2C_FUNCS, &funcs) < 0)
-    {
-        std::cerr << "not support I2C_FUNCS \n";
-        close(fd);
-        return -1;
-    }
-
-    if (!(funcs & I2C_FUNC_SMBUS_READ_BYTE_DATA))
-    {
-        std::cerr << "not support I2C_FUNC_SMBUS_READ_BYTE_DATA \n";
-        close(fd);
-        return -1;
-    }
-
-    int32_t statusMask = pchRegMaskIntrusion;
-    int32_t statusReg = pchStatusRegIntrusion;
-
-    int32_t statusValue = i2c_smbus_read_byte_data(fd, statusReg);
     if (debug)
     {
-        std::cout << "\nRead bus " << busId << " addr " << slaveAddr
+        std::cout << "\nRead bus " << mBusId << " addr " << mSlaveAddr
                   << ", value = " << statusValue << "\n";
     }
 
-    close(fd);
-
     if (statusValue < 0)
     {
-        std::cerr << "i2c_smbus_read_byte_data failed \n";
+        std::cerr << "i2c_smbus_read_byte_data failed: "
+                  << std::strerror(-statusValue) << "\n";
         return -1;
     }
 
     // Get status value with mask
-    int newValue = statusValue & statusMask;
+    int newValue = statusValue & pchRegMaskIntrusion;
 
     if (debug)
     {
@@ -140,15 +98,44 @@ int ChassisIntrusionSensor::i2cReadFromPch(int busId, int slaveAddr)
 
 void ChassisIntrusionSensor::pollSensorStatusByPch()
 {
+    // with an alert GPIO the register is only read to confirm its state
+    unsigned int pollSec =
+        mAlertLine ? intrusionAlertConfirmSec : intrusionSensorPollSec;
+
     // setting a new experation implicitly cancels any pending async wait
-    mPollTimer.expires_from_now(
-        boost::posix_time::seconds(intrusionSensorPollSec));
+    mPollTimer.expires_from_now(boost::posix_time::seconds(pollSec));
 
     mPollTimer.async_wait([&](const boost::system::error_code& ec) {
         // case of timer expired
         if (!ec)
         {
-            int statusValue = i2cReadFromPch(mBusId, mSlaveAddr);
+            readPch(true);
+        }
+        // case of being canceled
+        else if (ec == boost::asio::error::operation_aborted)
+        {
+            std::cerr << "Timer of intrusion sensor is cancelled. Return \n";
+            return;
+        }
+    });
+}
+
+void ChassisIntrusionSensor::readPch(bool pollAgain)
+{
+    // the read runs on the executor thread of the bus, polling is resumed
+    // once it is done
+    mSmbus.submit(
+        mBusId, static_cast<uint8_t>(mSlaveAddr), SmbusOp::readByteData,
+        pchStatusRegIntrusion,
+        [this, pollAgain, busId = mBusId,
+         slaveAddr = mSlaveAddr](int32_t result) {
+            // dropped if the sensor was stopped or moved meanwhile
+            if (!mInitialized || mType != IntrusionSensorType::pch ||
+                busId != mBusId || slaveAddr != mSlaveAddr)
+            {
+                return;
+            }
+            int statusValue = statusFromPch(result);
             std::string newValue = statusValue ? "HardwareIntrusion" : "Normal";
 
             if (newValue != "unknown" && mValue != newValue)
@@ -159,15 +146,92 @@ void ChassisIntrusionSensor::pollSensorStatusByPch()
             }
 
             // trigger next polling
-            pollSensorStatusByPch();
-        }
-        // case of being canceled
-        else if (ec == boost::asio::error::operation_aborted)
+            if (pollAgain)
+            {
+                pollSensorStatusByPch();
+            }
+        });
+}
+
+void ChassisIntrusionSensor::initAlertGpio(const std::string& pinName)
+{
+    releaseAlertGpio();
+    mAlertPinName = pinName;
+    if (mAlertPinName.empty())
+    {
+        return;
+    }
+
+    gpiod::line line = gpiod::find_line(mAlertPinName);
+    if (!line)
+    {
+        std::cerr << "ChassisIntrusionSensor can't find alert gpio "
+                  << mAlertPinName << ", polling the PCH\n";
+        return;
+    }
+    try
+    {
+        line.request({"ChassisIntrusionSensor",
+                      gpiod::line_request::EVENT_BOTH_EDGES, 0});
+        int lineFd = line.event_get_fd();
+        if (lineFd < 0)
         {
-            std::cerr << "Timer of intrusion sensor is cancelled. Return \n";
+            std::cerr << "ChassisIntrusionSensor failed to get "
+                      << mAlertPinName << " fd, polling the PCH\n";
+            line.release();
             return;
         }
-    });
+        mAlertFd.assign(lineFd);
+    }
+    catch (std::system_error&)
+    {
+        std::cerr << "ChassisIntrusionSensor can't request alert gpio "
+                  << mAlertPinName << ", polling the PCH\n";
+        return;
+    }
+    mAlertLine = line;
+    waitForAlert();
+}
+
+void ChassisIntrusionSensor::releaseAlertGpio()
+{
+    if (mAlertFd.is_open())
+    {
+        // the fd belongs to the line, release() closes it
+        mAlertFd.release();
+    }
+    if (mAlertLine)
+    {
+        mAlertLine.release();
+        mAlertLine = gpiod::line();
+    }
+}
+
+void ChassisIntrusionSensor::waitForAlert()
+{
+    mAlertFd.async_wait(
+        boost::asio::posix::stream_descriptor::wait_read,
+        [this](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted ||
+                ec == boost::system::errc::bad_file_descriptor)
+            {
+                return; // the alert line was released
+            }
+            if (ec)
+            {
+                std::cerr << "Error on intrusion alert gpio wait event\n";
+            }
+            else
+            {
+                mAlertLine.event_read();
+                if (debug)
+                {
+                    std::cout << "intrusion alert, reading the PCH\n";
+                }
+                readPch(false);
+            }
+            waitForAlert();
+        });
 }
 
 void ChassisIntrusionSensor::readGpio()
@@ -270,7 +334,8 @@ int ChassisIntrusionSensor::setSensorValue(const std::string& req,
 }
 
 void ChassisIntrusionSensor::start(IntrusionSensorType type, int busId,
-                                   int slaveAddr, bool gpioInverted)
+                                   int slaveAddr, bool gpioInverted,
+                                   const std::string& alertGpio)
 {
     if (debug)
     {
@@ -289,7 +354,7 @@ void ChassisIntrusionSensor::start(IntrusionSensorType type, int busId,
     }
 
     if ((type == IntrusionSensorType::pch && busId == mBusId &&
-         slaveAddr == mSlaveAddr) ||
+         slaveAddr == mSlaveAddr && alertGpio == mAlertPinName) ||
         (type == IntrusionSensorType::gpio && gpioInverted == mGpioInverted &&
          mInitialized))
     {
@@ -325,6 +390,7 @@ void ChassisIntrusionSensor::start(IntrusionSensorType type, int busId,
         // start polling value
         if (mType == IntrusionSensorType::pch)
         {
+            initAlertGpio(alertGpio);
             pollSensorStatusByPch();
         }
         else if (mType == IntrusionSensorType::gpio && mGpioLine)
@@ -342,6 +408,7 @@ void ChassisIntrusionSensor::start(IntrusionSensorType type, int busId,
             if (mType == IntrusionSensorType::pch)
             {
                 mPollTimer.cancel();
+                releaseAlertGpio();
             }
             else if (mType == IntrusionSensorType::gpio)
             {
@@ -361,8 +428,9 @@ ChassisIntrusionSensor::ChassisIntrusionSensor(
     std::shared_ptr<sdbusplus::asio::dbus_interface> iface) :
     mIface(std::move(iface)),
     mType(IntrusionSensorType::gpio), mValue("unknown"), mOldValue("unknown"),
-    mBusId(-1), mSlaveAddr(-1), mPollTimer(io), mGpioInverted(false),
-    mGpioFd(io)
+    mBusId(-1), mSlaveAddr(-1), mPollTimer(io),
+    mSmbus(SmbusExecutor::getInstance(io)), mAlertFd(io),
+    mGpioInverted(false), mGpioFd(io)
 {}
 
 ChassisIntrusionSensor::~ChassisIntrusionSensor()
@@ -370,6 +438,7 @@ ChassisIntrusionSensor::~ChassisIntrusionSensor()
     if (mType == IntrusionSensorType::pch)
     {
         mPollTimer.cancel();
+        releaseAlertGpio();
     }
     else if (mType == IntrusionSensorType::gpio)
     {
@@ -0,0 +1,385 @@
+#include <ConfigSnapshot.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+
+#ifdef ENABLE_CONFIG_CACHE
+static constexpr bool cacheEnabled = true;
+#else
+static constexpr bool cacheEnabled = false;
+#endif
+
+static constexpr bool debug = false;
+static constexpr const char* cacheDirectory = "/var/cache/dbus-sensors";
+static constexpr std::string_view magic = "DBSC";
+// bump whenever the layout below or BasicVariantType changes
+static constexpr uint32_t formatVersion = 1;
+
+namespace fs = std::filesystem;
+
+// FNV-1a, std::hash isn't guaranteed to be stable between builds
+static uint64_t hashBytes(std::string_view data,
+                          uint64_t hash = 0xcbf29ce484222325)
+{
+    for (char c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+template <typename T>
+static void writeRaw(std::string& out, T value)
+{
+    static_assert(std::is_arithmetic_v<T>);
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.append(bytes, sizeof(value));
+}
+
+static void writeString(std::string& out, const std::string& str)
+{
+    writeRaw(out, static_cast<uint32_t>(str.size()));
+    out.append(str);
+}
+
+template <typename T>
+static bool readRaw(std::string_view& in, T& value)
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if (in.size() < sizeof(value))
+    {
+        return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+static bool readString(std::string_view& in, std::string& str)
+{
+    uint32_t size = 0;
+    if (!readRaw(in, size) || in.size() < size)
+    {
+        return false;
+    }
+    str.assign(in.data(), size);
+    in.remove_prefix(size);
+    return true;
+}
+
+static void writeValue(std::string& out, const BasicVariantType& value)
+{
+    writeRaw(out, static_cast<uint8_t>(value.index()));
+    std::visit(
+        [&out](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, std::vector<std::string>>)
+            {
+                writeRaw(out, static_cast<uint32_t>(v.size()));
+                for (const std::string& str : v)
+                {
+                    writeString(out, str);
+                }
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                writeString(out, v);
+            }
+            else
+            {
+                writeRaw(out, v);
+            }
+        },
+        value);
+}
+
+// builds the variant alternative matching the stored index
+template <size_t index = 0>
+static bool readAlternative(std::string_view& in, uint8_t storedIndex,
+                            BasicVariantType& value)
+{
+    if constexpr (index == std::variant_size_v<BasicVariantType>)
+    {
+        return false;
+    }
+    else
+    {
+        if (storedIndex != index)
+        {
+            return readAlternative<index + 1>(in, storedIndex, value);
+        }
+        using T = std::variant_alternative_t<index, BasicVariantType>;
+        if constexpr (std::is_same_v<T, std::vector<std::string>>)
+        {
+            uint32_t count = 0;
+            if (!readRaw(in, count))
+            {
+                return false;
+            }
+            std::vector<std::string> strings(count);
+            for (std::string& str : strings)
+            {
+                if (!readString(in, str))
+                {
+                    return false;
+                }
+            }
+            value = std::move(strings);
+        }
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            std::string str;
+            if (!readString(in, str))
+            {
+                return false;
+            }
+            value = std::move(str);
+        }
+        else
+        {
+            T v{};
+            if (!readRaw(in, v))
+            {
+                return false;
+            }
+            value = v;
+        }
+        return true;
+    }
+}
+
+namespace config_snapshot
+{
+
+std::string serialize(const ManagedObjectType& config)
+{
+    std::string out;
+    writeRaw(out, static_cast<uint32_t>(config.size()));
+    for (const auto& [objectPath, sensorData] : config)
+    {
+        writeString(out, objectPath.str);
+        writeRaw(out, static_cast<uint32_t>(sensorData.size()));
+        for (const auto& [interface, properties] : sensorData)
+        {
+            writeString(out, interface);
+            writeRaw(out, static_cast<uint32_t>(properties.size()));
+            for (const auto& [property, value] : properties)
+            {
+                writeString(out, property);
+                writeValue(out, value);
+            }
+        }
+    }
+    return out;
+}
+
+bool deserialize(std::string_view in, ManagedObjectType& config)
+{
+    uint32_t objectCount = 0;
+    if (!readRaw(in, objectCount))
+    {
+        return false;
+    }
+    for (uint32_t object = 0; object < objectCount; object++)
+    {
+        std::string objectPath;
+        uint32_t interfaceCount = 0;
+        if (!readString(in, objectPath) || !readRaw(in, interfaceCount))
+        {
+            return false;
+        }
+        SensorData& sensorData =
+            config[sdbusplus::message::object_path(std::move(objectPath))];
+        for (uint32_t interface = 0; interface < interfaceCount; interface++)
+        {
+            std::string interfaceName;
+            uint32_t propertyCount = 0;
+            if (!readString(in, interfaceName) ||
+                !readRaw(in, propertyCount))
+            {
+                return false;
+            }
+            SensorBaseConfigMap& properties = sensorData[interfaceName];
+            for (uint32_t property = 0; property < propertyCount; property++)
+            {
+                std::string propertyName;
+                uint8_t index = 0;
+                if (!readString(in, propertyName) || !readRaw(in, index) ||
+                    !readAlternative(in, index, properties[propertyName]))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return in.empty();
+}
+
+} // namespace config_snapshot
+
+ConfigSnapshot::ConfigSnapshot(const std::string& daemonName,
+                               const std::vector<std::string>& interfaces) :
+    path(fs::path(cacheDirectory) / (daemonName + ".config")),
+    interfacesKey(hashBytes(std::string_view()))
+{
+    for (const std::string& interface : interfaces)
+    {
+        // include the terminator so {"ab", "c"} and {"a", "bc"} differ
+        interfacesKey = hashBytes(
+            std::string_view(interface.c_str(), interface.size() + 1),
+            interfacesKey);
+    }
+}
+
+uint64_t ConfigSnapshot::currentKey(void) const
+{
+    // Entity Manager rewrites its store whenever the configuration changes,
+    // e.g. after a firmware update or when a board is added
+    std::ifstream file(jsonStore, std::ios::binary);
+    if (!file.good())
+    {
+        return interfacesKey;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+    return hashBytes(contents, interfacesKey);
+}
+
+bool ConfigSnapshot::load(ManagedObjectType& config)
+{
+    if constexpr (!cacheEnabled)
+    {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good())
+    {
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+    std::string_view in(contents);
+
+    uint32_t version = 0;
+    uint64_t key = 0;
+    uint64_t checksum = 0;
+    if (in.substr(0, magic.size()) != magic)
+    {
+        std::cerr << "Ignoring malformed configuration snapshot " << path
+                  << "\n";
+        return false;
+    }
+    in.remove_prefix(magic.size());
+    if (!readRaw(in, version) || !readRaw(in, key) ||
+        !readRaw(in, checksum) || version != formatVersion ||
+        key != currentKey())
+    {
+        if constexpr (debug)
+        {
+            std::cerr << "Configuration snapshot " << path
+                      << " was written for another configuration\n";
+        }
+        return false;
+    }
+
+    ManagedObjectType snapshot;
+    if (hashBytes(in) != checksum ||
+        !config_snapshot::deserialize(in, snapshot))
+    {
+        std::cerr << "Ignoring corrupted configuration snapshot " << path
+                  << "\n";
+        return false;
+    }
+    storedKey = key;
+    current = snapshot;
+    config = std::move(snapshot);
+    return true;
+}
+
+void ConfigSnapshot::update(const ManagedObjectType& config,
+                            boost::container::flat_set<std::string>& changed)
+{
+    size_t differences = 0;
+    auto cached = current.begin();
+    auto live = config.begin();
+    // both maps are ordered by object path, walk them side by side
+    while (cached != current.end() || live != config.end())
+    {
+        if (live == config.end() ||
+            (cached != current.end() && cached->first.str < live->first.str))
+        {
+            changed.insert(cached->first.str);
+            differences++;
+            cached++;
+        }
+        else if (cached == current.end() ||
+                 live->first.str < cached->first.str)
+        {
+            changed.insert(live->first.str);
+            differences++;
+            live++;
+        }
+        else
+        {
+            if (cached->second != live->second)
+            {
+                changed.insert(live->first.str);
+                differences++;
+            }
+            cached++;
+            live++;
+        }
+    }
+    current = config;
+
+    if constexpr (!cacheEnabled)
+    {
+        return;
+    }
+    // also rewritten if only the stored configuration of Entity Manager
+    // changed, the snapshot would not be used on the next boot otherwise
+    uint64_t key = currentKey();
+    if (differences == 0 && key == storedKey)
+    {
+        return;
+    }
+
+    std::string payload = config_snapshot::serialize(config);
+    std::string contents(magic);
+    writeRaw(contents, formatVersion);
+    writeRaw(contents, key);
+    writeRaw(contents, hashBytes(payload));
+    contents += payload;
+
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    // write a temporary and rename it, so a power loss never leaves a
+    // truncated snapshot behind
+    fs::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), contents.size());
+        if (!file.good())
+        {
+            std::cerr << "Failed to write configuration snapshot " << path
+                      << "\n";
+            return;
+        }
+    }
+    fs::rename(temporary, path, ec);
+    if (ec)
+    {
+        std::cerr << "Failed to store configuration snapshot " << path << ": "
+                  << ec.message() << "\n";
+        return;
+    }
+    storedKey = key;
+}
@@ -20,6 +20,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
@@ -62,41 +63,143 @@ constexpr const std::array<const char*, 2> monitorIfaces = {exitAirIface,
 
 static std::vector<std::shared_ptr<CFMSensor>> cfmSensors;
 
-static void setupSensorMatch(
-    std::vector<sdbusplus::bus::match::match>& matches,
-    sdbusplus::bus::bus& connection, const std::string& type,
-    std::function<void(const double&, sdbusplus::message::message&)>&& callback)
+// One PropertiesChanged match per sensor namespace for the whole daemon,
+// rather than one for every sensor that listens. Sensors subscribe for the
+// objects whose path ends with a suffix, as configured tach names always
+// matched, or for every object with an empty suffix. A suffix is resolved to
+// the full object names once, when the object or the subscription shows up,
+// and signals are dispatched by object name from then on.
+struct ValueNamespace
 {
+    std::unique_ptr<sdbusplus::bus::match::match> match;
+    // by the object name below the namespace, empty for every object
+    boost::container::flat_map<std::string,
+                               std::vector<std::weak_ptr<SensorValueCallback>>>
+        subscribers;
+    std::vector<std::pair<std::string, std::weak_ptr<SensorValueCallback>>>
+        suffixes;
+    // object names the suffixes were resolved against
+    boost::container::flat_set<std::string> seen;
+};
+static boost::container::flat_map<std::string, std::unique_ptr<ValueNamespace>>
+    valueNamespaces;
+
+static void dispatchValue(ValueNamespace& space, const std::string& prefix,
+                          sdbusplus::message::message& message)
+{
+    std::string objectName;
+    boost::container::flat_map<std::string, std::variant<double, int64_t>>
+        values;
+    message.read(objectName, values);
+    auto findValue = values.find("Value");
+    if (findValue == values.end())
+    {
+        return;
+    }
+    double value = std::visit(VariantToDoubleVisitor(), findValue->second);
+    if (std::isnan(value))
+    {
+        return;
+    }
 
-    std::function<void(sdbusplus::message::message & message)> eventHandler =
-        [callback{std::move(callback)}](sdbusplus::message::message& message) {
-            std::string objectName;
-            boost::container::flat_map<std::string,
-                                       std::variant<double, int64_t>>
-                values;
-            message.read(objectName, values);
-            auto findValue = values.find("Value");
-            if (findValue == values.end())
-            {
-                return;
-            }
-            double value =
-                std::visit(VariantToDoubleVisitor(), findValue->second);
-            if (std::isnan(value))
+    std::string path = message.get_path();
+    std::string name;
+    if (boost::starts_with(path, prefix))
+    {
+        name = path.substr(prefix.size());
+    }
+    if (!name.empty() && space.seen.insert(name).second)
+    {
+        space.suffixes.erase(
+            std::remove_if(space.suffixes.begin(), space.suffixes.end(),
+                           [](const auto& entry) {
+                               return entry.second.expired();
+                           }),
+            space.suffixes.end());
+        for (const auto& [suffix, callback] : space.suffixes)
+        {
+            if (boost::ends_with(path, suffix))
             {
-                return;
+                space.subscribers[name].emplace_back(callback);
             }
+        }
+    }
+    // collected first, a callback may subscribe or unsubscribe
+    std::vector<std::shared_ptr<SensorValueCallback>> callbacks;
+    for (const std::string& key : {name, std::string()})
+    {
+        auto findSubscribers = space.subscribers.find(key);
+        if (findSubscribers == space.subscribers.end())
+        {
+            continue;
+        }
+        auto& list = findSubscribers->second;
+        list.erase(std::remove_if(list.begin(), list.end(),
+                                  [&callbacks](const auto& weak) {
+                                      auto callback = weak.lock();
+                                      if (!callback)
+                                      {
+                                          return true;
+                                      }
+                                      callbacks.emplace_back(
+                                          std::move(callback));
+                                      return false;
+                                  }),
+                   list.end());
+        if (key.empty())
+        {
+            break;
+        }
+    }
+    for (const auto& callback : callbacks)
+    {
+        (*callback)(value, message);
+    }
+}
 
-            callback(value, message);
-        };
-    matches.emplace_back(connection,
-                         "type='signal',"
-                         "member='PropertiesChanged',interface='org."
-                         "freedesktop.DBus.Properties',path_"
-                         "namespace='/xyz/openbmc_project/sensors/" +
-                             std::string(type) +
-                             "',arg0='xyz.openbmc_project.Sensor.Value'",
-                         std::move(eventHandler));
+// The callback runs for the objects whose path ends with suffix, for as long
+// as the returned handle is kept.
+static std::shared_ptr<SensorValueCallback>
+    subscribeSensorValue(sdbusplus::bus::bus& connection,
+                         const std::string& type, const std::string& suffix,
+                         SensorValueCallback&& callback)
+{
+    auto& entry = valueNamespaces[type];
+    if (!entry)
+    {
+        entry = std::make_unique<ValueNamespace>();
+    }
+    ValueNamespace& space = *entry;
+    if (!space.match)
+    {
+        std::string path = "/xyz/openbmc_project/sensors/" + type;
+        space.match = std::make_unique<sdbusplus::bus::match::match>(
+            connection,
+            "type='signal',"
+            "member='PropertiesChanged',interface='org."
+            "freedesktop.DBus.Properties',path_"
+            "namespace='" +
+                path + "',arg0='xyz.openbmc_project.Sensor.Value'",
+            [&space, prefix{path + "/"}](sdbusplus::message::message& message) {
+                dispatchValue(space, prefix, message);
+            });
+    }
+    auto handle = std::make_shared<SensorValueCallback>(std::move(callback));
+    if (suffix.empty())
+    {
+        space.subscribers[suffix].emplace_back(handle);
+        return handle;
+    }
+    space.suffixes.emplace_back(suffix, handle);
+    std::string prefix = "/xyz/openbmc_project/sensors/" + type + "/";
+    for (const std::string& name : space.seen)
+    {
+        if (boost::ends_with(prefix + name, suffix))
+        {
+            space.subscribers[name].emplace_back(handle);
+        }
+    }
+    return handle;
 }
 
 static void setMaxPWM(const std::shared_ptr<sdbusplus::asio::connection>& conn,
@@ -167,7 +270,7 @@ CFMSensor::CFMSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
            "xyz.openbmc_project.Configuration.ExitAirTemp", cfmMaxReading,
            cfmMinReading, conn, PowerState::on),
     std::enable_shared_from_this<CFMSensor>(), parent(parent),
-    objServer(objectServer)
+    updateTimer(conn->get_io_context()), objServer(objectServer)
 {
     sensorInterface =
         objectServer.add_interface("/xyz/openbmc_project/sensors/cfm/" + name,
@@ -203,27 +306,30 @@ void CFMSensor::setupMatches()
 {
 
     std::weak_ptr<CFMSensor> weakRef = weak_from_this();
-    setupSensorMatch(matches, *dbusConnection, "fan_tach",
-                     std::move([weakRef](const double& value,
-                                         sdbusplus::message::message& message) {
-                         auto self = weakRef.lock();
-                         if (!self)
-                         {
-                             return;
-                         }
-                         self->tachReadings[message.get_path()] = value;
-                         if (self->tachRanges.find(message.get_path()) ==
-                             self->tachRanges.end())
-                         {
-                             // calls update reading after updating ranges
-                             self->addTachRanges(message.get_sender(),
-                                                 message.get_path());
-                         }
-                         else
-                         {
-                             self->updateReading();
-                         }
-                     }));
+    for (const std::string& tachName : tachs)
+    {
+        valueSubscriptions.emplace_back(subscribeSensorValue(
+            *dbusConnection, "fan_tach", tachName,
+            [weakRef, tachName](double value,
+                                sdbusplus::message::message& message) {
+                auto self = weakRef.lock();
+                if (!self)
+                {
+                    return;
+                }
+                self->tachReadings[tachName] = value;
+                if (self->tachRanges.find(tachName) == self->tachRanges.end())
+                {
+                    // calls update reading after updating ranges
+                    self->addTachRanges(message.get_sender(),
+                                        message.get_path(), tachName);
+                }
+                else
+                {
+                    self->scheduleUpdate();
+                }
+            }));
+    }
 
     dbusConnection->async_method_call(
         [weakRef](const boost::system::error_code ec,
@@ -307,12 +413,13 @@ void CFMSensor::createMaxCFMIface(void)
 }
 
 void CFMSensor::addTachRanges(const std::string& serviceName,
-                              const std::string& path)
+                              const std::string& path,
+                              const std::string& tachName)
 {
     std::weak_ptr<CFMSensor> weakRef = weak_from_this();
     dbusConnection->async_method_call(
-        [weakRef,
-         path](const boost::system::error_code ec,
+        [weakRef, path,
+         tachName](const boost::system::error_code ec,
                const boost::container::flat_map<std::string, BasicVariantType>&
                    data) {
             if (ec)
@@ -327,8 +434,8 @@ void CFMSensor::addTachRanges(const std::string& serviceName,
             }
             double max = loadVariant<double>(data, "MaxValue");
             double min = loadVariant<double>(data, "MinValue");
-            self->tachRanges[path] = std::make_pair(min, max);
-            self->updateReading();
+            self->tachRanges[tachName] = std::make_pair(min, max);
+            self->scheduleUpdate();
         },
         serviceName, path, "org.freedesktop.DBus.Properties", "GetAll",
         "xyz.openbmc_project.Sensor.Value");
@@ -346,7 +453,7 @@ void CFMSensor::updateReading(void)
     {
         if (value != val && parent)
         {
-            parent->updateReading();
+            parent->scheduleUpdate();
         }
         updateValue(val);
     }
@@ -356,59 +463,70 @@ void CFMSensor::updateReading(void)
     }
 }
 
-uint64_t CFMSensor::getMaxRpm(uint64_t cfmMaxSetting)
+void CFMSensor::scheduleUpdate(void)
 {
-    uint64_t pwmPercent = 100;
-    double totalCFM = std::numeric_limits<double>::max();
-    if (cfmMaxSetting == 0)
+    if (updatePending)
     {
-        return pwmPercent;
+        return;
     }
-
-    bool firstLoop = true;
-    while (totalCFM > cfmMaxSetting)
-    {
-        if (firstLoop)
-        {
-            firstLoop = false;
-        }
-        else
-        {
-            pwmPercent--;
-        }
-
-        double ci = 0;
-        if (pwmPercent == 0)
-        {
-            ci = 0;
-        }
-        else if (pwmPercent < tachMinPercent)
-        {
-            ci = c1;
-        }
-        else if (pwmPercent > tachMaxPercent)
+    updatePending = true;
+    std::weak_ptr<CFMSensor> weakRef = weak_from_this();
+    updateTimer.expires_after(std::chrono::milliseconds(updateDelayMs));
+    updateTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
         {
-            ci = c2;
+            return; // we're being destroyed
         }
-        else
+        auto self = weakRef.lock();
+        if (!self)
         {
-            ci = c1 + (((c2 - c1) * (pwmPercent - tachMinPercent)) /
-                       (tachMaxPercent - tachMinPercent));
+            return;
         }
+        self->updatePending = false;
+        self->updateReading();
+    });
+}
 
-        // Now calculate the CFM for this tach
-        // CFMi = Ci * Qmaxi * TACHi
-        totalCFM = ci * maxCFM * pwmPercent;
-        totalCFM *= tachs.size();
-        // divide by 100 since pwm is in percent
-        totalCFM /= 100;
+// Do a linear interpolation to get Ci
+// Ci = C1 + (C2 - C1)/(RPM2 - RPM1) * (TACHi - TACH1)
+double CFMSensor::ciAt(double percent) const
+{
+    if (percent == 0)
+    {
+        return 0;
+    }
+    if (percent < tachMinPercent)
+    {
+        return c1;
+    }
+    if (percent > tachMaxPercent)
+    {
+        return c2;
+    }
+    return c1 + (((c2 - c1) * (percent - tachMinPercent)) /
+                 (tachMaxPercent - tachMinPercent));
+}
 
-        if (pwmPercent <= 0)
-        {
-            break;
-        }
+uint64_t CFMSensor::getMaxRpm(uint64_t cfmMaxSetting)
+{
+    uint64_t pwmPercent = 100;
+    if (cfmMaxSetting == 0)
+    {
+        return pwmPercent;
     }
 
+    // CFMi = Ci * Qmaxi * TACHi, divided by 100 since pwm is in percent
+    auto totalCFM = [this](uint64_t percent) {
+        return ciAt(static_cast<double>(percent)) * maxCFM *
+               static_cast<double>(percent * tachs.size()) / 100;
+    };
+    // the CFM doesn't have to grow with the PWM, with a c2 below c1 it can
+    // drop between tachMinPercent and tachMaxPercent, so scan down for the
+    // highest percentage within the limit rather than bisect
+    while (pwmPercent > 0 && totalCFM(pwmPercent) > cfmMaxSetting)
+    {
+        pwmPercent--;
+    }
     return pwmPercent;
 }
 
@@ -418,14 +536,8 @@ bool CFMSensor::calculate(double& value)
     for (const std::string& tachName : tachs)
     {
 
-        auto findReading = std::find_if(
-            tachReadings.begin(), tachReadings.end(), [&](const auto& item) {
-                return boost::ends_with(item.first, tachName);
-            });
-        auto findRange = std::find_if(
-            tachRanges.begin(), tachRanges.end(), [&](const auto& item) {
-                return boost::ends_with(item.first, tachName);
-            });
+        auto findReading = tachReadings.find(tachName);
+        auto findRange = tachRanges.find(tachName);
         if (findReading == tachReadings.end())
         {
             if constexpr (debug)
@@ -460,27 +572,7 @@ bool CFMSensor::calculate(double& value)
             std::cout << "Tach " << tachName << "at " << rpm << "\n";
         }
 
-        // Do a linear interpolation to get Ci
-        // Ci = C1 + (C2 - C1)/(RPM2 - RPM1) * (TACHi - TACH1)
-
-        double ci = 0;
-        if (rpm == 0)
-        {
-            ci = 0;
-        }
-        else if (rpm < tachMinPercent)
-        {
-            ci = c1;
-        }
-        else if (rpm > tachMaxPercent)
-        {
-            ci = c2;
-        }
-        else
-        {
-            ci = c1 + (((c2 - c1) * (rpm - tachMinPercent)) /
-                       (tachMaxPercent - tachMinPercent));
-        }
+        double ci = ciAt(rpm);
 
         // Now calculate the CFM for this tach
         // CFMi = Ci * Qmaxi * TACHi
@@ -515,7 +607,8 @@ ExitAirTempSensor::ExitAirTempSensor(
            std::move(thresholdData), sensorConfiguration,
            "xyz.openbmc_project.Configuration.ExitAirTemp", exitAirMaxReading,
            exitAirMinReading, conn, PowerState::on),
-    std::enable_shared_from_this<ExitAirTempSensor>(), objServer(objectServer)
+    std::enable_shared_from_this<ExitAirTempSensor>(),
+    updateTimer(conn->get_io_context()), objServer(objectServer)
 {
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/temperature/" + name,
@@ -555,30 +648,30 @@ void ExitAirTempSensor::setupMatches(void)
     std::weak_ptr<ExitAirTempSensor> weakRef = weak_from_this();
     for (const std::string& type : matchTypes)
     {
-        setupSensorMatch(matches, *dbusConnection, type,
-                         [weakRef, type](const double& value,
-                                         sdbusplus::message::message& message) {
-                             auto self = weakRef.lock();
-                             if (!self)
-                             {
-                                 return;
-                             }
-                             if (type == "power")
-                             {
-                                 std::string path = message.get_path();
-                                 if (path.find("PS") != std::string::npos &&
-                                     boost::ends_with(path, "Input_Power"))
-                                 {
-                                     self->powerReadings[message.get_path()] =
-                                         value;
-                                 }
-                             }
-                             else if (type == inletTemperatureSensor)
-                             {
-                                 self->inletTemp = value;
-                             }
-                             self->updateReading();
-                         });
+        valueSubscriptions.emplace_back(subscribeSensorValue(
+            *dbusConnection, type, "",
+            [weakRef, type](double value,
+                            sdbusplus::message::message& message) {
+                auto self = weakRef.lock();
+                if (!self)
+                {
+                    return;
+                }
+                if (type == "power")
+                {
+                    std::string path = message.get_path();
+                    if (path.find("PS") != std::string::npos &&
+                        boost::ends_with(path, "Input_Power"))
+                    {
+                        self->powerReadings[message.get_path()] = value;
+                    }
+                }
+                else if (type == inletTemperatureSensor)
+                {
+                    self->inletTemp = value;
+                }
+                self->scheduleUpdate();
+            }));
     }
     dbusConnection->async_method_call(
         [weakRef](boost::system::error_code ec,
@@ -670,6 +763,31 @@ void ExitAirTempSensor::updateReading(void)
     }
 }
 
+void ExitAirTempSensor::scheduleUpdate(void)
+{
+    if (updatePending)
+    {
+        return;
+    }
+    updatePending = true;
+    std::weak_ptr<ExitAirTempSensor> weakRef = weak_from_this();
+    updateTimer.expires_after(
+        std::chrono::milliseconds(CFMSensor::updateDelayMs));
+    updateTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return; // we're being destroyed
+        }
+        auto self = weakRef.lock();
+        if (!self)
+        {
+            return;
+        }
+        self->updatePending = false;
+        self->updateReading();
+    });
+}
+
 double ExitAirTempSensor::getTotalCFM(void)
 {
     double sum = 0;
@@ -178,6 +178,21 @@ void ExternalSensor::writeInvalidate(void)
     updateValue(std::numeric_limits<double>::quiet_NaN());
 }
 
+void ExternalSensor::ingest(
+    double newValue, const std::chrono::steady_clock::time_point& writtenAt)
+{
+    // the same path as a D-Bus write, which takes the Value over from
+    // internal updates and checks the thresholds
+    ingesting = true;
+    if (!sensorInterface->set_property("Value", newValue))
+    {
+        std::cerr << "ExternalSensor " << name << " rejected " << newValue
+                  << "\n";
+    }
+    ingesting = false;
+    writeBegin(writtenAt);
+}
+
 std::chrono::steady_clock::duration ExternalSensor::ageElapsed(
     const std::chrono::steady_clock::time_point& now) const
 {
@@ -194,6 +209,11 @@ std::chrono::steady_clock::duration ExternalSensor::ageRemaining(
 
 void ExternalSensor::externalSetTrigger(void)
 {
+    if (ingesting)
+    {
+        return; // ingest() takes care of it
+    }
+
     if constexpr (debug)
     {
         std::cerr << "ExternalSensor " << name << " received " << value << "\n";
@@ -10,14 +10,18 @@
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <queue>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -55,96 +59,200 @@ static constexpr bool debug = false;
 static const char* sensorType =
     "xyz.openbmc_project.Configuration.ExternalSensor";
 
-void updateReaper(boost::container::flat_map<
-                      std::string, std::shared_ptr<ExternalSensor>>& sensors,
-                  boost::asio::steady_timer& timer,
-                  const std::chrono::steady_clock::time_point& now)
+// Perishable sensors by the time they expire, earliest first. There is at
+// most one entry per sensor, a write to a sensor that already has one costs
+// nothing. When an entry comes due for a sensor that was written since, it
+// is put back at the new deadline. The timer only wakes for the earliest.
+class ExpiryQueue
 {
-    // First pass, reap all stale sensors
-    for (auto& sensor : sensors)
+  public:
+    explicit ExpiryQueue(boost::asio::io_service& io) : timer(io)
+    {}
+
+    void written(const std::shared_ptr<ExternalSensor>& sensor,
+                 const std::chrono::steady_clock::time_point& now)
+    {
+        add(sensor, now);
+        arm();
+    }
+
+    // for writes in bulk, arm() once after adding all of them
+    void add(const std::shared_ptr<ExternalSensor>& sensor,
+             const std::chrono::steady_clock::time_point& now)
     {
-        if (!sensor.second)
+        if (sensor->expiryQueued || !sensor->isAliveAndPerishable())
         {
-            continue;
+            return;
         }
+        push(sensor, now + sensor->ageRemaining(now));
+    }
 
-        if (!sensor.second->isAliveAndPerishable())
+    // (re)arms the timer for the earliest entry
+    void arm(void)
+    {
+        if (entries.empty())
         {
-            continue;
+            if constexpr (debug)
+            {
+                std::cerr << "Next ExternalSensor timer idle\n";
+            }
+            return;
+        }
+        auto deadline = entries.top().deadline;
+        if (armed && armedFor <= deadline)
+        {
+            return;
         }
+        armed = true;
+        armedFor = deadline;
+        timer.expires_at(deadline);
+        timer.async_wait([this](const boost::system::error_code& err) {
+            if (err != boost::system::errc::success)
+            {
+                // Cancellation is normal, as timer is dynamically rescheduled
+                if (err != boost::asio::error::operation_aborted)
+                {
+                    armed = false;
+                    std::cerr << "ExternalSensor timer scheduling problem: "
+                              << err.message() << "\n";
+                }
+                return;
+            }
+            armed = false;
+            reap(std::chrono::steady_clock::now());
+        });
 
-        if (!sensor.second->isAliveAndFresh(now))
+        if constexpr (debug)
         {
-            // Mark sensor as dead, no longer alive
-            sensor.second->writeInvalidate();
+            std::cerr << "Next ExternalSensor timer "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(
+                             deadline - std::chrono::steady_clock::now())
+                             .count()
+                      << " us\n";
         }
     }
 
-    std::chrono::steady_clock::duration nextCheck;
-    bool needCheck = false;
-
-    // Second pass, determine timer interval to next check
-    for (auto& sensor : sensors)
+  private:
+    struct Entry
     {
-        if (!sensor.second)
+        std::chrono::steady_clock::time_point deadline;
+        std::weak_ptr<ExternalSensor> sensor;
+
+        bool operator>(const Entry& rhs) const
         {
-            continue;
+            return deadline > rhs.deadline;
         }
+    };
 
-        if (!sensor.second->isAliveAndPerishable())
+    void push(const std::shared_ptr<ExternalSensor>& sensor,
+              const std::chrono::steady_clock::time_point& deadline)
+    {
+        sensor->expiryQueued = true;
+        entries.push(Entry{deadline, sensor});
+    }
+
+    void reap(const std::chrono::steady_clock::time_point& now)
+    {
+        while (!entries.empty() && entries.top().deadline <= now)
         {
-            continue;
+            std::shared_ptr<ExternalSensor> sensor =
+                entries.top().sensor.lock();
+            entries.pop();
+            if (!sensor)
+            {
+                continue; // removed or recreated
+            }
+            sensor->expiryQueued = false;
+            if (!sensor->isAliveAndPerishable())
+            {
+                continue;
+            }
+            if (sensor->isAliveAndFresh(now))
+            {
+                // written since this entry was queued
+                push(sensor, now + sensor->ageRemaining(now));
+                continue;
+            }
+            // Mark sensor as dead, no longer alive
+            sensor->writeInvalidate();
         }
+        arm();
+    }
 
-        auto expiration = sensor.second->ageRemaining(now);
-
-        if (needCheck)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>
+        entries;
+    boost::asio::steady_timer timer;
+    std::chrono::steady_clock::time_point armedFor;
+    bool armed = false;
+};
+
+// A sample written through SetValues: sensor name, value and the time it
+// was taken in milliseconds since the epoch, 0 for now
+using BulkSample = std::tuple<std::string, double, uint64_t>;
+
+// Applies a batch of external writes in one pass. A sensor listed more than
+// once only takes its last sample, so its thresholds are checked once, and
+// the expiry timer is armed once for the whole batch. Sensors are named as
+// in their configuration, or as on D-Bus. Returns the names not found.
+static std::vector<std::string> ingestSamples(
+    boost::container::flat_map<std::string, std::shared_ptr<ExternalSensor>>&
+        sensors,
+    ExpiryQueue& expiryQueue, const std::vector<BulkSample>& samples)
+{
+    std::vector<std::string> unknown;
+    std::vector<std::pair<ExternalSensor*, size_t>> targets;
+    targets.reserve(samples.size());
+    for (size_t index = 0; index < samples.size(); index++)
+    {
+        const std::string& sensorName = std::get<0>(samples[index]);
+        auto findSensor = sensors.find(sensorName);
+        if (findSensor == sensors.end())
         {
-            nextCheck = std::min(nextCheck, expiration);
+            findSensor =
+                sensors.find(boost::replace_all_copy(sensorName, "_", " "));
         }
-        else
+        if (findSensor == sensors.end() || !findSensor->second)
         {
-            // Initialization
-            nextCheck = expiration;
-            needCheck = true;
+            unknown.emplace_back(sensorName);
+            continue;
         }
+        targets.emplace_back(findSensor->second.get(), index);
     }
-
-    if (!needCheck)
+    // the last sample of each sensor ends up last in its run
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                         return lhs.first < rhs.first;
+                     });
+
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto systemNow = std::chrono::system_clock::now();
+    for (size_t index = 0; index < targets.size(); index++)
     {
-        if constexpr (debug)
+        if (index + 1 < targets.size() &&
+            targets[index + 1].first == targets[index].first)
         {
-            std::cerr << "Next ExternalSensor timer idle\n";
+            continue;
         }
+        ExternalSensor* sensor = targets[index].first;
+        const auto& [sensorName, newValue, timestamp] =
+            samples[targets[index].second];
 
-        return;
-    }
-
-    timer.expires_at(now + nextCheck);
-
-    timer.async_wait([&sensors, &timer](const boost::system::error_code& err) {
-        if (err != boost::system::errc::success)
+        auto writtenAt = steadyNow;
+        if (timestamp != 0)
         {
-            // Cancellation is normal, as timer is dynamically rescheduled
-            if (err != boost::asio::error::operation_aborted)
+            auto taken = std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(timestamp));
+            if (taken < systemNow)
             {
-                std::cerr << "ExternalSensor timer scheduling problem: "
-                          << err.message() << "\n";
+                writtenAt -= std::chrono::duration_cast<
+                    std::chrono::steady_clock::duration>(systemNow - taken);
             }
-            return;
         }
-
-        updateReaper(sensors, timer, std::chrono::steady_clock::now());
-    });
-
-    if constexpr (debug)
-    {
-        std::cerr << "Next ExternalSensor timer "
-                  << std::chrono::duration_cast<std::chrono::microseconds>(
-                         nextCheck)
-                         .count()
-                  << " us\n";
+        sensor->ingest(newValue, writtenAt);
+        expiryQueue.add(sensor->shared_from_this(), steadyNow);
     }
+    expiryQueue.arm();
+    return unknown;
 }
 
 void createSensors(
@@ -154,7 +262,7 @@ void createSensors(
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
     const std::shared_ptr<boost::container::flat_set<std::string>>&
         sensorsChanged,
-    boost::asio::steady_timer& reaperTimer)
+    ExpiryQueue& expiryQueue)
 {
     if constexpr (debug)
     {
@@ -164,7 +272,7 @@ void createSensors(
     auto getter = std::make_shared<GetSensorConfiguration>(
         dbusConnection,
         [&io, &objectServer, &sensors, &dbusConnection, sensorsChanged,
-         &reaperTimer](const ManagedObjectType& sensorConfigurations) {
+         &expiryQueue](const ManagedObjectType& sensorConfigurations) {
             bool firstScan = (sensorsChanged == nullptr);
 
             for (const std::pair<sdbusplus::message::object_path, SensorData>&
@@ -328,9 +436,13 @@ void createSensors(
                     sensorUnits, std::move(sensorThresholds), interfacePath,
                     maxValue, minValue, timeoutSecs, readState);
                 sensorEntry->initWriteHook(
-                    [&sensors, &reaperTimer](
+                    [&expiryQueue,
+                     weakSensor = std::weak_ptr<ExternalSensor>(sensorEntry)](
                         const std::chrono::steady_clock::time_point& now) {
-                        updateReaper(sensors, reaperTimer, now);
+                        if (auto sensor = weakSensor.lock())
+                        {
+                            expiryQueue.written(sensor, now);
+                        }
                     });
 
                 if constexpr (debug)
@@ -360,17 +472,17 @@ int main()
     std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
     auto sensorsChanged =
         std::make_shared<boost::container::flat_set<std::string>>();
-    boost::asio::steady_timer reaperTimer(io);
+    ExpiryQueue expiryQueue(io);
 
-    io.post([&io, &objectServer, &sensors, &systemBus, &reaperTimer]() {
+    io.post([&io, &objectServer, &sensors, &systemBus, &expiryQueue]() {
         createSensors(io, objectServer, sensors, systemBus, nullptr,
-                      reaperTimer);
+                      expiryQueue);
     });
 
     boost::asio::deadline_timer filterTimer(io);
     std::function<void(sdbusplus::message::message&)> eventHandler =
         [&io, &objectServer, &sensors, &systemBus, &sensorsChanged,
-         &filterTimer, &reaperTimer](sdbusplus::message::message& message) {
+         &filterTimer, &expiryQueue](sdbusplus::message::message& message) {
             if (message.is_method_error())
             {
                 std::cerr << "callback method error\n";
@@ -389,7 +501,7 @@ int main()
             filterTimer.expires_from_now(boost::posix_time::seconds(1));
 
             filterTimer.async_wait([&io, &objectServer, &sensors, &systemBus,
-                                    &sensorsChanged, &reaperTimer](
+                                    &sensorsChanged, &expiryQueue](
                                        const boost::system::error_code& ec) {
                 if (ec != boost::system::errc::success)
                 {
@@ -401,10 +513,21 @@ int main()
                 }
 
                 createSensors(io, objectServer, sensors, systemBus,
-                              sensorsChanged, reaperTimer);
+                              sensorsChanged, expiryQueue);
             });
         };
 
+    // many sensors written in one call, rather than a Set of Value each
+    auto bulkIface =
+        objectServer.add_interface("/xyz/openbmc_project/ExternalSensor",
+                                   "xyz.openbmc_project.ExternalSensor.Bulk");
+    bulkIface->register_method(
+        "SetValues",
+        [&sensors, &expiryQueue](const std::vector<BulkSample>& samples) {
+            return ingestSamples(sensors, expiryQueue, samples);
+        });
+    bulkIface->initialize();
+
     auto match = std::make_unique<sdbusplus::bus::match::match>(
         static_cast<sdbusplus::bus::bus&>(*systemBus),
         "type='signal',member='PropertiesChanged',path_namespace='" +
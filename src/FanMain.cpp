@@ -14,7 +14,9 @@
 // limitations under the License.
 */
 
+#include <HwmonIndex.hpp>
 #include <PwmSensor.hpp>
+#include <SensorDaemons.hpp>
 #include <TachSensor.hpp>
 #include <Utils.hpp>
 #include <VariantVisitors.hpp>
@@ -33,7 +35,6 @@
 #include <functional>
 #include <memory>
 #include <optional>
-#include <regex>
 #include <string>
 #include <utility>
 #include <variant>
@@ -62,11 +63,14 @@ static_assert(std::tuple_size<decltype(sensorTypes)>::value == FanTypes::max,
 
 constexpr const char* redundancyConfiguration =
     "xyz.openbmc_project.Configuration.FanRedundancy";
-static std::regex inputRegex(R"(fan(\d+)_input)");
+static constexpr HwmonAttributeMatch fanInputMatch{"fan", "input"};
 
 // todo: power supply fan redundancy
 std::optional<RedundancySensor> systemRedundancy;
 
+// configuration the tach sensors were last built from, by configuration path
+static boost::container::flat_map<std::string, SensorData> appliedConfigs;
+
 FanTypes getFanType(const fs::path& parentPath)
 {
     fs::path linkPath = parentPath / "device";
@@ -103,12 +107,12 @@ void createRedundancySensor(
     const boost::container::flat_map<std::string, std::unique_ptr<TachSensor>>&
         sensors,
     const std::shared_ptr<sdbusplus::asio::connection>& conn,
-    sdbusplus::asio::object_server& objectServer)
+    sdbusplus::asio::object_server& objectServer, boost::asio::io_service& io)
 {
 
     conn->async_method_call(
-        [&objectServer, &sensors](boost::system::error_code& ec,
-                                  const ManagedObjectType& managedObj) {
+        [&objectServer, &sensors, &io](boost::system::error_code& ec,
+                                       const ManagedObjectType& managedObj) {
             if (ec)
             {
                 std::cerr << "Error calling entity manager \n";
@@ -137,9 +141,9 @@ void createRedundancySensor(
                                 sensor.second->name);
                         }
                         systemRedundancy.reset();
-                        systemRedundancy.emplace(RedundancySensor(
+                        systemRedundancy.emplace(
                             std::get<uint64_t>(findCount->second), sensorList,
-                            objectServer, pathPair.first));
+                            objectServer, pathPair.first, io);
 
                         return;
                     }
@@ -168,8 +172,7 @@ void createSensors(
                       const ManagedObjectType& sensorConfigurations) {
             bool firstScan = sensorsChanged == nullptr;
             std::vector<fs::path> paths;
-            if (!findFiles(fs::path("/sys/class/hwmon"), R"(fan\d+_input)",
-                           paths))
+            if (!HwmonIndex::getInstance(io).findFiles(fanInputMatch, paths))
             {
                 std::cerr << "No fan sensors in system\n";
                 return;
@@ -179,17 +182,14 @@ void createSensors(
             // configuration
             for (const auto& path : paths)
             {
-                std::smatch match;
-                std::string pathStr = path.string();
-
-                std::regex_search(pathStr, match, inputRegex);
-                std::string indexStr = *(match.begin() + 1);
+                std::string fileName = path.filename();
+                auto attribute = splitHwmonAttribute(fileName);
 
                 fs::path directory = path.parent_path();
                 FanTypes fanType = getFanType(directory);
 
                 // convert to 0 based
-                size_t index = std::stoul(indexStr) - 1;
+                size_t index = attribute->getChannel() - 1;
 
                 const char* baseType;
                 const SensorData* sensorData = nullptr;
@@ -301,7 +301,6 @@ void createSensors(
                         if (boost::ends_with(*it, findSensor->second->name))
                         {
                             sensorsChanged->erase(it);
-                            findSensor->second = nullptr;
                             found = true;
                             break;
                         }
@@ -318,6 +317,46 @@ void createSensors(
                               << sensorName << "\n";
                 }
 
+                PowerState powerState = PowerState::on;
+                auto findPower = baseConfiguration->second.find("PowerState");
+                if (findPower != baseConfiguration->second.end())
+                {
+                    auto ptrPower =
+                        std::get_if<std::string>(&(findPower->second));
+                    if (ptrPower)
+                    {
+                        setReadState(*ptrPower, powerState);
+                    }
+                }
+
+                constexpr double defaultMaxReading = 25000;
+                constexpr double defaultMinReading = 0;
+                auto limits =
+                    std::make_pair(defaultMinReading, defaultMaxReading);
+                findLimits(limits, baseConfiguration);
+
+                if (findSensor != tachSensors.end())
+                {
+                    // keep the sensor on D-Bus if only what it can apply in
+                    // place has changed
+                    auto applied = appliedConfigs.find(*interfacePath);
+                    if (applied != appliedConfigs.end() &&
+                        onlyReconfigurableChanges(applied->second,
+                                                  *sensorData) &&
+                        findSensor->second->reconfigure(
+                            sensorThresholds, limits.second, limits.first,
+                            powerState))
+                    {
+                        findSensor->second->setPublishPolicy(
+                            getPublishPolicy(baseConfiguration->second));
+                        applied->second = *sensorData;
+                        continue;
+                    }
+                    // destruct it first, a presence gpio can only be
+                    // requested once
+                    findSensor->second = nullptr;
+                }
+
                 auto presenceConfig =
                     sensorData->find(baseType + std::string(".Presence"));
 
@@ -358,23 +397,6 @@ void createSensors(
                     redundancy = &systemRedundancy;
                 }
 
-                PowerState powerState = PowerState::on;
-                auto findPower = baseConfiguration->second.find("PowerState");
-                if (findPower != baseConfiguration->second.end())
-                {
-                    auto ptrPower =
-                        std::get_if<std::string>(&(findPower->second));
-                    if (ptrPower)
-                    {
-                        setReadState(*ptrPower, powerState);
-                    }
-                }
-
-                constexpr double defaultMaxReading = 25000;
-                constexpr double defaultMinReading = 0;
-                auto limits =
-                    std::make_pair(defaultMinReading, defaultMaxReading);
-
                 auto connector =
                     sensorData->find(baseType + std::string(".Connector"));
 
@@ -431,49 +453,78 @@ void createSensors(
                     }
                 }
 
-                findLimits(limits, baseConfiguration);
+                // read on sysfs notifications instead of at a fixed rate
+                bool eventDriven = false;
+                auto findEventDriven =
+                    baseConfiguration->second.find("EventDriven");
+                if (findEventDriven != baseConfiguration->second.end())
+                {
+                    if (auto ptrEventDriven =
+                            std::get_if<bool>(&findEventDriven->second))
+                    {
+                        eventDriven = *ptrEventDriven;
+                    }
+                    else
+                    {
+                        std::cerr << "Wrong format for EventDriven of "
+                                  << sensorName << "\n";
+                    }
+                }
+
                 tachSensors[sensorName] = std::make_unique<TachSensor>(
                     path.string(), baseType, objectServer, dbusConnection,
                     std::move(presenceSensor), redundancy, io, sensorName,
                     std::move(sensorThresholds), *interfacePath, limits,
-                    powerState, led);
+                    powerState, led, eventDriven);
+                tachSensors[sensorName]->setPublishPolicy(
+                    getPublishPolicy(baseConfiguration->second));
+                appliedConfigs[*interfacePath] = *sensorData;
 
                 if (!pwmPath.empty() && fs::exists(pwmPath) &&
                     !pwmSensors.count(pwmPath))
                 {
                     pwmSensors[pwmPath] = std::make_unique<PwmSensor>(
-                        pwmName, pwmPath, dbusConnection, objectServer,
+                        pwmName, pwmPath, dbusConnection, io, objectServer,
                         *interfacePath, "Fan");
                 }
             }
 
-            createRedundancySensor(tachSensors, dbusConnection, objectServer);
+            createRedundancySensor(tachSensors, dbusConnection, objectServer,
+                                   io);
         }));
     getter->getConfiguration(
         std::vector<std::string>{sensorTypes.begin(), sensorTypes.end()},
         retries);
 }
 
-int main()
+struct FanDaemon : public SensorDaemon
 {
-    boost::asio::io_service io;
-    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
-    systemBus->request_name("xyz.openbmc_project.FanSensor");
-    sdbusplus::asio::object_server objectServer(systemBus);
+    explicit FanDaemon(boost::asio::io_service& io) : filterTimer(io)
+    {}
+
     boost::container::flat_map<std::string, std::unique_ptr<TachSensor>>
         tachSensors;
     boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>
         pwmSensors;
-    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
-    auto sensorsChanged =
+    std::shared_ptr<boost::container::flat_set<std::string>> sensorsChanged =
         std::make_shared<boost::container::flat_set<std::string>>();
+    boost::asio::deadline_timer filterTimer;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
+
+std::unique_ptr<SensorDaemon>
+    setupFanSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus)
+{
+    auto daemon = std::make_unique<FanDaemon>(io);
+    FanDaemon& state = *daemon;
 
     io.post([&]() {
-        createSensors(io, objectServer, tachSensors, pwmSensors, systemBus,
-                      nullptr);
+        createSensors(io, objectServer, state.tachSensors, state.pwmSensors,
+                      systemBus, nullptr);
     });
 
-    boost::asio::deadline_timer filterTimer(io);
     std::function<void(sdbusplus::message::message&)> eventHandler =
         [&](sdbusplus::message::message& message) {
             if (message.is_method_error())
@@ -481,24 +532,26 @@ int main()
                 std::cerr << "callback method error\n";
                 return;
             }
-            sensorsChanged->insert(message.get_path());
+            state.sensorsChanged->insert(message.get_path());
             // this implicitly cancels the timer
-            filterTimer.expires_from_now(boost::posix_time::seconds(1));
+            state.filterTimer.expires_from_now(boost::posix_time::seconds(1));
 
-            filterTimer.async_wait([&](const boost::system::error_code& ec) {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    /* we were canceled*/
-                    return;
-                }
-                if (ec)
-                {
-                    std::cerr << "timer error\n";
-                    return;
-                }
-                createSensors(io, objectServer, tachSensors, pwmSensors,
-                              systemBus, sensorsChanged, 5);
-            });
+            state.filterTimer.async_wait(
+                [&](const boost::system::error_code& ec) {
+                    if (ec == boost::asio::error::operation_aborted)
+                    {
+                        /* we were canceled*/
+                        return;
+                    }
+                    if (ec)
+                    {
+                        std::cerr << "timer error\n";
+                        return;
+                    }
+                    createSensors(io, objectServer, state.tachSensors,
+                                  state.pwmSensors, systemBus,
+                                  state.sensorsChanged, 5);
+                });
         };
 
     for (const char* type : sensorTypes)
@@ -508,14 +561,14 @@ int main()
             "type='signal',member='PropertiesChanged',path_namespace='" +
                 std::string(inventoryPath) + "',arg0namespace='" + type + "'",
             eventHandler);
-        matches.emplace_back(std::move(match));
+        state.matches.emplace_back(std::move(match));
     }
 
     // redundancy sensor
     std::function<void(sdbusplus::message::message&)> redundancyHandler =
-        [&tachSensors, &systemBus,
-         &objectServer](sdbusplus::message::message&) {
-            createRedundancySensor(tachSensors, systemBus, objectServer);
+        [&systemBus, &objectServer, &io, &state](sdbusplus::message::message&) {
+            createRedundancySensor(state.tachSensors, systemBus, objectServer,
+                                   io);
         };
     auto match = std::make_unique<sdbusplus::bus::match::match>(
         static_cast<sdbusplus::bus::bus&>(*systemBus),
@@ -523,7 +576,19 @@ int main()
             std::string(inventoryPath) + "',arg0namespace='" +
             redundancyConfiguration + "'",
         std::move(redundancyHandler));
-    matches.emplace_back(std::move(match));
+    state.matches.emplace_back(std::move(match));
+    return daemon;
+}
 
+#ifndef COMBINED_SENSOR_DAEMON
+int main()
+{
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    systemBus->request_name("xyz.openbmc_project.FanSensor");
+    sdbusplus::asio::object_server objectServer(systemBus);
+    std::unique_ptr<SensorDaemon> daemon =
+        setupFanSensors(io, objectServer, systemBus);
     io.run();
 }
+#endif
@@ -0,0 +1,309 @@
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <HwmonIndex.hpp>
+#include <IoSingleton.hpp>
+#include <Utils.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static constexpr bool debug = false;
+
+const fs::path& hwmonRoot(void)
+{
+    static const fs::path root = [] {
+        const char* envRoot = std::getenv("SENSOR_HWMON_ROOT");
+        if (envRoot == nullptr || *envRoot == '\0')
+        {
+            return fs::path(defaultHwmonRoot);
+        }
+        std::cerr << "Using hwmon devices from " << envRoot << "\n";
+        return fs::path(envRoot);
+    }();
+    return root;
+}
+
+std::optional<std::string>
+    HwmonDevice::getLabel(const std::string& prefix) const
+{
+    auto findLabel = labels.find(prefix);
+    if (findLabel == labels.end())
+    {
+        return std::nullopt;
+    }
+    return findLabel->second;
+}
+
+bool HwmonDevice::findFiles(const HwmonAttributeMatch& match,
+                            std::vector<fs::path>& foundPaths) const
+{
+    for (const std::string& attribute : attributes)
+    {
+        if (match(attribute))
+        {
+            foundPaths.emplace_back(directory / attribute);
+        }
+    }
+    return true;
+}
+
+HwmonIndex& HwmonIndex::getInstance(boost::asio::io_service& io)
+{
+    std::unique_ptr<HwmonIndex>& index = IoSingleton<HwmonIndex>::get(io);
+    if (!index)
+    {
+        index = std::make_unique<HwmonIndex>(io);
+    }
+    return *index;
+}
+
+HwmonIndex::HwmonIndex(boost::asio::io_service& io) : uevents(io)
+{
+    if (hwmonRoot() != defaultHwmonRoot)
+    {
+        // uevents only describe the kernel's hwmon class
+        return;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                    NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+    {
+        std::cerr << "Unable to open uevent socket, hwmon index is rebuilt "
+                     "on every scan\n";
+        return;
+    }
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // kernel events, not the ones relayed by udev
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        std::cerr << "Unable to bind uevent socket, hwmon index is rebuilt "
+                     "on every scan\n";
+        close(fd);
+        return;
+    }
+
+    uevents.assign(fd);
+    monitored = true;
+    readEvents();
+}
+
+const boost::container::flat_map<std::string, HwmonDevice>&
+    HwmonIndex::getDevices()
+{
+    if (!monitored || !populated)
+    {
+        refresh();
+    }
+    return devices;
+}
+
+const HwmonDevice* HwmonIndex::find(const fs::path& directory)
+{
+    if (!populated)
+    {
+        refresh();
+    }
+    auto findDevice = devices.find(directory.filename().string());
+    if (findDevice == devices.end())
+    {
+        return nullptr;
+    }
+    return &findDevice->second;
+}
+
+bool HwmonIndex::findFiles(const HwmonAttributeMatch& match,
+                           std::vector<fs::path>& foundPaths)
+{
+    if (!fs::exists(hwmonRoot()))
+    {
+        return false;
+    }
+    for (const auto& [hwmonName, device] : getDevices())
+    {
+        device.findFiles(match, foundPaths);
+    }
+    return true;
+}
+
+void HwmonIndex::refresh(void)
+{
+    devices.clear();
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(hwmonRoot(), ec))
+    {
+        scan(entry.path().filename().string());
+    }
+    populated = true;
+}
+
+void HwmonIndex::scan(const std::string& hwmonName)
+{
+    HwmonDevice device;
+    device.directory = hwmonRoot() / hwmonName;
+
+    std::error_code ec;
+    device.devicePath = fs::canonical(device.directory / "device", ec);
+    if (ec)
+    {
+        device.devicePath.clear();
+    }
+
+    for (const auto& entry : fs::directory_iterator(device.directory, ec))
+    {
+        if (entry.is_directory(ec))
+        {
+            continue;
+        }
+        std::string attribute = entry.path().filename().string();
+        if (boost::ends_with(attribute, "_label"))
+        {
+            if (auto label = openAndRead(entry.path().string()))
+            {
+                device.labels[attribute.substr(0, attribute.find('_'))] =
+                    std::move(*label);
+            }
+        }
+        else if (attribute == "name")
+        {
+            device.name = openAndRead(entry.path().string()).value_or("");
+        }
+        device.attributes.emplace_back(std::move(attribute));
+    }
+    if (ec)
+    {
+        // the device went away while we were looking at it
+        devices.erase(hwmonName);
+        return;
+    }
+    std::sort(device.attributes.begin(), device.attributes.end());
+
+    if constexpr (debug)
+    {
+        std::cerr << "Indexed " << device.directory << " " << device.name
+                  << " with " << device.attributes.size() << " attributes\n";
+    }
+    devices[hwmonName] = std::move(device);
+}
+
+void HwmonIndex::readEvents(void)
+{
+    uevents.async_read_some(
+        boost::asio::buffer(eventBuffer),
+        [this](const boost::system::error_code& ec, std::size_t length) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+            if (ec == boost::asio::error::no_buffer_space)
+            {
+                // events got dropped, nothing in the index can be trusted
+                // anymore
+                populated = false;
+            }
+            else if (ec)
+            {
+                std::cerr << "uevent socket error " << ec.message()
+                          << ", hwmon index is rebuilt on every scan\n";
+                monitored = false;
+                return;
+            }
+            else
+            {
+                handleEvent(std::string_view(eventBuffer.data(), length));
+            }
+            readEvents();
+        });
+}
+
+void HwmonIndex::handleEvent(std::string_view event)
+{
+    // kernel uevents are action@devpath followed by NUL separated KEY=value
+    // pairs
+    std::string_view action;
+    std::string_view devPath;
+    std::string_view subsystem;
+    size_t pos = event.find('\0');
+    while (pos != std::string_view::npos && pos + 1 < event.size())
+    {
+        size_t end = event.find('\0', pos + 1);
+        std::string_view field = event.substr(pos + 1, end - pos - 1);
+        if (boost::starts_with(field, "ACTION="))
+        {
+            action = field.substr(7);
+        }
+        else if (boost::starts_with(field, "DEVPATH="))
+        {
+            devPath = field.substr(8);
+        }
+        else if (boost::starts_with(field, "SUBSYSTEM="))
+        {
+            subsystem = field.substr(10);
+        }
+        pos = end;
+    }
+
+    if (subsystem != "hwmon" || devPath.empty() || !populated)
+    {
+        return;
+    }
+
+    std::string hwmonName =
+        fs::path(std::string(devPath)).filename().string();
+    if (action == "remove")
+    {
+        devices.erase(hwmonName);
+        return;
+    }
+    scan(hwmonName);
+    if (action != "add")
+    {
+        return;
+    }
+    auto findDevice = devices.find(hwmonName);
+    if (findDevice == devices.end())
+    {
+        return;
+    }
+
+    // subscribers may come and go from within their callbacks, so walk a
+    // copy. The device is copied too, a callback may rescan the index.
+    HwmonDevice device = findDevice->second;
+    std::vector<std::weak_ptr<DeviceCallback>> subscribers = addedSubscribers;
+    for (const std::weak_ptr<DeviceCallback>& subscriber : subscribers)
+    {
+        if (std::shared_ptr<DeviceCallback> callback = subscriber.lock())
+        {
+            (*callback)(device);
+        }
+    }
+}
+
+std::shared_ptr<HwmonIndex::DeviceCallback>
+    HwmonIndex::subscribeAdded(DeviceCallback&& callback)
+{
+    addedSubscribers.erase(
+        std::remove_if(addedSubscribers.begin(), addedSubscribers.end(),
+                       [](const std::weak_ptr<DeviceCallback>& subscriber) {
+                           return subscriber.expired();
+                       }),
+        addedSubscribers.end());
+    // events are only followed once there is an index to update
+    if (monitored && !populated)
+    {
+        refresh();
+    }
+    auto subscription = std::make_shared<DeviceCallback>(std::move(callback));
+    addedSubscribers.emplace_back(subscription);
+    return subscription;
+}
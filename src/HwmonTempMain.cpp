@@ -14,7 +14,10 @@
 // limitations under the License.
 */
 
+#include <ConfigSnapshot.hpp>
+#include <HwmonIndex.hpp>
 #include <HwmonTempSensor.hpp>
+#include <SensorDaemons.hpp>
 #include <Utils.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -29,7 +32,6 @@
 #include <fstream>
 #include <functional>
 #include <memory>
-#include <regex>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -40,6 +42,7 @@ static constexpr bool debug = false;
 static constexpr float pollRateDefault = 0.5;
 
 namespace fs = std::filesystem;
+static constexpr HwmonAttributeMatch tempInputMatch{"temp", "input"};
 static constexpr std::array<const char*, 16> sensorTypes = {
     "xyz.openbmc_project.Configuration.EMC1412",
     "xyz.openbmc_project.Configuration.EMC1413",
@@ -58,245 +61,325 @@ static constexpr std::array<const char*, 16> sensorTypes = {
     "xyz.openbmc_project.Configuration.TMP75",
     "xyz.openbmc_project.Configuration.W83773G"};
 
-void createSensors(
+static ConfigSnapshot
+    configSnapshot("hwmontempsensor",
+                   std::vector<std::string>(sensorTypes.begin(),
+                                            sensorTypes.end()));
+// set while the sensors created from the snapshot await the live
+// configuration
+static bool createdFromSnapshot = false;
+
+using SensorMap =
+    boost::container::flat_map<std::string, std::shared_ptr<HwmonTempSensor>>;
+
+void createSensorsCallback(
     boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
-    boost::container::flat_map<std::string, std::shared_ptr<HwmonTempSensor>>&
-        sensors,
+    SensorMap& sensors,
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    const ManagedObjectType& sensorConfigurations,
     const std::shared_ptr<boost::container::flat_set<std::string>>&
         sensorsChanged)
 {
-    auto getter = std::make_shared<GetSensorConfiguration>(
-        dbusConnection,
-        std::move([&io, &objectServer, &sensors, &dbusConnection,
-                   sensorsChanged](
-                      const ManagedObjectType& sensorConfigurations) {
-            bool firstScan = sensorsChanged == nullptr;
+    bool firstScan = sensorsChanged == nullptr;
 
-            std::vector<fs::path> paths;
-            if (!findFiles(fs::path("/sys/class/hwmon"), R"(temp\d+_input)",
-                           paths))
-            {
-                std::cerr << "No temperature sensors in system\n";
-                return;
-            }
+    std::vector<fs::path> paths;
+    HwmonIndex& hwmonIndex = HwmonIndex::getInstance(io);
+    if (!hwmonIndex.findFiles(tempInputMatch, paths))
+    {
+        std::cerr << "No temperature sensors in system\n";
+        return;
+    }
 
-            boost::container::flat_set<std::string> directories;
+    boost::container::flat_set<std::string> directories;
 
-            // iterate through all found temp sensors, and try to match them
-            // with configuration
-            for (auto& path : paths)
-            {
-                std::smatch match;
-                const std::string& pathStr = path.string();
-                auto directory = path.parent_path();
+    // iterate through all found temp sensors, and try to match them
+    // with configuration
+    for (auto& path : paths)
+    {
+        const std::string& pathStr = path.string();
+        auto directory = path.parent_path();
 
-                auto ret = directories.insert(directory.string());
-                if (!ret.second)
-                {
-                    continue; // already searched this path
-                }
+        auto ret = directories.insert(directory.string());
+        if (!ret.second)
+        {
+            continue; // already searched this path
+        }
 
-                fs::path device = directory / "device";
-                std::string deviceName = fs::canonical(device).stem();
-                auto findHyphen = deviceName.find('-');
-                if (findHyphen == std::string::npos)
-                {
-                    std::cerr << "found bad device " << deviceName << "\n";
-                    continue;
-                }
-                std::string busStr = deviceName.substr(0, findHyphen);
-                std::string addrStr = deviceName.substr(findHyphen + 1);
+        const HwmonDevice* hwmonDevice = hwmonIndex.find(directory);
+        if (hwmonDevice == nullptr)
+        {
+            continue;
+        }
+        std::string deviceName = hwmonDevice->devicePath.stem();
+        auto findHyphen = deviceName.find('-');
+        if (findHyphen == std::string::npos)
+        {
+            std::cerr << "found bad device " << deviceName << "\n";
+            continue;
+        }
+        std::string busStr = deviceName.substr(0, findHyphen);
+        std::string addrStr = deviceName.substr(findHyphen + 1);
 
-                size_t bus = 0;
-                size_t addr = 0;
-                try
-                {
-                    bus = std::stoi(busStr);
-                    addr = std::stoi(addrStr, nullptr, 16);
-                }
-                catch (std::invalid_argument&)
-                {
-                    continue;
-                }
-                const SensorData* sensorData = nullptr;
-                const std::string* interfacePath = nullptr;
-                const char* sensorType = nullptr;
-                const SensorBaseConfiguration* baseConfiguration = nullptr;
-                const SensorBaseConfigMap* baseConfigMap = nullptr;
+        size_t bus = 0;
+        size_t addr = 0;
+        try
+        {
+            bus = std::stoi(busStr);
+            addr = std::stoi(addrStr, nullptr, 16);
+        }
+        catch (std::invalid_argument&)
+        {
+            continue;
+        }
+        const SensorData* sensorData = nullptr;
+        const std::string* interfacePath = nullptr;
+        const char* sensorType = nullptr;
+        const SensorBaseConfiguration* baseConfiguration = nullptr;
+        const SensorBaseConfigMap* baseConfigMap = nullptr;
 
-                for (const std::pair<sdbusplus::message::object_path,
-                                     SensorData>& sensor : sensorConfigurations)
+        for (const std::pair<sdbusplus::message::object_path,
+                             SensorData>& sensor : sensorConfigurations)
+        {
+            sensorData = &(sensor.second);
+            for (const char* type : sensorTypes)
+            {
+                auto sensorBase = sensorData->find(type);
+                if (sensorBase != sensorData->end())
                 {
-                    sensorData = &(sensor.second);
-                    for (const char* type : sensorTypes)
-                    {
-                        auto sensorBase = sensorData->find(type);
-                        if (sensorBase != sensorData->end())
-                        {
-                            baseConfiguration = &(*sensorBase);
-                            sensorType = type;
-                            break;
-                        }
-                    }
-                    if (baseConfiguration == nullptr)
-                    {
-                        std::cerr << "error finding base configuration for "
-                                  << deviceName << "\n";
-                        continue;
-                    }
-                    baseConfigMap = &baseConfiguration->second;
-                    auto configurationBus = baseConfigMap->find("Bus");
-                    auto configurationAddress = baseConfigMap->find("Address");
+                    baseConfiguration = &(*sensorBase);
+                    sensorType = type;
+                    break;
+                }
+            }
+            if (baseConfiguration == nullptr)
+            {
+                std::cerr << "error finding base configuration for "
+                          << deviceName << "\n";
+                continue;
+            }
+            baseConfigMap = &baseConfiguration->second;
+            auto configurationBus = baseConfigMap->find("Bus");
+            auto configurationAddress = baseConfigMap->find("Address");
 
-                    if (configurationBus == baseConfigMap->end() ||
-                        configurationAddress == baseConfigMap->end())
-                    {
-                        std::cerr << "error finding bus or address in "
-                                     "configuration\n";
-                        continue;
-                    }
+            if (configurationBus == baseConfigMap->end() ||
+                configurationAddress == baseConfigMap->end())
+            {
+                std::cerr << "error finding bus or address in "
+                             "configuration\n";
+                continue;
+            }
 
-                    if (std::get<uint64_t>(configurationBus->second) != bus ||
-                        std::get<uint64_t>(configurationAddress->second) !=
-                            addr)
-                    {
-                        continue;
-                    }
+            if (std::get<uint64_t>(configurationBus->second) != bus ||
+                std::get<uint64_t>(configurationAddress->second) !=
+                    addr)
+            {
+                continue;
+            }
 
-                    interfacePath = &(sensor.first.str);
-                    break;
-                }
-                if (interfacePath == nullptr)
-                {
-                    std::cerr << "failed to find match for " << deviceName
-                              << "\n";
-                    continue;
-                }
+            interfacePath = &(sensor.first.str);
+            break;
+        }
+        if (interfacePath == nullptr)
+        {
+            std::cerr << "failed to find match for " << deviceName
+                      << "\n";
+            continue;
+        }
 
-                auto findSensorName = baseConfigMap->find("Name");
-                if (findSensorName == baseConfigMap->end())
-                {
-                    std::cerr << "could not determine configuration name for "
-                              << deviceName << "\n";
-                    continue;
-                }
-                std::string sensorName =
-                    std::get<std::string>(findSensorName->second);
-                // on rescans, only update sensors we were signaled by
-                auto findSensor = sensors.find(sensorName);
-                if (!firstScan && findSensor != sensors.end())
-                {
-                    bool found = false;
-                    for (auto it = sensorsChanged->begin();
-                         it != sensorsChanged->end(); it++)
-                    {
-                        if (boost::ends_with(*it, findSensor->second->name))
-                        {
-                            sensorsChanged->erase(it);
-                            findSensor->second = nullptr;
-                            found = true;
-                            break;
-                        }
-                    }
-                    if (!found)
-                    {
-                        continue;
-                    }
-                }
-                std::vector<thresholds::Threshold> sensorThresholds;
-                if (!parseThresholdsFromConfig(*sensorData, sensorThresholds))
+        auto findSensorName = baseConfigMap->find("Name");
+        if (findSensorName == baseConfigMap->end())
+        {
+            std::cerr << "could not determine configuration name for "
+                      << deviceName << "\n";
+            continue;
+        }
+        std::string sensorName =
+            std::get<std::string>(findSensorName->second);
+        // on rescans, only update sensors we were signaled by
+        auto findSensor = sensors.find(sensorName);
+        if (!firstScan && findSensor != sensors.end())
+        {
+            bool found = false;
+            for (auto it = sensorsChanged->begin();
+                 it != sensorsChanged->end(); it++)
+            {
+                if (boost::ends_with(*it, findSensor->second->name))
                 {
-                    std::cerr << "error populating thresholds for "
-                              << sensorName << "\n";
+                    sensorsChanged->erase(it);
+                    findSensor->second = nullptr;
+                    found = true;
+                    break;
                 }
+            }
+            if (!found)
+            {
+                continue;
+            }
+        }
+        std::vector<thresholds::Threshold> sensorThresholds;
+        if (!parseThresholdsFromConfig(*sensorData, sensorThresholds))
+        {
+            std::cerr << "error populating thresholds for "
+                      << sensorName << "\n";
+        }
 
-                auto findPollRate = baseConfiguration->second.find("PollRate");
-                float pollRate = pollRateDefault;
-                if (findPollRate != baseConfiguration->second.end())
-                {
-                    pollRate = std::visit(VariantToFloatVisitor(),
-                                          findPollRate->second);
-                    if (pollRate <= 0.0f)
-                    {
-                        pollRate = pollRateDefault; // polling time too short
-                    }
-                }
+        auto findPollRate = baseConfiguration->second.find("PollRate");
+        float pollRate = pollRateDefault;
+        if (findPollRate != baseConfiguration->second.end())
+        {
+            pollRate = std::visit(VariantToFloatVisitor(),
+                                  findPollRate->second);
+            if (pollRate <= 0.0f)
+            {
+                pollRate = pollRateDefault; // polling time too short
+            }
+        }
 
-                auto findPowerOn = baseConfiguration->second.find("PowerState");
-                PowerState readState = PowerState::always;
-                if (findPowerOn != baseConfiguration->second.end())
-                {
-                    std::string powerState = std::visit(
-                        VariantToStringVisitor(), findPowerOn->second);
-                    setReadState(powerState, readState);
-                }
+        auto findPowerOn = baseConfiguration->second.find("PowerState");
+        PowerState readState = PowerState::always;
+        if (findPowerOn != baseConfiguration->second.end())
+        {
+            std::string powerState = std::visit(
+                VariantToStringVisitor(), findPowerOn->second);
+            setReadState(powerState, readState);
+        }
 
-                auto permitSet = getPermitSet(*baseConfigMap);
+        auto permitSet = getPermitSet(*baseConfigMap);
+        PublishPolicy publishPolicy = getPublishPolicy(*baseConfigMap);
+        auto& sensor = sensors[sensorName];
+        sensor = nullptr;
+        auto hwmonFile = getFullHwmonFilePath(directory.string(),
+                                              "temp1", permitSet);
+        if (hwmonFile)
+        {
+            sensor = std::make_shared<HwmonTempSensor>(
+                *hwmonFile, sensorType, objectServer, dbusConnection,
+                io, sensorName, std::move(sensorThresholds), pollRate,
+                *interfacePath, readState);
+            sensor->setPublishPolicy(publishPolicy);
+            sensor->setupRead();
+        }
+        // Looking for keys like "Name1" for temp2_input,
+        // "Name2" for temp3_input, etc.
+        int i = 0;
+        while (true)
+        {
+            ++i;
+            auto findKey =
+                baseConfigMap->find("Name" + std::to_string(i));
+            if (findKey == baseConfigMap->end())
+            {
+                break;
+            }
+            std::string sensorName =
+                std::get<std::string>(findKey->second);
+            hwmonFile = getFullHwmonFilePath(
+                directory.string(), "temp" + std::to_string(i + 1),
+                permitSet);
+            if (hwmonFile)
+            {
                 auto& sensor = sensors[sensorName];
                 sensor = nullptr;
-                auto hwmonFile = getFullHwmonFilePath(directory.string(),
-                                                      "temp1", permitSet);
-                if (hwmonFile)
-                {
-                    sensor = std::make_shared<HwmonTempSensor>(
-                        *hwmonFile, sensorType, objectServer, dbusConnection,
-                        io, sensorName, std::move(sensorThresholds), pollRate,
-                        *interfacePath, readState);
-                    sensor->setupRead();
-                }
-                // Looking for keys like "Name1" for temp2_input,
-                // "Name2" for temp3_input, etc.
-                int i = 0;
-                while (true)
-                {
-                    ++i;
-                    auto findKey =
-                        baseConfigMap->find("Name" + std::to_string(i));
-                    if (findKey == baseConfigMap->end())
-                    {
-                        break;
-                    }
-                    std::string sensorName =
-                        std::get<std::string>(findKey->second);
-                    hwmonFile = getFullHwmonFilePath(
-                        directory.string(), "temp" + std::to_string(i + 1),
-                        permitSet);
-                    if (hwmonFile)
-                    {
-                        auto& sensor = sensors[sensorName];
-                        sensor = nullptr;
-                        sensor = std::make_shared<HwmonTempSensor>(
-                            *hwmonFile, sensorType, objectServer,
-                            dbusConnection, io, sensorName,
-                            std::vector<thresholds::Threshold>(), pollRate,
-                            *interfacePath, readState);
-                        sensor->setupRead();
-                    }
-                }
+                sensor = std::make_shared<HwmonTempSensor>(
+                    *hwmonFile, sensorType, objectServer,
+                    dbusConnection, io, sensorName,
+                    std::vector<thresholds::Threshold>(), pollRate,
+                    *interfacePath, readState);
+                sensor->setPublishPolicy(publishPolicy);
+                sensor->setupRead();
+            }
+        }
+    }
+}
+
+// drops the sensors whose configuration has been removed
+static void removeStaleSensors(
+    SensorMap& sensors, const ManagedObjectType& sensorConfigurations,
+    const boost::container::flat_set<std::string>& sensorsChanged)
+{
+    for (auto it = sensors.begin(); it != sensors.end();)
+    {
+        const std::shared_ptr<HwmonTempSensor>& sensor = it->second;
+        if (sensor != nullptr &&
+            sensorsChanged.count(sensor->configurationPath) != 0 &&
+            sensorConfigurations.find(sdbusplus::message::object_path(
+                sensor->configurationPath)) == sensorConfigurations.end())
+        {
+            it = sensors.erase(it);
+            continue;
+        }
+        it++;
+    }
+}
+
+void createSensors(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    SensorMap& sensors,
+    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    const std::shared_ptr<boost::container::flat_set<std::string>>&
+        sensorsChanged)
+{
+    auto getter = std::make_shared<GetSensorConfiguration>(
+        dbusConnection,
+        std::move([&io, &objectServer, &sensors, &dbusConnection,
+                   sensorsChanged](
+                      const ManagedObjectType& sensorConfigurations) {
+            auto changed = sensorsChanged;
+            if (changed == nullptr && createdFromSnapshot)
+            {
+                // the first live configuration is handled like a rescan of
+                // everything that differs from the snapshot
+                changed =
+                    std::make_shared<boost::container::flat_set<std::string>>();
+                createdFromSnapshot = false;
+            }
+            if (changed == nullptr)
+            {
+                boost::container::flat_set<std::string> unused;
+                configSnapshot.update(sensorConfigurations, unused);
             }
+            else
+            {
+                configSnapshot.update(sensorConfigurations, *changed);
+                removeStaleSensors(sensors, sensorConfigurations, *changed);
+            }
+            createSensorsCallback(io, objectServer, sensors, dbusConnection,
+                                  sensorConfigurations, changed);
         }));
     getter->getConfiguration(
         std::vector<std::string>(sensorTypes.begin(), sensorTypes.end()));
 }
 
-int main()
+struct HwmonTempDaemon : public SensorDaemon
 {
-    boost::asio::io_service io;
-    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
-    systemBus->request_name("xyz.openbmc_project.HwmonTempSensor");
-    sdbusplus::asio::object_server objectServer(systemBus);
-    boost::container::flat_map<std::string, std::shared_ptr<HwmonTempSensor>>
-        sensors;
-    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
-    auto sensorsChanged =
+    explicit HwmonTempDaemon(boost::asio::io_service& io) : filterTimer(io)
+    {}
+
+    SensorMap sensors;
+    std::shared_ptr<boost::container::flat_set<std::string>> sensorsChanged =
         std::make_shared<boost::container::flat_set<std::string>>();
+    boost::asio::deadline_timer filterTimer;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
+
+std::unique_ptr<SensorDaemon> setupHwmonTempSensors(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& systemBus)
+{
+    auto daemon = std::make_unique<HwmonTempDaemon>(io);
+    HwmonTempDaemon& state = *daemon;
 
     io.post([&]() {
-        createSensors(io, objectServer, sensors, systemBus, nullptr);
+        ManagedObjectType snapshot;
+        if (configSnapshot.load(snapshot))
+        {
+            createSensorsCallback(io, objectServer, state.sensors, systemBus,
+                                  snapshot, nullptr);
+            createdFromSnapshot = true;
+        }
+        createSensors(io, objectServer, state.sensors, systemBus, nullptr);
     });
 
-    boost::asio::deadline_timer filterTimer(io);
     std::function<void(sdbusplus::message::message&)> eventHandler =
         [&](sdbusplus::message::message& message) {
             if (message.is_method_error())
@@ -304,24 +387,25 @@ int main()
                 std::cerr << "callback method error\n";
                 return;
             }
-            sensorsChanged->insert(message.get_path());
+            state.sensorsChanged->insert(message.get_path());
             // this implicitly cancels the timer
-            filterTimer.expires_from_now(boost::posix_time::seconds(1));
+            state.filterTimer.expires_from_now(boost::posix_time::seconds(1));
 
-            filterTimer.async_wait([&](const boost::system::error_code& ec) {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    /* we were canceled*/
-                    return;
-                }
-                if (ec)
-                {
-                    std::cerr << "timer error\n";
-                    return;
-                }
-                createSensors(io, objectServer, sensors, systemBus,
-                              sensorsChanged);
-            });
+            state.filterTimer.async_wait(
+                [&](const boost::system::error_code& ec) {
+                    if (ec == boost::asio::error::operation_aborted)
+                    {
+                        /* we were canceled*/
+                        return;
+                    }
+                    if (ec)
+                    {
+                        std::cerr << "timer error\n";
+                        return;
+                    }
+                    createSensors(io, objectServer, state.sensors, systemBus,
+                                  state.sensorsChanged);
+                });
         };
 
     for (const char* type : sensorTypes)
@@ -331,8 +415,20 @@ int main()
             "type='signal',member='PropertiesChanged',path_namespace='" +
                 std::string(inventoryPath) + "',arg0namespace='" + type + "'",
             eventHandler);
-        matches.emplace_back(std::move(match));
+        state.matches.emplace_back(std::move(match));
     }
+    return daemon;
+}
 
+#ifndef COMBINED_SENSOR_DAEMON
+int main()
+{
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    systemBus->request_name("xyz.openbmc_project.HwmonTempSensor");
+    sdbusplus::asio::object_server objectServer(systemBus);
+    std::unique_ptr<SensorDaemon> daemon =
+        setupHwmonTempSensors(io, objectServer, systemBus);
     io.run();
 }
+#endif
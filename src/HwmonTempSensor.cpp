@@ -19,13 +19,11 @@
 #include <HwmonTempSensor.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <cerrno>
 #include <iostream>
-#include <istream>
 #include <limits>
 #include <memory>
 #include <string>
@@ -48,9 +46,12 @@ HwmonTempSensor::HwmonTempSensor(
            std::move(thresholdsIn), sensorConfiguration, objectType, maxReading,
            minReading, conn, powerState),
     std::enable_shared_from_this<HwmonTempSensor>(), objServer(objectServer),
-    inputDev(io, open(path.c_str(), O_RDONLY)), waitTimer(io), path(path),
-    sensorPollMs(static_cast<unsigned int>(pollRate * 1000))
+    inputFile(std::make_shared<SysfsFile>(path)),
+    readPool(SysfsReadPool::getInstance(io)), path(path),
+    sensorPollMs(static_cast<unsigned int>(pollRate * 1000)),
+    pollHandle(io, sensorPollMs, [this]() { setupRead(); })
 {
+    setPoller(pollHandle, sensorPollMs);
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/temperature/" + name,
         "xyz.openbmc_project.Sensor.Value");
@@ -75,9 +76,7 @@ HwmonTempSensor::HwmonTempSensor(
 
 HwmonTempSensor::~HwmonTempSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
-    waitTimer.cancel();
+    pollHandle.reset();
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -86,82 +85,48 @@ HwmonTempSensor::~HwmonTempSensor()
 
 void HwmonTempSensor::setupRead(void)
 {
-    std::weak_ptr<HwmonTempSensor> weakRef = weak_from_this();
-
-    boost::asio::async_read_until(inputDev, readBuf, '\n',
-                                  [weakRef](const boost::system::error_code& ec,
-                                            std::size_t /*bytes_transfered*/) {
-                                      std::shared_ptr<HwmonTempSensor> self =
-                                          weakRef.lock();
-                                      if (self)
-                                      {
-                                          self->handleResponse(ec);
-                                      }
-                                  });
-}
-
-void HwmonTempSensor::handleResponse(const boost::system::error_code& err)
-{
-    if ((err == boost::system::errc::bad_file_descriptor) ||
-        (err == boost::asio::error::misc_errors::not_found))
-    {
-        std::cerr << "Hwmon temp sensor " << name << " removed " << path
-                  << "\n";
-        return; // we're being destroyed
-    }
-    std::istream responseStream(&readBuf);
-    if (!err)
-    {
-        std::string response;
-        std::getline(responseStream, response);
-        try
-        {
-            rawValue = std::stod(response);
-            double nvalue = rawValue / sensorScaleFactor;
-            updateValue(nvalue);
-        }
-        catch (const std::invalid_argument&)
-        {
-            incrementError();
-        }
-    }
-    else
+    if (readPool == nullptr)
     {
-        incrementError();
+        readStarted();
+        int64_t reading = 0;
+        int error = inputFile->readInteger(reading) ? 0 : errno;
+        handleResponse(reading, error);
+        return;
     }
-
-    responseStream.clear();
-    inputDev.close();
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
+    if (readQueued)
     {
-        std::cerr << "Hwmon temp sensor " << name << " not valid " << path
-                  << "\n";
-        return; // we're no longer valid
+        return; // the device is slow, that only holds up this sensor
     }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
-    std::weak_ptr<HwmonTempSensor> weakRef = weak_from_this();
-    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+    readQueued = true;
+    readStarted();
+    readPool->read(inputFile, [weakRef{weak_from_this()}](int64_t reading,
+                                                          int error) {
         std::shared_ptr<HwmonTempSensor> self = weakRef.lock();
-        if (ec == boost::asio::error::operation_aborted)
+        if (!self)
         {
-            if (self)
-            {
-                std::cerr << "Hwmon temp sensor " << self->name
-                          << " read cancelled " << self->path << "\n";
-            }
-            else
-            {
-                std::cerr << "Hwmon sensor read cancelled, no self\n";
-            }
-            return; // we're being canceled
+            return;
         }
-        if (self)
+        self->readQueued = false;
+        self->handleResponse(reading, error);
+    });
+}
+
+void HwmonTempSensor::handleResponse(int64_t reading, int error)
+{
+    if (error != 0)
+    {
+        if (error == ENODEV)
         {
-            self->setupRead();
+            std::cerr << "Hwmon temp sensor " << name << " removed " << path
+                      << "\n";
+            pollHandle.reset();
+            return; // we're no longer valid
         }
-    });
+        incrementError();
+        return;
+    }
+    rawValue = static_cast<double>(reading);
+    updateValue(rawValue / sensorScaleFactor);
 }
 
 void HwmonTempSensor::checkThresholds(void)
@@ -0,0 +1,241 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <I2CArbiter.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <string>
+
+static int64_t monotonicNs(void)
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static int lockFile(int fd, int operation)
+{
+    int rc = 0;
+    do
+    {
+        rc = flock(fd, operation);
+    } while (rc < 0 && errno == EINTR);
+    return rc;
+}
+
+I2CArbiter& I2CArbiter::getInstance(void)
+{
+    static I2CArbiter arbiter;
+    return arbiter;
+}
+
+I2CArbiter::Bus::~Bus()
+{
+    if (state != nullptr)
+    {
+        munmap(state, sizeof(i2c_arbiter::BusState));
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+I2CArbiter::Bus& I2CArbiter::getBus(int busId)
+{
+    std::lock_guard<std::mutex> guard(busesLock);
+    auto& bus = buses[busId];
+    if (!bus)
+    {
+        bus = std::make_unique<Bus>();
+        open(busId, *bus);
+    }
+    return *bus;
+}
+
+void I2CArbiter::open(int busId, Bus& bus)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(i2c_arbiter::directory, ec);
+    std::string path =
+        std::string(i2c_arbiter::directory) + "/bus-" + std::to_string(busId);
+    // every daemon using the bus opens the same file, whichever comes first
+    // initializes it with the file locked
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        std::cerr << "Can't open " << path << ", bus " << busId
+                  << " is not arbitrated: " << strerror(errno) << "\n";
+        return;
+    }
+    if (lockFile(fd, LOCK_EX) < 0)
+    {
+        std::cerr << "Can't lock " << path << ": " << strerror(errno) << "\n";
+        close(fd);
+        return;
+    }
+
+    struct stat status = {};
+    bool fresh = fstat(fd, &status) != 0 ||
+                 static_cast<size_t>(status.st_size) <
+                     sizeof(i2c_arbiter::BusState);
+    void* mapping = MAP_FAILED;
+    if (!fresh ||
+        ftruncate(fd, static_cast<off_t>(sizeof(i2c_arbiter::BusState))) == 0)
+    {
+        mapping = mmap(nullptr, sizeof(i2c_arbiter::BusState),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Can't map " << path << ": " << strerror(errno) << "\n";
+        lockFile(fd, LOCK_UN);
+        close(fd);
+        return;
+    }
+
+    auto state = static_cast<i2c_arbiter::BusState*>(mapping);
+    if (fresh || state->magic != i2c_arbiter::magic ||
+        state->version != i2c_arbiter::version)
+    {
+        state = new (mapping) i2c_arbiter::BusState{};
+        state->magic = i2c_arbiter::magic;
+        state->version = i2c_arbiter::version;
+        state->createdNs = monotonicNs();
+    }
+    lockFile(fd, LOCK_UN);
+    bus.fd = fd;
+    bus.state = state;
+}
+
+int32_t I2CArbiter::transact(int busId,
+                             const std::function<int32_t()>& transfer)
+{
+    Bus& bus = getBus(busId);
+    if (bus.state == nullptr)
+    {
+        return transfer();
+    }
+
+    std::lock_guard<std::mutex> guard(bus.lock);
+    i2c_arbiter::BusState& state = *bus.state;
+    uint32_t depth =
+        state.queueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t peak = state.peakQueueDepth.load(std::memory_order_relaxed);
+    while (depth > peak && !state.peakQueueDepth.compare_exchange_weak(
+                               peak, depth, std::memory_order_relaxed))
+    {}
+
+    int64_t requested = monotonicNs();
+    if (lockFile(bus.fd, LOCK_EX) < 0)
+    {
+        state.queueDepth.fetch_sub(1, std::memory_order_relaxed);
+        return transfer();
+    }
+    int64_t start = monotonicNs();
+    int64_t earliest = state.lastEndNs.load(std::memory_order_relaxed) +
+                       bus.minimumGap.count();
+    if (start < earliest)
+    {
+        timespec until{};
+        until.tv_sec = earliest / 1000000000;
+        until.tv_nsec = earliest % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until,
+                               nullptr) == EINTR)
+        {}
+        start = monotonicNs();
+    }
+
+    return run(bus, requested, start, transfer);
+}
+
+std::optional<int32_t>
+    I2CArbiter::tryTransact(int busId,
+                            const std::function<int32_t()>& transfer,
+                            std::chrono::nanoseconds& retryAfter)
+{
+    Bus& bus = getBus(busId);
+    if (bus.state == nullptr)
+    {
+        return transfer();
+    }
+
+    std::unique_lock<std::mutex> guard(bus.lock, std::try_to_lock);
+    retryAfter = bus.minimumGap;
+    if (!guard.owns_lock())
+    {
+        return std::nullopt;
+    }
+    i2c_arbiter::BusState& state = *bus.state;
+    int64_t start = monotonicNs();
+    int64_t earliest = state.lastEndNs.load(std::memory_order_relaxed) +
+                       bus.minimumGap.count();
+    if (start < earliest)
+    {
+        retryAfter = std::chrono::nanoseconds(earliest - start);
+        return std::nullopt;
+    }
+    if (lockFile(bus.fd, LOCK_EX | LOCK_NB) < 0)
+    {
+        if (errno == EWOULDBLOCK)
+        {
+            return std::nullopt;
+        }
+        return transfer();
+    }
+    // another daemon may have finished a transaction while we were checking
+    earliest = state.lastEndNs.load(std::memory_order_relaxed) +
+               bus.minimumGap.count();
+    if (start < earliest)
+    {
+        lockFile(bus.fd, LOCK_UN);
+        retryAfter = std::chrono::nanoseconds(earliest - start);
+        return std::nullopt;
+    }
+
+    uint32_t depth =
+        state.queueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t peak = state.peakQueueDepth.load(std::memory_order_relaxed);
+    while (depth > peak && !state.peakQueueDepth.compare_exchange_weak(
+                               peak, depth, std::memory_order_relaxed))
+    {}
+    return run(bus, start, start, transfer);
+}
+
+int32_t I2CArbiter::run(Bus& bus, int64_t requested, int64_t start,
+                        const std::function<int32_t()>& transfer)
+{
+    i2c_arbiter::BusState& state = *bus.state;
+    int32_t result = transfer();
+
+    int64_t end = monotonicNs();
+    state.lastEndNs.store(end, std::memory_order_relaxed);
+    state.busyNs.fetch_add(static_cast<uint64_t>(end - start),
+                           std::memory_order_relaxed);
+    state.transactions.fetch_add(1, std::memory_order_relaxed);
+    state.waitNs.fetch_add(static_cast<uint64_t>(start - requested),
+                           std::memory_order_relaxed);
+    lockFile(bus.fd, LOCK_UN);
+    state.queueDepth.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+}
+
+void I2CArbiter::setMinimumGap(int busId, std::chrono::microseconds gap)
+{
+    Bus& bus = getBus(busId);
+    std::lock_guard<std::mutex> guard(bus.lock);
+    bus.minimumGap = gap;
+}
+
+const i2c_arbiter::BusState* I2CArbiter::state(int busId)
+{
+    return getBus(busId).state;
+}
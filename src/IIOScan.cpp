@@ -0,0 +1,60 @@
+#include <IIOScan.hpp>
+
+#include <cstdio>
+
+namespace iio
+{
+
+bool parseScanType(const std::string& type, ScanElement& element)
+{
+    char endian = 'l';
+    char sign = 'u';
+    unsigned int bits = 0;
+    unsigned int storageBits = 0;
+    unsigned int shift = 0;
+    if (std::sscanf(type.c_str(), "%ce:%c%u/%u>>%u", &endian, &sign, &bits,
+                    &storageBits, &shift) != 5 ||
+        (endian != 'l' && endian != 'b') || (sign != 'u' && sign != 's') ||
+        storageBits == 0 || storageBits % 8 != 0 || storageBits > 64 ||
+        bits == 0 || bits + shift > storageBits)
+    {
+        return false;
+    }
+    element.storageBytes = storageBits / 8;
+    element.bits = bits;
+    element.shift = shift;
+    element.isSigned = sign == 's';
+    element.bigEndian = endian == 'b';
+    return true;
+}
+
+double decode(const ScanElement& element, const uint8_t* scan)
+{
+    const uint8_t* data = scan + element.offset;
+    uint64_t raw = 0;
+    for (unsigned int ii = 0; ii < element.storageBytes; ii++)
+    {
+        unsigned int byte =
+            element.bigEndian ? ii : element.storageBytes - 1 - ii;
+        raw = (raw << 8) | data[byte];
+    }
+    raw >>= element.shift;
+    if (element.bits < 64)
+    {
+        raw &= (uint64_t(1) << element.bits) - 1;
+    }
+
+    double value = static_cast<double>(raw);
+    if (element.isSigned && element.bits < 64 &&
+        (raw & (uint64_t(1) << (element.bits - 1))) != 0)
+    {
+        value -= static_cast<double>(uint64_t(1) << element.bits);
+    }
+    else if (element.isSigned)
+    {
+        value = static_cast<double>(static_cast<int64_t>(raw));
+    }
+    return (value + element.rawOffset) * element.scale;
+}
+
+} // namespace iio
@@ -0,0 +1,40 @@
+#include <InternedString.hpp>
+#include <boost/container/flat_map.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+using InternPool =
+    boost::container::flat_map<std::string_view,
+                               std::weak_ptr<const std::string>>;
+
+// never destroyed, sensors in static maps outlive function local statics
+static InternPool& internPool(void)
+{
+    static InternPool* pool = new InternPool();
+    return *pool;
+}
+
+InternedString::InternedString(std::string_view contents)
+{
+    InternPool& pool = internPool();
+    auto found = pool.find(contents);
+    if (found != pool.end())
+    {
+        // the entry goes with the storage, so it can't have expired
+        storage = found->second.lock();
+        return;
+    }
+    storage = std::shared_ptr<const std::string>(
+        new std::string(contents), [](const std::string* string) {
+            internPool().erase(std::string_view(*string));
+            delete string;
+        });
+    pool.emplace(std::string_view(*storage), storage);
+}
+
+size_t InternedString::poolSize(void)
+{
+    return internPool().size();
+}
@@ -55,7 +55,7 @@ namespace fs = std::filesystem;
 static bool getIntrusionSensorConfig(
     const std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
     IntrusionSensorType* pType, int* pBusId, int* pSlaveAddr,
-    bool* pGpioInverted)
+    bool* pGpioInverted, std::string* pAlertGpio)
 {
     // find matched configuration according to sensor type
     ManagedObjectType sensorConfigurations;
@@ -158,10 +158,23 @@ static bool getIntrusionSensorConfig(
                 continue;
             }
 
+            // optional line the PCH signals intrusion on
+            pAlertGpio->clear();
+            auto findAlertGpio = baseConfiguration->second.find("AlertGpio");
+            if (findAlertGpio != baseConfiguration->second.end())
+            {
+                if (auto alertGpio =
+                        std::get_if<std::string>(&findAlertGpio->second))
+                {
+                    *pAlertGpio = *alertGpio;
+                }
+            }
+
             if (debug)
             {
                 std::cout << "find matched bus " << *pBusId
-                          << ", matched slave addr " << *pSlaveAddr << "\n";
+                          << ", matched slave addr " << *pSlaveAddr
+                          << ", alert gpio " << *pAlertGpio << "\n";
             }
             return true;
         }
@@ -425,6 +438,7 @@ int main()
     int busId = -1;
     int slaveAddr = -1;
     bool gpioInverted = false;
+    std::string alertGpio;
     IntrusionSensorType type = IntrusionSensorType::gpio;
 
     // setup connection to dbus
@@ -443,9 +457,10 @@ int main()
     ChassisIntrusionSensor chassisIntrusionSensor(io, ifaceChassis);
 
     if (getIntrusionSensorConfig(systemBus, &type, &busId, &slaveAddr,
-                                 &gpioInverted))
+                                 &gpioInverted, &alertGpio))
     {
-        chassisIntrusionSensor.start(type, busId, slaveAddr, gpioInverted);
+        chassisIntrusionSensor.start(type, busId, slaveAddr, gpioInverted,
+                                     alertGpio);
     }
 
     // callback to handle configuration change
@@ -459,10 +474,10 @@ int main()
 
             std::cout << "rescan due to configuration change \n";
             if (getIntrusionSensorConfig(systemBus, &type, &busId, &slaveAddr,
-                                         &gpioInverted))
+                                         &gpioInverted, &alertGpio))
             {
                 chassisIntrusionSensor.start(type, busId, slaveAddr,
-                                             gpioInverted);
+                                             gpioInverted, alertGpio);
             }
         };
 
@@ -19,13 +19,17 @@
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/container/flat_map.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <limits>
@@ -49,13 +53,254 @@ static constexpr uint8_t hostSMbusIndexDefault = 0x03;
 
 static constexpr const char* sensorPathPrefix = "/xyz/openbmc_project/sensors/";
 
-using IpmbMethodType =
-    std::tuple<int, uint8_t, uint8_t, uint8_t, uint8_t, std::vector<uint8_t>>;
+// requests outstanding on one IPMB address at a time
+static constexpr size_t maxInFlight = 4;
 
 boost::container::flat_map<std::string, std::unique_ptr<IpmbSensor>> sensors;
 
 std::unique_ptr<boost::asio::deadline_timer> initCmdTimer;
 
+// Sends the read requests of all sensors behind one IPMB address. Each
+// sensor is due once per its own poll interval, with the first reads phased
+// so that sensors sharing an interval are spread over it instead of going out
+// all at once. Up to maxInFlight requests are pipelined to ipmbbridged. When
+// the link is that busy the queued reads go out by priority, and lower
+// priorities leave some of the requests in flight to the higher ones, so a
+// slow ME delays the low priority sensors first. Sensors that send an
+// identical request share one round trip and its response.
+class IpmbBus
+{
+  public:
+    IpmbBus(boost::asio::io_service& io,
+            const std::shared_ptr<sdbusplus::asio::connection>& conn,
+            uint8_t address) :
+        timer(io), conn(conn), address(address)
+    {}
+
+    static IpmbBus&
+        get(boost::asio::io_service& io,
+            const std::shared_ptr<sdbusplus::asio::connection>& conn,
+            uint8_t address);
+
+    void add(IpmbSensor* sensor);
+    void remove(IpmbSensor* sensor);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Poll
+    {
+        IpmbSensor* sensor;
+        Clock::time_point due;
+    };
+
+    // sensors waiting on one sendRequest, an entry is cleared if its sensor
+    // goes away before the response is in
+    using Request = std::vector<IpmbSensor*>;
+
+    void arm(void);
+    void tick(void);
+    bool isPending(const IpmbSensor* sensor) const;
+    void send(void);
+    bool takeNext(std::deque<IpmbSensor*>& queue, size_t limit);
+
+    boost::asio::steady_timer timer;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    uint8_t address;
+    std::vector<Poll> polls;
+    // fraction of its interval the next added sensor is phased by
+    double nextPhase = 0.0;
+    // reads waiting for a free request, by IpmbPriority
+    std::array<std::deque<IpmbSensor*>, ipmbPriorityCount> queues;
+    std::vector<std::shared_ptr<Request>> inFlight;
+};
+
+// buses live as long as the daemon, an idle one just stops its timer
+static boost::container::flat_map<uint8_t, std::unique_ptr<IpmbBus>> ipmbBuses;
+
+IpmbBus& IpmbBus::get(boost::asio::io_service& io,
+                      const std::shared_ptr<sdbusplus::asio::connection>& conn,
+                      uint8_t address)
+{
+    auto& bus = ipmbBuses[address];
+    if (!bus)
+    {
+        bus = std::make_unique<IpmbBus>(io, conn, address);
+    }
+    return *bus;
+}
+
+void IpmbBus::add(IpmbSensor* sensor)
+{
+    // stepping the phase by the golden ratio keeps any number of sensors
+    // close to evenly spread, without knowing how many are still to come
+    constexpr double phaseStep = 0.6180339887;
+    auto phase = std::chrono::duration_cast<Clock::duration>(
+        sensor->pollInterval * nextPhase);
+    nextPhase += phaseStep;
+    nextPhase -= std::floor(nextPhase);
+
+    polls.push_back({sensor, Clock::now() + phase});
+    arm();
+}
+
+void IpmbBus::remove(IpmbSensor* sensor)
+{
+    polls.erase(std::remove_if(polls.begin(), polls.end(),
+                               [sensor](const Poll& poll) {
+                                   return poll.sensor == sensor;
+                               }),
+                polls.end());
+    for (auto& queue : queues)
+    {
+        queue.erase(std::remove(queue.begin(), queue.end(), sensor),
+                    queue.end());
+    }
+    for (const auto& request : inFlight)
+    {
+        std::replace(request->begin(), request->end(), sensor,
+                     static_cast<IpmbSensor*>(nullptr));
+    }
+}
+
+// (re)starts the timer for the earliest due sensor
+void IpmbBus::arm(void)
+{
+    if (polls.empty())
+    {
+        timer.cancel();
+        return; // add() starts us again
+    }
+    auto earliest = std::min_element(polls.begin(), polls.end(),
+                                     [](const Poll& lhs, const Poll& rhs) {
+                                         return lhs.due < rhs.due;
+                                     });
+    timer.expires_at(earliest->due);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return; // rearmed or canceled
+        }
+        tick();
+    });
+}
+
+void IpmbBus::tick(void)
+{
+    auto now = Clock::now();
+    for (Poll& poll : polls)
+    {
+        if (poll.due > now)
+        {
+            continue;
+        }
+        // keep a fixed cadence rather than drifting by the time the request
+        // took, unless we fell behind by more than a whole interval
+        poll.due += poll.sensor->pollInterval;
+        if (poll.due <= now)
+        {
+            poll.due = now + poll.sensor->pollInterval;
+        }
+
+        IpmbSensor* sensor = poll.sensor;
+        if (!sensor->readingStateGood())
+        {
+            sensor->updateValue(std::numeric_limits<double>::quiet_NaN());
+        }
+        else if (!isPending(sensor))
+        {
+            // a sensor still waiting on its last read skips this one rather
+            // than piling up requests to a slow device
+            queues[static_cast<size_t>(sensor->priority)].emplace_back(sensor);
+        }
+    }
+    send();
+    arm();
+}
+
+bool IpmbBus::isPending(const IpmbSensor* sensor) const
+{
+    const auto& queue = queues[static_cast<size_t>(sensor->priority)];
+    if (std::find(queue.begin(), queue.end(), sensor) != queue.end())
+    {
+        return true;
+    }
+    return std::any_of(inFlight.begin(), inFlight.end(),
+                       [sensor](const std::shared_ptr<Request>& request) {
+                           return std::find(request->begin(), request->end(),
+                                            sensor) != request->end();
+                       });
+}
+
+void IpmbBus::send(void)
+{
+    // high priority reads may use every request, normal ones leave one and
+    // low ones half of them to the higher priorities
+    const std::array<size_t, ipmbPriorityCount> limits = {
+        maxInFlight, maxInFlight - 1, maxInFlight / 2};
+    for (size_t priority = 0; priority < queues.size(); priority++)
+    {
+        while (takeNext(queues[priority], limits[priority]))
+        {}
+    }
+}
+
+// sends the first read of the queue if fewer than limit are in flight
+bool IpmbBus::takeNext(std::deque<IpmbSensor*>& queue, size_t limit)
+{
+    if (queue.empty() || inFlight.size() >= std::max<size_t>(limit, 1))
+    {
+        return false;
+    }
+    auto request = std::make_shared<Request>();
+    IpmbSensor* first = queue.front();
+    queue.pop_front();
+    request->emplace_back(first);
+    for (auto& other : queues)
+    {
+        for (auto it = other.begin(); it != other.end();)
+        {
+            if ((*it)->netfn == first->netfn &&
+                (*it)->command == first->command &&
+                (*it)->commandData == first->commandData)
+            {
+                request->emplace_back(*it);
+                it = other.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+    inFlight.emplace_back(request);
+    for (IpmbSensor* sensor : *request)
+    {
+        sensor->readStarted();
+    }
+
+    conn->async_method_call(
+        [this, request](boost::system::error_code ec,
+                        const IpmbMethodType& response) {
+            inFlight.erase(
+                std::remove(inFlight.begin(), inFlight.end(), request),
+                inFlight.end());
+            for (IpmbSensor* sensor : *request)
+            {
+                if (sensor != nullptr)
+                {
+                    sensor->handleResponse(ec, response);
+                }
+            }
+            send();
+        },
+        "xyz.openbmc_project.Ipmi.Channel.Ipmb",
+        "/xyz/openbmc_project/Ipmi/Channel/Ipmb", "org.openbmc.Ipmb",
+        "sendRequest", address, first->netfn, lun, first->command,
+        first->commandData);
+    return true;
+}
+
 IpmbSensor::IpmbSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
                        boost::asio::io_service& io,
                        const std::string& sensorName,
@@ -69,7 +314,7 @@ IpmbSensor::IpmbSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
            "xyz.openbmc_project.Configuration.ExitAirTemp", ipmbMaxReading,
            ipmbMinReading, conn, PowerState::on),
     deviceAddress(deviceAddress), hostSMbusIndex(hostSMbusIndex),
-    objectServer(objectServer), waitTimer(io)
+    objectServer(objectServer), io(io)
 {
     std::string dbusPath = sensorPathPrefix + sensorTypeName + "/" + name;
 
@@ -91,7 +336,10 @@ IpmbSensor::IpmbSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
 
 IpmbSensor::~IpmbSensor()
 {
-    waitTimer.cancel();
+    if (bus != nullptr)
+    {
+        bus->remove(this);
+    }
     objectServer.remove_interface(thresholdInterfaceWarning);
     objectServer.remove_interface(thresholdInterfaceCritical);
     objectServer.remove_interface(sensorInterface);
@@ -125,7 +373,8 @@ void IpmbSensor::init(void)
     {
         runInitCmd();
     }
-    read();
+    bus = &IpmbBus::get(io, dbusConnection, commandAddress);
+    bus->add(this);
 }
 
 void IpmbSensor::runInitCmd()
@@ -338,78 +587,54 @@ bool IpmbSensor::processReading(const std::vector<uint8_t>& data, double& resp)
     }
 }
 
-void IpmbSensor::read(void)
+void IpmbSensor::handleResponse(const boost::system::error_code& ec,
+                                const IpmbMethodType& response)
 {
-    static constexpr size_t pollTime = 1; // in seconds
-
-    waitTimer.expires_from_now(boost::posix_time::seconds(pollTime));
-    waitTimer.async_wait([this](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return; // we're being canceled
-        }
-        if (!readingStateGood())
+    const int& status = std::get<0>(response);
+    if (ec || status)
+    {
+        incrementError();
+        return;
+    }
+    const std::vector<uint8_t>& data = std::get<5>(response);
+    if constexpr (debug)
+    {
+        std::cout << name << ": ";
+        for (size_t d : data)
         {
-            updateValue(std::numeric_limits<double>::quiet_NaN());
-            read();
-            return;
+            std::cout << d << " ";
         }
-        dbusConnection->async_method_call(
-            [this](boost::system::error_code ec,
-                   const IpmbMethodType& response) {
-                const int& status = std::get<0>(response);
-                if (ec || status)
-                {
-                    incrementError();
-                    read();
-                    return;
-                }
-                const std::vector<uint8_t>& data = std::get<5>(response);
-                if constexpr (debug)
-                {
-                    std::cout << name << ": ";
-                    for (size_t d : data)
-                    {
-                        std::cout << d << " ";
-                    }
-                    std::cout << "\n";
-                }
-                if (data.empty())
-                {
-                    incrementError();
-                    read();
-                    return;
-                }
+        std::cout << "\n";
+    }
+    if (data.empty())
+    {
+        incrementError();
+        return;
+    }
 
-                double value = 0;
+    double value = 0;
 
-                if (!processReading(data, value))
-                {
-                    incrementError();
-                    read();
-                    return;
-                }
+    if (!processReading(data, value))
+    {
+        incrementError();
+        return;
+    }
 
-                // rawValue only used in debug logging
-                // up to 5th byte in data are used to derive value
-                size_t end = std::min(sizeof(uint64_t), data.size());
-                uint64_t rawData = 0;
-                for (size_t i = 0; i < end; i++)
-                {
-                    reinterpret_cast<uint8_t*>(&rawData)[i] = data[i];
-                }
-                rawValue = static_cast<double>(rawData);
+    // rawValue only used in debug logging
+    // up to 5th byte in data are used to derive value
+    size_t end = std::min(sizeof(uint64_t), data.size());
+    uint64_t rawData = 0;
+    for (size_t i = 0; i < end; i++)
+    {
+        reinterpret_cast<uint8_t*>(&rawData)[i] = data[i];
+    }
+    rawValue = static_cast<double>(rawData);
 
-                /* Adjust value as per scale and offset */
-                value = (value * scaleVal) + offsetVal;
-                updateValue(value);
-                read();
-            },
-            "xyz.openbmc_project.Ipmi.Channel.Ipmb",
-            "/xyz/openbmc_project/Ipmi/Channel/Ipmb", "org.openbmc.Ipmb",
-            "sendRequest", commandAddress, netfn, lun, command, commandData);
-    });
+    /* Adjust value as per scale and offset */
+    value = (value * scaleVal) + offsetVal;
+    updateValue(value);
 }
+
 void createSensors(
     boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
     boost::container::flat_map<std::string, std::unique_ptr<IpmbSensor>>&
@@ -492,6 +717,44 @@ void createSensors(
                                                        findOffsetVal->second);
                     }
 
+                    auto findPollRate = entry.second.find("PollRate");
+                    if (findPollRate != entry.second.end())
+                    {
+                        float pollRate = std::visit(VariantToFloatVisitor(),
+                                                    findPollRate->second);
+                        if (pollRate > 0.0f)
+                        {
+                            sensor->pollInterval =
+                                std::chrono::milliseconds(
+                                    static_cast<int64_t>(pollRate * 1000));
+                        }
+                        else
+                        {
+                            std::cerr << "Ignoring invalid PollRate of "
+                                      << name << "\n";
+                        }
+                    }
+
+                    auto findPriority = entry.second.find("Priority");
+                    if (findPriority != entry.second.end())
+                    {
+                        std::string priority = std::visit(
+                            VariantToStringVisitor(), findPriority->second);
+                        if (priority == "High")
+                        {
+                            sensor->priority = IpmbPriority::high;
+                        }
+                        else if (priority == "Low")
+                        {
+                            sensor->priority = IpmbPriority::low;
+                        }
+                        else if (priority != "Normal")
+                        {
+                            std::cerr << "Invalid priority " << priority
+                                      << " of " << name << "\n";
+                        }
+                    }
+
                     auto findPowerState = entry.second.find("PowerState");
 
                     if (findPowerState != entry.second.end())
@@ -14,6 +14,7 @@
 // limitations under the License.
 */
 #include <MCUTempSensor.hpp>
+#include <SmbusExecutor.hpp>
 #include <Utils.hpp>
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -23,8 +24,10 @@
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <cerrno>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <limits>
@@ -33,12 +36,6 @@
 #include <string>
 #include <vector>
 
-extern "C"
-{
-#include <i2c/smbus.h>
-#include <linux/i2c-dev.h>
-}
-
 constexpr const bool debug = false;
 
 constexpr const char* configInterface =
@@ -46,7 +43,7 @@ constexpr const char* configInterface =
 static constexpr double mcuTempMaxReading = 0xFF;
 static constexpr double mcuTempMinReading = 0;
 
-boost::container::flat_map<std::string, std::unique_ptr<MCUTempSensor>> sensors;
+boost::container::flat_map<std::string, std::shared_ptr<MCUTempSensor>> sensors;
 
 MCUTempSensor::MCUTempSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
                              boost::asio::io_service& io,
@@ -61,7 +58,8 @@ MCUTempSensor::MCUTempSensor(std::shared_ptr<sdbusplus::asio::connection>& conn,
            "xyz.openbmc_project.Configuration.ExitAirTemp", mcuTempMaxReading,
            mcuTempMinReading, conn),
     busId(busId), mcuAddress(mcuAddress), tempReg(tempReg),
-    objectServer(objectServer), waitTimer(io)
+    objectServer(objectServer), waitTimer(io),
+    smbus(SmbusExecutor::getInstance(io))
 {
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/temperature/" + name,
@@ -104,53 +102,6 @@ void MCUTempSensor::checkThresholds(void)
     thresholds::checkThresholds(this);
 }
 
-int MCUTempSensor::getMCURegsInfoWord(uint8_t regs, int16_t* pu16data)
-{
-    std::string i2cBus = "/dev/i2c-" + std::to_string(busId);
-    int fd = open(i2cBus.c_str(), O_RDWR);
-
-    if (fd < 0)
-    {
-        std::cerr << " unable to open i2c device" << i2cBus << "  err=" << fd
-                  << "\n";
-        return -1;
-    }
-
-    if (ioctl(fd, I2C_SLAVE_FORCE, mcuAddress) < 0)
-    {
-        std::cerr << " unable to set device address\n";
-        close(fd);
-        return -1;
-    }
-
-    unsigned long funcs = 0;
-    if (ioctl(fd, I2C_FUNCS, &funcs) < 0)
-    {
-        std::cerr << " not support I2C_FUNCS\n";
-        close(fd);
-        return -1;
-    }
-
-    if (!(funcs & I2C_FUNC_SMBUS_READ_WORD_DATA))
-    {
-        std::cerr << " not support I2C_FUNC_SMBUS_READ_WORD_DATA\n";
-        close(fd);
-        return -1;
-    }
-
-    *pu16data = i2c_smbus_read_word_data(fd, regs);
-    close(fd);
-
-    if (*pu16data < 0)
-    {
-        std::cerr << " read word data failed at " << static_cast<int>(regs)
-                  << "\n";
-        return -1;
-    }
-
-    return 0;
-}
-
 void MCUTempSensor::read(void)
 {
     static constexpr size_t pollTime = 1; // in seconds
@@ -167,30 +118,48 @@ void MCUTempSensor::read(void)
             std::cerr << "timer error\n";
             return;
         }
-        int16_t temp;
-        int ret = getMCURegsInfoWord(tempReg, &temp);
-        if (ret >= 0)
-        {
-            double v = static_cast<double>(temp) / 1000;
-            if constexpr (debug)
-            {
-                std::cerr << "Value update to " << v << "raw reading "
-                          << static_cast<int>(temp) << "\n";
-            }
-            updateValue(v);
-        }
-        else
+        readStarted();
+        // the transaction runs on the executor thread of the bus, the timer
+        // is only armed again once it is done
+        std::weak_ptr<MCUTempSensor> weakRef = weak_from_this();
+        smbus.submit(busId, mcuAddress, SmbusOp::readWordData, tempReg,
+                     [weakRef](int32_t result) {
+                         std::shared_ptr<MCUTempSensor> self = weakRef.lock();
+                         if (!self)
+                         {
+                             return;
+                         }
+                         self->handleResponse(result);
+                     });
+    });
+}
+
+void MCUTempSensor::handleResponse(int32_t result)
+{
+    auto temp = static_cast<int16_t>(result);
+    if (result >= 0 && temp >= 0)
+    {
+        double v = static_cast<double>(temp) / 1000;
+        if constexpr (debug)
         {
-            std::cerr << "Invalid read getMCURegsInfoWord\n";
-            incrementError();
+            std::cerr << "Value update to " << v << "raw reading "
+                      << static_cast<int>(temp) << "\n";
         }
-        read();
-    });
+        updateValue(v);
+    }
+    else
+    {
+        std::cerr << "Invalid read of register " << static_cast<int>(tempReg)
+                  << " on bus " << static_cast<int>(busId) << ": "
+                  << std::strerror(result < 0 ? -result : ERANGE) << "\n";
+        incrementError();
+    }
+    read();
 }
 
 void createSensors(
     boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
-    boost::container::flat_map<std::string, std::unique_ptr<MCUTempSensor>>&
+    boost::container::flat_map<std::string, std::shared_ptr<MCUTempSensor>>&
         sensors,
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection)
 {
@@ -253,7 +222,7 @@ void createSensors(
 
                     auto& sensor = sensors[name];
 
-                    sensor = std::make_unique<MCUTempSensor>(
+                    sensor = std::make_shared<MCUTempSensor>(
                         dbusConnection, io, name, pathPair.first, objectServer,
                         std::move(sensorThresholds), busId, mcuAddress,
                         tempReg);
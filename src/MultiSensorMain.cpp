@@ -0,0 +1,96 @@
+#include <SensorDaemons.hpp>
+#include <boost/asio/io_service.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Hosts several sensor daemons in one process. They share the io_service,
+// the D-Bus connection and object server, the power state matches and the
+// Entity Manager queries made at the same time, instead of each carrying its
+// own copy. Every hosted daemon still owns its usual bus name, so clients
+// can't tell the difference.
+//
+//   multisensor [daemon...]
+//
+// starts the given daemons (adc, fan, hwmontemp, psu), or all of the ones
+// built in when none are given.
+
+struct HostedDaemon
+{
+    const char* name;
+    const char* busName;
+    std::unique_ptr<SensorDaemon> (*setup)(
+        boost::asio::io_service&, sdbusplus::asio::object_server&,
+        std::shared_ptr<sdbusplus::asio::connection>&);
+};
+
+static const std::vector<HostedDaemon> hostedDaemons = {
+#ifdef MULTISENSOR_ADC
+    {"adc", "xyz.openbmc_project.ADCSensor", setupAdcSensors},
+#endif
+#ifdef MULTISENSOR_FAN
+    {"fan", "xyz.openbmc_project.FanSensor", setupFanSensors},
+#endif
+#ifdef MULTISENSOR_HWMON_TEMP
+    {"hwmontemp", "xyz.openbmc_project.HwmonTempSensor",
+     setupHwmonTempSensors},
+#endif
+#ifdef MULTISENSOR_PSU
+    {"psu", "xyz.openbmc_project.PSUSensor", setupPsuSensors},
+#endif
+};
+
+int main(int argc, char** argv)
+{
+    std::vector<const HostedDaemon*> selected;
+    for (int index = 1; index < argc; index++)
+    {
+        auto findDaemon = std::find_if(
+            hostedDaemons.begin(), hostedDaemons.end(),
+            [name = std::string(argv[index])](const HostedDaemon& daemon) {
+                return name == daemon.name;
+            });
+        if (findDaemon == hostedDaemons.end())
+        {
+            std::cerr << argv[index] << " is not built into " << argv[0]
+                      << ", available are:";
+            for (const HostedDaemon& daemon : hostedDaemons)
+            {
+                std::cerr << " " << daemon.name;
+            }
+            std::cerr << "\n";
+            return 1;
+        }
+        if (std::find(selected.begin(), selected.end(), &*findDaemon) ==
+            selected.end())
+        {
+            selected.push_back(&*findDaemon);
+        }
+    }
+    if (selected.empty())
+    {
+        for (const HostedDaemon& daemon : hostedDaemons)
+        {
+            selected.push_back(&daemon);
+        }
+    }
+
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    for (const HostedDaemon* daemon : selected)
+    {
+        systemBus->request_name(daemon->busName);
+    }
+    sdbusplus::asio::object_server objectServer(systemBus);
+    std::vector<std::unique_ptr<SensorDaemon>> running;
+    for (const HostedDaemon* daemon : selected)
+    {
+        running.emplace_back(daemon->setup(io, objectServer, systemBus));
+    }
+    io.run();
+}
@@ -17,28 +17,82 @@
 #include <crc32c.h>
 #include <libmctp-smbus.h>
 
+#include <I2CArbiter.hpp>
 #include <NVMeDevice.hpp>
 #include <NVMeSensor.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
 
 static constexpr double maxReading = 127;
 static constexpr double minReading = 0;
 
 static constexpr bool debug = false;
 
+// how long a drive gets to answer a health status poll. Responses can't be
+// matched to their request, one arriving after this is taken for the next
+// drive, so this must stay well above what a slow drive takes.
+static constexpr unsigned int mctpResponseTimeoutMs = 1000;
+// a drive that keeps timing out is left out of up to this many sweeps
+static constexpr unsigned int maxSkippedSweeps = 32;
+// in the adaptive mode a steady drive sits out one more sweep for every
+// steadyReadsPerSweep readings without a change, up to maxIdleSweeps, unless
+// it is within thresholdMargin degrees of a threshold. Those drives are
+// polled again nearThresholdSweepMs into every sweep.
+static constexpr unsigned int steadyReadsPerSweep = 4;
+static constexpr unsigned int maxIdleSweeps = 7;
+static constexpr double thresholdMargin = 5;
+static constexpr unsigned int nearThresholdSweepMs = 500;
+
+static constexpr const char* healthStatusInterface =
+    "xyz.openbmc_project.NVMe.HealthStatus";
+
 void rxMessage(uint8_t eid, void* data, void* msg, size_t len);
 
 namespace nvmeMCTP
 {
-struct mctp_binding_smbus* smbus = mctp_smbus_init();
-struct mctp* mctp = mctp_init();
+// Every root bus gets an MCTP binding of its own, so root buses are polled
+// independently rather than taking turns on a single binding. Bindings are
+// kept for the life of the daemon, contexts attach to them.
+struct Binding
+{
+    struct mctp_binding_smbus* smbus = nullptr;
+    struct mctp* mctp = nullptr;
+    NVMeContext* context = nullptr;
+};
 
+static boost::container::flat_map<int, std::unique_ptr<Binding>> bindings;
 static boost::container::flat_map<int, int> inFds;
 static boost::container::flat_map<int, int> outFds;
 
+Binding& getBinding(int rootBus)
+{
+    auto& binding = bindings[rootBus];
+    if (!binding)
+    {
+        auto created = std::make_unique<Binding>();
+        created->smbus = mctp_smbus_init();
+        created->mctp = mctp_init();
+        if (created->mctp == nullptr || created->smbus == nullptr)
+        {
+            bindings.erase(rootBus);
+            throw std::runtime_error("Unable to init mctp");
+        }
+        mctp_smbus_register_bus(created->smbus, created->mctp, 0);
+        mctp_set_rx_all(created->mctp, rxMessage, created.get());
+        binding = std::move(created);
+    }
+    return *binding;
+}
+
 int getInFd(int rootBus)
 {
     auto findBus = inFds.find(rootBus);
@@ -46,7 +100,7 @@ int getInFd(int rootBus)
     {
         return findBus->second;
     }
-    int fd = mctp_smbus_open_in_bus(smbus, rootBus);
+    int fd = mctp_smbus_open_in_bus(getBinding(rootBus).smbus, rootBus);
     if (fd < 0)
     {
         std::cerr << "Error opening IN Bus " << rootBus << "\n";
@@ -55,14 +109,14 @@ int getInFd(int rootBus)
     return fd;
 }
 
-int getOutFd(int bus)
+int getOutFd(Binding& binding, int bus)
 {
     auto findBus = outFds.find(bus);
     if (findBus != outFds.end())
     {
         return findBus->second;
     }
-    int fd = mctp_smbus_open_out_bus(smbus, bus);
+    int fd = mctp_smbus_open_out_bus(binding.smbus, bus);
     if (fd < 0)
     {
         std::cerr << "Error opening Out Bus " << bus << "\n";
@@ -84,50 +138,8 @@ void closeInFd(int rootBus)
     inFds.erase(rootBus);
 }
 
-int getRootBus(int inFd)
-{
-    // we assume that we won't have too many FDs, so looping is OK
-    for (const auto [root, fd] : inFds)
-    {
-        if (fd == inFd)
-        {
-            return root;
-        }
-    }
-
-    return -1;
-}
-
-void init()
-{
-    if (mctp == nullptr || smbus == nullptr)
-    {
-        throw std::runtime_error("Unable to init mctp");
-    }
-    mctp_smbus_register_bus(smbus, nvmeMCTP::mctp, 0);
-    mctp_set_rx_all(mctp, rxMessage, nullptr);
-}
-
 } // namespace nvmeMCTP
 
-void readResponse(const std::shared_ptr<NVMeContext>& nvmeDevice)
-{
-    nvmeDevice->nvmeSlaveSocket.async_wait(
-        boost::asio::ip::tcp::socket::wait_error,
-        [nvmeDevice](const boost::system::error_code errorCode) {
-            if (errorCode)
-            {
-                return;
-            }
-
-            mctp_smbus_set_in_fd(nvmeMCTP::smbus,
-                                 nvmeMCTP::getInFd(nvmeDevice->rootBus));
-
-            // through libmctp this will invoke rxMessage
-            mctp_smbus_read(nvmeMCTP::smbus);
-        });
-}
-
 int nvmeMessageTransmit(mctp& mctp, nvme_mi_msg_request& req)
 {
     std::array<uint8_t, NVME_MI_MSG_BUFFER_SIZE> messageBuf = {};
@@ -200,61 +212,6 @@ int verifyIntegrity(uint8_t* msg, size_t len)
     return 0;
 }
 
-void readAndProcessNVMeSensor(const std::shared_ptr<NVMeContext>& nvmeDevice)
-{
-    struct nvme_mi_msg_request requestMsg = {};
-    requestMsg.header.opcode = NVME_MI_OPCODE_HEALTH_STATUS_POLL;
-    requestMsg.header.dword0 = 0;
-    requestMsg.header.dword1 = 0;
-
-    int mctpResponseTimeout = 1;
-
-    if (nvmeDevice->sensors.empty())
-    {
-        return;
-    }
-
-    std::shared_ptr<NVMeSensor>& sensor = nvmeDevice->sensors.front();
-
-    // setup the timeout timer
-    nvmeDevice->mctpResponseTimer.expires_from_now(
-        boost::posix_time::seconds(mctpResponseTimeout));
-
-    nvmeDevice->mctpResponseTimer.async_wait(
-        [sensor, nvmeDevice](const boost::system::error_code errorCode) {
-            if (errorCode)
-            {
-                // timer cancelled successfully
-                return;
-            }
-
-            sensor->incrementError();
-
-            // cycle it back
-            nvmeDevice->sensors.pop_front();
-            nvmeDevice->sensors.emplace_back(sensor);
-
-            nvmeDevice->nvmeSlaveSocket.cancel();
-        });
-
-    readResponse(nvmeDevice);
-
-    if (debug)
-    {
-        std::cout << "Sending message to read data from Drive on bus: "
-                  << sensor->bus << " , rootBus: " << nvmeDevice->rootBus
-                  << " device: " << sensor->name << "\n";
-    }
-
-    mctp_smbus_set_out_fd(nvmeMCTP::smbus, nvmeMCTP::getOutFd(sensor->bus));
-    int rc = nvmeMessageTransmit(*nvmeMCTP::mctp, requestMsg);
-
-    if (rc != 0)
-    {
-        std::cerr << "Error sending request message to NVMe device\n";
-    }
-}
-
 static double getTemperatureReading(int8_t reading)
 {
 
@@ -269,22 +226,20 @@ static double getTemperatureReading(int8_t reading)
     return reading;
 }
 
-void rxMessage(uint8_t eid, void*, void* msg, size_t len)
+void rxMessage(uint8_t eid, void* data, void* msg, size_t len)
 {
-    struct nvme_mi_msg_response_header header
-    {};
-
-    int inFd = mctp_smbus_get_in_fd(nvmeMCTP::smbus);
-    int rootBus = nvmeMCTP::getRootBus(inFd);
-
-    NVMEMap& nvmeMap = getNVMEMap();
-    auto findMap = nvmeMap.find(rootBus);
-    if (findMap == nvmeMap.end())
+    auto binding = static_cast<nvmeMCTP::Binding*>(data);
+    if (binding == nullptr || binding->context == nullptr)
     {
-        std::cerr << "Unable to lookup root bus " << rootBus << "\n";
-        return;
+        return; // nobody polls this root bus anymore
     }
-    std::shared_ptr<NVMeContext>& self = findMap->second;
+    binding->context->processResponse(eid, msg, len);
+}
+
+void NVMeContext::processResponse(uint8_t eid, void* msg, size_t len)
+{
+    struct nvme_mi_msg_response_header header
+    {};
 
     if (msg == nullptr)
     {
@@ -355,7 +310,12 @@ void rxMessage(uint8_t eid, void*, void* msg, size_t len)
         return;
     }
 
-    std::shared_ptr<NVMeSensor> sensorInfo = self->sensors.front();
+    // a response coming in after its drive timed out is dropped
+    if (!polling)
+    {
+        return;
+    }
+    std::shared_ptr<NVMeSensor> sensorInfo = std::move(polling);
     if (debug)
     {
         std::cout << "Temperature Reading: "
@@ -363,7 +323,13 @@ void rxMessage(uint8_t eid, void*, void* msg, size_t len)
                   << " Celsius for device " << sensorInfo->name << "\n";
     }
 
+    sensorInfo->missedResponses = 0;
+    sensorInfo->cacheHealthStatus(messageData, messageLength);
     double value = getTemperatureReading(messageData[5]);
+    if (sensorInfo->adaptive)
+    {
+        sensorInfo->skipSweeps = sensorInfo->idleSweeps(value);
+    }
     if (!std::isfinite(value))
     {
         sensorInfo->markAvailable(false);
@@ -379,40 +345,215 @@ void rxMessage(uint8_t eid, void*, void* msg, size_t len)
         std::cout << "Cancelling the timer now\n";
     }
 
-    // move to back of scan queue
-    self->sensors.pop_front();
-    self->sensors.emplace_back(sensorInfo);
-
-    self->mctpResponseTimer.cancel();
+    mctpResponseTimer.cancel();
+    pollNext();
 }
 
 NVMeContext::NVMeContext(boost::asio::io_service& io, int rootBus) :
-    rootBus(rootBus), scanTimer(io), nvmeSlaveSocket(io), mctpResponseTimer(io)
+    rootBus(rootBus), binding(nvmeMCTP::getBinding(rootBus)), scanTimer(io),
+    mctpResponseTimer(io), arbiterRetryTimer(io), nvmeSlaveSocket(io)
 {
     nvmeSlaveSocket.assign(boost::asio::ip::tcp::v4(),
                            nvmeMCTP::getInFd(rootBus));
+    binding.context = this;
 }
 
 void NVMeContext::pollNVMeDevices()
 {
+    waitForResponses();
     scanTimer.expires_from_now(boost::posix_time::seconds(1));
+    scheduleSweep();
+}
+
+void NVMeContext::scheduleSweep()
+{
     scanTimer.async_wait(
         [self{shared_from_this()}](const boost::system::error_code errorCode) {
             if (errorCode == boost::asio::error::operation_aborted)
             {
                 return; // we're being canceled
             }
-            else if (errorCode)
+            if (errorCode)
             {
                 std::cerr << "Error:" << errorCode.message() << "\n";
                 return;
             }
-            else
+            self->startSweep();
+        });
+}
+
+// Polls every drive of the root bus once, one request right after the other
+// and each cut short after mctpResponseTimeoutMs. Responses on the root bus
+// can't be told apart by drive, so there is only ever one outstanding. The
+// sweep half way to the next one only polls the drives near a threshold.
+void NVMeContext::startSweep()
+{
+    if (!nearThresholdSweep)
+    {
+        sweepStart = boost::posix_time::microsec_clock::universal_time();
+    }
+    sweep.clear();
+    for (auto it = sensors.rbegin(); it != sensors.rend(); it++)
+    {
+        NVMeSensor& sensor = **it;
+        if (nearThresholdSweep)
+        {
+            if (sensor.nearThreshold && sensor.missedResponses == 0)
+            {
+                sweep.emplace_back(*it);
+            }
+            continue;
+        }
+        if (sensor.skipSweeps > 0)
+        {
+            sensor.skipSweeps--;
+            continue;
+        }
+        sweep.emplace_back(*it);
+    }
+    pollNext();
+}
+
+void NVMeContext::pollNext()
+{
+    arbiterRetryTimer.cancel();
+    polling = nullptr;
+    if (sweep.empty())
+    {
+        // unless this one ran late, the drives near a threshold are polled
+        // again half way, and the next sweep a second after this one started
+        boost::posix_time::ptime halfWay =
+            sweepStart + boost::posix_time::milliseconds(nearThresholdSweepMs);
+        if (!nearThresholdSweep &&
+            boost::posix_time::microsec_clock::universal_time() < halfWay &&
+            std::any_of(sensors.begin(), sensors.end(),
+                        [](const std::shared_ptr<NVMeSensor>& sensor) {
+                            return sensor->nearThreshold &&
+                                   sensor->missedResponses == 0;
+                        }))
+        {
+            nearThresholdSweep = true;
+            scanTimer.expires_at(halfWay);
+        }
+        else
+        {
+            nearThresholdSweep = false;
+            scanTimer.expires_at(sweepStart + boost::posix_time::seconds(1));
+        }
+        scheduleSweep();
+        return;
+    }
+    polling = std::move(sweep.back());
+    sweep.pop_back();
+    requestSequence++;
+    polling->readStarted();
+
+    mctpResponseTimer.expires_from_now(
+        boost::posix_time::milliseconds(mctpResponseTimeoutMs));
+    mctpResponseTimer.async_wait(
+        [self{shared_from_this()},
+         sequence{requestSequence}](const boost::system::error_code errorCode) {
+            // an expiry already on its way when the response came in
+            // belongs to an earlier request
+            if (errorCode || sequence != self->requestSequence)
+            {
+                // timer cancelled successfully
+                return;
+            }
+            self->responseTimedOut();
+        });
+
+    if (debug)
+    {
+        std::cout << "Sending message to read data from Drive on bus: "
+                  << polling->bus << " , rootBus: " << rootBus
+                  << " device: " << polling->name << "\n";
+    }
+
+    sendRequest();
+}
+
+// The request is a single write of the bus. The io thread doesn't wait for
+// other daemons on the bus, it tries again until the response timeout of the
+// drive ends the attempt.
+void NVMeContext::sendRequest()
+{
+    struct nvme_mi_msg_request requestMsg = {};
+    requestMsg.header.opcode = NVME_MI_OPCODE_HEALTH_STATUS_POLL;
+    requestMsg.header.dword0 = 0;
+    requestMsg.header.dword1 = 0;
+
+    mctp_smbus_set_out_fd(binding.smbus,
+                          nvmeMCTP::getOutFd(binding, polling->bus));
+    std::chrono::nanoseconds retryAfter{0};
+    std::optional<int32_t> rc = I2CArbiter::getInstance().tryTransact(
+        polling->bus,
+        [this, &requestMsg]() {
+            return nvmeMessageTransmit(*binding.mctp, requestMsg);
+        },
+        retryAfter);
+
+    if (!rc)
+    {
+        auto retryUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(retryAfter);
+        arbiterRetryTimer.expires_from_now(
+            boost::posix_time::microseconds(retryUs.count() + 1));
+        arbiterRetryTimer.async_wait(
+            [self{shared_from_this()}, sequence{requestSequence}](
+                const boost::system::error_code errorCode) {
+                if (errorCode || sequence != self->requestSequence ||
+                    !self->polling)
+                {
+                    return;
+                }
+                self->sendRequest();
+            });
+        return;
+    }
+    if (*rc != 0)
+    {
+        std::cerr << "Error sending request message to NVMe device\n";
+    }
+}
+
+// a dead drive is left out of a doubling number of sweeps, so it doesn't
+// hold up the others by its timeout every second
+void NVMeContext::responseTimedOut()
+{
+    if (!polling)
+    {
+        return;
+    }
+    polling->incrementError();
+    if (polling->missedResponses < maxSkippedSweeps)
+    {
+        polling->missedResponses++;
+    }
+    polling->skipSweeps = std::min(1U << (polling->missedResponses - 1),
+                                   maxSkippedSweeps) -
+                          1;
+    pollNext();
+}
+
+void NVMeContext::waitForResponses()
+{
+    nvmeSlaveSocket.async_wait(
+        boost::asio::ip::tcp::socket::wait_error,
+        [weak{weak_from_this()}](const boost::system::error_code errorCode) {
+            if (errorCode)
             {
-                readAndProcessNVMeSensor(self);
+                return;
+            }
+            std::shared_ptr<NVMeContext> self = weak.lock();
+            if (!self)
+            {
+                return;
             }
 
-            self->pollNVMeDevices();
+            // through libmctp this will invoke rxMessage
+            mctp_smbus_read(self->binding.smbus);
+            self->waitForResponses();
         });
 }
 
@@ -420,8 +561,16 @@ void NVMeContext::close()
 {
     scanTimer.cancel();
     mctpResponseTimer.cancel();
+    arbiterRetryTimer.cancel();
     nvmeSlaveSocket.cancel();
     nvmeMCTP::closeInFd(rootBus);
+    if (binding.context == this)
+    {
+        binding.context = nullptr;
+    }
+    polling = nullptr;
+    sweep.clear();
+    nearThresholdSweep = false;
 }
 
 NVMeContext::~NVMeContext()
@@ -462,6 +611,24 @@ NVMeSensor::NVMeSensor(sdbusplus::asio::object_server& objectServer,
         "/xyz/openbmc_project/sensors/temperature/" + name,
         association::interface);
 
+    // whoever needs more of the health status than the temperature can have
+    // the latest poll response without another round trip to the drive
+    healthInterface = objectServer.add_interface(
+        "/xyz/openbmc_project/sensors/temperature/" + name,
+        healthStatusInterface);
+    healthInterface->register_method("GetHealthStatus", [this]() {
+        if (healthStatus.empty())
+        {
+            throw std::runtime_error("No health status read yet");
+        }
+        uint64_t ageMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - healthStatusTime)
+                .count());
+        return std::make_tuple(healthStatus, ageMs);
+    });
+    healthInterface->initialize();
+
     setInitialProperties(conn, sensor_paths::unitDegreesC);
 }
 
@@ -472,9 +639,50 @@ NVMeSensor::~NVMeSensor()
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
     objServer.remove_interface(association);
+    objServer.remove_interface(healthInterface);
 }
 
 void NVMeSensor::checkThresholds(void)
 {
     thresholds::checkThresholds(this);
 }
+
+void NVMeSensor::cacheHealthStatus(const uint8_t* data, size_t len)
+{
+    healthStatus.assign(data, data + len);
+    healthStatusTime = std::chrono::steady_clock::now();
+}
+
+unsigned int NVMeSensor::idleSweeps(double reading)
+{
+    nearThreshold = false;
+    if (!std::isfinite(reading))
+    {
+        steadyReads = 0;
+        return 0;
+    }
+    for (const thresholds::Threshold& threshold : thresholds)
+    {
+        double distance = threshold.direction == thresholds::Direction::HIGH
+                              ? threshold.value - reading
+                              : reading - threshold.value;
+        if (distance < thresholdMargin)
+        {
+            steadyReads = 0;
+            nearThreshold = true;
+            return 0;
+        }
+    }
+    if (std::isfinite(value) && std::abs(reading - value) <= hysteresisTrigger)
+    {
+        if (steadyReads < steadyReadsPerSweep * maxIdleSweeps)
+        {
+            steadyReads++;
+        }
+    }
+    else
+    {
+        steadyReads = 0;
+    }
+    return steadyReads / steadyReadsPerSweep;
+}
@@ -126,7 +126,16 @@ void createSensors(boost::asio::io_service& io,
                 }
                 else
                 {
-                    context = std::make_shared<NVMeContext>(io, rootBus);
+                    try
+                    {
+                        context = std::make_shared<NVMeContext>(io, rootBus);
+                    }
+                    catch (const std::runtime_error& e)
+                    {
+                        std::cerr << "Can't poll root bus " << rootBus << ": "
+                                  << e.what() << "\n";
+                        continue;
+                    }
                     nvmeDeviceMap[rootBus] = context;
                 }
 
@@ -135,6 +144,22 @@ void createSensors(boost::asio::io_service& io,
                         objectServer, io, dbusConnection, sensorName,
                         std::move(sensorThresholds), interfacePath, busNumber);
 
+                auto findAdaptive =
+                    baseConfiguration->second.find("AdaptivePolling");
+                if (findAdaptive != baseConfiguration->second.end())
+                {
+                    if (auto adaptive =
+                            std::get_if<bool>(&findAdaptive->second))
+                    {
+                        sensorPtr->adaptive = *adaptive;
+                    }
+                    else
+                    {
+                        std::cerr << "Wrong format for AdaptivePolling of "
+                                  << sensorName << "\n";
+                    }
+                }
+
                 context->sensors.emplace_back(sensorPtr);
             }
             for (const auto& [_, context] : nvmeDeviceMap)
@@ -151,7 +176,6 @@ int main()
     auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
     systemBus->request_name("xyz.openbmc_project.NVMeSensor");
     sdbusplus::asio::object_server objectServer(systemBus);
-    nvmeMCTP::init();
 
     io.post([&]() { createSensors(io, objectServer, systemBus); });
 
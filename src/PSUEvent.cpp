@@ -18,16 +18,21 @@
 
 #include <PSUEvent.hpp>
 #include <SensorPaths.hpp>
+#include <Utils.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/read_until.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <array>
+#include <cerrno>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -42,8 +47,9 @@ PSUCombineEvent::PSUCombineEvent(
         std::string,
         boost::container::flat_map<std::string, std::vector<std::string>>>&
         groupEventPathList,
-    const std::string& combineEventName) :
-    objServer(objectServer)
+    const std::string& combineEventName, bool batchEvents) :
+    objServer(objectServer),
+    notifier(io, [this](const std::string& path) { handleNotification(path); })
 {
     std::string psuNameEscaped = sensor_paths::escapePathForDbus(psuName);
     eventInterface = objServer.add_interface(
@@ -72,7 +78,10 @@ PSUCombineEvent::PSUCombineEvent(
             auto p = std::make_shared<PSUSubEvent>(
                 eventInterface, path, conn, io, eventName, eventName, assert,
                 combineEvent, state, psuName);
-            p->setupRead();
+            if (!batchEvents)
+            {
+                p->setupRead();
+            }
 
             events[eventPSUName].emplace_back(p);
             asserts.emplace_back(assert);
@@ -95,7 +104,10 @@ PSUCombineEvent::PSUCombineEvent(
                 auto p = std::make_shared<PSUSubEvent>(
                     eventInterface, path, conn, io, groupEventName,
                     groupPathList.first, assert, combineEvent, state, psuName);
-                p->setupRead();
+                if (!batchEvents)
+                {
+                    p->setupRead();
+                }
                 events[eventPSUName].emplace_back(p);
 
                 asserts.emplace_back(assert);
@@ -103,10 +115,32 @@ PSUCombineEvent::PSUCombineEvent(
             }
         }
     }
+
+    boost::container::flat_set<std::string> watched;
+    for (const auto& [eventName, subEvents] : events)
+    {
+        for (const auto& subEvent : subEvents)
+        {
+            if (watched.insert(subEvent->getPath()).second)
+            {
+                notifier.watch(subEvent->getPath());
+            }
+        }
+    }
+
+    // The interval matches the one of the PSU sensors, so the batch is read
+    // in the same tick as the sensors of the device and the driver can serve
+    // the status words from the update it just did for them.
+    if (batchEvents && !events.empty())
+    {
+        pollHandle.start(io, PSUSubEvent::eventPollMs,
+                         [this]() { pollEvents(); });
+    }
 }
 
 PSUCombineEvent::~PSUCombineEvent()
 {
+    pollHandle.reset();
     // Clear unique_ptr first
     for (auto& event : events)
     {
@@ -119,6 +153,37 @@ PSUCombineEvent::~PSUCombineEvent()
     objServer.remove_interface(eventInterface);
 }
 
+void PSUCombineEvent::pollEvents(void)
+{
+    constexpr size_t ticksPerNotifiedPoll =
+        PSUSubEvent::notifiedPollMs / PSUSubEvent::eventPollMs;
+    bool slowTick = (pollTicks++ % ticksPerNotifiedPoll) == 0;
+    for (const auto& [eventName, subEvents] : events)
+    {
+        for (const auto& subEvent : subEvents)
+        {
+            if (!subEvent->isNotified() || slowTick)
+            {
+                subEvent->poll();
+            }
+        }
+    }
+}
+
+void PSUCombineEvent::handleNotification(const std::string& path)
+{
+    for (const auto& [eventName, subEvents] : events)
+    {
+        for (const auto& subEvent : subEvents)
+        {
+            if (subEvent->getPath() == path)
+            {
+                subEvent->notify();
+            }
+        }
+    }
+}
+
 static boost::container::flat_map<std::string,
                                   std::pair<std::string, std::string>>
     logID = {
@@ -216,22 +281,79 @@ void PSUSubEvent::handleResponse(const boost::system::error_code& err)
         return;
     }
     std::istream responseStream(readBuf.get());
+    bool valid = false;
+    int nvalue = 0;
     if (!err)
     {
         std::string response;
         try
         {
             std::getline(responseStream, response);
-            int nvalue = std::stoi(response);
+            nvalue = std::stoi(response);
             responseStream.clear();
-
-            updateValue(nvalue);
-            errCount = 0;
+            valid = true;
         }
         catch (const std::invalid_argument&)
+        {}
+    }
+    handleReading(valid, nvalue);
+    lseek(fd, 0, SEEK_SET);
+    waitTimer.expires_from_now(boost::posix_time::milliseconds(
+        notified ? notifiedPollMs : eventPollMs));
+
+    std::weak_ptr<PSUSubEvent> weakRef = weak_from_this();
+    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
+        std::shared_ptr<PSUSubEvent> self = weakRef.lock();
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+        if (self)
         {
-            errCount++;
+            self->setupRead();
         }
+    });
+}
+
+void PSUSubEvent::poll(void)
+{
+    if (fd < 0)
+    {
+        return;
+    }
+    std::array<char, 32> buffer;
+    ssize_t rc = 0;
+    do
+    {
+        rc = pread(fd, buffer.data(), buffer.size(), 0);
+    } while (rc < 0 && errno == EINTR);
+    if (rc < 0 && errno == ENODEV)
+    {
+        return; // device is gone, same as a not_found on the async read
+    }
+    int64_t nvalue = 0;
+    bool valid = rc >= 0 &&
+                 parseSysfsInteger(std::string_view(buffer.data(), rc), nvalue);
+    handleReading(valid, static_cast<int>(nvalue));
+}
+
+void PSUSubEvent::notify(void)
+{
+    if (!notified)
+    {
+        std::cerr << "PSU event " << path << " is notified, polling every "
+                  << notifiedPollMs << "ms from now\n";
+        notified = true;
+    }
+    poll();
+}
+
+void PSUSubEvent::handleReading(bool valid, int newValue)
+{
+    if (valid)
+    {
+        updateValue(newValue);
+        errCount = 0;
     }
     else
     {
@@ -246,21 +368,6 @@ void PSUSubEvent::handleResponse(const boost::system::error_code& err)
         updateValue(0);
         errCount++;
     }
-    lseek(fd, 0, SEEK_SET);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(eventPollMs));
-
-    std::weak_ptr<PSUSubEvent> weakRef = weak_from_this();
-    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
-        std::shared_ptr<PSUSubEvent> self = weakRef.lock();
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return;
-        }
-        if (self)
-        {
-            self->setupRead();
-        }
-    });
 }
 
 // Any of the sub events of one event is asserted, then the event will be
@@ -19,13 +19,11 @@
 #include <PSUSensor.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <cerrno>
 #include <iostream>
-#include <istream>
 #include <limits>
 #include <memory>
 #include <string>
@@ -48,7 +46,9 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
            std::move(thresholdsIn), sensorConfiguration, objectType, max, min,
            conn),
     std::enable_shared_from_this<PSUSensor>(), objServer(objectServer),
-    inputDev(io), waitTimer(io), path(path), pathRatedMax(""), pathRatedMin(""),
+    inputFile(std::make_shared<SysfsFile>(path)),
+    readPool(SysfsReadPool::getInstance(io)), path(path), pathRatedMax(""),
+    pathRatedMin(""),
     sensorFactor(factor), minMaxReadCounter(0)
 {
     std::string unitPath = sensor_paths::getPathForUnits(sensorUnits);
@@ -61,13 +61,13 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
                   << "\"\n";
     }
 
-    fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
+    if (!inputFile->isOpen())
     {
         std::cerr << "PSU sensor failed to open file\n";
         return;
     }
-    inputDev.assign(fd);
+    pollHandle.start(io, sensorPollMs, [this]() { setupRead(); });
+    setPoller(pollHandle, sensorPollMs);
 
     std::string dbusPath = sensorPathPrefix + unitPath + "/" + name;
 
@@ -121,8 +121,7 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
 
 PSUSensor::~PSUSensor()
 {
-    waitTimer.cancel();
-    inputDev.close();
+    pollHandle.reset();
     objServer.remove_interface(sensorInterface);
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
@@ -131,89 +130,109 @@ PSUSensor::~PSUSensor()
 
 void PSUSensor::setupRead(void)
 {
-    std::shared_ptr<boost::asio::streambuf> buffer =
-        std::make_shared<boost::asio::streambuf>();
-    std::weak_ptr<PSUSensor> weakRef = weak_from_this();
-    boost::asio::async_read_until(
-        inputDev, *buffer, '\n',
-        [weakRef, buffer](const boost::system::error_code& ec,
-                          std::size_t /*bytes_transfered*/) {
-            std::shared_ptr<PSUSensor> self = weakRef.lock();
-            if (self)
-            {
-                self->readBuf = buffer;
-                self->handleResponse(ec);
-            }
-        });
+    if (readPool == nullptr)
+    {
+        readStarted();
+        int64_t reading = 0;
+        int error = inputFile->readInteger(reading) ? 0 : errno;
+        handleResponse(reading, error);
+        return;
+    }
+    if (readQueued)
+    {
+        return; // the device is slow, that only holds up this sensor
+    }
+    readQueued = true;
+    readStarted();
+    readPool->read(inputFile, [weakRef{weak_from_this()}](int64_t reading,
+                                                          int error) {
+        std::shared_ptr<PSUSensor> self = weakRef.lock();
+        if (!self)
+        {
+            return;
+        }
+        self->readQueued = false;
+        self->handleResponse(reading, error);
+    });
 }
 
-void PSUSensor::updateMinMaxValues(void)
+void PSUSensor::handleResponse(int64_t reading, int error)
 {
-    if (auto newVal = readFile(pathRatedMin, sensorFactor))
+    if (error != 0)
     {
-        updateProperty(sensorInterface, minValue, *newVal, "MinValue");
+        if (error == ENODEV)
+        {
+            std::cerr << "PSU sensor " << name << " removed " << path << "\n";
+            pollHandle.reset();
+            return;
+        }
+        // only the first of a run of failures is logged, the rest is
+        // retried at a backed off rate anyway
+        if (failedReads == 0)
+        {
+            if (error == EINVAL)
+            {
+                std::cerr << "Could not parse " << path << "\n";
+            }
+            else
+            {
+                std::cerr << "System error " << error << "\n";
+            }
+        }
+        incrementError();
+        return;
     }
 
-    if (auto newVal = readFile(pathRatedMax, sensorFactor))
+    rawValue = static_cast<double>(reading);
+    updateValue(rawValue / sensorFactor);
+
+    if (minMaxReadCounter++ % 8 == 0)
     {
-        updateProperty(sensorInterface, maxValue, *newVal, "MaxValue");
+        updateMinMaxValues();
     }
 }
 
-void PSUSensor::handleResponse(const boost::system::error_code& err)
+bool PSUSensor::readSnapshot(const SysfsSnapshot& snapshot)
 {
-    if ((err == boost::system::errc::bad_file_descriptor) ||
-        (err == boost::asio::error::misc_errors::not_found))
+    auto findReading = snapshot.find(path);
+    if (findReading == snapshot.end())
     {
-        std::cerr << "Bad file descriptor from\n";
-        return;
+        return false;
     }
-    std::istream responseStream(readBuf.get());
-    if (!err)
-    {
-        std::string response;
-        try
-        {
-            std::getline(responseStream, response);
-            rawValue = std::stod(response);
-            responseStream.clear();
-            double nvalue = rawValue / sensorFactor;
 
-            updateValue(nvalue);
+    rawValue = static_cast<double>(findReading->second);
+    updateValue(rawValue / sensorFactor);
 
-            if (minMaxReadCounter++ % 8 == 0)
-            {
-                updateMinMaxValues();
-            }
-        }
-        catch (const std::invalid_argument&)
-        {
-            std::cerr << "Could not parse " << response << "\n";
-            incrementError();
-        }
+    auto findRatedMin = snapshot.find(pathRatedMin);
+    if (findRatedMin != snapshot.end())
+    {
+        updateProperty(sensorInterface, minValue,
+                       static_cast<double>(findRatedMin->second) / sensorFactor,
+                       "MinValue");
     }
-    else
+    auto findRatedMax = snapshot.find(pathRatedMax);
+    if (findRatedMax != snapshot.end())
     {
-        std::cerr << "System error " << err << "\n";
-        incrementError();
+        updateProperty(sensorInterface, maxValue,
+                       static_cast<double>(findRatedMax->second) / sensorFactor,
+                       "MaxValue");
     }
+    // the rated limits were just read, don't reread them on the next poll
+    minMaxReadCounter = 1;
+    return true;
+}
 
-    lseek(fd, 0, SEEK_SET);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
+void PSUSensor::updateMinMaxValues(void)
+{
+    if (auto newVal = readFile(pathRatedMin, sensorFactor))
+    {
+        updateProperty(sensorInterface, minValue, *newVal, "MinValue");
+    }
 
-    std::weak_ptr<PSUSensor> weakRef = weak_from_this();
-    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
-        std::shared_ptr<PSUSensor> self = weakRef.lock();
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            std::cerr << "Failed to reschedule\n";
-            return;
-        }
-        if (self)
-        {
-            self->setupRead();
-        }
-    });
+    if (auto newVal = readFile(pathRatedMax, sensorFactor))
+    {
+        updateProperty(sensorInterface, maxValue, *newVal, "MaxValue");
+    }
 }
 
 void PSUSensor::checkThresholds(void)
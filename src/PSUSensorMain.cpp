@@ -14,8 +14,12 @@
 // limitations under the License.
 */
 
+#include <HwmonIndex.hpp>
+#include <IoSingleton.hpp>
 #include <PSUEvent.hpp>
 #include <PSUSensor.hpp>
+#include <ProbePool.hpp>
+#include <SensorDaemons.hpp>
 #include <Utils.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -25,13 +29,15 @@
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <regex>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -40,6 +46,15 @@
 
 static constexpr bool debug = false;
 
+static constexpr HwmonAttributeMatch anyInputMatch{"", "input"};
+static constexpr HwmonAttributeMatch anyMaxMatch{"", "max"};
+static constexpr HwmonAttributeMatch
+    probeMatch{"", "input|max|rated_min|rated_max"};
+
+// PMBus reads mostly wait on the I2C bus, so this is not bound to the number
+// of cores
+static constexpr size_t probeWorkers = 4;
+
 static constexpr std::array<const char*, 25> sensorTypes = {
     "xyz.openbmc_project.Configuration.ADM1272",
     "xyz.openbmc_project.Configuration.ADM1275",
@@ -60,14 +75,14 @@ static constexpr std::array<const char*, 25> sensorTypes = {
     "xyz.openbmc_project.Configuration.MAX20734",
     "xyz.openbmc_project.Configuration.MAX20796",
     "xyz.openbmc_project.Configuration.MAX34451",
-    "xyz.openbmc_project.Configuration.pmbus",
     "xyz.openbmc_project.Configuration.PXE1610",
     "xyz.openbmc_project.Configuration.RAA228000",
     "xyz.openbmc_project.Configuration.RAA228228",
     "xyz.openbmc_project.Configuration.RAA229004",
-    "xyz.openbmc_project.Configuration.TPS546D24"};
+    "xyz.openbmc_project.Configuration.TPS546D24",
+    "xyz.openbmc_project.Configuration.pmbus"};
 
-static std::vector<std::string> pmbusNames = {
+static constexpr std::array<std::string_view, 25> pmbusNames = {
     "adm1272",  "adm1275",   "adm1278",   "dps800",    "ina219",
     "ina230",   "ipsps1",    "isl68137",  "isl68220",  "isl68223",
     "isl69243", "isl69260",  "lm25066",   "max16601",  "max20710",
@@ -76,96 +91,245 @@ static std::vector<std::string> pmbusNames = {
 
 namespace fs = std::filesystem;
 
+// The classification tables are built at compile time. The ones looked up by
+// key are sorted, which isSorted() checks, and searched with findEntry().
+template <typename Value>
+struct StaticEntry
+{
+    std::string_view key;
+    Value value;
+};
+
+constexpr std::string_view tableKey(std::string_view key)
+{
+    return key;
+}
+
+template <typename Value>
+constexpr std::string_view tableKey(const StaticEntry<Value>& entry)
+{
+    return entry.key;
+}
+
+template <typename Entry, size_t size>
+constexpr bool isSorted(const std::array<Entry, size>& table)
+{
+    for (size_t index = 1; index < size; index++)
+    {
+        if (!(tableKey(table[index - 1]) < tableKey(table[index])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// nullptr if the key is not in the table
+template <typename Entry, size_t size>
+const Entry* findEntry(const std::array<Entry, size>& table,
+                       std::string_view key)
+{
+    auto found = std::lower_bound(
+        table.begin(), table.end(), key,
+        [](const Entry& entry, std::string_view key) {
+            return tableKey(entry) < key;
+        });
+    if (found == table.end() || tableKey(*found) != key)
+    {
+        return nullptr;
+    }
+    return &*found;
+}
+
+static_assert(isSorted(sensorTypes), "sensorTypes must be sorted");
+static_assert(isSorted(pmbusNames), "pmbusNames must be sorted");
+
+// defaults of the sensors of a label, copied into a PSUProperty to customize
+struct PSULabel
+{
+    std::string_view typeName;
+    double maxReading;
+    double minReading;
+    unsigned int scaleFactor;
+};
+
+static constexpr std::array<StaticEntry<const char*>, 5> sensorTable = {{
+    {"curr", sensor_paths::unitAmperes},
+    {"fan", sensor_paths::unitRPMs},
+    {"in", sensor_paths::unitVolts},
+    {"power", sensor_paths::unitWatts},
+    {"temp", sensor_paths::unitDegreesC},
+}};
+static_assert(isSorted(sensorTable), "sensorTable must be sorted");
+
+static constexpr std::array<StaticEntry<PSULabel>, 68> labelMatch = {{
+    {"curr1", {"Output Current", 255, 0, 3}},
+    {"fan1", {"Fan Speed 1", 30000, 0, 0}},
+    {"fan2", {"Fan Speed 2", 30000, 0, 0}},
+    {"iin", {"Input Current", 20, 0, 3}},
+    {"in1", {"Output Voltage", 255, 0, 3}},
+    {"iout1", {"Output Current", 255, 0, 3}},
+    {"iout10", {"Output Current", 255, 0, 3}},
+    {"iout11", {"Output Current", 255, 0, 3}},
+    {"iout12", {"Output Current", 255, 0, 3}},
+    {"iout13", {"Output Current", 255, 0, 3}},
+    {"iout14", {"Output Current", 255, 0, 3}},
+    {"iout2", {"Output Current", 255, 0, 3}},
+    {"iout3", {"Output Current", 255, 0, 3}},
+    {"iout4", {"Output Current", 255, 0, 3}},
+    {"iout5", {"Output Current", 255, 0, 3}},
+    {"iout6", {"Output Current", 255, 0, 3}},
+    {"iout7", {"Output Current", 255, 0, 3}},
+    {"iout8", {"Output Current", 255, 0, 3}},
+    {"iout9", {"Output Current", 255, 0, 3}},
+    {"maxiout1", {"Max Output Current", 255, 0, 3}},
+    {"maxpin", {"Max Input Power", 3000, 0, 6}},
+    {"maxtemp1", {"Max Temperature", 127, -128, 3}},
+    {"maxvin", {"Max Input Voltage", 300, 0, 3}},
+    {"pin", {"Input Power", 3000, 0, 6}},
+    {"pout1", {"Output Power", 3000, 0, 6}},
+    {"pout2", {"Output Power", 3000, 0, 6}},
+    {"pout3", {"Output Power", 3000, 0, 6}},
+    {"power1", {"Output Power", 3000, 0, 6}},
+    {"temp1", {"Temperature", 127, -128, 3}},
+    {"temp2", {"Temperature", 127, -128, 3}},
+    {"temp3", {"Temperature", 127, -128, 3}},
+    {"temp4", {"Temperature", 127, -128, 3}},
+    {"temp5", {"Temperature", 127, -128, 3}},
+    {"temp6", {"Temperature", 127, -128, 3}},
+    {"vin", {"Input Voltage", 300, 0, 3}},
+    {"vmon", {"Auxiliary Input Voltage", 255, 0, 3}},
+    {"vout1", {"Output Voltage", 255, 0, 3}},
+    {"vout10", {"Output Voltage", 255, 0, 3}},
+    {"vout11", {"Output Voltage", 255, 0, 3}},
+    {"vout12", {"Output Voltage", 255, 0, 3}},
+    {"vout13", {"Output Voltage", 255, 0, 3}},
+    {"vout14", {"Output Voltage", 255, 0, 3}},
+    {"vout15", {"Output Voltage", 255, 0, 3}},
+    {"vout16", {"Output Voltage", 255, 0, 3}},
+    {"vout17", {"Output Voltage", 255, 0, 3}},
+    {"vout18", {"Output Voltage", 255, 0, 3}},
+    {"vout19", {"Output Voltage", 255, 0, 3}},
+    {"vout2", {"Output Voltage", 255, 0, 3}},
+    {"vout20", {"Output Voltage", 255, 0, 3}},
+    {"vout21", {"Output Voltage", 255, 0, 3}},
+    {"vout22", {"Output Voltage", 255, 0, 3}},
+    {"vout23", {"Output Voltage", 255, 0, 3}},
+    {"vout24", {"Output Voltage", 255, 0, 3}},
+    {"vout25", {"Output Voltage", 255, 0, 3}},
+    {"vout26", {"Output Voltage", 255, 0, 3}},
+    {"vout27", {"Output Voltage", 255, 0, 3}},
+    {"vout28", {"Output Voltage", 255, 0, 3}},
+    {"vout29", {"Output Voltage", 255, 0, 3}},
+    {"vout3", {"Output Voltage", 255, 0, 3}},
+    {"vout30", {"Output Voltage", 255, 0, 3}},
+    {"vout31", {"Output Voltage", 255, 0, 3}},
+    {"vout32", {"Output Voltage", 255, 0, 3}},
+    {"vout4", {"Output Voltage", 255, 0, 3}},
+    {"vout5", {"Output Voltage", 255, 0, 3}},
+    {"vout6", {"Output Voltage", 255, 0, 3}},
+    {"vout7", {"Output Voltage", 255, 0, 3}},
+    {"vout8", {"Output Voltage", 255, 0, 3}},
+    {"vout9", {"Output Voltage", 255, 0, 3}},
+}};
+static_assert(isSorted(labelMatch), "labelMatch must be sorted");
+
+static constexpr std::array<StaticEntry<std::string_view>, 2> pwmTable = {{
+    {"fan1", "Fan_1"},
+    {"fan2", "Fan_2"},
+}};
+static_assert(isSorted(pwmTable), "pwmTable must be sorted");
+
+struct EventAttribute
+{
+    std::string_view eventName;
+    std::string_view attribute;
+};
+
+// attributes of a device, by the event they belong to
+static constexpr std::array<EventAttribute, 4> eventMatch = {{
+    {"ACLost", "in1_beep"},
+    {"ConfigureError", "in1_fault"},
+    {"Failure", "in2_alarm"},
+    {"PredictiveFailure", "power1_alarm"},
+}};
+
+// suffixes of the limit alarms of an input, by the event they belong to
+static constexpr std::array<EventAttribute, 4> limitEventMatch = {{
+    {"Failure", "crit_alarm"},
+    {"Failure", "lcrit_alarm"},
+    {"PredictiveFailure", "max_alarm"},
+    {"PredictiveFailure", "min_alarm"},
+}};
+
+struct GroupEventAttribute
+{
+    std::string_view groupEventName;
+    std::string_view eventName;
+    std::string_view attribute;
+};
+
+static constexpr std::array<GroupEventAttribute, 4> groupEventMatch = {{
+    {"FanFault", "fan1", "fan1_alarm"},
+    {"FanFault", "fan1", "fan1_fault"},
+    {"FanFault", "fan2", "fan2_alarm"},
+    {"FanFault", "fan2", "fan2_fault"},
+}};
+
 static boost::container::flat_map<std::string, std::shared_ptr<PSUSensor>>
     sensors;
 static boost::container::flat_map<std::string, std::unique_ptr<PSUCombineEvent>>
     combineEvents;
 static boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>
     pwmSensors;
-static boost::container::flat_map<std::string, std::string> sensorTable;
-static boost::container::flat_map<std::string, PSUProperty> labelMatch;
-static boost::container::flat_map<std::string, std::string> pwmTable;
-static boost::container::flat_map<std::string, std::vector<std::string>>
-    eventMatch;
-static boost::container::flat_map<
-    std::string,
-    boost::container::flat_map<std::string, std::vector<std::string>>>
-    groupEventMatch;
-static boost::container::flat_map<std::string, std::vector<std::string>>
-    limitEventMatch;
-
-static std::vector<PSUProperty> psuProperties;
+// configuration the sensors were last built from, by configuration path
+static boost::container::flat_map<std::string, SensorData> appliedConfigs;
+
+// owned by the io_service, so that its workers are joined before it goes away
+static ProbePool* probePool = nullptr;
 
 // Function CheckEvent will check each attribute from eventMatch table in the
 // sysfs. If the attributes exists in sysfs, then store the complete path
 // of the attribute into eventPathList.
 void checkEvent(
-    const std::string& directory,
-    const boost::container::flat_map<std::string, std::vector<std::string>>&
-        eventMatch,
+    const HwmonDevice& device,
     boost::container::flat_map<std::string, std::vector<std::string>>&
         eventPathList)
 {
-    for (const auto& match : eventMatch)
+    for (const EventAttribute& match : eventMatch)
     {
-        const std::vector<std::string>& eventAttrs = match.second;
-        const std::string& eventName = match.first;
-        for (const auto& eventAttr : eventAttrs)
+        if (!std::binary_search(device.attributes.begin(),
+                                device.attributes.end(), match.attribute))
         {
-            std::string eventPath = directory;
-            eventPath += "/";
-            eventPath += eventAttr;
-
-            std::ifstream eventFile(eventPath);
-            if (!eventFile.good())
-            {
-                continue;
-            }
-
-            eventPathList[eventName].push_back(eventPath);
+            continue;
         }
+
+        eventPathList[std::string(match.eventName)].push_back(
+            (device.directory / match.attribute).string());
     }
 }
 
 // Check Group Events which contains more than one targets in each combine
 // events.
 void checkGroupEvent(
-    const std::string& directory,
-    const boost::container::flat_map<
-        std::string,
-        boost::container::flat_map<std::string, std::vector<std::string>>>&
-        groupEventMatch,
+    const HwmonDevice& device,
     boost::container::flat_map<
         std::string,
         boost::container::flat_map<std::string, std::vector<std::string>>>&
         groupEventPathList)
 {
-    for (const auto& match : groupEventMatch)
+    for (const GroupEventAttribute& match : groupEventMatch)
     {
-        const std::string& groupEventName = match.first;
-        const boost::container::flat_map<std::string, std::vector<std::string>>
-            events = match.second;
-        boost::container::flat_map<std::string, std::vector<std::string>>
-            pathList;
-        for (const auto& match : events)
+        // every group is listed, even if none of its attributes exist
+        auto& pathList = groupEventPathList[std::string(match.groupEventName)];
+        if (!std::binary_search(device.attributes.begin(),
+                                device.attributes.end(), match.attribute))
         {
-            const std::string& eventName = match.first;
-            const std::vector<std::string>& eventAttrs = match.second;
-            for (const auto& eventAttr : eventAttrs)
-            {
-                std::string eventPath = directory;
-                eventPath += "/";
-                eventPath += eventAttr;
-                std::ifstream eventFile(eventPath);
-                if (!eventFile.good())
-                {
-                    continue;
-                }
-
-                pathList[eventName].push_back(eventPath);
-            }
+            continue;
         }
-        groupEventPathList[groupEventName] = pathList;
+
+        pathList[std::string(match.eventName)].push_back(
+            (device.directory / match.attribute).string());
     }
 }
 
@@ -175,8 +339,6 @@ void checkGroupEvent(
 // to eventPathList.
 void checkEventLimits(
     const std::string& sensorPathStr,
-    const boost::container::flat_map<std::string, std::vector<std::string>>&
-        limitEventMatch,
     boost::container::flat_map<std::string, std::vector<std::string>>&
         eventPathList)
 {
@@ -195,20 +357,16 @@ void checkEventLimits(
     }
 
     auto prefixPart = sensorPathStr.substr(0, attributePartPos + 1);
-    for (const auto& limitMatch : limitEventMatch)
+    for (const EventAttribute& limitMatch : limitEventMatch)
     {
-        const std::vector<std::string>& limitEventAttrs = limitMatch.second;
-        const std::string& eventName = limitMatch.first;
-        for (const auto& limitEventAttr : limitEventAttrs)
+        auto limitEventPath = prefixPart + std::string(limitMatch.attribute);
+        std::ifstream eventFile(limitEventPath);
+        if (!eventFile.good())
         {
-            auto limitEventPath = prefixPart + limitEventAttr;
-            std::ifstream eventFile(limitEventPath);
-            if (!eventFile.good())
-            {
-                continue;
-            }
-            eventPathList[eventName].push_back(limitEventPath);
+            continue;
         }
+        eventPathList[std::string(limitMatch.eventName)].push_back(
+            limitEventPath);
     }
 }
 
@@ -216,35 +374,35 @@ static void
     checkPWMSensor(const fs::path& sensorPath, std::string& labelHead,
                    const std::string& interfacePath,
                    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+                   boost::asio::io_service& io,
                    sdbusplus::asio::object_server& objectServer,
                    const std::string& psuName)
 {
-    for (const auto& pwmName : pwmTable)
+    const auto* pwmName = findEntry(pwmTable, labelHead);
+    if (pwmName == nullptr)
     {
-        if (pwmName.first != labelHead)
-        {
-            continue;
-        }
-
-        const std::string& sensorPathStr = sensorPath.string();
-        const std::string& pwmPathStr =
-            boost::replace_all_copy(sensorPathStr, "input", "target");
-        std::ifstream pwmFile(pwmPathStr);
-        if (!pwmFile.good())
-        {
-            continue;
-        }
+        return;
+    }
 
-        auto findPWMSensor = pwmSensors.find(psuName + labelHead);
-        if (findPWMSensor != pwmSensors.end())
-        {
-            continue;
-        }
+    const std::string& sensorPathStr = sensorPath.string();
+    const std::string& pwmPathStr =
+        boost::replace_all_copy(sensorPathStr, "input", "target");
+    std::ifstream pwmFile(pwmPathStr);
+    if (!pwmFile.good())
+    {
+        return;
+    }
 
-        pwmSensors[psuName + labelHead] = std::make_unique<PwmSensor>(
-            "Pwm_" + psuName + "_" + pwmName.second, pwmPathStr, dbusConnection,
-            objectServer, interfacePath + "_" + pwmName.second, "PSU");
+    auto findPWMSensor = pwmSensors.find(psuName + labelHead);
+    if (findPWMSensor != pwmSensors.end())
+    {
+        return;
     }
+
+    std::string pwmSuffix(pwmName->value);
+    pwmSensors[psuName + labelHead] = std::make_unique<PwmSensor>(
+        "Pwm_" + psuName + "_" + pwmSuffix, pwmPathStr, dbusConnection, io,
+        objectServer, interfacePath + "_" + pwmSuffix, "PSU");
 }
 
 static void createSensorsCallback(
@@ -252,20 +410,21 @@ static void createSensorsCallback(
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
     const ManagedObjectType& sensorConfigs,
     const std::shared_ptr<boost::container::flat_set<std::string>>&
-        sensorsChanged)
+        sensorsChanged,
+    const SysfsSnapshot& snapshot)
 {
     int numCreated = 0;
     bool firstScan = sensorsChanged == nullptr;
 
-    std::vector<fs::path> pmbusPaths;
-    if (!findFiles(fs::path("/sys/class/hwmon"), "name", pmbusPaths))
+    HwmonIndex& hwmonIndex = HwmonIndex::getInstance(io);
+    const auto& hwmonDevices = hwmonIndex.getDevices();
+    if (hwmonDevices.empty())
     {
         std::cerr << "No PSU sensors in system\n";
         return;
     }
 
-    boost::container::flat_set<std::string> directories;
-    for (const auto& pmbusPath : pmbusPaths)
+    for (const auto& [hwmonName, hwmonDevice] : hwmonDevices)
     {
         boost::container::flat_map<std::string, std::vector<std::string>>
             eventPathList;
@@ -274,19 +433,8 @@ static void createSensorsCallback(
             boost::container::flat_map<std::string, std::vector<std::string>>>
             groupEventPathList;
 
-        std::ifstream nameFile(pmbusPath);
-        if (!nameFile.good())
-        {
-            std::cerr << "Failure finding pmbus path " << pmbusPath << "\n";
-            continue;
-        }
-
-        std::string pmbusName;
-        std::getline(nameFile, pmbusName);
-        nameFile.close();
-
-        if (std::find(pmbusNames.begin(), pmbusNames.end(), pmbusName) ==
-            pmbusNames.end())
+        const std::string& pmbusName = hwmonDevice.name;
+        if (findEntry(pmbusNames, pmbusName) == nullptr)
         {
             // To avoid this error message, add your driver name to
             // the pmbusNames vector at the top of this file.
@@ -296,17 +444,8 @@ static void createSensorsCallback(
         }
 
         const std::string* psuName;
-        auto directory = pmbusPath.parent_path();
-
-        auto ret = directories.insert(directory.string());
-        if (!ret.second)
-        {
-            std::cerr << "Duplicate path " << directory.string() << "\n";
-            continue; // check if path has already been searched
-        }
 
-        fs::path device = directory / "device";
-        std::string deviceName = fs::canonical(device).stem();
+        std::string deviceName = hwmonDevice.devicePath.stem();
         auto findHyphen = deviceName.find('-');
         if (findHyphen == std::string::npos)
         {
@@ -343,13 +482,13 @@ static void createSensorsCallback(
                  sensor : sensorConfigs)
         {
             sensorData = &(sensor.second);
-            for (const char* type : sensorTypes)
+            for (const auto& sensorBase : *sensorData)
             {
-                auto sensorBase = sensorData->find(type);
-                if (sensorBase != sensorData->end())
+                if (const char* const* type =
+                        findEntry(sensorTypes, sensorBase.first))
                 {
-                    baseConfig = &(*sensorBase);
-                    sensorType = type;
+                    baseConfig = &sensorBase;
+                    sensorType = *type;
                     break;
                 }
             }
@@ -436,9 +575,16 @@ static void createSensorsCallback(
             }
             sensorsChanged->erase(it);
         }
-        checkEvent(directory.string(), eventMatch, eventPathList);
-        checkGroupEvent(directory.string(), groupEventMatch,
-                        groupEventPathList);
+
+        // sensors are only recreated when something they can't apply in
+        // place has changed
+        auto applied = appliedConfigs.find(*interfacePath);
+        bool inPlace = !firstScan && applied != appliedConfigs.end() &&
+                       onlyReconfigurableChanges(applied->second, *sensorData);
+        appliedConfigs[*interfacePath] = *sensorData;
+
+        checkEvent(hwmonDevice, eventPathList);
+        checkGroupEvent(hwmonDevice, groupEventPathList);
 
         /* Check if there are more sensors in the same interface */
         int i = 1;
@@ -451,14 +597,14 @@ static void createSensorsCallback(
         } while (findPSUName != baseConfig->second.end());
 
         std::vector<fs::path> sensorPaths;
-        if (!findFiles(directory, R"(\w\d+_input$)", sensorPaths, 0))
+        if (!hwmonDevice.findFiles(anyInputMatch, sensorPaths))
         {
             std::cerr << "No PSU non-label sensor in PSU\n";
             continue;
         }
 
         /* read max value in sysfs for in, curr, power, temp, ... */
-        if (!findFiles(directory, R"(\w\d+_max$)", sensorPaths, 0))
+        if (!hwmonDevice.findFiles(anyMaxMatch, sensorPaths))
         {
             if constexpr (debug)
             {
@@ -475,57 +621,29 @@ static void createSensorsCallback(
                 std::get<std::vector<std::string>>(findLabelObj->second);
         }
 
-        std::regex sensorNameRegEx("([A-Za-z]+)[0-9]*_");
-        std::smatch matches;
-
         for (const auto& sensorPath : sensorPaths)
         {
             bool maxLabel = false;
             std::string labelHead;
             std::string sensorPathStr = sensorPath.string();
             std::string sensorNameStr = sensorPath.filename();
-            std::string sensorNameSubStr{""};
-            if (std::regex_search(sensorNameStr, matches, sensorNameRegEx))
-            {
-                // hwmon *_input filename without number:
-                // in, curr, power, temp, ...
-                sensorNameSubStr = matches[1];
-            }
-            else
+            auto attribute = splitHwmonAttribute(sensorNameStr);
+            if (!attribute)
             {
                 std::cerr << "Could not extract the alpha prefix from "
                           << sensorNameStr;
                 continue;
             }
+            // hwmon *_input filename without number:
+            // in, curr, power, temp, ...
+            std::string sensorNameSubStr(attribute->type);
 
-            std::string labelPath;
-
-            /* find and differentiate _max and _input to replace "label" */
-            size_t pos = sensorPathStr.find('_');
-            if (pos != std::string::npos)
-            {
-
-                std::string sensorPathStrMax = sensorPathStr.substr(pos);
-                if (sensorPathStrMax.compare("_max") == 0)
-                {
-                    labelPath =
-                        boost::replace_all_copy(sensorPathStr, "max", "label");
-                    maxLabel = true;
-                }
-                else
-                {
-                    labelPath = boost::replace_all_copy(sensorPathStr, "input",
-                                                        "label");
-                    maxLabel = false;
-                }
-            }
-            else
-            {
-                continue;
-            }
+            /* differentiate _max and _input to find the label */
+            maxLabel = attribute->item == "max";
 
-            std::ifstream labelFile(labelPath);
-            if (!labelFile.good())
+            std::optional<std::string> label = hwmonDevice.getLabel(
+                sensorNameStr.substr(0, sensorNameStr.find('_')));
+            if (!label)
             {
                 if constexpr (debug)
                 {
@@ -538,10 +656,7 @@ static void createSensorsCallback(
             }
             else
             {
-                std::string label;
-                std::getline(labelFile, label);
-                labelFile.close();
-                auto findSensor = sensors.find(label);
+                auto findSensor = sensors.find(*label);
                 if (findSensor != sensors.end())
                 {
                     continue;
@@ -549,7 +664,7 @@ static void createSensorsCallback(
 
                 // hwmon corresponding *_label file contents:
                 // vin1, vout1, ...
-                labelHead = label.substr(0, label.find(' '));
+                labelHead = label->substr(0, label->find(' '));
             }
 
             /* append "max" for labelMatch */
@@ -565,7 +680,7 @@ static void createSensorsCallback(
             }
 
             checkPWMSensor(sensorPath, labelHead, *interfacePath,
-                           dbusConnection, objectServer, psuNames[0]);
+                           dbusConnection, io, objectServer, psuNames[0]);
 
             if (!findLabels.empty())
             {
@@ -582,8 +697,8 @@ static void createSensorsCallback(
                 }
             }
 
-            auto findProperty = labelMatch.find(labelHead);
-            if (findProperty == labelMatch.end())
+            const auto* findProperty = findEntry(labelMatch, labelHead);
+            if (findProperty == nullptr)
             {
                 if constexpr (debug)
                 {
@@ -593,12 +708,13 @@ static void createSensorsCallback(
                 continue;
             }
 
-            // Protect the hardcoded labelMatch list from changes,
-            // by making a copy and modifying that instead.
-            // Avoid bleedthrough of one device's customizations to
-            // the next device, as each should be independently customizable.
-            psuProperties.push_back(findProperty->second);
-            auto psuProperty = psuProperties.rbegin();
+            // Customizations go into a copy of the defaults from the
+            // labelMatch table, each device is customized on its own.
+            const PSULabel& labelDefaults = findProperty->value;
+            PSUProperty psuProperty(std::string(labelDefaults.typeName),
+                                    labelDefaults.maxReading,
+                                    labelDefaults.minReading,
+                                    labelDefaults.scaleFactor);
 
             // Use label head as prefix for reading from config file,
             // example if temp1: temp1_Name, temp1_Scale, temp1_Min, ...
@@ -613,7 +729,7 @@ static void createSensorsCallback(
             {
                 try
                 {
-                    psuProperty->labelTypeName = std::visit(
+                    psuProperty.labelTypeName = std::visit(
                         VariantToStringVisitor(), findCustomName->second);
                 }
                 catch (std::invalid_argument&)
@@ -632,7 +748,7 @@ static void createSensorsCallback(
             {
                 try
                 {
-                    psuProperty->sensorScaleFactor = std::visit(
+                    psuProperty.sensorScaleFactor = std::visit(
                         VariantToUnsignedIntVisitor(), findCustomScale->second);
                 }
                 catch (std::invalid_argument&)
@@ -642,7 +758,7 @@ static void createSensorsCallback(
                 }
 
                 // Avoid later division by zero
-                if (psuProperty->sensorScaleFactor > 0)
+                if (psuProperty.sensorScaleFactor > 0)
                 {
                     customizedScale = true;
                 }
@@ -658,7 +774,7 @@ static void createSensorsCallback(
             {
                 try
                 {
-                    psuProperty->minReading = std::visit(
+                    psuProperty.minReading = std::visit(
                         VariantToDoubleVisitor(), findCustomMin->second);
                 }
                 catch (std::invalid_argument&)
@@ -673,7 +789,7 @@ static void createSensorsCallback(
             {
                 try
                 {
-                    psuProperty->maxReading = std::visit(
+                    psuProperty.maxReading = std::visit(
                         VariantToDoubleVisitor(), findCustomMax->second);
                 }
                 catch (std::invalid_argument&)
@@ -683,7 +799,7 @@ static void createSensorsCallback(
                 }
             }
 
-            if (!(psuProperty->minReading < psuProperty->maxReading))
+            if (!(psuProperty.minReading < psuProperty.maxReading))
             {
                 std::cerr << "Min must be less than Max\n";
                 continue;
@@ -696,11 +812,10 @@ static void createSensorsCallback(
             if (!customizedName)
             {
                 /* Find out sensor name index for this label */
-                std::regex rgx("[A-Za-z]+([0-9]+)");
                 size_t nameIndex{0};
-                if (std::regex_search(labelHead, matches, rgx))
+                if (auto labelParts = splitHwmonAttribute(labelHead))
                 {
-                    nameIndex = std::stoi(matches[1]);
+                    nameIndex = labelParts->getChannel();
 
                     // Decrement to preserve alignment, because hwmon
                     // human-readable filenames and labels use 1-based
@@ -733,12 +848,12 @@ static void createSensorsCallback(
                 }
             }
 
-            checkEventLimits(sensorPathStr, limitEventMatch, eventPathList);
+            checkEventLimits(sensorPathStr, eventPathList);
 
             // Similarly, if sensor scaling factor is being customized,
             // then the below power-of-10 constraint becomes unnecessary,
             // as config should be able to specify an arbitrary divisor.
-            unsigned int factor = psuProperty->sensorScaleFactor;
+            unsigned int factor = psuProperty.sensorScaleFactor;
             if (!customizedScale)
             {
                 // Preserve existing usage of hardcoded labelMatch table below
@@ -774,8 +889,9 @@ static void createSensorsCallback(
                           << sensorNameSubStr << "\n";
             }
 
-            auto findSensorUnit = sensorTable.find(sensorNameSubStr);
-            if (findSensorUnit == sensorTable.end())
+            const auto* findSensorUnit =
+                findEntry(sensorTable, sensorNameSubStr);
+            if (findSensorUnit == nullptr)
             {
                 std::cerr << sensorNameSubStr
                           << " is not a recognized sensor type\n";
@@ -785,13 +901,13 @@ static void createSensorsCallback(
             if constexpr (debug)
             {
                 std::cerr << "Sensor properties: Name \""
-                          << psuProperty->labelTypeName << "\" Scale "
-                          << psuProperty->sensorScaleFactor << " Min "
-                          << psuProperty->minReading << " Max "
-                          << psuProperty->maxReading << "\n";
+                          << psuProperty.labelTypeName << "\" Scale "
+                          << psuProperty.sensorScaleFactor << " Min "
+                          << psuProperty.minReading << " Max "
+                          << psuProperty.maxReading << "\n";
             }
 
-            std::string sensorName = psuProperty->labelTypeName;
+            std::string sensorName = psuProperty.labelTypeName;
             if (customizedName)
             {
                 if (sensorName.empty())
@@ -807,7 +923,7 @@ static void createSensorsCallback(
                 // Sensor name not customized, do prefix/suffix composition,
                 // preserving default behavior by using psuNameFromIndex.
                 sensorName =
-                    psuNameFromIndex + " " + psuProperty->labelTypeName;
+                    psuNameFromIndex + " " + psuProperty.labelTypeName;
             }
 
             if constexpr (debug)
@@ -816,14 +932,28 @@ static void createSensorsCallback(
                           << sensorPathStr << "\" type \"" << sensorType
                           << "\"\n";
             }
+            auto& sensor = sensors[sensorName];
+            if (inPlace && sensor != nullptr &&
+                sensor->reconfigure(sensorThresholds, psuProperty.maxReading,
+                                    psuProperty.minReading,
+                                    PowerState::always))
+            {
+                sensor->setPublishPolicy(getPublishPolicy(baseConfig->second));
+                continue;
+            }
             // destruct existing one first if already created
             sensors[sensorName] = nullptr;
             sensors[sensorName] = std::make_shared<PSUSensor>(
                 sensorPathStr, sensorType, objectServer, dbusConnection, io,
                 sensorName, std::move(sensorThresholds), *interfacePath,
-                findSensorUnit->second, factor, psuProperty->maxReading,
-                psuProperty->minReading, labelHead, thresholdConfSize);
-            sensors[sensorName]->setupRead();
+                findSensorUnit->value, factor, psuProperty.maxReading,
+                psuProperty.minReading, labelHead, thresholdConfSize);
+            sensors[sensorName]->setPublishPolicy(
+                getPublishPolicy(baseConfig->second));
+            if (!sensors[sensorName]->readSnapshot(snapshot))
+            {
+                sensors[sensorName]->setupRead();
+            }
             ++numCreated;
             if constexpr (debug)
             {
@@ -831,12 +961,27 @@ static void createSensorsCallback(
             }
         }
 
-        // OperationalStatus event
+        // OperationalStatus event, it only depends on the hwmon device
+        if (inPlace)
+        {
+            continue;
+        }
+        // reading all event attributes of the device in one batch saves a
+        // timer and an async read per attribute
+        bool batchEvents = false;
+        auto findBatched = baseConfig->second.find("BatchedEvents");
+        if (findBatched != baseConfig->second.end())
+        {
+            if (auto batched = std::get_if<bool>(&findBatched->second))
+            {
+                batchEvents = *batched;
+            }
+        }
         combineEvents[*psuName + "OperationalStatus"] = nullptr;
         combineEvents[*psuName + "OperationalStatus"] =
             std::make_unique<PSUCombineEvent>(
                 objectServer, dbusConnection, io, *psuName, eventPathList,
-                groupEventPathList, "OperationalStatus");
+                groupEventPathList, "OperationalStatus", batchEvents);
     }
 
     if constexpr (debug)
@@ -846,6 +991,57 @@ static void createSensorsCallback(
     return;
 }
 
+// Reads every PSU attribute that may become a sensor, along with the rated
+// limits, on the probe pool and creates the sensors from that snapshot once
+// it is complete. These reads are PMBus transactions, done one sensor after
+// the other on the io thread they delay the first readings at boot by
+// seconds on systems with many PSUs.
+static void probeAndCreateSensors(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    const ManagedObjectType& sensorConfigs)
+{
+    std::vector<std::vector<std::string>> probePaths;
+    for (const auto& [hwmonName, hwmonDevice] :
+         HwmonIndex::getInstance(io).getDevices())
+    {
+        if (findEntry(pmbusNames, hwmonDevice.name) == nullptr)
+        {
+            continue;
+        }
+        std::vector<fs::path> paths;
+        hwmonDevice.findFiles(probeMatch, paths);
+        std::vector<std::string>& devicePaths = probePaths.emplace_back();
+        for (const fs::path& path : paths)
+        {
+            devicePaths.emplace_back(path.string());
+        }
+    }
+
+    // one snapshot per device, so that the jobs don't share any state
+    auto snapshots =
+        std::make_shared<std::vector<SysfsSnapshot>>(probePaths.size());
+    std::vector<std::function<void()>> jobs;
+    for (size_t ii = 0; ii < probePaths.size(); ii++)
+    {
+        jobs.emplace_back(
+            [snapshots, ii, paths = std::move(probePaths[ii])]() {
+                ProbePool::readAll(paths, (*snapshots)[ii]);
+            });
+    }
+
+    probePool->run(std::move(jobs), [&io, &objectServer, &dbusConnection,
+                                     sensorConfigs, snapshots]() {
+        SysfsSnapshot snapshot;
+        for (const SysfsSnapshot& deviceSnapshot : *snapshots)
+        {
+            snapshot.insert(deviceSnapshot.begin(), deviceSnapshot.end());
+        }
+        createSensorsCallback(io, objectServer, dbusConnection, sensorConfigs,
+                              nullptr, snapshot);
+    });
+}
+
 void createSensors(
     boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
@@ -855,120 +1051,46 @@ void createSensors(
     auto getter = std::make_shared<GetSensorConfiguration>(
         dbusConnection, [&io, &objectServer, &dbusConnection, sensorsChanged](
                             const ManagedObjectType& sensorConfigs) {
+            // rescans only recreate a few sensors, those read their first
+            // value directly
+            if (sensorsChanged == nullptr)
+            {
+                probeAndCreateSensors(io, objectServer, dbusConnection,
+                                      sensorConfigs);
+                return;
+            }
             createSensorsCallback(io, objectServer, dbusConnection,
-                                  sensorConfigs, sensorsChanged);
+                                  sensorConfigs, sensorsChanged,
+                                  SysfsSnapshot());
         });
     getter->getConfiguration(
         std::vector<std::string>(sensorTypes.begin(), sensorTypes.end()));
 }
 
-void propertyInitialize(void)
+struct PsuDaemon : public SensorDaemon
 {
-    sensorTable = {{"power", sensor_paths::unitWatts},
-                   {"curr", sensor_paths::unitAmperes},
-                   {"temp", sensor_paths::unitDegreesC},
-                   {"in", sensor_paths::unitVolts},
-                   {"fan", sensor_paths::unitRPMs}};
-
-    labelMatch = {{"pin", PSUProperty("Input Power", 3000, 0, 6)},
-                  {"pout1", PSUProperty("Output Power", 3000, 0, 6)},
-                  {"pout2", PSUProperty("Output Power", 3000, 0, 6)},
-                  {"pout3", PSUProperty("Output Power", 3000, 0, 6)},
-                  {"power1", PSUProperty("Output Power", 3000, 0, 6)},
-                  {"maxpin", PSUProperty("Max Input Power", 3000, 0, 6)},
-                  {"vin", PSUProperty("Input Voltage", 300, 0, 3)},
-                  {"maxvin", PSUProperty("Max Input Voltage", 300, 0, 3)},
-                  {"vout1", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout2", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout3", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout4", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout5", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout6", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout7", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout8", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout9", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout10", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout11", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout12", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout13", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout14", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout15", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout16", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout17", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout18", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout19", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout20", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout21", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout22", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout23", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout24", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout25", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout26", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout27", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout28", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout29", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout30", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout31", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vout32", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"vmon", PSUProperty("Auxiliary Input Voltage", 255, 0, 3)},
-                  {"in1", PSUProperty("Output Voltage", 255, 0, 3)},
-                  {"iin", PSUProperty("Input Current", 20, 0, 3)},
-                  {"iout1", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout2", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout3", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout4", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout5", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout6", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout7", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout8", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout9", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout10", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout11", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout12", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout13", PSUProperty("Output Current", 255, 0, 3)},
-                  {"iout14", PSUProperty("Output Current", 255, 0, 3)},
-                  {"curr1", PSUProperty("Output Current", 255, 0, 3)},
-                  {"maxiout1", PSUProperty("Max Output Current", 255, 0, 3)},
-                  {"temp1", PSUProperty("Temperature", 127, -128, 3)},
-                  {"temp2", PSUProperty("Temperature", 127, -128, 3)},
-                  {"temp3", PSUProperty("Temperature", 127, -128, 3)},
-                  {"temp4", PSUProperty("Temperature", 127, -128, 3)},
-                  {"temp5", PSUProperty("Temperature", 127, -128, 3)},
-                  {"temp6", PSUProperty("Temperature", 127, -128, 3)},
-                  {"maxtemp1", PSUProperty("Max Temperature", 127, -128, 3)},
-                  {"fan1", PSUProperty("Fan Speed 1", 30000, 0, 0)},
-                  {"fan2", PSUProperty("Fan Speed 2", 30000, 0, 0)}};
-
-    pwmTable = {{"fan1", "Fan_1"}, {"fan2", "Fan_2"}};
-
-    limitEventMatch = {{"PredictiveFailure", {"max_alarm", "min_alarm"}},
-                       {"Failure", {"crit_alarm", "lcrit_alarm"}}};
-
-    eventMatch = {{"PredictiveFailure", {"power1_alarm"}},
-                  {"Failure", {"in2_alarm"}},
-                  {"ACLost", {"in1_beep"}},
-                  {"ConfigureError", {"in1_fault"}}};
-
-    groupEventMatch = {{"FanFault",
-                        {{"fan1", {"fan1_alarm", "fan1_fault"}},
-                         {"fan2", {"fan2_alarm", "fan2_fault"}}}}};
-}
-
-int main()
-{
-    boost::asio::io_service io;
-    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    explicit PsuDaemon(boost::asio::io_service& io) : filterTimer(io)
+    {}
 
-    systemBus->request_name("xyz.openbmc_project.PSUSensor");
-    sdbusplus::asio::object_server objectServer(systemBus);
-    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
-    auto sensorsChanged =
+    std::shared_ptr<boost::container::flat_set<std::string>> sensorsChanged =
         std::make_shared<boost::container::flat_set<std::string>>();
+    boost::asio::deadline_timer filterTimer;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
 
-    propertyInitialize();
+std::unique_ptr<SensorDaemon>
+    setupPsuSensors(boost::asio::io_service& io,
+                    sdbusplus::asio::object_server& objectServer,
+                    std::shared_ptr<sdbusplus::asio::connection>& systemBus)
+{
+    auto daemon = std::make_unique<PsuDaemon>(io);
+    PsuDaemon& state = *daemon;
+
+    std::unique_ptr<ProbePool>& pool = IoSingleton<ProbePool>::get(io);
+    pool = std::make_unique<ProbePool>(io, probeWorkers);
+    probePool = pool.get();
 
     io.post([&]() { createSensors(io, objectServer, systemBus, nullptr); });
-    boost::asio::deadline_timer filterTimer(io);
     std::function<void(sdbusplus::message::message&)> eventHandler =
         [&](sdbusplus::message::message& message) {
             if (message.is_method_error())
@@ -976,19 +1098,21 @@ int main()
                 std::cerr << "callback method error\n";
                 return;
             }
-            sensorsChanged->insert(message.get_path());
-            filterTimer.expires_from_now(boost::posix_time::seconds(3));
-            filterTimer.async_wait([&](const boost::system::error_code& ec) {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    return;
-                }
-                if (ec)
-                {
-                    std::cerr << "timer error\n";
-                }
-                createSensors(io, objectServer, systemBus, sensorsChanged);
-            });
+            state.sensorsChanged->insert(message.get_path());
+            state.filterTimer.expires_from_now(boost::posix_time::seconds(3));
+            state.filterTimer.async_wait(
+                [&](const boost::system::error_code& ec) {
+                    if (ec == boost::asio::error::operation_aborted)
+                    {
+                        return;
+                    }
+                    if (ec)
+                    {
+                        std::cerr << "timer error\n";
+                    }
+                    createSensors(io, objectServer, systemBus,
+                                  state.sensorsChanged);
+                });
         };
 
     for (const char* type : sensorTypes)
@@ -998,7 +1122,20 @@ int main()
             "type='signal',member='PropertiesChanged',path_namespace='" +
                 std::string(inventoryPath) + "',arg0namespace='" + type + "'",
             eventHandler);
-        matches.emplace_back(std::move(match));
+        state.matches.emplace_back(std::move(match));
     }
+    return daemon;
+}
+
+#ifndef COMBINED_SENSOR_DAEMON
+int main()
+{
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    systemBus->request_name("xyz.openbmc_project.PSUSensor");
+    sdbusplus::asio::object_server objectServer(systemBus);
+    std::unique_ptr<SensorDaemon> daemon =
+        setupPsuSensors(io, objectServer, systemBus);
     io.run();
 }
+#endif
@@ -0,0 +1,118 @@
+#include <IoSingleton.hpp>
+#include <PollScheduler.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+PollScheduler& PollScheduler::getInstance(boost::asio::io_service& io)
+{
+    std::unique_ptr<PollScheduler>& scheduler =
+        IoSingleton<PollScheduler>::get(io);
+    if (!scheduler)
+    {
+        scheduler = std::make_unique<PollScheduler>(io);
+    }
+    return *scheduler;
+}
+
+void PollScheduler::add(unsigned int intervalMs,
+                        const std::shared_ptr<PollEntry>& entry)
+{
+    auto& bucket = buckets[intervalMs];
+    if (!bucket)
+    {
+        bucket = std::make_unique<Bucket>(io, intervalMs);
+        bucket->timer.expires_after(bucket->interval);
+        arm(intervalMs, *bucket);
+    }
+    bucket->entries.emplace_back(entry);
+    entry->active = true;
+}
+
+void PollScheduler::remove(unsigned int intervalMs,
+                           const std::shared_ptr<PollEntry>& entry)
+{
+    entry->active = false;
+
+    auto findBucket = buckets.find(intervalMs);
+    if (findBucket == buckets.end())
+    {
+        return;
+    }
+    Bucket& bucket = *findBucket->second;
+    auto& entries = bucket.entries;
+    entries.erase(std::remove(entries.begin(), entries.end(), entry),
+                  entries.end());
+
+    // a bucket emptied from one of its own callbacks is dropped once the
+    // tick is over, see tick()
+    if (entries.empty() && !bucket.inTick)
+    {
+        buckets.erase(findBucket);
+    }
+}
+
+void PollScheduler::arm(unsigned int intervalMs, Bucket& bucket)
+{
+    bucket.timer.async_wait(
+        [this, intervalMs](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return; // bucket is gone
+            }
+            if (ec)
+            {
+                std::cerr << "poll timer error " << ec.message() << "\n";
+            }
+            tick(intervalMs);
+        });
+}
+
+void PollScheduler::tick(unsigned int intervalMs)
+{
+    auto findBucket = buckets.find(intervalMs);
+    if (findBucket == buckets.end())
+    {
+        return;
+    }
+    Bucket& bucket = *findBucket->second;
+
+    // pollers may add or drop registrations from within their callback, so
+    // walk a snapshot and skip whatever got deactivated in the meantime
+    bucket.inTick = true;
+    bucket.firing.assign(bucket.entries.begin(), bucket.entries.end());
+    for (const auto& entry : bucket.firing)
+    {
+        if (entry->active)
+        {
+            entry->callback();
+        }
+    }
+    bucket.firing.clear();
+    bucket.inTick = false;
+
+    // lookup again, callbacks may have modified the bucket map
+    findBucket = buckets.find(intervalMs);
+    if (findBucket == buckets.end())
+    {
+        return;
+    }
+    Bucket& current = *findBucket->second;
+    if (current.entries.empty())
+    {
+        buckets.erase(findBucket);
+        return;
+    }
+
+    // keep a fixed cadence rather than drifting by the time spent in the
+    // callbacks, unless we fell behind by more than a whole interval
+    auto now = std::chrono::steady_clock::now();
+    auto next = current.timer.expiry() + current.interval;
+    if (next <= now)
+    {
+        next = now + current.interval;
+    }
+    current.timer.expires_at(next);
+    arm(intervalMs, current);
+}
@@ -0,0 +1,133 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <ProbePool.hpp>
+#include <Utils.hpp>
+#include <boost/asio/read.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+ProbePool::ProbePool(boost::asio::io_service& io, size_t maxWorkers) :
+    notifier(io), maxWorkers(std::max<size_t>(maxWorkers, 1))
+{
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0)
+    {
+        std::cerr << "Unable to create eventfd, probing on the io thread\n";
+        return;
+    }
+    notifier.assign(fd);
+}
+
+ProbePool::~ProbePool()
+{
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ProbePool::readAll(const std::vector<std::string>& paths,
+                        SysfsSnapshot& snapshot)
+{
+    for (const std::string& path : paths)
+    {
+        int64_t reading = 0;
+        if (SysfsFile(path).readInteger(reading))
+        {
+            snapshot[path] = reading;
+        }
+    }
+}
+
+void ProbePool::run(std::vector<std::function<void()>>&& jobs,
+                    std::function<void()>&& done)
+{
+    if (!notifier.is_open())
+    {
+        for (auto& job : jobs)
+        {
+            job();
+        }
+        done();
+        return;
+    }
+    batches.push_back(Batch{std::make_shared<const Jobs>(std::move(jobs)),
+                            std::move(done)});
+    if (batches.size() == 1)
+    {
+        start();
+    }
+}
+
+void ProbePool::start(void)
+{
+    std::shared_ptr<const Jobs> jobs = batches.front().jobs;
+    size_t numWorkers = std::min(maxWorkers, jobs->size());
+    if (numWorkers == 0)
+    {
+        finish();
+        return;
+    }
+
+    nextJob = 0;
+    runningWorkers = numWorkers;
+    for (size_t ii = 0; ii < numWorkers; ii++)
+    {
+        workers.emplace_back([this, jobs]() { work(*jobs); });
+    }
+    waitForWorkers();
+}
+
+void ProbePool::work(const Jobs& jobs)
+{
+    for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+    {
+        jobs[job]();
+    }
+    if (--runningWorkers == 0)
+    {
+        uint64_t one = 1;
+        if (write(notifier.native_handle(), &one, sizeof(one)) < 0)
+        {
+            std::cerr << "Failed to signal probe completion\n";
+        }
+    }
+}
+
+void ProbePool::waitForWorkers(void)
+{
+    boost::asio::async_read(
+        notifier, boost::asio::buffer(&notifierValue, sizeof(notifierValue)),
+        [this](const boost::system::error_code& ec, std::size_t) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+            if (ec)
+            {
+                std::cerr << "probe notifier error " << ec.message() << "\n";
+            }
+            finish();
+        });
+}
+
+void ProbePool::finish(void)
+{
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    // done may queue another batch, keep ours at the front until it returned
+    std::function<void()> done = std::move(batches.front().done);
+    done();
+    batches.pop_front();
+    if (!batches.empty())
+    {
+        start();
+    }
+}
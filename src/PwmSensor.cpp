@@ -13,11 +13,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 */
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <PwmSensor.hpp>
 #include <Utils.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
-#include <fstream>
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -26,14 +31,18 @@ static constexpr double sysPwmMax = 255.0;
 static constexpr double psuPwmMax = 100.0;
 static constexpr double defaultPwm = 30.0;
 static constexpr double targetIfaceMax = sysPwmMax;
+// one write per fan per tick of the fan controller at the most, later
+// requests within a tick only change what is written at its end
+static constexpr std::chrono::milliseconds pwmWriteInterval{100};
 
 PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
                      std::shared_ptr<sdbusplus::asio::connection>& conn,
+                     boost::asio::io_service& io,
                      sdbusplus::asio::object_server& objectServer,
                      const std::string& sensorConfiguration,
                      const std::string& sensorType) :
     sysPath(sysPath),
-    objectServer(objectServer), name(name)
+    objectServer(objectServer), name(name), writeTimer(io)
 {
     // add interface under sensor and Control.FanPwm as Control is used
     // in obmc project, also add sensor so it can be viewed as a sensor
@@ -165,35 +174,135 @@ PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
 }
 PwmSensor::~PwmSensor()
 {
+    writeTimer.cancel();
+    closeFile();
     objectServer.remove_interface(sensorInterface);
     objectServer.remove_interface(controlInterface);
     objectServer.remove_interface(association);
 }
 
+bool PwmSensor::openFile(void)
+{
+    if (fd < 0)
+    {
+        fd = open(sysPath.c_str(), O_RDWR | O_CLOEXEC);
+    }
+    return fd >= 0;
+}
+
+void PwmSensor::closeFile(void)
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
 void PwmSensor::setValue(uint32_t value)
 {
-    std::ofstream ref(sysPath);
-    if (!ref.good())
+    pending = value;
+    if (writeWaiting)
     {
+        return; // goes out with the write already waiting
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto next = lastWrite + pwmWriteInterval;
+    if (now >= next)
+    {
+        flush();
+        return;
+    }
+    writeTimer.expires_from_now(boost::posix_time::milliseconds(
+        std::chrono::duration_cast<std::chrono::milliseconds>(next - now)
+            .count()));
+    writeWaiting = true;
+    writeTimer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec)
+        {
+            return; // we're being destroyed
+        }
+        writeWaiting = false;
+        try
+        {
+            flush();
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << name << ": " << e.what() << "\n";
+        }
+    });
+}
+
+void PwmSensor::flush(void)
+{
+    if (!pending)
+    {
+        return;
+    }
+    uint32_t value = *pending;
+    pending = std::nullopt;
+    if (written == value)
+    {
+        return;
+    }
+    writeValue(value);
+}
+
+void PwmSensor::writeValue(uint32_t value)
+{
+    if (!openFile())
+    {
+        written = std::nullopt;
         throw std::runtime_error("Bad Write File");
     }
-    ref << value;
+    std::string text = std::to_string(value);
+    ssize_t rc = 0;
+    do
+    {
+        rc = pwrite(fd, text.data(), text.size(), 0);
+    } while (rc < 0 && errno == EINTR);
+    if (rc != static_cast<ssize_t>(text.size()))
+    {
+        // write it again next time, whatever the file holds now, and open
+        // the file again in case the device went away and came back
+        written = std::nullopt;
+        closeFile();
+        throw std::runtime_error("Bad Write File");
+    }
+    written = value;
+    lastWrite = std::chrono::steady_clock::now();
 }
 
 // on success returns pwm, on failure throws except on initialization, where it
 // prints an error and returns 0
 uint32_t PwmSensor::getValue(bool errThrow)
 {
-    std::ifstream ref(sysPath);
-    if (!ref.good())
+    if (pending)
+    {
+        return *pending; // the file is about to hold it
+    }
+    if (!openFile())
     {
+        written = std::nullopt;
         return -1;
     }
-    std::string line;
-    if (!std::getline(ref, line))
+    std::array<char, 32> buffer{};
+    ssize_t rc = 0;
+    do
+    {
+        rc = pread(fd, buffer.data(), buffer.size() - 1, 0);
+    } while (rc < 0 && errno == EINTR);
+    if (rc <= 0)
     {
+        // the kernel may have reset the pwm along with the device, the
+        // next request rewrites it even if it asks for the same duty
+        written = std::nullopt;
+        closeFile();
         return -1;
     }
+    std::string line(buffer.data(), static_cast<size_t>(rc));
     try
     {
         uint32_t value = std::stoi(line);
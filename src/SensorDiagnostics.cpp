@@ -0,0 +1,97 @@
+#include <SensorDiagnostics.hpp>
+#include <sensor.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+void SensorDiagnostics::add(
+    Sensor* sensor, const std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    sensors.insert(sensor);
+    if (interface)
+    {
+        return;
+    }
+
+    const char* env = std::getenv("SENSOR_DIAGNOSTICS");
+    active = env != nullptr && std::strcmp(env, "1") == 0;
+
+    interface = std::make_shared<sdbusplus::asio::dbus_interface>(
+        conn, diagnosticsPath, diagnosticsInterface);
+    interface->register_property(
+        "Enabled", active, [](const bool& request, bool& oldValue) {
+            oldValue = request;
+            setEnabled(request);
+            return 1;
+        });
+    interface->register_property(
+        "ReadLatencyBoundsUs",
+        std::vector<uint64_t>(SensorCounters::latencyBoundsUs.begin(),
+                              SensorCounters::latencyBoundsUs.end()));
+    interface->register_method("GetCounters", []() { return collect(); });
+    interface->register_method("Reset", []() { reset(); });
+    if (!interface->initialize())
+    {
+        std::cerr << "error initializing diagnostics interface\n";
+    }
+}
+
+void SensorDiagnostics::remove(Sensor* sensor)
+{
+    sensors.erase(sensor);
+}
+
+void SensorDiagnostics::setEnabled(bool enable)
+{
+    active = enable;
+    if (!enable)
+    {
+        // in flight reads would otherwise count the time spent disabled
+        for (Sensor* sensor : sensors)
+        {
+            if (sensor->counters)
+            {
+                sensor->counters->reading = false;
+            }
+        }
+    }
+}
+
+boost::container::flat_map<std::string, SensorDiagnostics::SensorCounterMap>
+    SensorDiagnostics::collect(void)
+{
+    boost::container::flat_map<std::string, SensorCounterMap> result;
+    for (const Sensor* sensor : sensors)
+    {
+        if (!sensor->counters || !sensor->sensorInterface)
+        {
+            continue;
+        }
+        const SensorCounters& counters = *sensor->counters;
+        SensorCounterMap& entry =
+            result[sensor->sensorInterface->get_object_path()];
+        entry["Samples"] = counters.samples;
+        entry["Errors"] = counters.errors;
+        entry["ErrorStreak"] = counters.errorStreak;
+        entry["MaxErrorStreak"] = counters.maxErrorStreak;
+        entry["Publishes"] = counters.publishes;
+        entry["ReadLatencyHistogram"] = std::vector<uint64_t>(
+            counters.readLatency.begin(), counters.readLatency.end());
+        entry["MaxReadLatencyUs"] = counters.maxReadLatencyUs;
+        entry["TotalPollJitterUs"] = counters.totalPollJitterUs;
+        entry["MaxPollJitterUs"] = counters.maxPollJitterUs;
+        entry["ThresholdChecks"] = counters.thresholdChecks;
+        entry["TotalThresholdTimeNs"] = counters.totalThresholdTimeNs;
+        entry["MaxThresholdTimeNs"] = counters.maxThresholdTimeNs;
+    }
+    return result;
+}
+
+void SensorDiagnostics::reset(void)
+{
+    for (Sensor* sensor : sensors)
+    {
+        sensor->counters = nullptr;
+    }
+}
@@ -0,0 +1,95 @@
+#include <SensorHistory.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// the code stored for a nan reading
+static constexpr int16_t nanCode = std::numeric_limits<int16_t>::min();
+static constexpr double codeRange = 65534;
+static constexpr std::chrono::milliseconds tick(100);
+
+SensorHistory::SensorHistory(size_t capacity, double minValue,
+                             double maxValue, Clock::time_point now) :
+    base(minValue),
+    step(maxValue > minValue ? (maxValue - minValue) / codeRange : 1.0),
+    start(now), values(capacity, nanCode), times(capacity, 0)
+{}
+
+int16_t SensorHistory::encode(double value) const
+{
+    if (std::isnan(value))
+    {
+        return nanCode;
+    }
+    double code = std::round((value - base) / step) - codeRange / 2;
+    return static_cast<int16_t>(
+        std::clamp(code, -codeRange / 2, codeRange / 2));
+}
+
+double SensorHistory::decode(int16_t code) const
+{
+    if (code == nanCode)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return base + (static_cast<double>(code) + codeRange / 2) * step;
+}
+
+uint32_t SensorHistory::ticks(Clock::time_point time) const
+{
+    return static_cast<uint32_t>((time - start) / tick);
+}
+
+void SensorHistory::add(double value, Clock::time_point now)
+{
+    if (values.empty())
+    {
+        return;
+    }
+    values[next] = encode(value);
+    times[next] = ticks(now);
+    next = (next + 1) % values.size();
+    used = std::min(used + 1, values.size());
+}
+
+SensorHistory::Aggregate
+    SensorHistory::aggregate(std::chrono::milliseconds window,
+                             Clock::time_point now) const
+{
+    Aggregate result{std::numeric_limits<double>::quiet_NaN(),
+                     std::numeric_limits<double>::quiet_NaN(),
+                     std::numeric_limits<double>::quiet_NaN(), 0};
+    uint32_t newest = ticks(now);
+    uint32_t span = static_cast<uint32_t>(window / tick);
+    double sum = 0;
+    // newest first, stop at the first sample older than the window
+    for (size_t count = 0; count < used; count++)
+    {
+        size_t index = (next + values.size() - 1 - count) % values.size();
+        if (newest - times[index] > span)
+        {
+            break;
+        }
+        if (values[index] == nanCode)
+        {
+            continue;
+        }
+        double value = decode(values[index]);
+        if (result.samples == 0)
+        {
+            result.min = value;
+            result.max = value;
+        }
+        result.min = std::min(result.min, value);
+        result.max = std::max(result.max, value);
+        sum += value;
+        result.samples++;
+    }
+    if (result.samples > 0)
+    {
+        result.average = sum / result.samples;
+    }
+    return result;
+}
@@ -1,7 +1,6 @@
 #include <SensorPaths.hpp>
 
 #include <cstring>
-#include <regex>
 #include <string>
 
 namespace sensor_paths
@@ -50,7 +49,25 @@ std::string getPathForUnits(const std::string& units)
 
 std::string escapePathForDbus(const std::string& name)
 {
-    return std::regex_replace(name, std::regex("[^a-zA-Z0-9_/]+"), "_");
+    // each run of characters outside [a-zA-Z0-9_/] becomes a single '_'
+    std::string escaped;
+    escaped.reserve(name.size());
+    bool inRun = false;
+    for (char c : name)
+    {
+        bool legal = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                     (c >= '0' && c <= '9') || c == '_' || c == '/';
+        if (legal)
+        {
+            escaped += c;
+        }
+        else if (!inRun)
+        {
+            escaped += '_';
+        }
+        inRun = !legal;
+    }
+    return escaped;
 }
 
 } // namespace sensor_paths
@@ -0,0 +1,168 @@
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <I2CArbiter.hpp>
+#include <IoSingleton.hpp>
+#include <SmbusExecutor.hpp>
+
+#include <cerrno>
+#include <iostream>
+#include <string>
+#include <utility>
+
+extern "C"
+{
+#include <i2c/smbus.h>
+#include <linux/i2c-dev.h>
+}
+
+SmbusExecutor::SmbusExecutor(boost::asio::io_service& io) :
+    io(io), completions(io, "SMBus", [](Request& request) {
+        request.callback(request.result);
+    })
+{
+    if (!completions.isOpen())
+    {
+        std::cerr << "Unable to create eventfd, SMBus transactions are run "
+                     "on the io thread\n";
+    }
+}
+
+SmbusExecutor::~SmbusExecutor()
+{
+    for (auto& [busId, bus] : buses)
+    {
+        {
+            std::lock_guard<std::mutex> guard(bus->lock);
+            bus->stopping = true;
+        }
+        bus->wake.notify_one();
+        if (bus->worker.joinable())
+        {
+            bus->worker.join();
+        }
+        if (bus->fd >= 0)
+        {
+            close(bus->fd);
+        }
+    }
+}
+
+SmbusExecutor& SmbusExecutor::getInstance(boost::asio::io_service& io)
+{
+    std::unique_ptr<SmbusExecutor>& executor =
+        IoSingleton<SmbusExecutor>::get(io);
+    if (!executor)
+    {
+        executor = std::make_unique<SmbusExecutor>(io);
+    }
+    return *executor;
+}
+
+void SmbusExecutor::submit(int busId, uint8_t address, SmbusOp op,
+                           uint8_t reg, Callback&& callback)
+{
+    auto& bus = buses[busId];
+    if (!bus)
+    {
+        bus = std::make_unique<Bus>(busId);
+        if (completions.isOpen())
+        {
+            bus->worker = std::thread([this, busPtr = bus.get()]() {
+                work(*busPtr);
+            });
+        }
+    }
+
+    Request request{address, op, reg, std::move(callback)};
+    if (!bus->worker.joinable())
+    {
+        // still deliver the result asynchronously, callers may rely on not
+        // being called back from within submit()
+        request.result = transfer(*bus, request);
+        io.post([request = std::move(request)]() {
+            request.callback(request.result);
+        });
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(bus->lock);
+        bus->queue.emplace_back(std::move(request));
+    }
+    bus->wake.notify_one();
+}
+
+int32_t SmbusExecutor::transfer(Bus& bus, const Request& request)
+{
+    if (bus.fd < 0)
+    {
+        std::string path = "/dev/i2c-" + std::to_string(bus.busId);
+        bus.fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (bus.fd < 0)
+        {
+            return -errno;
+        }
+        if (ioctl(bus.fd, I2C_FUNCS, &bus.funcs) < 0)
+        {
+            int error = errno;
+            close(bus.fd);
+            bus.fd = -1;
+            return -error;
+        }
+        bus.address = -1;
+    }
+    if (bus.address != request.address)
+    {
+        if (ioctl(bus.fd, I2C_SLAVE_FORCE, request.address) < 0)
+        {
+            return -errno;
+        }
+        bus.address = request.address;
+    }
+
+    unsigned long needed = request.op == SmbusOp::readByteData
+                               ? I2C_FUNC_SMBUS_READ_BYTE_DATA
+                               : I2C_FUNC_SMBUS_READ_WORD_DATA;
+    if (!(bus.funcs & needed))
+    {
+        return -EOPNOTSUPP;
+    }
+    int fd = bus.fd;
+    int32_t result = I2CArbiter::getInstance().transact(
+        bus.busId, [fd, &request]() {
+            if (request.op == SmbusOp::readByteData)
+            {
+                return i2c_smbus_read_byte_data(fd, request.reg);
+            }
+            return i2c_smbus_read_word_data(fd, request.reg);
+        });
+    if (result == -ENODEV)
+    {
+        // the adapter is gone, open it again on the next transaction
+        close(bus.fd);
+        bus.fd = -1;
+    }
+    return result;
+}
+
+void SmbusExecutor::work(Bus& bus)
+{
+    std::unique_lock<std::mutex> lock(bus.lock);
+    while (true)
+    {
+        bus.wake.wait(lock,
+                      [&bus]() { return bus.stopping || !bus.queue.empty(); });
+        if (bus.stopping)
+        {
+            return;
+        }
+        Request request = std::move(bus.queue.front());
+        bus.queue.pop_front();
+        lock.unlock();
+
+        request.result = transfer(bus, request);
+        completions.push(std::move(request));
+        lock.lock();
+    }
+}
@@ -0,0 +1,87 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <SysfsNotifier.hpp>
+
+#include <array>
+#include <cerrno>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Reading the attribute again is what acknowledges a notification, until then
+// kernfs keeps reporting it.
+static void acknowledge(int fd)
+{
+    std::array<char, 64> buffer{};
+    ssize_t rc = 0;
+    do
+    {
+        rc = pread(fd, buffer.data(), buffer.size(), 0);
+    } while (rc < 0 && errno == EINTR);
+}
+
+SysfsNotifier::~SysfsNotifier()
+{
+    for (const auto& watch : watches)
+    {
+        boost::system::error_code ec;
+        watch->fd.close(ec);
+    }
+}
+
+bool SysfsNotifier::watch(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    acknowledge(fd);
+
+    auto entry = std::make_shared<Watch>(io, path, *this);
+    boost::system::error_code ec;
+    entry->fd.assign(fd, ec);
+    if (ec)
+    {
+        std::cerr << "Can't wait for notifications of " << path << ": "
+                  << ec.message() << "\n";
+        close(fd);
+        return false;
+    }
+    watches.emplace_back(entry);
+    wait(entry);
+    return true;
+}
+
+void SysfsNotifier::wait(const std::shared_ptr<Watch>& watch)
+{
+    // POLLPRI is what asio waits for as the error condition
+    watch->fd.async_wait(
+        boost::asio::posix::stream_descriptor::wait_error,
+        [weak = std::weak_ptr<Watch>(watch)](
+            const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return; // notifier is gone
+            }
+            std::shared_ptr<Watch> watch = weak.lock();
+            if (!watch || !watch->fd.is_open())
+            {
+                return;
+            }
+            if (ec)
+            {
+                std::cerr << "Error waiting for " << watch->path << ": "
+                          << ec.message() << "\n";
+                return;
+            }
+            acknowledge(watch->fd.native_handle());
+            watch->owner.callback(watch->path);
+            // the callback may have destroyed the notifier
+            if (watch->fd.is_open())
+            {
+                wait(watch);
+            }
+        });
+}
@@ -0,0 +1,111 @@
+#include <IoSingleton.hpp>
+#include <SysfsReadPool.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+// more threads than this only add contention on the bus locks
+static constexpr size_t maxReadThreads = 16;
+
+SysfsReadPool::SysfsReadPool(boost::asio::io_service& io, size_t threads) :
+    completions(io, "sysfs read", [](Request& request) {
+        request.callback(request.value, request.error);
+    })
+{
+    if (!completions.isOpen())
+    {
+        std::cerr << "Unable to create eventfd, sensors are read on the io "
+                     "thread\n";
+        return;
+    }
+    for (size_t ii = 0; ii < threads; ii++)
+    {
+        workers.emplace_back([this]() { work(); });
+    }
+}
+
+SysfsReadPool::~SysfsReadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// 0 unless SENSOR_READ_THREADS is set to a number of threads
+static size_t readThreads(void)
+{
+    const char* env = std::getenv("SENSOR_READ_THREADS");
+    if (env == nullptr)
+    {
+        return 0;
+    }
+    char* end = nullptr;
+    unsigned long threads = std::strtoul(env, &end, 10);
+    if (*end != '\0')
+    {
+        return 0;
+    }
+    return std::min<size_t>(threads, maxReadThreads);
+}
+
+SysfsReadPool* SysfsReadPool::getInstance(boost::asio::io_service& io)
+{
+    static const size_t threads = readThreads();
+    if (threads == 0)
+    {
+        return nullptr;
+    }
+    std::unique_ptr<SysfsReadPool>& pool = IoSingleton<SysfsReadPool>::get(io);
+    if (!pool)
+    {
+        pool = std::make_unique<SysfsReadPool>(io, threads);
+    }
+    // without the eventfd there is no way back to the io thread
+    if (!pool->completions.isOpen())
+    {
+        return nullptr;
+    }
+    return pool.get();
+}
+
+void SysfsReadPool::read(const std::shared_ptr<const SysfsFile>& file,
+                         Callback&& callback)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.push_back(Request{file, std::move(callback)});
+    }
+    wake.notify_one();
+}
+
+void SysfsReadPool::work(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [this]() { return stopping || !queue.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+        Request request = std::move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+
+        if (!request.file->readInteger(request.value))
+        {
+            request.error = errno;
+        }
+        completions.push(std::move(request));
+        guard.lock();
+    }
+}
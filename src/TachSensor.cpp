@@ -20,25 +20,32 @@
 #include <Utils.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/asio/read_until.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <gpiod.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
 #include <fstream>
 #include <iostream>
-#include <istream>
 #include <limits>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 static constexpr unsigned int pwmPollMs = 500;
 static constexpr size_t warnAfterErrorCount = 10;
+// in the event driven mode the interval doubles after every few readings in a
+// row without a change, up to steadyPollMs
+static constexpr unsigned int steadyReadsPerStep = 4;
+static constexpr unsigned int steadyPollMs = 8000;
 
 TachSensor::TachSensor(const std::string& path, const std::string& objectType,
                        sdbusplus::asio::object_server& objectServer,
@@ -50,15 +57,27 @@ TachSensor::TachSensor(const std::string& path, const std::string& objectType,
                        const std::string& sensorConfiguration,
                        const std::pair<size_t, size_t>& limits,
                        const PowerState& powerState,
-                       const std::optional<std::string>& ledIn) :
+                       const std::optional<std::string>& ledIn,
+                       bool eventDriven) :
     Sensor(boost::replace_all_copy(fanName, " ", "_"), std::move(thresholdsIn),
            sensorConfiguration, objectType, limits.second, limits.first, conn,
            powerState),
     objServer(objectServer), redundancy(redundancy),
     presence(std::move(presenceSensor)),
-    inputDev(io, open(path.c_str(), O_RDONLY)), waitTimer(io), path(path),
-    led(ledIn)
+    inputFile(path), path(path), led(ledIn), ledTimer(io),
+    pollHandle(io, pwmPollMs, [this]() { setupRead(); })
 {
+    setPoller(pollHandle, pwmPollMs);
+    if (presence)
+    {
+        // a fan put back in is read right away rather than at the backed
+        // off rate
+        presence->setChangedHook([this]() { resetBackoff(); });
+    }
+    if (eventDriven)
+    {
+        watchAttributes(io);
+    }
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/fan_tach/" + name,
         "xyz.openbmc_project.Sensor.Value");
@@ -103,9 +122,9 @@ TachSensor::TachSensor(const std::string& path, const std::string& objectType,
 
 TachSensor::~TachSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
-    waitTimer.cancel();
+    notifier = nullptr;
+    ledTimer.cancel();
+    pollHandle.reset();
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -116,71 +135,103 @@ TachSensor::~TachSensor()
 
 void TachSensor::setupRead(void)
 {
-    boost::asio::async_read_until(
-        inputDev, readBuf, '\n',
-        [&](const boost::system::error_code& ec,
-            std::size_t /*bytes_transfered*/) { handleResponse(ec); });
-}
-
-void TachSensor::handleResponse(const boost::system::error_code& err)
-{
-    if (err == boost::system::errc::bad_file_descriptor)
-    {
-        return; // we're being destroyed
-    }
     bool missing = false;
-    size_t pollTime = pwmPollMs;
     if (presence)
     {
         if (!presence->getValue())
         {
             markAvailable(false);
             missing = true;
-            pollTime = sensorFailedPollTimeMs;
+            backOff();
         }
         itemIface->set_property("Present", !missing);
     }
-    std::istream responseStream(&readBuf);
     if (!missing)
     {
-        if (!err)
+        readStarted();
+        int64_t reading = 0;
+        if (inputFile.readInteger(reading))
         {
-            std::string response;
-            try
-            {
-                std::getline(responseStream, response);
-                rawValue = std::stod(response);
-                responseStream.clear();
-                updateValue(rawValue);
-            }
-            catch (const std::invalid_argument&)
+            if (notifier)
             {
-                incrementError();
-                pollTime = sensorFailedPollTimeMs;
+                updateSteadyRate(static_cast<double>(reading));
             }
+            rawValue = static_cast<double>(reading);
+            updateValue(rawValue);
         }
         else
         {
+            if (errno == ENODEV)
+            {
+                pollHandle.reset();
+                return; // we're no longer valid
+            }
             incrementError();
-            pollTime = sensorFailedPollTimeMs;
         }
     }
-    responseStream.clear();
-    inputDev.close();
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
-    {
-        return; // we're no longer valid
-    }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(pollTime));
-    waitTimer.async_wait([&](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
+}
+
+void TachSensor::watchAttributes(boost::asio::io_service& io)
+{
+    notifier = std::make_unique<SysfsNotifier>(io, [this](const std::string&) {
+        if (readsPaused)
         {
-            return; // we're being canceled
+            return;
         }
+        // something happened to the fan, read it now and keep reading it at
+        // the full rate until it settles again
+        steadyReads = 0;
+        setPoller(pollHandle, pwmPollMs);
+        resetBackoff();
         setupRead();
     });
+
+    notifier->watch(path);
+    constexpr std::string_view inputSuffix = "_input";
+    if (boost::ends_with(path, inputSuffix))
+    {
+        std::string base = path.substr(0, path.size() - inputSuffix.size());
+        constexpr std::array<const char*, 4> alarms = {
+            "_alarm", "_fault", "_min_alarm", "_max_alarm"};
+        for (const char* alarm : alarms)
+        {
+            notifier->watch(base + alarm);
+        }
+    }
+    if (notifier->size() == 0)
+    {
+        std::cerr << "No attributes to wait on for " << name
+                  << ", polling it instead\n";
+        notifier = nullptr;
+    }
+}
+
+void TachSensor::updateSteadyRate(double reading)
+{
+    if (std::isfinite(rawValue) &&
+        std::abs(reading - rawValue) <= hysteresisTrigger)
+    {
+        if (steadyReads < steadyReadsPerStep * 8)
+        {
+            steadyReads++;
+        }
+    }
+    else
+    {
+        steadyReads = 0;
+    }
+
+    unsigned int interval = pwmPollMs;
+    for (unsigned int steps = steadyReads / steadyReadsPerStep;
+         steps > 0 && interval < steadyPollMs; steps--)
+    {
+        interval *= 2;
+    }
+    interval = std::min(interval, steadyPollMs);
+    if (interval != pollIntervalMs)
+    {
+        setPoller(pollHandle, interval);
+    }
 }
 
 void TachSensor::checkThresholds(void)
@@ -194,13 +245,51 @@ void TachSensor::checkThresholds(void)
     }
 
     bool curLed = !status;
-    if (led && ledState != curLed)
+    if (led && ledWanted != curLed)
     {
-        ledState = curLed;
-        setLed(dbusConnection, *led, curLed);
+        ledWanted = curLed;
+        updateLed();
     }
 }
 
+void TachSensor::updateLed(void)
+{
+    if (ledWaiting)
+    {
+        return; // goes out at the end of the window
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto next = lastLedChange + RedundancySensor::updateWindow;
+    if (now >= next)
+    {
+        applyLed();
+        return;
+    }
+    ledWaiting = true;
+    ledTimer.expires_from_now(boost::posix_time::milliseconds(
+        std::chrono::duration_cast<std::chrono::milliseconds>(next - now)
+            .count()));
+    ledTimer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec)
+        {
+            return; // we're being destroyed
+        }
+        ledWaiting = false;
+        applyLed();
+    });
+}
+
+void TachSensor::applyLed(void)
+{
+    if (ledState == ledWanted)
+    {
+        return; // flapped back within the window
+    }
+    ledState = ledWanted;
+    lastLedChange = std::chrono::steady_clock::now();
+    setLed(dbusConnection, *led, ledState);
+}
+
 PresenceSensor::PresenceSensor(const std::string& gpioName, bool inverted,
                                boost::asio::io_service& io,
                                const std::string& name) :
@@ -280,6 +369,10 @@ void PresenceSensor::read(void)
     {
         logFanRemoved(name);
     }
+    if (changedHook)
+    {
+        changedHook();
+    }
 }
 
 bool PresenceSensor::getValue(void)
@@ -290,7 +383,8 @@ bool PresenceSensor::getValue(void)
 RedundancySensor::RedundancySensor(size_t count,
                                    const std::vector<std::string>& children,
                                    sdbusplus::asio::object_server& objectServer,
-                                   const std::string& sensorConfiguration) :
+                                   const std::string& sensorConfiguration,
+                                   boost::asio::io_service& io) :
     count(count),
     iface(objectServer.add_interface(
         "/xyz/openbmc_project/control/FanRedundancy/Tach",
@@ -298,7 +392,7 @@ RedundancySensor::RedundancySensor(size_t count,
     association(objectServer.add_interface(
         "/xyz/openbmc_project/control/FanRedundancy/Tach",
         association::interface)),
-    objectServer(objectServer)
+    objectServer(objectServer), publishTimer(io)
 {
     createAssociation(association, sensorConfiguration);
     iface->register_property("Collection", children);
@@ -308,42 +402,85 @@ RedundancySensor::RedundancySensor(size_t count,
 }
 RedundancySensor::~RedundancySensor()
 {
+    publishTimer.cancel();
     objectServer.remove_interface(association);
     objectServer.remove_interface(iface);
 }
-void RedundancySensor::update(const std::string& name, bool failed)
+
+const char* RedundancySensor::stateFor(size_t failures) const
 {
-    statuses[name] = failed;
-    size_t failedCount = 0;
+    if (failures > count)
+    {
+        return redundancy::failed;
+    }
+    if (failures > 0)
+    {
+        return redundancy::degraded;
+    }
+    return redundancy::full;
+}
 
-    std::string newState = redundancy::full;
-    for (const auto& status : statuses)
+void RedundancySensor::update(const std::string& name, bool failed)
+{
+    auto [status, inserted] = statuses.try_emplace(name, failed);
+    if (!inserted)
     {
-        if (status.second)
+        if (status->second == failed)
         {
-            failedCount++;
-        }
-        if (failedCount > count)
-        {
-            newState = redundancy::failed;
-            break;
+            return;
         }
-        if (failedCount)
+        status->second = failed;
+        if (!failed)
         {
-            newState = redundancy::degraded;
+            failedCount--;
         }
     }
-    if (state != newState)
+    if (failed)
     {
-        if (state == redundancy::full)
-        {
-            logFanRedundancyLost();
-        }
-        else if (newState == redundancy::full)
+        failedCount++;
+    }
+
+    if (publishWaiting || stateFor(failedCount) == state)
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto next = lastPublish + updateWindow;
+    if (now >= next)
+    {
+        publish();
+        return;
+    }
+    publishWaiting = true;
+    publishTimer.expires_from_now(boost::posix_time::milliseconds(
+        std::chrono::duration_cast<std::chrono::milliseconds>(next - now)
+            .count()));
+    publishTimer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec)
         {
-            logFanRedundancyRestored();
+            return; // we're being destroyed
         }
-        state = newState;
-        iface->set_property("Status", state);
+        publishWaiting = false;
+        publish();
+    });
+}
+
+void RedundancySensor::publish(void)
+{
+    const char* newState = stateFor(failedCount);
+    if (newState == state)
+    {
+        return; // flapped back within the window
+    }
+    if (state == redundancy::full)
+    {
+        logFanRedundancyLost();
+    }
+    else if (newState == redundancy::full)
+    {
+        logFanRedundancyRestored();
     }
+    state = newState;
+    lastPublish = std::chrono::steady_clock::now();
+    iface->set_property("Status", std::string(state));
 }
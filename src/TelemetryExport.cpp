@@ -0,0 +1,126 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <TelemetryExport.hpp>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+
+#ifdef ENABLE_TELEMETRY_EXPORT
+static constexpr bool exportEnabled = true;
+#else
+static constexpr bool exportEnabled = false;
+#endif
+
+// 256 KiB, far more sensors than any one daemon has
+static constexpr uint32_t capacity = 2048;
+
+TelemetryExport* TelemetryExport::get(void)
+{
+    static bool initialized = false;
+    static TelemetryExport* instance = nullptr;
+    if (!exportEnabled || initialized)
+    {
+        return instance;
+    }
+    initialized = true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(sensor_telemetry::directory, ec);
+    std::string path = std::string(sensor_telemetry::directory) + "/" +
+                       program_invocation_short_name;
+    // set up under another name, readers never see a half written header
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0)
+    {
+        std::cerr << "Can't create " << temporary << ": " << strerror(errno)
+                  << "\n";
+        return nullptr;
+    }
+    size_t size = sizeof(sensor_telemetry::Header) +
+                  capacity * sizeof(sensor_telemetry::Entry);
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        mapping =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Can't map " << temporary << ": " << strerror(error)
+                  << "\n";
+        unlink(temporary.c_str());
+        return nullptr;
+    }
+
+    // the file starts out zeroed
+    auto header = new (mapping) sensor_telemetry::Header{};
+    header->magic = sensor_telemetry::magic;
+    header->version = sensor_telemetry::version;
+    header->headerSize = sizeof(sensor_telemetry::Header);
+    header->entrySize = sizeof(sensor_telemetry::Entry);
+    header->capacity = capacity;
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::cerr << "Can't publish " << path << ": " << strerror(errno)
+                  << "\n";
+        munmap(mapping, size);
+        unlink(temporary.c_str());
+        return nullptr;
+    }
+    instance = new TelemetryExport(mapping);
+    return instance;
+}
+
+TelemetryExport::TelemetryExport(void* mapping) :
+    header(static_cast<sensor_telemetry::Header*>(mapping)),
+    entries(reinterpret_cast<sensor_telemetry::Entry*>(
+        static_cast<char*>(mapping) + sizeof(sensor_telemetry::Header)))
+{}
+
+sensor_telemetry::Entry* TelemetryExport::entry(const std::string& sensorPath)
+{
+    auto findEntry = byPath.find(sensorPath);
+    if (findEntry != byPath.end())
+    {
+        return findEntry->second;
+    }
+    if (sensorPath.size() >= sensor_telemetry::pathSize)
+    {
+        std::cerr << "Not exporting " << sensorPath << ", paths of up to "
+                  << sensor_telemetry::pathSize - 1
+                  << " characters fit in the telemetry table\n";
+        return nullptr;
+    }
+    uint32_t count = header->count.load(std::memory_order_relaxed);
+    if (count == capacity)
+    {
+        static bool warned = false;
+        if (!warned)
+        {
+            warned = true;
+            std::cerr << "Telemetry table full, " << sensorPath
+                      << " and later sensors are not exported\n";
+        }
+        return nullptr;
+    }
+    sensor_telemetry::Entry* newEntry = new (&entries[count])
+        sensor_telemetry::Entry{};
+    sensorPath.copy(newEntry->path, sizeof(newEntry->path));
+    write(*newEntry, std::numeric_limits<double>::quiet_NaN(),
+          sensor_telemetry::statusRemoved);
+    header->count.store(count + 1, std::memory_order_release);
+    byPath.emplace(sensorPath, newEntry);
+    return newEntry;
+}
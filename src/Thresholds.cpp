@@ -1,10 +1,13 @@
+#include <IoSingleton.hpp>
 #include <Thresholds.hpp>
 #include <VariantVisitors.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/container/flat_map.hpp>
 #include <sensor.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -118,26 +121,121 @@ bool parseThresholdsFromConfig(
     return true;
 }
 
-void persistThreshold(const std::string& path, const std::string& baseInterface,
-                      const thresholds::Threshold& threshold,
-                      std::shared_ptr<sdbusplus::asio::connection>& conn,
-                      size_t thresholdCount, const std::string& labelMatch)
+// Writes coming in over D-Bus are persisted to Entity Manager behind the
+// sensors' back. Repeated writes of one threshold are merged, and all that
+// are pending go out together once writes have been quiet for a moment, or
+// persistMaxDelay after the oldest one at the latest. Every write to Entity
+// Manager ends up rewriting its JSON configuration, a tool setting all
+// thresholds of a system would otherwise cause one rewrite per sensor.
+class ThresholdPersister
 {
-    for (size_t ii = 0; ii < thresholdCount; ii++)
+  public:
+    explicit ThresholdPersister(boost::asio::io_service& io) : timer(io)
+    {}
+
+    // one per io_service, destroyed with it
+    static ThresholdPersister& getInstance(boost::asio::io_service& io)
+    {
+        std::unique_ptr<ThresholdPersister>& persister =
+            IoSingleton<ThresholdPersister>::get(io);
+        if (!persister)
+        {
+            persister = std::make_unique<ThresholdPersister>(io);
+        }
+        return *persister;
+    }
+
+    void queue(const std::string& path, const std::string& baseInterface,
+               const Threshold& threshold,
+               const std::shared_ptr<sdbusplus::asio::connection>& conn,
+               size_t thresholdCount, const std::string& labelMatch)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (pending.empty())
+        {
+            oldest = now;
+        }
+        Key key{path, baseInterface, labelMatch, threshold.level,
+                threshold.direction};
+        pending.insert_or_assign(
+            std::move(key), Pending{threshold.value, thresholdCount, conn});
+
+        timer.expires_at(std::min(now + persistQuietTime,
+                                  oldest + persistMaxDelay));
+        timer.async_wait([this](const boost::system::error_code& ec) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return; // rescheduled
+            }
+            flush();
+        });
+    }
+
+  private:
+    static constexpr std::chrono::milliseconds persistQuietTime{500};
+    static constexpr std::chrono::seconds persistMaxDelay{5};
+
+    struct Key
     {
-        std::string thresholdInterface =
-            baseInterface + ".Thresholds" + std::to_string(ii);
-        conn->async_method_call(
-            [&, path, threshold, thresholdInterface, labelMatch](
-                const boost::system::error_code& ec,
-                const boost::container::flat_map<std::string, BasicVariantType>&
-                    result) {
+        std::string path;
+        std::string baseInterface;
+        std::string labelMatch;
+        Level level;
+        Direction direction;
+
+        bool operator<(const Key& rhs) const
+        {
+            return std::tie(path, baseInterface, labelMatch, level,
+                            direction) < std::tie(rhs.path, rhs.baseInterface,
+                                                  rhs.labelMatch, rhs.level,
+                                                  rhs.direction);
+        }
+    };
+
+    struct Pending
+    {
+        double value;
+        size_t thresholdCount;
+        std::shared_ptr<sdbusplus::asio::connection> conn;
+    };
+
+    void flush(void)
+    {
+        boost::container::flat_map<Key, Pending> batch;
+        batch.swap(pending);
+        for (const auto& [key, update] : batch)
+        {
+            auto resolved = interfaces.find(key);
+            if (resolved != interfaces.end())
+            {
+                setValue(key, resolved->second, update);
+                continue;
+            }
+            for (size_t ii = 0; ii < update.thresholdCount; ii++)
+            {
+                resolve(key, key.baseInterface + ".Thresholds" +
+                                 std::to_string(ii),
+                        update);
+            }
+        }
+    }
+
+    // looks up whether thresholdInterface holds the threshold of key, the
+    // match is remembered so only the first write pays for the lookup
+    void resolve(const Key& key, const std::string& thresholdInterface,
+                 const Pending& update)
+    {
+        update.conn->async_method_call(
+            [this, key, thresholdInterface,
+             update](const boost::system::error_code& ec,
+                     const boost::container::flat_map<
+                         std::string, BasicVariantType>& result) {
                 if (ec)
                 {
                     return; // threshold not supported
                 }
 
-                if (!labelMatch.empty())
+                if (!key.labelMatch.empty())
                 {
                     auto labelFind = result.find("Label");
                     if (labelFind == result.end())
@@ -147,7 +245,7 @@ void persistThreshold(const std::string& path, const std::string& baseInterface,
                     }
                     std::string label =
                         std::visit(VariantToStringVisitor(), labelFind->second);
-                    if (label != labelMatch)
+                    if (label != key.labelMatch)
                     {
                         return;
                     }
@@ -167,27 +265,50 @@ void persistThreshold(const std::string& path, const std::string& baseInterface,
 
                 std::string dir =
                     std::visit(VariantToStringVisitor(), directionFind->second);
-                if ((toBusValue(threshold.level) != level) ||
-                    (toBusValue(threshold.direction) != dir))
+                if ((toBusValue(key.level) != level) ||
+                    (toBusValue(key.direction) != dir))
                 {
                     return; // not the droid we're looking for
                 }
 
-                std::variant<double> value(threshold.value);
-                conn->async_method_call(
-                    [](const boost::system::error_code& ec) {
-                        if (ec)
-                        {
-                            std::cerr << "Error setting threshold " << ec
-                                      << "\n";
-                        }
-                    },
-                    entityManagerName, path, "org.freedesktop.DBus.Properties",
-                    "Set", thresholdInterface, "Value", value);
+                interfaces[key] = thresholdInterface;
+                setValue(key, thresholdInterface, update);
             },
-            entityManagerName, path, "org.freedesktop.DBus.Properties",
+            entityManagerName, key.path, "org.freedesktop.DBus.Properties",
             "GetAll", thresholdInterface);
     }
+
+    void setValue(const Key& key, const std::string& thresholdInterface,
+                  const Pending& update)
+    {
+        std::variant<double> value(update.value);
+        update.conn->async_method_call(
+            [this, key](const boost::system::error_code& ec) {
+                if (ec)
+                {
+                    std::cerr << "Error setting threshold " << ec << "\n";
+                    // the configuration may have changed under us
+                    interfaces.erase(key);
+                }
+            },
+            entityManagerName, key.path, "org.freedesktop.DBus.Properties",
+            "Set", thresholdInterface, "Value", value);
+    }
+
+    boost::asio::steady_timer timer;
+    boost::container::flat_map<Key, Pending> pending;
+    std::chrono::steady_clock::time_point oldest;
+    boost::container::flat_map<Key, std::string> interfaces;
+};
+
+void persistThreshold(const std::string& path, const std::string& baseInterface,
+                      const thresholds::Threshold& threshold,
+                      std::shared_ptr<sdbusplus::asio::connection>& conn,
+                      size_t thresholdCount, const std::string& labelMatch)
+{
+    ThresholdPersister::getInstance(conn->get_io_context())
+        .queue(path, baseInterface, threshold, conn, thresholdCount,
+               labelMatch);
 }
 
 void updateThresholds(Sensor* sensor)
@@ -247,26 +368,14 @@ static int cLoMidstate = 0;
 static int cDebugThrottle = 0;
 static constexpr int assertLogCount = 10;
 
-struct ChangeParam
-{
-    ChangeParam(Threshold whichThreshold, bool status, double value) :
-        threshold(whichThreshold), asserted(status), assertValue(value)
-    {}
-
-    Threshold threshold;
-    bool asserted;
-    double assertValue;
-};
-
-static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
+// Calls handler(threshold, asserted) for every threshold the value is
+// clearly above or below of, the handler decides whether that changes
+// anything. This runs for every sample of every sensor, so nothing in here
+// may allocate.
+template <typename Handler>
+static void checkThresholds(Sensor* sensor, double value, Handler&& handler)
 {
-    std::vector<ChangeParam> thresholdChanges;
-    if (sensor->thresholds.empty())
-    {
-        return thresholdChanges;
-    }
-
-    for (auto& threshold : sensor->thresholds)
+    for (const auto& threshold : sensor->thresholds)
     {
         // Use "Schmitt trigger" logic to avoid threshold trigger spam,
         // if value is noisy while hovering very close to a threshold.
@@ -277,7 +386,7 @@ static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
         {
             if (value >= threshold.value)
             {
-                thresholdChanges.emplace_back(threshold, true, value);
+                handler(threshold, true);
                 if (++cHiTrue < assertLogCount)
                 {
                     std::cerr << "Sensor " << sensor->name << " high threshold "
@@ -287,7 +396,7 @@ static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
             }
             else if (value < (threshold.value - sensor->hysteresisTrigger))
             {
-                thresholdChanges.emplace_back(threshold, false, value);
+                handler(threshold, false);
                 ++cHiFalse;
             }
             else
@@ -299,7 +408,7 @@ static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
         {
             if (value <= threshold.value)
             {
-                thresholdChanges.emplace_back(threshold, true, value);
+                handler(threshold, true);
                 if (++cLoTrue < assertLogCount)
                 {
                     std::cerr << "Sensor " << sensor->name << " low threshold "
@@ -310,7 +419,7 @@ static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
             }
             else if (value > (threshold.value + sensor->hysteresisTrigger))
             {
-                thresholdChanges.emplace_back(threshold, false, value);
+                handler(threshold, false);
                 ++cLoFalse;
             }
             else
@@ -337,39 +446,52 @@ static std::vector<ChangeParam> checkThresholds(Sensor* sensor, double value)
                       << " M=" << cLoMidstate << "\n";
         }
     }
-
-    return thresholdChanges;
 }
 
-void ThresholdTimer::startTimer(const Threshold& threshold, bool assert,
-                                double assertValue)
+static bool alarmUnchanged(const Sensor* sensor, const Threshold& threshold,
+                           bool asserted)
 {
-    struct TimerUsed timerUsed = {};
-    constexpr const size_t waitTime = 5;
-    TimerPair* pair = nullptr;
+    return sensor->alarmStates[alarmIndex(threshold.level,
+                                          threshold.direction)] == asserted;
+}
 
-    for (TimerPair& timer : timers)
+ThresholdTimerPool& ThresholdTimerPool::getInstance(boost::asio::io_service& io)
+{
+    std::unique_ptr<ThresholdTimerPool>& pool =
+        IoSingleton<ThresholdTimerPool>::get(io);
+    if (!pool)
     {
-        if (!timer.first.used)
-        {
-            pair = &timer;
-            break;
-        }
+        pool = std::make_unique<ThresholdTimerPool>(io);
     }
-    if (pair == nullptr)
+    return *pool;
+}
+
+void ThresholdTimerPool::start(ThresholdTimer& owner, size_t index,
+                               uint32_t generation, double assertValue)
+{
+    entries.push_back({&owner, index, generation, assertValue,
+                       std::chrono::steady_clock::now() + delay});
+    if (entries.size() == 1)
     {
-        pair = &timers.emplace_back(timerUsed, boost::asio::deadline_timer(io));
+        arm();
     }
+}
 
-    pair->first.used = true;
-    pair->first.level = threshold.level;
-    pair->first.direction = threshold.direction;
-    pair->first.assert = assert;
-    pair->second.expires_from_now(boost::posix_time::seconds(waitTime));
-    pair->second.async_wait([this, pair, threshold, assert,
-                             assertValue](boost::system::error_code ec) {
-        pair->first.used = false;
+void ThresholdTimerPool::cancel(const ThresholdTimer& owner)
+{
+    for (Entry& entry : entries)
+    {
+        if (entry.owner == &owner)
+        {
+            entry.owner = nullptr;
+        }
+    }
+}
 
+void ThresholdTimerPool::arm(void)
+{
+    timer.expires_at(entries.front().expiry);
+    timer.async_wait([this](const boost::system::error_code& ec) {
         if (ec == boost::asio::error::operation_aborted)
         {
             return; // we're being canceled
@@ -377,40 +499,98 @@ void ThresholdTimer::startTimer(const Threshold& threshold, bool assert,
         if (ec)
         {
             std::cerr << "timer error: " << ec.message() << "\n";
-            return;
         }
-        if (sensor->readingStateGood())
+        expire();
+    });
+}
+
+void ThresholdTimerPool::expire(void)
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!entries.empty() && entries.front().expiry <= now)
+    {
+        Entry entry = entries.front();
+        entries.pop_front();
+        // the owner may start new timers from here, the entry is already
+        // out of the queue
+        if (entry.owner != nullptr)
         {
-            assertThresholds(sensor, assertValue, threshold.level,
-                             threshold.direction, assert);
+            entry.owner->expired(entry.index, entry.generation,
+                                 entry.assertValue);
         }
-    });
+    }
+    if (!entries.empty())
+    {
+        arm();
+    }
+}
+
+void ThresholdTimer::startTimer(const Threshold& threshold, bool assert,
+                                double assertValue)
+{
+    size_t index = timerIndex(threshold, assert);
+    if (pending[index] != 0)
+    {
+        // only the first expiry changes the state, more entries would just
+        // grow the pool while a sensor keeps reading below its threshold
+        return;
+    }
+    pool.start(*this, index, generation[index], assertValue);
+    pending[index]++;
+}
+
+void ThresholdTimer::expired(size_t index, uint32_t entryGeneration,
+                             double assertValue)
+{
+    if (entryGeneration != generation[index])
+    {
+        return; // stopped meanwhile
+    }
+    pending[index]--;
+    if (sensor->readingStateGood())
+    {
+        size_t alarm = index / 2;
+        assertThresholds(sensor, assertValue,
+                         static_cast<Level>(alarm / 2),
+                         static_cast<Direction>(alarm % 2), (index % 2) != 0);
+    }
 }
 
 bool checkThresholds(Sensor* sensor)
 {
     bool status = true;
-    std::vector<ChangeParam> changes = checkThresholds(sensor, sensor->value);
-    for (const auto& change : changes)
-    {
-        assertThresholds(sensor, change.assertValue, change.threshold.level,
-                         change.threshold.direction, change.asserted);
-        if (change.threshold.level == thresholds::Level::CRITICAL &&
-            change.asserted)
+    double value = sensor->value;
+    checkThresholds(sensor, value, [sensor, value, &status](
+                                       const Threshold& threshold,
+                                       bool asserted) {
+        if (threshold.level == thresholds::Level::CRITICAL && asserted)
         {
             status = false;
         }
-    }
+        if (alarmUnchanged(sensor, threshold, asserted))
+        {
+            return;
+        }
+        assertThresholds(sensor, value, threshold.level, threshold.direction,
+                         asserted);
+    });
 
     return status;
 }
 
 void checkThresholdsPowerDelay(Sensor* sensor, ThresholdTimer& thresholdTimer)
 {
-
-    std::vector<ChangeParam> changes = checkThresholds(sensor, sensor->value);
-    for (const auto& change : changes)
-    {
+    double value = sensor->value;
+    checkThresholds(sensor, value, [sensor, value, &thresholdTimer](
+                                       const Threshold& threshold,
+                                       bool asserted) {
+        // a pending timer for the opposite change still has to be
+        // overtaken, see below
+        if (alarmUnchanged(sensor, threshold, asserted) &&
+            !thresholdTimer.hasActiveTimer(threshold, !asserted))
+        {
+            return;
+        }
         // When CPU is powered off, some volatges are expected to
         // go below low thresholds. Filter these events with thresholdTimer.
         // 1. always delay the assertion of low events to see if they are
@@ -422,63 +602,56 @@ void checkThresholdsPowerDelay(Sensor* sensor, ThresholdTimer& thresholdTimer)
         //   first and when timer expires for the previous one, no additional
         //   signal will be logged.
         // 4. no delays for all high events.
-        if (change.threshold.direction == thresholds::Direction::LOW)
+        if (threshold.direction == thresholds::Direction::LOW)
         {
-            if (change.asserted || thresholdTimer.hasActiveTimer(
-                                       change.threshold, !change.asserted))
+            if (asserted || thresholdTimer.hasActiveTimer(threshold, !asserted))
             {
-                thresholdTimer.startTimer(change.threshold, change.asserted,
-                                          change.assertValue);
-                continue;
+                thresholdTimer.startTimer(threshold, asserted, value);
+                return;
             }
         }
-        assertThresholds(sensor, change.assertValue, change.threshold.level,
-                         change.threshold.direction, change.asserted);
-    }
+        assertThresholds(sensor, value, threshold.level, threshold.direction,
+                         asserted);
+    });
 }
 
+struct AlarmProperty
+{
+    const char* name;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> Sensor::*interface;
+};
+
+// by alarmIndex()
+static constexpr std::array<AlarmProperty, alarmCount> alarmProperties = {{
+    {"WarningAlarmHigh", &Sensor::thresholdInterfaceWarning},
+    {"WarningAlarmLow", &Sensor::thresholdInterfaceWarning},
+    {"CriticalAlarmHigh", &Sensor::thresholdInterfaceCritical},
+    {"CriticalAlarmLow", &Sensor::thresholdInterfaceCritical},
+}};
+static_assert(alarmIndex(Level::WARNING, Direction::LOW) == 1);
+static_assert(alarmIndex(Level::CRITICAL, Direction::HIGH) == 2);
+
 void assertThresholds(Sensor* sensor, double assertValue,
                       thresholds::Level level, thresholds::Direction direction,
                       bool assert)
 {
-    std::string property;
-    std::shared_ptr<sdbusplus::asio::dbus_interface> interface;
-    if (level == thresholds::Level::WARNING &&
-        direction == thresholds::Direction::HIGH)
-    {
-        property = "WarningAlarmHigh";
-        interface = sensor->thresholdInterfaceWarning;
-    }
-    else if (level == thresholds::Level::WARNING &&
-             direction == thresholds::Direction::LOW)
-    {
-        property = "WarningAlarmLow";
-        interface = sensor->thresholdInterfaceWarning;
-    }
-    else if (level == thresholds::Level::CRITICAL &&
-             direction == thresholds::Direction::HIGH)
-    {
-        property = "CriticalAlarmHigh";
-        interface = sensor->thresholdInterfaceCritical;
-    }
-    else if (level == thresholds::Level::CRITICAL &&
-             direction == thresholds::Direction::LOW)
-    {
-        property = "CriticalAlarmLow";
-        interface = sensor->thresholdInterfaceCritical;
-    }
-    else
+    size_t index = alarmIndex(level, direction);
+    if (index >= alarmCount)
     {
         std::cerr << "Unknown threshold, level " << level << "direction "
                   << direction << "\n";
         return;
     }
+    const char* property = alarmProperties[index].name;
+    const std::shared_ptr<sdbusplus::asio::dbus_interface>& interface =
+        sensor->*alarmProperties[index].interface;
     if (!interface)
     {
         std::cout << "trying to set uninitialized interface\n";
         return;
     }
 
+    sensor->alarmStates[index] = assert;
     if (interface->set_property<bool, true>(property, assert))
     {
         try
@@ -17,16 +17,24 @@
 #include <Utils.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <memory>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -38,6 +46,7 @@ static bool biosHasPost = false;
 
 static std::unique_ptr<sdbusplus::bus::match::match> powerMatch = nullptr;
 static std::unique_ptr<sdbusplus::bus::match::match> postMatch = nullptr;
+static std::vector<std::weak_ptr<PowerStateCallback>> powerSubscribers;
 
 /**
  * return the contents of a file
@@ -126,6 +135,100 @@ std::set<std::string> getPermitSet(const SensorBaseConfigMap& config)
     return permitSet;
 }
 
+PublishPolicy getPublishPolicy(const SensorBaseConfigMap& config)
+{
+    PublishPolicy policy;
+    std::array<std::pair<const char*, double*>, 3> fields = {
+        std::make_pair("PublishHysteresis", &policy.hysteresis),
+        std::make_pair("PublishHysteresisPercent", &policy.hysteresisPercent),
+        std::make_pair("MaxPublishRate", &policy.maxRate)};
+    for (const auto& [key, field] : fields)
+    {
+        auto find = config.find(key);
+        if (find == config.end())
+        {
+            continue;
+        }
+        try
+        {
+            double val = std::visit(VariantToDoubleVisitor(), find->second);
+            if (!std::isfinite(val) || val < 0.0)
+            {
+                std::cerr << "Ignoring invalid " << key << " " << val << "\n";
+                continue;
+            }
+            *field = val;
+        }
+        catch (const std::invalid_argument&)
+        {
+            std::cerr << key << " is not a number\n";
+        }
+    }
+    return policy;
+}
+
+static bool isReconfigurableProperty(const std::string& property)
+{
+    static constexpr std::array<std::string_view, 6> properties = {
+        "MaxReading",
+        "MinReading",
+        "PowerState",
+        "PublishHysteresis",
+        "PublishHysteresisPercent",
+        "MaxPublishRate",
+    };
+    if (std::find(properties.begin(), properties.end(), property) !=
+        properties.end())
+    {
+        return true;
+    }
+    // per label limits of PSU sensors, e.g. vout1_Max
+    return boost::ends_with(property, "_Min") ||
+           boost::ends_with(property, "_Max");
+}
+
+bool onlyReconfigurableChanges(const SensorData& current,
+                               const SensorData& updated)
+{
+    if (current.size() != updated.size())
+    {
+        return false;
+    }
+    for (auto currentIt = current.begin(), updatedIt = updated.begin();
+         currentIt != current.end(); currentIt++, updatedIt++)
+    {
+        const auto& [interface, currentProperties] = *currentIt;
+        if (interface != updatedIt->first)
+        {
+            return false;
+        }
+        // threshold layout changes are caught by Sensor::reconfigure()
+        if (interface.find(".Thresholds") != std::string::npos)
+        {
+            continue;
+        }
+        const SensorBaseConfigMap& updatedProperties = updatedIt->second;
+        for (const auto& [property, value] : currentProperties)
+        {
+            auto find = updatedProperties.find(property);
+            if ((find == updatedProperties.end() || find->second != value) &&
+                !isReconfigurableProperty(property))
+            {
+                return false;
+            }
+        }
+        for (const auto& [property, value] : updatedProperties)
+        {
+            if (!currentProperties.count(property) &&
+                !isReconfigurableProperty(property))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 bool getSensorConfiguration(
     const std::string& type,
     const std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
@@ -237,6 +340,60 @@ bool hasBiosPost(void)
     return biosHasPost;
 }
 
+static void prunePowerSubscribers(void)
+{
+    powerSubscribers.erase(
+        std::remove_if(powerSubscribers.begin(), powerSubscribers.end(),
+                       [](const std::weak_ptr<PowerStateCallback>& subscriber) {
+                           return subscriber.expired();
+                       }),
+        powerSubscribers.end());
+}
+
+std::shared_ptr<PowerStateCallback>
+    subscribePowerState(PowerStateCallback&& callback)
+{
+    prunePowerSubscribers();
+    auto subscription =
+        std::make_shared<PowerStateCallback>(std::move(callback));
+    powerSubscribers.emplace_back(subscription);
+    return subscription;
+}
+
+static void notifyPowerSubscribers(void)
+{
+    // subscribers may come and go from within their callbacks, so walk a
+    // copy and skip the ones that are gone by the time they're reached
+    std::vector<std::weak_ptr<PowerStateCallback>> subscribers =
+        powerSubscribers;
+    for (const std::weak_ptr<PowerStateCallback>& subscriber : subscribers)
+    {
+        if (std::shared_ptr<PowerStateCallback> callback = subscriber.lock())
+        {
+            (*callback)();
+        }
+    }
+    prunePowerSubscribers();
+}
+
+static void setPowerStatus(bool on)
+{
+    if (on != powerStatusOn)
+    {
+        powerStatusOn = on;
+        notifyPowerSubscribers();
+    }
+}
+
+static void setPostStatus(bool posted)
+{
+    if (posted != biosHasPost)
+    {
+        biosHasPost = posted;
+        notifyPowerSubscribers();
+    }
+}
+
 static void
     getPowerStatus(const std::shared_ptr<sdbusplus::asio::connection>& conn,
                    size_t retries = 2)
@@ -264,8 +421,8 @@ static void
                           << "\n";
                 return;
             }
-            powerStatusOn =
-                boost::ends_with(std::get<std::string>(state), "Running");
+            setPowerStatus(
+                boost::ends_with(std::get<std::string>(state), "Running"));
         },
         power::busname, power::path, properties::interface, properties::get,
         power::interface, power::property);
@@ -297,7 +454,7 @@ static void
                           << "\n";
                 return;
             }
-            biosHasPost = std::get<std::string>(state) != "Inactive";
+            setPostStatus(std::get<std::string>(state) != "Inactive");
         },
         post::busname, post::path, properties::interface, properties::get,
         post::interface, post::property);
@@ -331,7 +488,7 @@ void setupPowerMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn)
                 if (!on)
                 {
                     timer.cancel();
-                    powerStatusOn = false;
+                    setPowerStatus(false);
                     return;
                 }
                 // on comes too quickly
@@ -346,7 +503,7 @@ void setupPowerMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn)
                         std::cerr << "Timer error " << ec.message() << "\n";
                         return;
                     }
-                    powerStatusOn = true;
+                    setPowerStatus(true);
                 });
             }
         });
@@ -364,8 +521,8 @@ void setupPowerMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn)
             auto findState = values.find(post::property);
             if (findState != values.end())
             {
-                biosHasPost =
-                    std::get<std::string>(findState->second) != "Inactive";
+                setPostStatus(std::get<std::string>(findState->second) !=
+                              "Inactive");
             }
         });
 
@@ -462,6 +619,195 @@ void createInventoryAssoc(
             "xyz.openbmc_project.Inventory.Item.System"});
 }
 
+// configuration requests collected until the next io_service turn
+struct ConfigurationBatch
+{
+    struct Request
+    {
+        std::shared_ptr<GetSensorConfiguration> getter;
+        std::vector<std::string> interfaces;
+        size_t retries;
+    };
+    std::vector<Request> requests;
+};
+
+static std::shared_ptr<ConfigurationBatch> pendingBatch;
+
+static bool wantsInterface(const std::vector<std::string>& interfaces,
+                           const std::string& interface)
+{
+    // anything that starts with a requested configuration is good
+    return std::any_of(interfaces.begin(), interfaces.end(),
+                       [&interface](const std::string& possible) {
+                           return boost::starts_with(interface, possible);
+                       });
+}
+
+static void retryConfiguration(const ConfigurationBatch::Request& request)
+{
+    std::cerr << "Error calling mapper\n";
+    if (!request.retries)
+    {
+        return;
+    }
+    auto timer = std::make_shared<boost::asio::steady_timer>(
+        request.getter->dbusConnection->get_io_context());
+    timer->expires_after(std::chrono::seconds(10));
+    timer->async_wait([request, timer](boost::system::error_code ec) {
+        if (ec)
+        {
+            std::cerr << "Timer error!\n";
+            return;
+        }
+        request.getter->getConfiguration(request.interfaces,
+                                         request.retries - 1);
+    });
+}
+
+// one GetAll for every getter that asked for the interface
+static void
+    getBatchPath(std::vector<std::shared_ptr<GetSensorConfiguration>>&& getters,
+                 const std::string& path, const std::string& interface,
+                 const std::string& owner)
+{
+    std::shared_ptr<sdbusplus::asio::connection> conn =
+        getters.front()->dbusConnection;
+    conn->async_method_call(
+        [getters{std::move(getters)}, path, interface,
+         owner](const boost::system::error_code ec,
+                boost::container::flat_map<std::string, BasicVariantType>&
+                    data) {
+            if (ec)
+            {
+                // from here on every getter retries on its own
+                std::cerr << "Error getting " << path << ": retrying\n";
+                for (const std::shared_ptr<GetSensorConfiguration>& getter :
+                     getters)
+                {
+                    auto timer = std::make_shared<boost::asio::steady_timer>(
+                        getter->dbusConnection->get_io_context());
+                    timer->expires_after(std::chrono::seconds(10));
+                    timer->async_wait([getter, timer, path, interface,
+                                       owner](boost::system::error_code ec) {
+                        if (ec)
+                        {
+                            std::cerr << "Timer error!\n";
+                            return;
+                        }
+                        getter->getPath(path, interface, owner, 4);
+                    });
+                }
+                return;
+            }
+            for (size_t index = 0; index + 1 < getters.size(); index++)
+            {
+                getters[index]->respData[path][interface] = data;
+            }
+            getters.back()->respData[path][interface] = std::move(data);
+        },
+        owner, path, "org.freedesktop.DBus.Properties", "GetAll", interface);
+}
+
+static void runBatch(const std::shared_ptr<ConfigurationBatch>& batch)
+{
+    boost::container::flat_set<std::string> interfaceSet;
+    for (const ConfigurationBatch::Request& request : batch->requests)
+    {
+        interfaceSet.insert(request.interfaces.begin(),
+                            request.interfaces.end());
+    }
+    std::vector<std::string> interfaces(interfaceSet.begin(),
+                                        interfaceSet.end());
+
+    batch->requests.front().getter->dbusConnection->async_method_call(
+        [batch](const boost::system::error_code ec,
+                const GetSubTreeType& ret) {
+            if (ec)
+            {
+                for (const ConfigurationBatch::Request& request :
+                     batch->requests)
+                {
+                    retryConfiguration(request);
+                }
+                return;
+            }
+            for (const auto& [path, objDict] : ret)
+            {
+                if (objDict.empty())
+                {
+                    return;
+                }
+                const std::string& owner = objDict.begin()->first;
+
+                for (const std::string& interface : objDict.begin()->second)
+                {
+                    std::vector<std::shared_ptr<GetSensorConfiguration>>
+                        getters;
+                    for (const ConfigurationBatch::Request& request :
+                         batch->requests)
+                    {
+                        if (wantsInterface(request.interfaces, interface))
+                        {
+                            getters.push_back(request.getter);
+                        }
+                    }
+                    if (!getters.empty())
+                    {
+                        getBatchPath(std::move(getters), path, interface,
+                                     owner);
+                    }
+                }
+            }
+        },
+        mapper::busName, mapper::path, mapper::interface, mapper::subtree, "/",
+        0, interfaces);
+}
+
+void GetSensorConfiguration::getConfiguration(
+    const std::vector<std::string>& interfaces, size_t retries)
+{
+    if (retries > 5)
+    {
+        retries = 5;
+    }
+    if (!pendingBatch)
+    {
+        pendingBatch = std::make_shared<ConfigurationBatch>();
+        dbusConnection->get_io_context().post([]() {
+            std::shared_ptr<ConfigurationBatch> batch = std::move(pendingBatch);
+            pendingBatch = nullptr;
+            runBatch(batch);
+        });
+    }
+    pendingBatch->requests.push_back(
+        {shared_from_this(), interfaces, retries});
+}
+
+/**
+ * parse a sysfs attribute holding a single decimal integer, as hwmon and iio
+ * attributes are formatted, without allocating or throwing
+ * @param[in] str - the attribute contents, usually terminated by a newline
+ * @param[out] value - the parsed value, only written on success
+ * @return true if the whole attribute was a valid integer
+ */
+bool parseSysfsInteger(std::string_view str, int64_t& value)
+{
+    size_t end = str.find_last_not_of(" \t\n");
+    if (end == std::string_view::npos)
+    {
+        return false;
+    }
+    const char* last = str.data() + end + 1;
+    int64_t parsed = 0;
+    auto [ptr, ec] = std::from_chars(str.data(), last, parsed);
+    if (ec != std::errc() || ptr != last)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
 std::optional<double> readFile(const std::string& thresholdFile,
                                const double& scaleFactor)
 {
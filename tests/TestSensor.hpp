@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Thresholds.hpp>
+#include <sensor.hpp>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Base of the fake sensors the tests build, it has no D-Bus connection, so
+// Value updates and threshold alarms stop where they would be sent out
+class TestSensor : public Sensor
+{
+  public:
+    TestSensor(const std::string& name,
+               std::vector<thresholds::Threshold>&& thresholdData,
+               const std::string& configurationPath,
+               const std::string& objectType, double max, double min) :
+        Sensor(name, std::move(thresholdData), configurationPath, objectType,
+               max, min, noConnection)
+    {}
+
+    void checkThresholds(void) override
+    {}
+
+  private:
+    static inline std::shared_ptr<sdbusplus::asio::connection> noConnection;
+};
@@ -0,0 +1,107 @@
+#include <HwmonAttribute.hpp>
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+// attribute names of a dozen PMBus PSUs, the typical worst case discovery has
+// to walk through
+static std::vector<std::string> makeAttributePaths(void)
+{
+    std::vector<std::string> paths;
+    const std::vector<std::string> types = {"in", "curr", "power", "temp",
+                                            "fan"};
+    const std::vector<std::string> items = {
+        "input", "label", "max", "min", "crit", "lcrit", "alarm", "max_alarm"};
+    for (int device = 0; device < 12; device++)
+    {
+        std::string directory =
+            "/sys/class/hwmon/hwmon" + std::to_string(device) + "/";
+        for (const std::string& type : types)
+        {
+            for (int channel = 1; channel <= 3; channel++)
+            {
+                for (const std::string& item : items)
+                {
+                    paths.emplace_back(directory + type +
+                                       std::to_string(channel) + "_" + item);
+                }
+            }
+        }
+        paths.emplace_back(directory + "name");
+        paths.emplace_back(directory + "uevent");
+    }
+    return paths;
+}
+
+static void BM_RegexDiscovery(benchmark::State& state)
+{
+    std::vector<std::string> paths = makeAttributePaths();
+    for (auto _ : state)
+    {
+        // findFiles() compiles the pattern on every call
+        std::regex search(R"(\w\d+_input$)");
+        std::smatch match;
+        size_t found = 0;
+        for (const std::string& path : paths)
+        {
+            if (std::regex_search(path, match, search))
+            {
+                found++;
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+BENCHMARK(BM_RegexDiscovery);
+
+static void BM_MatcherDiscovery(benchmark::State& state)
+{
+    std::vector<std::string> paths = makeAttributePaths();
+    constexpr HwmonAttributeMatch match{"", "input"};
+    for (auto _ : state)
+    {
+        size_t found = 0;
+        for (const std::string& path : paths)
+        {
+            std::string_view fileName(path);
+            fileName.remove_prefix(fileName.rfind('/') + 1);
+            if (match(fileName))
+            {
+                found++;
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+BENCHMARK(BM_MatcherDiscovery);
+
+static void BM_RegexChannel(benchmark::State& state)
+{
+    std::regex inputRegex(R"(in(\d+)_input)");
+    std::string path = "/sys/class/hwmon/hwmon3/in12_input";
+    for (auto _ : state)
+    {
+        std::smatch match;
+        std::regex_search(path, match, inputRegex);
+        size_t index = std::stoul(*(match.begin() + 1));
+        benchmark::DoNotOptimize(index);
+    }
+}
+BENCHMARK(BM_RegexChannel);
+
+static void BM_MatcherChannel(benchmark::State& state)
+{
+    std::string fileName = "in12_input";
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(fileName);
+        size_t index = splitHwmonAttribute(fileName)->getChannel();
+        benchmark::DoNotOptimize(index);
+    }
+}
+BENCHMARK(BM_MatcherChannel);
+
+BENCHMARK_MAIN();
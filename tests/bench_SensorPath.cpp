@@ -0,0 +1,208 @@
+#include "TestSensor.hpp"
+
+#include <SensorPaths.hpp>
+#include <Thresholds.hpp>
+#include <Utils.hpp>
+#include <sensor.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace fs = std::filesystem;
+
+// A sensor without any D-Bus interfaces that runs the real threshold checks,
+// so only the work done by this project is measured.
+class BenchSensor : public TestSensor
+{
+  public:
+    explicit BenchSensor(std::vector<thresholds::Threshold>&& thresholdData) :
+        TestSensor("Bench Sensor", std::move(thresholdData),
+                   "/xyz/openbmc_project/inventory/system/board/Bench",
+                   "xyz.openbmc_project.Configuration.Bench", 127, -128)
+    {}
+
+    void checkThresholds(void) override
+    {
+        thresholds::checkThresholds(this);
+    }
+};
+
+static std::vector<thresholds::Threshold> makeThresholds(void)
+{
+    return {{thresholds::Level::WARNING, thresholds::Direction::HIGH, 80},
+            {thresholds::Level::CRITICAL, thresholds::Direction::HIGH, 90},
+            {thresholds::Level::WARNING, thresholds::Direction::LOW, 5},
+            {thresholds::Level::CRITICAL, thresholds::Direction::LOW, 0}};
+}
+
+// Fake sysfs tree laid out like /sys/class/hwmon with a dozen PMBus devices,
+// removed again once the benchmarks are done.
+class FakeSysfs
+{
+  public:
+    FakeSysfs()
+    {
+        std::string dirTemplate =
+            (fs::temp_directory_path() / "bench-hwmon-XXXXXX").string();
+        root = mkdtemp(dirTemplate.data());
+        const std::vector<std::string> types = {"in", "curr", "power", "temp"};
+        const std::vector<std::string> items = {"input", "label", "max",
+                                                "min",   "crit",  "alarm"};
+        for (int device = 0; device < 12; device++)
+        {
+            fs::path directory = root / ("hwmon" + std::to_string(device));
+            fs::create_directories(directory);
+            std::ofstream(directory / "name") << "pmbus\n";
+            for (const std::string& type : types)
+            {
+                for (int channel = 1; channel <= 3; channel++)
+                {
+                    for (const std::string& item : items)
+                    {
+                        std::ofstream(directory /
+                                      (type + std::to_string(channel) + "_" +
+                                       item))
+                            << "12345\n";
+                    }
+                }
+            }
+        }
+    }
+    ~FakeSysfs()
+    {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    FakeSysfs(const FakeSysfs&) = delete;
+    FakeSysfs& operator=(const FakeSysfs&) = delete;
+
+    fs::path root;
+};
+
+static FakeSysfs& getFakeSysfs(void)
+{
+    static FakeSysfs sysfs;
+    return sysfs;
+}
+
+static void BM_UpdateValue(benchmark::State& state)
+{
+    BenchSensor sensor(makeThresholds());
+    // noise around a stable reading, most samples are within hysteresis
+    const std::array<double, 4> readings = {42.0, 42.001, 41.999, 42.5};
+    size_t index = 0;
+    for (auto _ : state)
+    {
+        sensor.updateValue(readings[index++ % readings.size()]);
+    }
+}
+BENCHMARK(BM_UpdateValue);
+
+static void BM_RequiresUpdate(benchmark::State& state)
+{
+    BenchSensor sensor(makeThresholds());
+    double lVal = 42.0;
+    double rVal = 42.001;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(lVal);
+        benchmark::DoNotOptimize(sensor.requiresUpdate(lVal, rVal));
+    }
+}
+BENCHMARK(BM_RequiresUpdate);
+
+static void BM_CheckThresholds(benchmark::State& state)
+{
+    BenchSensor sensor(makeThresholds());
+    // well inside the normal range, the common case of no alarm changing
+    sensor.value = 42.0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(thresholds::checkThresholds(&sensor));
+    }
+}
+BENCHMARK(BM_CheckThresholds);
+
+static void BM_ParseThresholdsFromConfig(benchmark::State& state)
+{
+    SensorData sensorData;
+    sensorData["xyz.openbmc_project.Configuration.Bench"]["Name"] =
+        std::string("Bench");
+    const std::array<std::pair<const char*, uint64_t>, 4> severities = {
+        {{"greater than", 0}, {"greater than", 1}, {"less than", 0},
+         {"less than", 1}}};
+    for (size_t ii = 0; ii < severities.size(); ii++)
+    {
+        SensorBaseConfigMap& threshold =
+            sensorData["xyz.openbmc_project.Configuration.Bench.Thresholds" +
+                       std::to_string(ii)];
+        threshold["Direction"] = std::string(severities[ii].first);
+        threshold["Severity"] = severities[ii].second;
+        threshold["Value"] = static_cast<double>(ii * 10);
+        threshold["Label"] = std::string("temp1");
+    }
+    std::string label = "temp1";
+    for (auto _ : state)
+    {
+        std::vector<thresholds::Threshold> result;
+        parseThresholdsFromConfig(sensorData, result, &label);
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+BENCHMARK(BM_ParseThresholdsFromConfig);
+
+static void BM_FindFiles(benchmark::State& state)
+{
+    const fs::path& root = getFakeSysfs().root;
+    for (auto _ : state)
+    {
+        std::vector<fs::path> paths;
+        findFiles(root, R"(\w\d+_input$)", paths);
+        benchmark::DoNotOptimize(paths.data());
+    }
+}
+BENCHMARK(BM_FindFiles);
+
+static void BM_EscapePathForDbus(benchmark::State& state)
+{
+    std::string name = "PSU1 Output Voltage (12V) #2";
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(sensor_paths::escapePathForDbus(name));
+    }
+}
+BENCHMARK(BM_EscapePathForDbus);
+
+static void BM_ParseSysfsInteger(benchmark::State& state)
+{
+    std::string_view contents = "-12345\n";
+    for (auto _ : state)
+    {
+        int64_t value = 0;
+        benchmark::DoNotOptimize(parseSysfsInteger(contents, value));
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_ParseSysfsInteger);
+
+static void BM_SysfsFileReadInteger(benchmark::State& state)
+{
+    SysfsFile file((getFakeSysfs().root / "hwmon0" / "temp1_input").string());
+    for (auto _ : state)
+    {
+        int64_t value = 0;
+        benchmark::DoNotOptimize(file.readInteger(value));
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_SysfsFileReadInteger);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,626 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <SensorPaths.hpp>
+#include <Utils.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/container/flat_map.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Load harness for the hwmon based daemons. It builds a fake hwmon class
+// tree with N devices of M channels for each of hwmontempsensor, psusensor
+// and fansensor, serves their configuration from a fake Entity Manager on a
+// private dbus-daemon, keeps the readings moving and reports what the
+// daemons cost:
+//
+//   load_hwmon_daemons [-n devices] [-m channels] [-u update-ms]
+//                      [-w warmup-s] [-t duration-s] daemon...
+//
+// The daemons are passed by path, e.g. build/src/hwmontempsensor. Which
+// devices a daemon picks up is decided by the daemon itself, every daemon
+// sees the whole tree as it would on a real BMC. DBUS_SYSTEM_BUS_ADDRESS
+// and SENSOR_HWMON_ROOT are set for the children, nothing of the host's
+// system bus or sysfs is touched.
+
+namespace fs = std::filesystem;
+
+static constexpr const char* configPath =
+    "/xyz/openbmc_project/inventory/system/board/Load_Board";
+static constexpr const char* configInterface =
+    "xyz.openbmc_project.Configuration.";
+static constexpr size_t psuLabels = 32; // vout1 to vout32 in psusensor
+
+struct Options
+{
+    size_t devices = 8;
+    size_t channels = 4;
+    std::chrono::milliseconds update{1000};
+    std::chrono::seconds warmup{10};
+    std::chrono::seconds duration{60};
+    std::vector<std::string> daemons;
+};
+
+// one kind of fake device, readings swing around base in sysfs units
+struct DeviceKind
+{
+    const char* driver;
+    const char* configType;
+    size_t bus;
+    const char* attribute;
+    int64_t base;
+    int64_t swing;
+    // sysfs units per sensor unit
+    double scale;
+};
+
+static const std::array<DeviceKind, 3> deviceKinds = {{
+    {"tmp75", "TMP75", 10, "temp", 40000, 5000, 1000},
+    {"pmbus", "pmbus", 30, "in", 12000, 200, 1000},
+    {"max31790", "I2CFan", 50, "fan", 8000, 1500, 1},
+}};
+
+struct ProcessSample
+{
+    uint64_t cpuTicks = 0;
+    uint64_t contextSwitches = 0;
+    uint64_t rssKb = 0;
+    uint64_t peakRssKb = 0;
+};
+
+struct Daemon
+{
+    std::string name;
+    pid_t pid = -1;
+    ProcessSample start;
+    uint64_t signals = 0;
+    uint64_t startSignals = 0;
+};
+
+static std::optional<ProcessSample> sampleProcess(pid_t pid)
+{
+    ProcessSample sample;
+    std::string base = "/proc/" + std::to_string(pid);
+    std::ifstream stat(base + "/stat");
+    std::string line;
+    if (!std::getline(stat, line))
+    {
+        return std::nullopt;
+    }
+    // the command may contain spaces, fields are counted from its end
+    size_t close = line.rfind(')');
+    if (close == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    std::istringstream fields(line.substr(close + 2));
+    std::string field;
+    for (size_t index = 3; fields >> field; index++)
+    {
+        if (index == 14 || index == 15) // utime, stime
+        {
+            sample.cpuTicks += std::stoull(field);
+        }
+    }
+
+    std::ifstream status(base + "/status");
+    while (std::getline(status, line))
+    {
+        std::istringstream entry(line);
+        std::string key;
+        uint64_t value = 0;
+        entry >> key >> value;
+        if (key == "VmRSS:")
+        {
+            sample.rssKb = value;
+        }
+        else if (key == "VmHWM:")
+        {
+            sample.peakRssKb = value;
+        }
+        else if (key == "voluntary_ctxt_switches:" ||
+                 key == "nonvoluntary_ctxt_switches:")
+        {
+            sample.contextSwitches += value;
+        }
+    }
+    return sample;
+}
+
+static std::string hexAddress(size_t address)
+{
+    std::ostringstream hex;
+    hex << std::hex << std::setw(4) << std::setfill('0') << address;
+    return hex.str();
+}
+
+class FakeHwmonTree
+{
+  public:
+    FakeHwmonTree(const Options& options) : options(options)
+    {
+        std::string dirTemplate =
+            (fs::temp_directory_path() / "load-hwmon-XXXXXX").string();
+        if (mkdtemp(dirTemplate.data()) == nullptr)
+        {
+            throw std::runtime_error("Unable to create the fake hwmon tree");
+        }
+        root = dirTemplate;
+        size_t hwmonIndex = 0;
+        for (const DeviceKind& kind : deviceKinds)
+        {
+            for (size_t device = 0; device < options.devices; device++)
+            {
+                createDevice(kind, device, hwmonIndex++);
+            }
+        }
+    }
+    ~FakeHwmonTree()
+    {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    FakeHwmonTree(const FakeHwmonTree&) = delete;
+    FakeHwmonTree& operator=(const FakeHwmonTree&) = delete;
+
+    fs::path hwmonRoot(void) const
+    {
+        return root / "class" / "hwmon";
+    }
+
+    // moves every reading along a sine, each channel at its own phase
+    void update(void)
+    {
+        step++;
+        for (size_t index = 0; index < inputs.size(); index++)
+        {
+            const DeviceKind& kind = *inputs[index].first;
+            double phase = static_cast<double>(step + index) / 10.0;
+            int64_t offset = static_cast<int64_t>(
+                static_cast<double>(kind.swing) * std::sin(phase));
+            // rewritten in place, the daemons keep their files open
+            std::ofstream(inputs[index].second, std::ios::trunc)
+                << kind.base + offset << "\n";
+        }
+    }
+
+    static size_t busOf(const DeviceKind& kind, size_t device)
+    {
+        return kind.bus + device / 100;
+    }
+
+    static size_t addressOf(size_t device)
+    {
+        return 0x10 + device % 100;
+    }
+
+    fs::path root;
+
+  private:
+    void createDevice(const DeviceKind& kind, size_t device,
+                      size_t hwmonIndex)
+    {
+        size_t bus = busOf(kind, device);
+        fs::path devicePath =
+            root / "devices" / ("i2c-" + std::to_string(bus)) /
+            (std::to_string(bus) + "-" + hexAddress(addressOf(device)));
+        fs::path directory = devicePath / "hwmon" /
+                             ("hwmon" + std::to_string(hwmonIndex));
+        fs::create_directories(directory);
+        fs::create_directories(hwmonRoot());
+        fs::create_directory_symlink(directory,
+                                     hwmonRoot() / directory.filename());
+        fs::create_directory_symlink(devicePath, directory / "device");
+        std::ofstream(directory / "name") << kind.driver << "\n";
+
+        for (size_t channel = 1; channel <= options.channels; channel++)
+        {
+            std::string prefix = kind.attribute + std::to_string(channel);
+            fs::path input = directory / (prefix + "_input");
+            std::ofstream(input) << kind.base << "\n";
+            inputs.emplace_back(&kind, input);
+            if (kind.attribute == std::string("in"))
+            {
+                std::ofstream(directory / (prefix + "_label"))
+                    << "vout" << channel << "\n";
+            }
+        }
+    }
+
+    const Options& options;
+    std::vector<std::pair<const DeviceKind*, fs::path>> inputs;
+    uint64_t step = 0;
+};
+
+// the Entity Manager exposes for the fake tree
+static void addConfigurations(sdbusplus::asio::object_server& objectServer,
+                              const Options& options)
+{
+    for (const DeviceKind& kind : deviceKinds)
+    {
+        std::string type = configInterface + std::string(kind.configType);
+        double thresholdValue =
+            static_cast<double>(kind.base + kind.swing * 9 / 10) / kind.scale;
+        for (size_t device = 0; device < options.devices; device++)
+        {
+            std::string name = std::string("Load ") + kind.configType + " " +
+                               std::to_string(device);
+            std::string path = std::string(configPath) + "/" +
+                               sensor_paths::escapePathForDbus(name);
+            size_t bus = FakeHwmonTree::busOf(kind, device);
+            uint64_t address = FakeHwmonTree::addressOf(device);
+
+            for (size_t channel = 1; channel <= options.channels; channel++)
+            {
+                // fans are matched per channel, the others per device
+                bool perChannel = kind.configType == std::string("I2CFan");
+                if (!perChannel && channel > 1)
+                {
+                    break;
+                }
+                std::string objectPath =
+                    perChannel ? path + "_" + std::to_string(channel) : path;
+                std::string sensorName =
+                    perChannel ? name + " Fan " + std::to_string(channel)
+                               : name;
+                std::shared_ptr<sdbusplus::asio::dbus_interface> iface =
+                    objectServer.add_interface(objectPath, type);
+                iface->register_property("Name", sensorName);
+                iface->register_property("Type", std::string(kind.configType));
+                iface->register_property("Bus", static_cast<uint64_t>(bus));
+                iface->register_property("Address", address);
+                iface->register_property("PowerState", std::string("Always"));
+                if (perChannel)
+                {
+                    iface->register_property(
+                        "Index", static_cast<uint64_t>(channel - 1));
+                }
+                else if (kind.attribute == std::string("in"))
+                {
+                    for (size_t label = 1;
+                         label <= std::min(options.channels, psuLabels);
+                         label++)
+                    {
+                        iface->register_property(
+                            "vout" + std::to_string(label) + "_Name",
+                            name + " Vout" + std::to_string(label));
+                    }
+                }
+                else
+                {
+                    for (size_t label = 1; label < options.channels; label++)
+                    {
+                        iface->register_property(
+                            "Name" + std::to_string(label),
+                            name + " Temp" + std::to_string(label + 1));
+                    }
+                }
+                iface->initialize();
+
+                std::shared_ptr<sdbusplus::asio::dbus_interface> threshold =
+                    objectServer.add_interface(objectPath,
+                                               type + ".Thresholds0");
+                threshold->register_property("Direction",
+                                             std::string("greater than"));
+                threshold->register_property("Name", std::string("upper"));
+                threshold->register_property("Severity", uint64_t(0));
+                // crossed at the top of the swing only
+                threshold->register_property("Value", thresholdValue);
+                threshold->initialize();
+            }
+        }
+    }
+}
+
+// enough of the mapper for association lookups to succeed
+static void addMapper(sdbusplus::asio::object_server& objectServer)
+{
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface =
+        objectServer.add_interface(mapper::path, mapper::interface);
+    iface->register_method("GetSubTreePaths",
+                           [](const std::string&, int32_t,
+                              const std::vector<std::string>&) {
+                               return std::vector<std::string>();
+                           });
+    iface->register_method("GetSubTree", [](const std::string&, int32_t,
+                                            const std::vector<std::string>&) {
+        return GetSubTreeType();
+    });
+    iface->initialize();
+}
+
+static pid_t spawn(const std::vector<std::string>& argv,
+                   const fs::path& logFile)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+    {
+        return pid;
+    }
+    int log = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0)
+    {
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        close(log);
+    }
+    std::vector<char*> args;
+    for (const std::string& arg : argv)
+    {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+    execv(args[0], args.data());
+    std::perror(args[0]);
+    _exit(127);
+}
+
+static fs::path startBus(const fs::path& root, pid_t& busPid)
+{
+    fs::path socket = root / "system_bus_socket";
+    fs::path config = root / "bus.conf";
+    std::ofstream(config)
+        << "<!DOCTYPE busconfig PUBLIC "
+           "\"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\" "
+           "\"http://www.freedesktop.org/standard/dbus/1.0/"
+           "busconfig.dtd\">\n"
+           "<busconfig>\n"
+           "  <type>system</type>\n"
+           "  <listen>unix:path="
+        << socket.string()
+        << "</listen>\n"
+           "  <auth>EXTERNAL</auth>\n"
+           "  <policy context=\"default\">\n"
+           "    <allow user=\"*\"/>\n"
+           "    <allow own=\"*\"/>\n"
+           "    <allow send_type=\"method_call\"/>\n"
+           "    <allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+           "    <allow eavesdrop=\"true\"/>\n"
+           "  </policy>\n"
+           "</busconfig>\n";
+    const char* dbusDaemon = std::getenv("DBUS_DAEMON");
+    busPid = spawn({dbusDaemon != nullptr ? dbusDaemon : "/usr/bin/dbus-daemon",
+                    "--nofork", "--config-file=" + config.string()},
+                   root / "dbus-daemon.log");
+    for (int retry = 0; retry < 100 && !fs::exists(socket); retry++)
+    {
+        usleep(50000);
+    }
+    if (!fs::exists(socket))
+    {
+        throw std::runtime_error("dbus-daemon did not come up, see " +
+                                 (root / "dbus-daemon.log").string());
+    }
+    return socket;
+}
+
+static void report(const std::vector<Daemon>& daemons,
+                   std::chrono::steady_clock::duration elapsed)
+{
+    double seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
+            .count();
+    double ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+    std::cout << std::left << std::setw(20) << "daemon" << std::right
+              << std::setw(10) << "cpu %" << std::setw(12) << "wakeups/s"
+              << std::setw(12) << "rss KiB" << std::setw(12) << "peak KiB"
+              << std::setw(12) << "signals/s" << "\n";
+    for (const Daemon& daemon : daemons)
+    {
+        std::optional<ProcessSample> end = sampleProcess(daemon.pid);
+        if (!end)
+        {
+            std::cout << std::left << std::setw(20) << daemon.name
+                      << " exited\n";
+            continue;
+        }
+        double cpu = static_cast<double>(end->cpuTicks -
+                                         daemon.start.cpuTicks) /
+                     ticks / seconds * 100;
+        double wakeups = static_cast<double>(end->contextSwitches -
+                                             daemon.start.contextSwitches) /
+                         seconds;
+        double signals =
+            static_cast<double>(daemon.signals - daemon.startSignals) /
+            seconds;
+        std::cout << std::left << std::setw(20) << daemon.name << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(10)
+                  << cpu << std::setw(12) << wakeups << std::setw(12)
+                  << end->rssKb << std::setw(12) << end->peakRssKb
+                  << std::setw(12) << signals << "\n";
+    }
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "n:m:u:w:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                options.devices = std::stoul(optarg);
+                break;
+            case 'm':
+                options.channels = std::stoul(optarg);
+                break;
+            case 'u':
+                options.update = std::chrono::milliseconds(std::stoul(optarg));
+                break;
+            case 'w':
+                options.warmup = std::chrono::seconds(std::stoul(optarg));
+                break;
+            case 't':
+                options.duration = std::chrono::seconds(std::stoul(optarg));
+                break;
+            default:
+                return false;
+        }
+    }
+    for (int index = optind; index < argc; index++)
+    {
+        options.daemons.emplace_back(argv[index]);
+    }
+    return !options.daemons.empty() && options.devices > 0 &&
+           options.channels > 0 && options.update.count() > 0;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " [-n devices] [-m channels] [-u update-ms]"
+                     " [-w warmup-s] [-t duration-s] daemon...\n";
+        return 1;
+    }
+
+    FakeHwmonTree tree(options);
+    pid_t busPid = -1;
+    fs::path socket = startBus(tree.root, busPid);
+    std::string address = "unix:path=" + socket.string();
+    setenv("DBUS_SYSTEM_BUS_ADDRESS", address.c_str(), 1);
+    setenv("SENSOR_HWMON_ROOT", tree.hwmonRoot().c_str(), 1);
+
+    boost::asio::io_service io;
+    auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
+    sdbusplus::asio::object_server objectServer(systemBus);
+    addConfigurations(objectServer, options);
+    addMapper(objectServer);
+    systemBus->request_name(entityManagerName);
+    systemBus->request_name(mapper::busName);
+
+    std::vector<Daemon> daemons;
+    for (const std::string& path : options.daemons)
+    {
+        Daemon& daemon = daemons.emplace_back();
+        daemon.name = fs::path(path).filename().string();
+        daemon.pid = spawn({path}, tree.root / (daemon.name + ".log"));
+    }
+
+    // signals are attributed to the daemons by the sender's process
+    boost::container::flat_map<std::string, Daemon*> senders;
+    sdbusplus::bus::match::match propertiesChanged(
+        static_cast<sdbusplus::bus::bus&>(*systemBus),
+        "type='signal',interface='org.freedesktop.DBus.Properties',"
+        "member='PropertiesChanged'",
+        [&systemBus, &daemons, &senders](sdbusplus::message::message& msg) {
+            std::string sender = msg.get_sender();
+            auto findSender = senders.find(sender);
+            if (findSender == senders.end())
+            {
+                Daemon* match = nullptr;
+                try
+                {
+                    sdbusplus::message::message call =
+                        systemBus->new_method_call(
+                            "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                            "org.freedesktop.DBus",
+                            "GetConnectionUnixProcessID");
+                    call.append(sender);
+                    uint32_t pid = 0;
+                    systemBus->call(call).read(pid);
+                    for (Daemon& daemon : daemons)
+                    {
+                        if (daemon.pid == static_cast<pid_t>(pid))
+                        {
+                            match = &daemon;
+                        }
+                    }
+                }
+                catch (const sdbusplus::exception::exception&)
+                {}
+                findSender = senders.emplace(sender, match).first;
+            }
+            if (findSender->second != nullptr)
+            {
+                findSender->second->signals++;
+            }
+        });
+
+    boost::asio::steady_timer updateTimer(io);
+    std::function<void(void)> update = [&]() {
+        tree.update();
+        updateTimer.expires_after(options.update);
+        updateTimer.async_wait([&](const boost::system::error_code& ec) {
+            if (!ec)
+            {
+                update();
+            }
+        });
+    };
+    update();
+
+    std::cout << "Started " << daemons.size() << " daemons against "
+              << options.devices << " devices of " << options.channels
+              << " channels per kind, warming up for "
+              << options.warmup.count() << "s\n";
+
+    std::chrono::steady_clock::time_point measureStart;
+    boost::asio::steady_timer phaseTimer(io);
+    phaseTimer.expires_after(options.warmup);
+    phaseTimer.async_wait([&](const boost::system::error_code& ec) {
+        if (ec)
+        {
+            return;
+        }
+        measureStart = std::chrono::steady_clock::now();
+        for (Daemon& daemon : daemons)
+        {
+            daemon.start =
+                sampleProcess(daemon.pid).value_or(ProcessSample());
+            daemon.startSignals = daemon.signals;
+        }
+        phaseTimer.expires_after(options.duration);
+        phaseTimer.async_wait([&](const boost::system::error_code& ec) {
+            if (ec)
+            {
+                return;
+            }
+            report(daemons, std::chrono::steady_clock::now() - measureStart);
+            io.stop();
+        });
+    });
+
+    boost::asio::signal_set interrupt(io, SIGINT, SIGTERM);
+    interrupt.async_wait(
+        [&io](const boost::system::error_code&, int) { io.stop(); });
+
+    io.run();
+
+    for (const Daemon& daemon : daemons)
+    {
+        kill(daemon.pid, SIGTERM);
+        waitpid(daemon.pid, nullptr, 0);
+    }
+    kill(busPid, SIGTERM);
+    waitpid(busPid, nullptr, 0);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <ConfigSnapshot.hpp>
+#include <Utils.hpp>
+
+#include <boost/container/flat_set.hpp>
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static ManagedObjectType sampleConfiguration(void)
+{
+    ManagedObjectType config;
+    SensorBaseConfigMap& tmp75 =
+        config[sdbusplus::message::object_path(
+            "/xyz/openbmc_project/inventory/system/board/A/Inlet")]
+              ["xyz.openbmc_project.Configuration.TMP75"];
+    tmp75["Name"] = std::string("Inlet");
+    tmp75["Bus"] = uint64_t(7);
+    tmp75["Address"] = std::string("0x48");
+    tmp75["PollRate"] = 0.5;
+    tmp75["Offset"] = int64_t(-3);
+    tmp75["Labels"] = std::vector<std::string>{"temp1", "temp2"};
+
+    SensorBaseConfigMap& threshold =
+        config[sdbusplus::message::object_path(
+            "/xyz/openbmc_project/inventory/system/board/A/Inlet")]
+              ["xyz.openbmc_project.Configuration.TMP75.Thresholds0"];
+    threshold["Value"] = 80.0;
+    threshold["Severity"] = int32_t(1);
+    threshold["Index"] = uint32_t(2);
+    threshold["Hysteresis"] = int16_t(-1);
+    threshold["Mask"] = uint16_t(0xffff);
+    threshold["Direction"] = uint8_t(3);
+    threshold["Enabled"] = true;
+
+    config[sdbusplus::message::object_path(
+        "/xyz/openbmc_project/inventory/system/board/B/Empty")];
+    return config;
+}
+
+TEST(ConfigSnapshot, RoundTripsEveryValueType)
+{
+    ManagedObjectType config = sampleConfiguration();
+    std::string encoded = config_snapshot::serialize(config);
+
+    ManagedObjectType decoded;
+    ASSERT_TRUE(config_snapshot::deserialize(encoded, decoded));
+    EXPECT_EQ(decoded, config);
+}
+
+TEST(ConfigSnapshot, RoundTripsAnEmptyConfiguration)
+{
+    ManagedObjectType decoded;
+    ASSERT_TRUE(config_snapshot::deserialize(
+        config_snapshot::serialize(ManagedObjectType()), decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST(ConfigSnapshot, RejectsTruncatedInput)
+{
+    std::string encoded = config_snapshot::serialize(sampleConfiguration());
+    // every proper prefix is cut off somewhere in the middle
+    for (size_t size = 0; size < encoded.size(); size++)
+    {
+        ManagedObjectType decoded;
+        EXPECT_FALSE(config_snapshot::deserialize(
+            std::string_view(encoded.data(), size), decoded))
+            << "prefix of " << size << " bytes";
+    }
+}
+
+TEST(ConfigSnapshot, RejectsTrailingBytes)
+{
+    std::string encoded = config_snapshot::serialize(sampleConfiguration());
+    encoded.push_back('\0');
+    ManagedObjectType decoded;
+    EXPECT_FALSE(config_snapshot::deserialize(encoded, decoded));
+}
+
+TEST(ConfigSnapshot, RejectsUnknownValueTypes)
+{
+    ManagedObjectType config;
+    config[sdbusplus::message::object_path("/a")]["b"]["c"] = true;
+    std::string encoded = config_snapshot::serialize(config);
+    // the bool is one byte after its one byte type index at the very end
+    ASSERT_GE(encoded.size(), 2U);
+    encoded[encoded.size() - 2] =
+        static_cast<char>(std::variant_size_v<BasicVariantType>);
+    ManagedObjectType decoded;
+    EXPECT_FALSE(config_snapshot::deserialize(encoded, decoded));
+}
+
+TEST(ConfigSnapshot, ReportsChangedObjects)
+{
+    ConfigSnapshot snapshot("test", {"xyz.openbmc_project.Configuration.A"});
+    ManagedObjectType config = sampleConfiguration();
+    boost::container::flat_set<std::string> changed;
+    snapshot.update(config, changed);
+    EXPECT_EQ(changed.size(), 2U);
+
+    // nothing changed, nothing to report
+    changed.clear();
+    snapshot.update(config, changed);
+    EXPECT_TRUE(changed.empty());
+
+    // one modified, one removed, one added
+    ManagedObjectType updated = config;
+    updated.erase(sdbusplus::message::object_path(
+        "/xyz/openbmc_project/inventory/system/board/B/Empty"));
+    updated[sdbusplus::message::object_path(
+        "/xyz/openbmc_project/inventory/system/board/A/Inlet")]
+           ["xyz.openbmc_project.Configuration.TMP75"]["PollRate"] = 1.0;
+    updated[sdbusplus::message::object_path(
+        "/xyz/openbmc_project/inventory/system/board/C/New")];
+    snapshot.update(updated, changed);
+    EXPECT_EQ(changed,
+              (boost::container::flat_set<std::string>{
+                  "/xyz/openbmc_project/inventory/system/board/A/Inlet",
+                  "/xyz/openbmc_project/inventory/system/board/B/Empty",
+                  "/xyz/openbmc_project/inventory/system/board/C/New"}));
+}
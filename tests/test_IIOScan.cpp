@@ -0,0 +1,91 @@
+#include <IIOScan.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(IIOScan, ParsesScanTypes)
+{
+    iio::ScanElement element;
+    ASSERT_TRUE(iio::parseScanType("le:u12/16>>0", element));
+    EXPECT_EQ(element.storageBytes, 2U);
+    EXPECT_EQ(element.bits, 12U);
+    EXPECT_EQ(element.shift, 0U);
+    EXPECT_FALSE(element.isSigned);
+    EXPECT_FALSE(element.bigEndian);
+
+    ASSERT_TRUE(iio::parseScanType("be:s24/32>>8", element));
+    EXPECT_EQ(element.storageBytes, 4U);
+    EXPECT_EQ(element.bits, 24U);
+    EXPECT_EQ(element.shift, 8U);
+    EXPECT_TRUE(element.isSigned);
+    EXPECT_TRUE(element.bigEndian);
+}
+
+TEST(IIOScan, RejectsUnsupportedScanTypes)
+{
+    iio::ScanElement element;
+    EXPECT_FALSE(iio::parseScanType("", element));
+    EXPECT_FALSE(iio::parseScanType("le:u12/16", element));
+    EXPECT_FALSE(iio::parseScanType("le:u12/12>>0", element));
+    EXPECT_FALSE(iio::parseScanType("le:u12/128>>0", element));
+    EXPECT_FALSE(iio::parseScanType("le:u0/16>>0", element));
+    EXPECT_FALSE(iio::parseScanType("le:u12/16>>8", element));
+    EXPECT_FALSE(iio::parseScanType("xe:u12/16>>0", element));
+    EXPECT_FALSE(iio::parseScanType("le:f12/16>>0", element));
+}
+
+TEST(IIOScan, LaysOutElementsByIndexAligned)
+{
+    std::vector<iio::ScanElement> elements(3);
+    elements[0].scanIndex = 2;
+    elements[0].storageBytes = 2;
+    elements[1].scanIndex = 0;
+    elements[1].storageBytes = 1;
+    elements[2].scanIndex = 1;
+    elements[2].storageBytes = 4;
+
+    // 1 byte at 0, padded to 4 bytes at 4, 2 bytes at 8, padded to 12
+    EXPECT_EQ(iio::layoutScan(elements), 12U);
+    EXPECT_EQ(elements[0].scanIndex, 0U);
+    EXPECT_EQ(elements[0].offset, 0U);
+    EXPECT_EQ(elements[1].scanIndex, 1U);
+    EXPECT_EQ(elements[1].offset, 4U);
+    EXPECT_EQ(elements[2].scanIndex, 2U);
+    EXPECT_EQ(elements[2].offset, 8U);
+}
+
+TEST(IIOScan, DecodesEndiannessShiftAndScale)
+{
+    iio::ScanElement little;
+    ASSERT_TRUE(iio::parseScanType("le:u12/16>>0", little));
+    little.scale = 0.5;
+    // 0xabc with the unused top bits set, which are masked off
+    std::vector<uint8_t> scan = {0xbc, 0xfa};
+    EXPECT_DOUBLE_EQ(iio::decode(little, scan.data()), 0xabc * 0.5);
+
+    iio::ScanElement big;
+    ASSERT_TRUE(iio::parseScanType("be:u10/16>>4", big));
+    big.offset = 2;
+    big.rawOffset = 1;
+    scan.push_back(0x12);
+    scan.push_back(0x34);
+    EXPECT_DOUBLE_EQ(iio::decode(big, scan.data()), (0x1234 >> 4) + 1);
+}
+
+TEST(IIOScan, DecodesSignedValues)
+{
+    iio::ScanElement element;
+    ASSERT_TRUE(iio::parseScanType("le:s12/16>>0", element));
+    std::vector<uint8_t> scan = {0xff, 0x0f};
+    EXPECT_DOUBLE_EQ(iio::decode(element, scan.data()), -1.0);
+    scan = {0x00, 0x08};
+    EXPECT_DOUBLE_EQ(iio::decode(element, scan.data()), -2048.0);
+    scan = {0xff, 0x07};
+    EXPECT_DOUBLE_EQ(iio::decode(element, scan.data()), 2047.0);
+
+    ASSERT_TRUE(iio::parseScanType("be:s64/64>>0", element));
+    scan = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe};
+    EXPECT_DOUBLE_EQ(iio::decode(element, scan.data()), -2.0);
+}
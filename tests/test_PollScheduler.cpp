@@ -0,0 +1,148 @@
+#include <PollScheduler.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <chrono>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static boost::asio::io_service io;
+
+// run() returns once no rate bucket is left with a timer pending
+static void runUntilIdle(void)
+{
+    io.restart();
+    io.run();
+}
+
+TEST(PollScheduler, SharedBucketTicksEveryPoller)
+{
+    PollHandle first;
+    PollHandle second;
+    int firstTicks = 0;
+    int secondTicks = 0;
+    first.start(io, 5, [&]() {
+        if (++firstTicks == 3)
+        {
+            first.reset();
+        }
+    });
+    second.start(io, 5, [&]() {
+        if (++secondTicks == 5)
+        {
+            second.reset();
+        }
+    });
+    runUntilIdle();
+    EXPECT_EQ(firstTicks, 3);
+    EXPECT_EQ(secondTicks, 5);
+}
+
+TEST(PollScheduler, SetIntervalMovesToAnotherBucket)
+{
+    PollHandle handle;
+    std::vector<std::chrono::steady_clock::time_point> ticks;
+    handle.start(io, 5, [&]() {
+        ticks.push_back(std::chrono::steady_clock::now());
+        if (ticks.size() == 2)
+        {
+            handle.setInterval(30);
+        }
+        else if (ticks.size() == 4)
+        {
+            handle.reset();
+        }
+    });
+    EXPECT_EQ(handle.getInterval(), 5U);
+    // the 5 ms bucket is dropped once its last poller moved, otherwise
+    // run() wouldn't return
+    runUntilIdle();
+    ASSERT_EQ(ticks.size(), 4U);
+    // the new bucket keeps its cadence from the move on
+    EXPECT_GE(ticks[2] - ticks[1], std::chrono::milliseconds(30));
+    EXPECT_GE(ticks[3] - ticks[1], std::chrono::milliseconds(60));
+}
+
+TEST(PollScheduler, SetIntervalToTheSameBucketKeepsTheEntry)
+{
+    PollHandle handle;
+    int ticks = 0;
+    handle.start(io, 5, [&]() {
+        handle.setInterval(5);
+        if (++ticks == 3)
+        {
+            handle.reset();
+        }
+    });
+    runUntilIdle();
+    EXPECT_EQ(ticks, 3);
+}
+
+TEST(PollScheduler, PausedPollersLeaveTheirBucket)
+{
+    PollHandle handle;
+    int ticks = 0;
+    handle.setPaused(true);
+    handle.start(io, 5, [&]() { ticks++; });
+    EXPECT_TRUE(handle.active());
+    // nothing in any bucket while paused
+    runUntilIdle();
+    EXPECT_EQ(ticks, 0);
+
+    // the interval of a paused poller applies once it is resumed
+    handle.setInterval(10);
+    PollHandle stopper;
+    stopper.start(io, 10, [&]() {
+        if (ticks >= 2)
+        {
+            handle.reset();
+            stopper.reset();
+        }
+    });
+    handle.setPaused(false);
+    EXPECT_EQ(handle.getInterval(), 10U);
+    runUntilIdle();
+    EXPECT_GE(ticks, 2);
+    EXPECT_FALSE(handle.active());
+}
+
+TEST(PollScheduler, PollersAddedWithinATickWaitForTheNextOne)
+{
+    PollHandle first;
+    PollHandle added;
+    int firstTicks = 0;
+    int addedTicks = 0;
+    first.start(io, 5, [&]() {
+        firstTicks++;
+        if (firstTicks == 1)
+        {
+            added.start(io, 5, [&]() { addedTicks++; });
+        }
+        else if (firstTicks == 3)
+        {
+            first.reset();
+            added.reset();
+        }
+    });
+    runUntilIdle();
+    EXPECT_EQ(firstTicks, 3);
+    // added during the first tick, ticked with the second one
+    EXPECT_EQ(addedTicks, 1);
+}
+
+TEST(PollScheduler, EveryIoServiceHasItsOwnScheduler)
+{
+    boost::asio::io_service other;
+    PollScheduler& scheduler = PollScheduler::getInstance(other);
+    EXPECT_EQ(&PollScheduler::getInstance(other), &scheduler);
+    EXPECT_NE(&PollScheduler::getInstance(io), &scheduler);
+
+    // the bucket timer goes away with other, not at exit
+    PollHandle handle;
+    int ticks = 0;
+    handle.start(other, 5, [&]() { ticks++; });
+    other.run_one();
+    EXPECT_EQ(ticks, 1);
+    handle.reset();
+}
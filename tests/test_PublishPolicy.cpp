@@ -0,0 +1,113 @@
+#include "TestSensor.hpp"
+
+#include <SensorDiagnostics.hpp>
+#include <Utils.hpp>
+#include <sensor.hpp>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+class PublishingSensor : public TestSensor
+{
+  public:
+    PublishingSensor() :
+        TestSensor("Publishing Sensor", std::vector<thresholds::Threshold>(),
+                   "/xyz/openbmc_project/inventory/system/board/Publishing",
+                   "xyz.openbmc_project.Configuration.PublishTestSensor", 100,
+                   0)
+    {
+        counters = std::make_unique<SensorCounters>();
+    }
+
+    uint64_t publishes(void) const
+    {
+        return counters->publishes;
+    }
+};
+
+static constexpr double noReading = std::numeric_limits<double>::quiet_NaN();
+
+TEST(PublishPolicy, ParsesTheConfiguration)
+{
+    SensorBaseConfigMap config;
+    config["PublishHysteresis"] = 0.5;
+    config["PublishHysteresisPercent"] = uint64_t(2);
+    config["MaxPublishRate"] = std::string("fast");
+    PublishPolicy policy = getPublishPolicy(config);
+    EXPECT_DOUBLE_EQ(policy.hysteresis, 0.5);
+    EXPECT_DOUBLE_EQ(policy.hysteresisPercent, 2);
+    EXPECT_DOUBLE_EQ(policy.maxRate, 0);
+
+    config["PublishHysteresis"] = -1.0;
+    config["MaxPublishRate"] = std::numeric_limits<double>::infinity();
+    policy = getPublishPolicy(config);
+    EXPECT_DOUBLE_EQ(policy.hysteresis, 0);
+    EXPECT_DOUBLE_EQ(policy.maxRate, 0);
+
+    policy = getPublishPolicy(SensorBaseConfigMap());
+    EXPECT_DOUBLE_EQ(policy.hysteresis, 0);
+    EXPECT_DOUBLE_EQ(policy.hysteresisPercent, 0);
+    EXPECT_DOUBLE_EQ(policy.maxRate, 0);
+}
+
+TEST(PublishPolicy, HysteresisHoldsBackSmallChanges)
+{
+    PublishingSensor sensor;
+    PublishPolicy policy;
+    policy.hysteresis = 1;
+    // 2 % of the range of 100 is the larger of the two
+    policy.hysteresisPercent = 2;
+    sensor.setPublishPolicy(policy);
+
+    sensor.updateValue(50);
+    EXPECT_EQ(sensor.publishes(), 1U);
+    sensor.updateValue(51.5);
+    EXPECT_EQ(sensor.publishes(), 1U);
+    EXPECT_DOUBLE_EQ(sensor.value, 51.5);
+    EXPECT_DOUBLE_EQ(sensor.publishedValue, 50);
+
+    // compared against the published value, not the last reading
+    sensor.updateValue(52.5);
+    EXPECT_EQ(sensor.publishes(), 2U);
+    EXPECT_DOUBLE_EQ(sensor.publishedValue, 52.5);
+
+    sensor.updateValue(noReading);
+    EXPECT_EQ(sensor.publishes(), 3U);
+    EXPECT_TRUE(std::isnan(sensor.publishedValue));
+}
+
+TEST(PublishPolicy, MaxRateHoldsBackFrequentChanges)
+{
+    PublishingSensor sensor;
+    PublishPolicy policy;
+    policy.maxRate = 0.001;
+    sensor.setPublishPolicy(policy);
+
+    sensor.updateValue(10);
+    EXPECT_EQ(sensor.publishes(), 1U);
+    sensor.updateValue(20);
+    EXPECT_EQ(sensor.publishes(), 1U);
+    EXPECT_DOUBLE_EQ(sensor.publishedValue, 10);
+
+    // a sensor going away and coming back always goes out
+    sensor.updateValue(noReading);
+    EXPECT_EQ(sensor.publishes(), 2U);
+    sensor.updateValue(30);
+    EXPECT_EQ(sensor.publishes(), 3U);
+    EXPECT_DOUBLE_EQ(sensor.publishedValue, 30);
+}
+
+TEST(PublishPolicy, NoPolicyPublishesEveryChange)
+{
+    PublishingSensor sensor;
+    sensor.setPublishPolicy(PublishPolicy());
+    sensor.updateValue(10);
+    sensor.updateValue(20);
+    sensor.updateValue(30);
+    EXPECT_EQ(sensor.publishes(), 3U);
+}
@@ -0,0 +1,110 @@
+#include "TestSensor.hpp"
+
+#include <malloc.h>
+
+#include <InternedString.hpp>
+#include <Thresholds.hpp>
+#include <sensor.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// heap bytes in use that were allocated while counting, to tell what a
+// sensor costs beyond its own size
+static std::atomic<bool> counting = false;
+static std::atomic<ptrdiff_t> allocated = 0;
+
+void* operator new(size_t size)
+{
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    if (counting)
+    {
+        allocated += malloc_usable_size(memory);
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    if (counting && memory != nullptr)
+    {
+        allocated -= malloc_usable_size(memory);
+    }
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    operator delete(memory);
+}
+
+class FootprintSensor : public TestSensor
+{
+  public:
+    FootprintSensor(const std::string& name,
+                    const std::string& configurationPath) :
+        TestSensor(name, std::vector<thresholds::Threshold>(),
+                   configurationPath,
+                   "xyz.openbmc_project.Configuration.FootprintTestSensor",
+                   255, 0)
+    {}
+};
+
+TEST(InternedString, SharesEqualContents)
+{
+    size_t before = InternedString::poolSize();
+    {
+        InternedString first("/xyz/openbmc_project/inventory/system/board/A");
+        InternedString second(
+            std::string("/xyz/openbmc_project/inventory/system/board/A"));
+        InternedString other("/xyz/openbmc_project/inventory/system/board/B");
+
+        EXPECT_EQ(&first.str(), &second.str());
+        EXPECT_EQ(first, second);
+        EXPECT_NE(first, other);
+        EXPECT_EQ(InternedString::poolSize(), before + 2);
+    }
+    EXPECT_EQ(InternedString::poolSize(), before);
+}
+
+TEST(SensorFootprint, ConfigurationStringsAreShared)
+{
+    constexpr size_t sensorCount = 200;
+    const std::string configurationPath =
+        "/xyz/openbmc_project/inventory/system/powersupply/"
+        "Footprint_Test_Power_Supply_With_A_Long_Name";
+
+    std::vector<std::unique_ptr<FootprintSensor>> sensors;
+    sensors.reserve(sensorCount);
+    sensors.emplace_back(
+        std::make_unique<FootprintSensor>("S0", configurationPath));
+    size_t poolSize = InternedString::poolSize();
+
+    allocated = 0;
+    counting = true;
+    for (size_t ii = 1; ii < sensorCount; ii++)
+    {
+        sensors.emplace_back(std::make_unique<FootprintSensor>(
+            "S" + std::to_string(ii), configurationPath));
+    }
+    counting = false;
+
+    // the sensors after the first don't add strings of their own
+    EXPECT_EQ(InternedString::poolSize(), poolSize);
+    ptrdiff_t perSensor = allocated / static_cast<ptrdiff_t>(sensorCount - 1);
+    RecordProperty("SensorSize", static_cast<int>(sizeof(Sensor)));
+    RecordProperty("HeapBytesPerSensor", static_cast<int>(perSensor));
+    // nothing but the sensor itself, no copies of the shared strings
+    EXPECT_LT(perSensor, static_cast<ptrdiff_t>(sizeof(FootprintSensor) +
+                                                configurationPath.size()));
+}
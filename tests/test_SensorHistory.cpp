@@ -0,0 +1,97 @@
+#include <SensorHistory.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+// half the resolution of a sample over a range of 0 to 65534
+static constexpr double rounding = 0.5;
+
+TEST(SensorHistory, EncodesTheRangeEnds)
+{
+    auto now = SensorHistory::Clock::now();
+    SensorHistory history(4, 0, 65534, now);
+    history.add(0, now);
+    history.add(65534, now);
+    history.add(32767, now);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, now);
+    EXPECT_EQ(result.samples, 3U);
+    EXPECT_DOUBLE_EQ(result.min, 0);
+    EXPECT_DOUBLE_EQ(result.max, 65534);
+    EXPECT_DOUBLE_EQ(result.average, 32767);
+}
+
+TEST(SensorHistory, RoundsToItsResolution)
+{
+    auto now = SensorHistory::Clock::now();
+    SensorHistory history(4, -40, 125, now);
+    history.add(23.4567, now);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, now);
+    ASSERT_EQ(result.samples, 1U);
+    EXPECT_NEAR(result.min, 23.4567, 165.0 / 65534 * rounding);
+}
+
+TEST(SensorHistory, ClampsValuesOutsideTheRange)
+{
+    auto now = SensorHistory::Clock::now();
+    SensorHistory history(4, 0, 100, now);
+    history.add(-20, now);
+    history.add(250, now);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, now);
+    EXPECT_EQ(result.samples, 2U);
+    EXPECT_DOUBLE_EQ(result.min, 0);
+    EXPECT_DOUBLE_EQ(result.max, 100);
+}
+
+TEST(SensorHistory, LeavesOutNanReadings)
+{
+    auto now = SensorHistory::Clock::now();
+    SensorHistory history(4, 0, 100, now);
+    history.add(std::numeric_limits<double>::quiet_NaN(), now);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, now);
+    EXPECT_EQ(result.samples, 0U);
+    EXPECT_TRUE(std::isnan(result.min));
+    EXPECT_TRUE(std::isnan(result.average));
+    EXPECT_TRUE(std::isnan(result.max));
+
+    history.add(50, now);
+    result = history.aggregate(1s, now);
+    EXPECT_EQ(result.samples, 1U);
+    EXPECT_NEAR(result.average, 50, 100.0 / 65534 * rounding);
+}
+
+TEST(SensorHistory, OnlyAggregatesTheWindow)
+{
+    auto start = SensorHistory::Clock::now();
+    SensorHistory history(8, 0, 100, start);
+    history.add(10, start);
+    history.add(20, start + 1s);
+    history.add(30, start + 2s);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, start + 2s);
+    EXPECT_EQ(result.samples, 2U);
+    EXPECT_NEAR(result.min, 20, 100.0 / 65534 * rounding);
+    EXPECT_NEAR(result.max, 30, 100.0 / 65534 * rounding);
+}
+
+TEST(SensorHistory, OverwritesTheOldestSamples)
+{
+    auto now = SensorHistory::Clock::now();
+    SensorHistory history(2, 0, 100, now);
+    history.add(10, now);
+    history.add(20, now);
+    history.add(30, now);
+
+    SensorHistory::Aggregate result = history.aggregate(1s, now);
+    EXPECT_EQ(result.samples, 2U);
+    EXPECT_NEAR(result.min, 20, 100.0 / 65534 * rounding);
+    EXPECT_NEAR(result.max, 30, 100.0 / 65534 * rounding);
+}
@@ -0,0 +1,55 @@
+#include <Utils.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+TEST(ParseSysfsInteger, ParsesAttributes)
+{
+    int64_t value = 0;
+    EXPECT_TRUE(parseSysfsInteger("42000\n", value));
+    EXPECT_EQ(value, 42000);
+    EXPECT_TRUE(parseSysfsInteger("-1500\n", value));
+    EXPECT_EQ(value, -1500);
+    EXPECT_TRUE(parseSysfsInteger("0", value));
+    EXPECT_EQ(value, 0);
+    // trailing whitespace of any kind
+    EXPECT_TRUE(parseSysfsInteger("7 \t\n", value));
+    EXPECT_EQ(value, 7);
+}
+
+TEST(ParseSysfsInteger, ParsesTheLimits)
+{
+    int64_t value = 0;
+    EXPECT_TRUE(parseSysfsInteger("9223372036854775807\n", value));
+    EXPECT_EQ(value, std::numeric_limits<int64_t>::max());
+    EXPECT_TRUE(parseSysfsInteger("-9223372036854775808\n", value));
+    EXPECT_EQ(value, std::numeric_limits<int64_t>::min());
+}
+
+TEST(ParseSysfsInteger, RejectsMalformedAttributes)
+{
+    int64_t value = 123;
+    EXPECT_FALSE(parseSysfsInteger("", value));
+    EXPECT_FALSE(parseSysfsInteger("\n", value));
+    EXPECT_FALSE(parseSysfsInteger("abc\n", value));
+    EXPECT_FALSE(parseSysfsInteger("12abc\n", value));
+    EXPECT_FALSE(parseSysfsInteger("1 2\n", value));
+    EXPECT_FALSE(parseSysfsInteger("1.5\n", value));
+    EXPECT_FALSE(parseSysfsInteger("+1\n", value));
+    EXPECT_FALSE(parseSysfsInteger(" 1\n", value));
+    EXPECT_FALSE(parseSysfsInteger("9223372036854775808\n", value));
+    // failures leave the value alone
+    EXPECT_EQ(value, 123);
+}
+
+TEST(ParseSysfsInteger, StopsAtTheGivenLength)
+{
+    std::string buffer = "1234";
+    int64_t value = 0;
+    EXPECT_TRUE(parseSysfsInteger(std::string_view(buffer.data(), 2), value));
+    EXPECT_EQ(value, 12);
+}
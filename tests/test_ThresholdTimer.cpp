@@ -0,0 +1,114 @@
+#include "TestSensor.hpp"
+
+#include <Thresholds.hpp>
+#include <sensor.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+class DelayedSensor : public TestSensor
+{
+  public:
+    explicit DelayedSensor(std::vector<thresholds::Threshold>&& thresholds) :
+        TestSensor("Delayed Sensor", std::move(thresholds),
+                   "/xyz/openbmc_project/inventory/system/board/Delayed",
+                   "xyz.openbmc_project.Configuration.DelayedTestSensor", 255,
+                   0)
+    {}
+};
+
+// shared so that the last test can wait for what the others queued
+static boost::asio::io_service io;
+
+TEST(ThresholdTimer, SamplesBelowLowThresholdsShareOneEntryEach)
+{
+    const thresholds::Threshold warningLow(thresholds::Level::WARNING,
+                                           thresholds::Direction::LOW, 10);
+    const thresholds::Threshold criticalLow(thresholds::Level::CRITICAL,
+                                            thresholds::Direction::LOW, 5);
+    DelayedSensor sensor({warningLow, criticalLow});
+    thresholds::ThresholdTimer timer(io, &sensor);
+    size_t queued = timer.pool.size();
+
+    // a sensor polled at 0.5 s reads ten samples within the delay, keep
+    // going well past that
+    sensor.value = 0;
+    for (int sample = 0; sample < 1000; sample++)
+    {
+        thresholds::checkThresholdsPowerDelay(&sensor, timer);
+    }
+    EXPECT_TRUE(timer.hasActiveTimer(warningLow, true));
+    EXPECT_TRUE(timer.hasActiveTimer(criticalLow, true));
+    EXPECT_FALSE(sensor.alarmStates[thresholds::alarmIndex(
+        thresholds::Level::WARNING, thresholds::Direction::LOW)]);
+    // the two pending assertions hold one entry each
+    EXPECT_EQ(timer.pool.size(), queued + 2);
+}
+
+TEST(ThresholdTimerPool, DelaysChangesOfEverySensor)
+{
+    const thresholds::Threshold warningLow(thresholds::Level::WARNING,
+                                           thresholds::Direction::LOW, 10);
+    const thresholds::Threshold criticalLow(thresholds::Level::CRITICAL,
+                                            thresholds::Direction::LOW, 5);
+    // far more changes pending at once than a fixed pool would have held
+    std::vector<std::unique_ptr<DelayedSensor>> sensors;
+    std::vector<std::unique_ptr<thresholds::ThresholdTimer>> timers;
+    for (size_t ii = 0; ii < 1000; ii++)
+    {
+        DelayedSensor& sensor = *sensors.emplace_back(
+            std::make_unique<DelayedSensor>(
+                std::vector<thresholds::Threshold>{warningLow, criticalLow}));
+        thresholds::ThresholdTimer& timer = *timers.emplace_back(
+            std::make_unique<thresholds::ThresholdTimer>(io, &sensor));
+        sensor.value = 0;
+        thresholds::checkThresholdsPowerDelay(&sensor, timer);
+    }
+    for (const auto& timer : timers)
+    {
+        // pending rather than applied right away
+        EXPECT_TRUE(timer->hasActiveTimer(warningLow, true));
+        EXPECT_TRUE(timer->hasActiveTimer(criticalLow, true));
+    }
+    for (const auto& sensor : sensors)
+    {
+        EXPECT_FALSE(sensor->alarmStates[thresholds::alarmIndex(
+            thresholds::Level::CRITICAL, thresholds::Direction::LOW)]);
+    }
+}
+
+TEST(ThresholdTimerPool, IgnoresStoppedChangesOnExpiry)
+{
+    // let whatever the other tests queued expire first
+    io.restart();
+    io.run();
+
+    const thresholds::Threshold warningLow(thresholds::Level::WARNING,
+                                           thresholds::Direction::LOW, 10);
+    const thresholds::Threshold criticalLow(thresholds::Level::CRITICAL,
+                                            thresholds::Direction::LOW, 5);
+    DelayedSensor sensor({warningLow, criticalLow});
+    thresholds::ThresholdTimer timer(io, &sensor);
+    auto start = std::chrono::steady_clock::now();
+    sensor.value = 0;
+    thresholds::checkThresholdsPowerDelay(&sensor, timer);
+    ASSERT_TRUE(timer.hasActiveTimer(warningLow, true));
+    ASSERT_TRUE(timer.hasActiveTimer(criticalLow, true));
+    // the entry of the stopped change stays queued and has to be ignored,
+    // or it would also count down the one started again
+    timer.stopTimer(criticalLow, true);
+    timer.startTimer(criticalLow, true, 0);
+
+    io.restart();
+    io.run();
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              thresholds::ThresholdTimerPool::delay);
+    EXPECT_FALSE(timer.hasActiveTimer(warningLow, true));
+    EXPECT_FALSE(timer.hasActiveTimer(criticalLow, true));
+}